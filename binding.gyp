@@ -0,0 +1,47 @@
+{
+  "targets": [
+    {
+      "target_name": "octopack",
+      "sources": [ "src/native/octopack.cpp", "src/native/octopack_addon.cpp" ],
+      "cflags_cc": [ "-O3", "-std=c++14" ],
+      "xcode_settings": { "OTHER_CPLUSPLUSFLAGS": [ "-O3", "-std=c++14" ] },
+      "msvs_settings": { "VCCLCompilerTool": { "Optimization": 2 } }
+    },
+    {
+      "target_name": "voxelkernels",
+      "sources": [ "src/native/voxelkernels.cpp", "src/native/voxelkernels_addon.cpp" ],
+      "cflags_cc": [ "-O3", "-std=c++14" ],
+      "xcode_settings": { "OTHER_CPLUSPLUSFLAGS": [ "-O3", "-std=c++14" ] },
+      "msvs_settings": { "VCCLCompilerTool": { "Optimization": 2 } }
+    },
+    {
+      "target_name": "vtcore",
+      "sources": [ "src/native/vtcore.cpp", "src/native/vtcore_addon.cpp" ],
+      "cflags_cc": [ "-O3", "-std=c++14" ],
+      "xcode_settings": { "OTHER_CPLUSPLUSFLAGS": [ "-O3", "-std=c++14" ] },
+      "msvs_settings": { "VCCLCompilerTool": { "Optimization": 2 } }
+    },
+    {
+      "target_name": "mmapfile",
+      "sources": [ "src/native/mmapfile_addon.cpp" ],
+      "cflags_cc": [ "-O3", "-std=c++14" ],
+      "xcode_settings": { "OTHER_CPLUSPLUSFLAGS": [ "-O3", "-std=c++14" ] },
+      "msvs_settings": { "VCCLCompilerTool": { "Optimization": 2 } }
+    },
+    {
+      "target_name": "audiofft",
+      "sources": [ "src/native/audiofft.cpp", "src/native/audiofft_addon.cpp" ],
+      "cflags_cc": [ "-O3", "-std=c++14" ],
+      "xcode_settings": { "OTHER_CPLUSPLUSFLAGS": [ "-O3", "-std=c++14" ] },
+      "msvs_settings": { "VCCLCompilerTool": { "Optimization": 2 } }
+    },
+    {
+      "target_name": "octopack_bench",
+      "type": "executable",
+      "sources": [ "src/native/octopack.cpp", "src/native/octopack_bench.cpp" ],
+      "cflags_cc": [ "-O3", "-std=c++14" ],
+      "xcode_settings": { "OTHER_CPLUSPLUSFLAGS": [ "-O3", "-std=c++14" ] },
+      "msvs_settings": { "VCCLCompilerTool": { "Optimization": 2 } }
+    }
+  ]
+}
@@ -56,6 +56,47 @@ class AudioVisualizerAnimator extends VoxelAnimator {
     this.timeSinceLastBeat = 1;
   }
 
+  /**
+   * Fill levels with the audio levels of as many bins, from the lowest frequencies to the highest. Audio analyzed on
+   * the server (see AudioAnalyzer) comes with the levels of its log frequency bands, which are just resampled to fit.
+   * Audio from the controller only has the FFT, its frequencies are distributed over the bins by the config's gamma
+   * and each bin's level is calculated with calcFFTBinLevel.
+   */
+  calcAudioLevels(audioInfo, levels, calcFFTBinLevel=AudioVisualizerAnimator.calcFFTBinLevelMax) {
+    const {fft, bands} = audioInfo;
+    if (bands) {
+      AudioVisualizerAnimator.resampleBandLevels(bands, levels);
+      return;
+    }
+
+    // Build a distribution of what bins to throw each frequency in
+    const {gamma} = this.config;
+    const numFreqs = Math.floor(fft.length/(gamma+1.8));
+    const binIndexLookupKey = `${numFreqs}:${levels.length}:${gamma}`;
+    if (!this.binIndexLookup || this.binIndexLookupKey !== binIndexLookupKey) {
+      this.binIndexLookup = AudioVisualizerAnimator.buildBinIndexLookup(numFreqs, levels.length, gamma);
+      this.binIndexLookupKey = binIndexLookupKey;
+    }
+    for (let i = 0; i < levels.length; i++) {
+      levels[i] = calcFFTBinLevel(this.binIndexLookup[i], fft);
+    }
+  }
+
+  static resampleBandLevels(bands, levels) {
+    const numBands = bands.length;
+    const numLevels = levels.length;
+    for (let i = 0; i < numLevels; i++) {
+      // The loudest of the bands in the level's share of the spectrum, or the band that it's in if it's within one band
+      const start = Math.floor(i*numBands/numLevels);
+      const end = Math.max(start+1, Math.floor((i+1)*numBands/numLevels));
+      let level = 0;
+      for (let j = start; j < end; j++) {
+        level = Math.max(level, bands[j]);
+      }
+      levels[i] = level;
+    }
+  }
+
   static buildBinIndexLookup(numFreqs, numBins, gamma) {
     const binIndexLookup = {};
     for (let i = 0; i < numFreqs; i++) {
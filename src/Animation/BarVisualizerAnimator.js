@@ -159,7 +159,7 @@ class BarVisualizerAnimator extends AudioVisualizerAnimator {
       }
     }
 
-    let temp = this.prevVisTex;
+    const prevVisTex = this.prevVisTex;
     switch (displayMode) {
       case MOVING_HISTORY_BARS_DISPLAY_TYPE:
         this.prevVisTex = gpuKernelMgr.historyBarVisFunc(this.audioHistoryBuffer, this.directionVec, levelMax, fadeFactor, this.levelColours, this.prevVisTex, dt);
@@ -179,7 +179,7 @@ class BarVisualizerAnimator extends AudioVisualizerAnimator {
         }
         break;
     }
-    temp.delete();
+    gpuKernelMgr.texturePool.release(prevVisTex);
 
     framebuffer.setBufferTexture(gpuKernelMgr.renderBarVisualizerAlphaFunc(this.prevVisTex));
   }
@@ -187,16 +187,7 @@ class BarVisualizerAnimator extends AudioVisualizerAnimator {
   setAudioInfo(audioInfo) {
     super.setAudioInfo(audioInfo);
 
-    const {fft} = audioInfo;
-    const {gamma, centerSorted, displayMode} = this.config;
-
-    const numIntensities = displayMode === MOVING_HISTORY_BARS_DISPLAY_TYPE ? this.voxelModel.gridSize : this.audioIntensities.length;
-
-    // Build a distribution of what bins to throw each frequency in
-    const numFreqs = Math.floor(fft.length/(gamma+1.8));
-    if (!this.binIndexLookup || numFreqs !== this.binIndexLookup.length) {
-      this.binIndexLookup = AudioVisualizerAnimator.buildBinIndexLookup(numFreqs, numIntensities, gamma);
-    }
+    const {centerSorted, displayMode} = this.config;
 
     switch (displayMode) {
       case MOVING_HISTORY_BARS_DISPLAY_TYPE: {
@@ -205,12 +196,9 @@ class BarVisualizerAnimator extends AudioVisualizerAnimator {
         const oneOverSpeed = 1.0 / Math.max(1, speed + tempoBeat);
     
         if (this.timeCounter >= oneOverSpeed) {
-          // Create the next audio frame from the FFT data
-          const newAudioFrame = new Array(numIntensities);
-          for (let i = 0; i < numIntensities; i++) {
-            const fftIndices = this.binIndexLookup[i];
-            newAudioFrame[i] = AudioVisualizerAnimator.calcFFTBinLevelMax(fftIndices, fft);
-          }
+          // Create the next audio frame from the audio levels
+          const newAudioFrame = new Array(this.voxelModel.gridSize);
+          this.calcAudioLevels(audioInfo, newAudioFrame);
           const numFrames = Math.min(this.audioHistoryBuffer.length, Math.floor(this.timeCounter/oneOverSpeed));
           for (let i = 0; i < numFrames; i++) {
             this.audioHistoryBuffer.pop();
@@ -219,9 +207,12 @@ class BarVisualizerAnimator extends AudioVisualizerAnimator {
           this.timeCounter -= numFrames * oneOverSpeed;
         }
         else {
-          for (let i = 0; i < numIntensities; i++) {
-            const fftIndices = this.binIndexLookup[i];
-            this.audioHistoryBuffer[0][i] = (AudioVisualizerAnimator.calcFFTBinLevelMax(fftIndices, fft) + this.audioHistoryBuffer[0][i])/2;
+          if (!this.audioLevels || this.audioLevels.length !== this.voxelModel.gridSize) {
+            this.audioLevels = new Array(this.voxelModel.gridSize);
+          }
+          this.calcAudioLevels(audioInfo, this.audioLevels);
+          for (let i = 0; i < this.audioLevels.length; i++) {
+            this.audioHistoryBuffer[0][i] = (this.audioLevels[i] + this.audioHistoryBuffer[0][i])/2;
           }
           this.timeCounter += this.dtAudioFrame;
         }
@@ -230,10 +221,8 @@ class BarVisualizerAnimator extends AudioVisualizerAnimator {
 
       case STATIC_BARS_DISPLAY_TYPE:
       default: {
-        // Throw the audio levels of the distribution into the proper bins
-        Object.keys(this.binIndexLookup).forEach((key, index) => {
-          this.audioIntensities[index] = AudioVisualizerAnimator.calcFFTBinLevelSum(this.binIndexLookup[key], fft);
-        });
+        // Throw the audio levels into the proper bins
+        this.calcAudioLevels(audioInfo, this.audioIntensities, AudioVisualizerAnimator.calcFFTBinLevelSum);
         if (centerSorted) {
           // If the display is center sorted, then we place the highest intensity frequencies in the center of the base of the voxel grid, 
           // then move outwards with the lower ones: Sort all of the frequency bins by their descending intensities.
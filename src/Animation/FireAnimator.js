@@ -71,6 +71,7 @@ class FireAnimator extends AudioVisualizerAnimator {
   }
 
   getType() { return VoxelAnimator.VOXEL_ANIM_FIRE; }
+  isCacheable() { return !this.config.audioVisualizationOn; }
 
   setConfig(c) {
     super.setConfig(c);
@@ -184,21 +185,13 @@ class FireAnimator extends AudioVisualizerAnimator {
     //console.log("AUDIO!");
     super.setAudioInfo(audioInfo);
 
-    const {gamma, levelMax, audioBuoyancyMultiplier, audioCoolingMultiplier, audioTurbulenceMultiplier, buoyancy, cooling, vorticityConfinement} = this.config;
+    const {levelMax, audioBuoyancyMultiplier, audioCoolingMultiplier, audioTurbulenceMultiplier, buoyancy, cooling, vorticityConfinement} = this.config;
     const {fft, spectralCentroid} = audioInfo;
 
-    // Use the FFT array to populate the initialization array for the fire
-    let numFreqs = Math.floor(fft.length/(gamma+1.8));
-
-    // Build a distribution of what bins (i.e., meshes) to throw each frequency in
-    if (!this.binIndexLookup || numFreqs !== this.binIndexLookup.length) {
-      this.binIndexLookup = AudioVisualizerAnimator.buildBinIndexLookup(numFreqs, this.audioIntensitiesArray.length, gamma);
-    }
-
+    // Use the audio levels to populate the initialization array for the fire
+    this.calcAudioLevels(audioInfo, this.audioIntensitiesArray);
     for (let i = 0; i < this.audioIntensitiesArray.length; i++) {
-      const fftIndices = this.binIndexLookup[i];
-      const binLevel = AudioVisualizerAnimator.calcFFTBinLevelMax(fftIndices, fft);
-      this.audioIntensitiesArray[i] = clamp(Math.log10(binLevel)/levelMax, 0, 1);
+      this.audioIntensitiesArray[i] = clamp(Math.log10(this.audioIntensitiesArray[i])/levelMax, 0, 1);
     }
 
     // Update the fluid model levers based on the current audio
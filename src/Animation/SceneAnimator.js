@@ -59,6 +59,8 @@ class SceneAnimator extends VoxelAnimator {
   }
 
   rendersToCPUOnly() { return true; }
+  // Not while crossfading between scenes, the frames of the crossfade depend on the scene before
+  isCacheable() { return this._prevSceneConfig === null; }
 
   async render(dt) {
     const currScene = this._sceneMap[this.config.sceneType];
@@ -93,9 +95,8 @@ class SceneAnimator extends VoxelAnimator {
       this.voxelModel.clear();
       await currScene.render(dt);
 
-      // Now we set the default render framebuffer for the animator and we combine
-      // the two scene framebuffers into it
-      this.voxelModel.setFramebuffer(VoxelModel.GPU_FRAMEBUFFER_IDX_0);
+      // Combine the two scene framebuffers in place, into the current scene's CPU framebuffer
+      this.voxelModel.setFramebuffer(currSceneFBIdx);
       this.voxelModel.drawCombinedFramebuffers(
         currSceneFBIdx, prevSceneFBIdx, 
         {mode: VoxelModel.FB1_ALPHA_FB2_ONE_MINUS_ALPHA, alpha: percentFade}
@@ -1,5 +1,3 @@
-import VoxelConstants from "../VoxelConstants";
-
 export const SCENE_TYPE_SIMPLE  = "Simple";
 export const SCENE_TYPE_SHADOW  = "Shadow";
 export const SCENE_TYPE_FOG     = "Fog";
@@ -18,11 +16,12 @@ const attenuationCtrlOpt = {
   quadratic: {label: "Quadratic Falloff", min:0, max:1, step:0.001},
   linear: {label: "Linear Falloff", min:0, max:1, step:0.001},
 };
-const positionCtrlOpt = {
-  x: {min:0, max:VoxelConstants.VOXEL_GRID_SIZE-1, step:1},
-  y: {min:0, max:VoxelConstants.VOXEL_GRID_SIZE-1, step:1},
-  z: {min:0, max:VoxelConstants.VOXEL_GRID_SIZE-1, step:1},
-};
+// The control options of positions and sizes depend on the [x,y,z] size of the grid
+const positionCtrlOpt = ([xSize, ySize, zSize]) => ({
+  x: {min:0, max:xSize-1, step:1},
+  y: {min:0, max:ySize-1, step:1},
+  z: {min:0, max:zSize-1, step:1},
+});
 
 const simpleSceneDefaultOptions = {
   sphereRadius: 3,
@@ -42,7 +41,7 @@ const simpleSceneDefaultOptions = {
   wallZ: true,
   wallColour: {r:1, g:1, b:1},
 };
-const simpleSceneControlOptions = {
+const simpleSceneControlOptions = () => ({
   sphereRadius: {label: "Sphere Radius", min:0.5, max:5, step:0.25},
   sphereColour: {label: "Sphere Colour"},
   sphereEmission: {label: "Sphere Emission"},
@@ -56,7 +55,7 @@ const simpleSceneControlOptions = {
   wallY: {label: "Show Y-Axis Wall?"},
   wallZ: {label: "Show Z-Axis Wall?"},
   wallColour: {label: "Wall Colour"},
-};
+});
 
 const shadowSceneDefaultOptions = {
   movingBoxSize: {x:5, y:2, z:5},
@@ -66,7 +65,7 @@ const shadowSceneDefaultOptions = {
   pointLightPosition: {x:4, y:0, z:4},
   pointLightAtten: {quadratic:0, linear:0},
 };
-const shadowSceneControlOptions = {
+const shadowSceneControlOptions = (gridSize) => ({
   movingBoxSize: {
     label: "Moving Box Size",
     x: {min:0.5, max:5, step:0.25}, 
@@ -76,9 +75,9 @@ const shadowSceneControlOptions = {
   movingBoxSpeed: {label: "Moving Box Speed", min:0, max:4*Math.PI, step:0.1},
   ambientLightColour: {label: "Ambient Light Colour"},
   pointLightColour: {label: "Point Light Colour"},
-  pointLightPosition: {...positionCtrlOpt, label: "Light Position"},
+  pointLightPosition: {...positionCtrlOpt(gridSize), label: "Light Position"},
   pointLightAtten: {...attenuationCtrlOpt},
-};
+});
 
 const fogSceneDefaultOptions = {
   fogColour: {r:1, g:1, b:1},
@@ -89,7 +88,7 @@ const fogSceneDefaultOptions = {
   spotLightAngles: {inner:25, outer:45},
   spotLightAtten: {quadratic:0.001, linear:0.001}
 };
-const fogSceneControlOptions = {
+const fogSceneControlOptions = () => ({
   fogColour: {label: "Fog Colour"},
   fogScattering: {...fogScatteringCtrlOpt},
   ambientLightColour: {label: "Ambient Light Colour"},
@@ -101,7 +100,7 @@ const fogSceneControlOptions = {
     outer: {label: "Outer (°)", min:45, max:90, step:1},
   },
   spotLightAtten: {...attenuationCtrlOpt, label: "Spot Light Attenuation"},
-};
+});
 
 const godRaySceneDefaultOptions = {
   fogColour: {r:1, g:1, b:1},
@@ -114,19 +113,19 @@ const godRaySceneDefaultOptions = {
   shapeSize: {x:8, y:5, z:5},
   shapeRotationSpd: {x:0, y:0.5*Math.PI, z:0},
 };
-const godRaySceneControlOptions = {
+const godRaySceneControlOptions = ([xSize, ySize, zSize]) => ({
   fogColour: {label: "Fog Colour"},
   fogScattering: {...fogScatteringCtrlOpt},
   pointLightColour: {label: "Point Light Colour"},
-  pointLightPosition: {...positionCtrlOpt, label: "Light Position"},
+  pointLightPosition: {...positionCtrlOpt([xSize, ySize, zSize]), label: "Light Position"},
   pointLightAtten: {...attenuationCtrlOpt, label: "Point Light Attenuation"},
   shapeColour: {label: "Shape Colour"},
   shapeEmission: {label: "Shape Emission"},
   shapeSize: {
     label: "Shape Size",
-    x: {min:1, max:VoxelConstants.VOXEL_GRID_SIZE/2, step:1}, 
-    y: {min:1, max:VoxelConstants.VOXEL_GRID_SIZE/2, step:1}, 
-    z: {min:1, max:VoxelConstants.VOXEL_GRID_SIZE/2, step:1},
+    x: {min:1, max:xSize/2, step:1}, 
+    y: {min:1, max:ySize/2, step:1}, 
+    z: {min:1, max:zSize/2, step:1},
   },
   shapeRotationSpd: {
     label: "Shape Rotation Speed",
@@ -134,8 +133,9 @@ const godRaySceneControlOptions = {
     y: {min:0, max:2*Math.PI, step:0.1},
     z: {min:0, max:2*Math.PI, step:0.1},
   }
-};
+});
 
+// The constraints (control options) of each scene type are made for a grid of a given [x,y,z] size
 export const sceneDefaultOptionsMap = {
   [SCENE_TYPE_SIMPLE]: {options: simpleSceneDefaultOptions, constraints: simpleSceneControlOptions},
   [SCENE_TYPE_SHADOW]: {options: shadowSceneDefaultOptions, constraints: shadowSceneControlOptions},
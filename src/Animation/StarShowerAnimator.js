@@ -1,29 +1,28 @@
 import * as THREE from 'three';
 
-import VoxelConstants from '../VoxelConstants';
-
 import VoxelAnimator from './VoxelAnimator';
 import ShootingStarAnimator from './ShootingStarAnimator';
 import {UniformVector3Randomizer, Vector3DirectionRandomizer, UniformFloatRandomizer, ColourRandomizer} from '../Randomizers';
 
-export const starShowerDefaultConfig = {
-  minSpawnPos: {x: 0, y: 0, z: VoxelConstants.VOXEL_GRID_MAX_IDX},
-  maxSpawnPos: {x: VoxelConstants.VOXEL_GRID_MAX_IDX, y: VoxelConstants.VOXEL_GRID_MAX_IDX, z: VoxelConstants.VOXEL_GRID_MAX_IDX},
+// Default config for a grid of the given [x,y,z] size: the stars fall from across its top
+export const starShowerDefaultConfig = ([xSize, ySize, zSize]) => ({
+  minSpawnPos: {x: 0, y: 0, z: zSize-1},
+  maxSpawnPos: {x: xSize-1, y: ySize-1, z: zSize-1},
   direction: {x: 0, y: 0, z: -1},
   directionVariance: 0,
   speedMin: 3.0,
   speedMax: 8.0,
   colourMin: {r:0, g:1, b:0},
   colourMax: {r:0, g:1, b:1},
-  spawnRate: 10.0*Math.pow(VoxelConstants.VOXEL_GRID_SIZE/8, 2), // Spawn rate in stars / second
-};
+  spawnRate: 10.0*(xSize*ySize)/64, // Spawn rate in stars / second
+});
 
 /**
  * This class can be thought of as a composition of many shooting stars with
  * lots of levers for randomness (where they appear, how fast they move, etc.).
  */
 class StarShowerAnimator extends VoxelAnimator {
-  constructor(voxels, config={...starShowerDefaultConfig}) {
+  constructor(voxels, config=starShowerDefaultConfig([voxels.xSize(), voxels.ySize(), voxels.zSize()])) {
     super(voxels, config);
     this.reset();
   }
@@ -32,13 +32,12 @@ class TextAnimator extends VoxelAnimator {
   rendersToCPUOnly() { return true; }
 
   render(dt) {
-    const {gridSize} = this.voxelModel;
     super.render(dt);
 
     if (!this.font) { return; }
 
     // Split the text up into the number of characters that will fit per line
-    const maxCharsPerLine = gridSize / (this.font.fontDef.width+this.font.letterSpacing);
+    const maxCharsPerLine = this.voxelModel.xSize() / (this.font.fontDef.width+this.font.letterSpacing);
     const textLines = [];
     for (let i = 0; i < this.text.length; i+=maxCharsPerLine) {
       let currTextLine = "";
@@ -49,7 +48,7 @@ class TextAnimator extends VoxelAnimator {
     }
     //console.log(textLines);
 
-    let currY = gridSize-1-this.font.fontDef.height;
+    let currY = this.voxelModel.ySize()-1-this.font.fontDef.height;
     for (let i = 0; i < textLines.length; i++) {
       this.font.setCursor(0,currY);
       this.font.print(textLines[i], this.voxelModel);
@@ -103,10 +102,8 @@ class TinyFont {
   }
 
   _printCharAtPos(c, x, y, voxelModel) {
-    const {gridSize} = voxelModel;
-
     // Don't draw if we're offscreen
-    if (x + this.fontDef.width <= 0 || x > gridSize - 1 || y + this.fontDef.height <= 0 || y > gridSize - 1) { return; }
+    if (x + this.fontDef.width <= 0 || x > voxelModel.xSize() - 1 || y + this.fontDef.height <= 0 || y > voxelModel.ySize() - 1) { return; }
 
     const charCode = (""+c).charCodeAt(0);
     // Make sure the character is available in the font
@@ -136,8 +133,7 @@ class TinyFont {
   }
 
   _drawByteAtPos(x, y, pixels, voxelModel) {
-    const {gridSize} = voxelModel;
-    if (x < 0 || x > gridSize-1) { return; }
+    if (x < 0 || x > voxelModel.xSize()-1) { return; }
 
     // String of 4 bits representing the current column of on/off pixels
     const binPixels = ("0".repeat(this.fontDef.height) + pixels.toString(2)).slice(-this.fontDef.height);
@@ -146,7 +142,7 @@ class TinyFont {
     const black = new THREE.Color(0,0,0);
     for (let i = 0; i < binPixels.length; i++) {
       const currY = y+i;
-      if (currY < 0 || currY > gridSize-1) { continue; }
+      if (currY < 0 || currY > voxelModel.ySize()-1) { continue; }
       currPt.set(x, currY, 0);
       //console.log("Draw point at: " + currPt.x + "," + currPt.y + "," + currPt.z);
       voxelModel.setVoxel(currPt, binPixels[i] === "1" ? this.colour : black);
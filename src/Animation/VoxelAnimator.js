@@ -66,6 +66,9 @@ class VoxelAnimator {
 
   render(dt) {}
   rendersToCPUOnly() { return false; }
+  // Whether the animator's frames depend on nothing but its config (e.g., not on audio), so that they can be cached
+  // and played back (see AnimationCache)
+  isCacheable() { return false; }
 
   reset() {
     this.setPlayCounter(0);
@@ -59,7 +59,7 @@ class VoxelColourAnimator extends VoxelAnimator {
     switch (shapeType) {
       case VOXEL_COLOUR_SHAPE_TYPE_ALL:
       default:
-        this.voxelPositions = VoxelGeometryUtils.voxelIndexList(VoxelConstants.VOXEL_GRID_SIZE);
+        this.voxelPositions = VoxelGeometryUtils.voxelIndexList(this.voxelModel.xSize(), this.voxelModel.ySize(), this.voxelModel.zSize());
         break;
 
       case VOXEL_COLOUR_SHAPE_TYPE_POINT: {
@@ -72,7 +72,7 @@ class VoxelColourAnimator extends VoxelAnimator {
         const {center, radius, fill} = sphereProperties;
         const centerVec3 = new THREE.Vector3(center.x, center.y, center.z);
         this.voxelPositions = VoxelGeometryUtils.voxelSphereList(
-          centerVec3, radius, fill, VoxelGeometryUtils.voxelBoundingBox(VoxelConstants.VOXEL_GRID_SIZE)
+          centerVec3, radius, fill, this.voxelModel.getBoundingBox()
         );
         break;
       }
@@ -87,7 +87,7 @@ class VoxelColourAnimator extends VoxelAnimator {
         );
         const sizeVec3 = new THREE.Vector3(size.x, size.y, size.z);
         this.voxelPositions = VoxelGeometryUtils.voxelBoxList(
-          centerVec3, eulerRot, sizeVec3, fill, VoxelGeometryUtils.voxelBoundingBox(VoxelConstants.VOXEL_GRID_SIZE)
+          centerVec3, eulerRot, sizeVec3, fill, this.voxelModel.getBoundingBox()
         );
         break;
       }
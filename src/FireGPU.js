@@ -34,89 +34,51 @@ class FireGPU extends FluidGPU {
   }
 
   addSource(srcBuffer, dstBuffer, dt) {
-    const temp = dstBuffer;
-    const result = this.gpuManager.addFluidSourceFunc(srcBuffer, dstBuffer, dt);
-    temp.delete();
-    return result;
+    return this.texturePool.replace(dstBuffer, this.gpuManager.addFluidSourceFunc(srcBuffer, dstBuffer, dt));
   }
 
   addBuoyancy(dt) {
-    const temp = this.uvw;
-    this.uvw = this.gpuManager.addBuoyancyFunc(this.T, this.uvw, this.buoyancy * dt);
-    temp.delete();
+    this.uvw = this.texturePool.replace(this.uvw, this.gpuManager.addBuoyancyFunc(this.T, this.uvw, this.buoyancy * dt));
   }
 
   vorticityConfinement(dt) {
-    let temp = this.uvw0;
-    this.uvw0 = this.gpuManager.curlFunc(this.uvw0, this.uvw);
-    temp.delete();
-
-    temp = this.T0;
-    this.T0 = this.gpuManager.vorticityConfinementStep1Func(this.uvw0);
-    temp.delete();
+    const {texturePool} = this;
+    this.uvw0 = texturePool.replace(this.uvw0, this.gpuManager.curlFunc(this.uvw0, this.uvw));
+    this.T0 = texturePool.replace(this.T0, this.gpuManager.vorticityConfinementStep1Func(this.uvw0));
 
     const dt0 = dt * this.vc_eps;
-    temp = this.uvw;
-    this.uvw = this.gpuManager.vorticityConfinementStep2Func(this.uvw, this.T0, this.uvw0, dt0);
-    temp.delete();
+    this.uvw = texturePool.replace(this.uvw, this.gpuManager.vorticityConfinementStep2Func(this.uvw, this.T0, this.uvw0, dt0));
   }
 
   _advectCoolX(x0, x, uuvvww, dt) {
     const dt0 = dt * this.N;
-    const result = this.gpuManager.advectCoolFunc(x0, x, uuvvww, dt0, 1, this.boundaryBuf);
-    x.delete();
-    return result;
+    return this.texturePool.replace(x, this.gpuManager.advectCoolFunc(x0, x, uuvvww, dt0, 1, this.boundaryBuf));
   }
   _advectCoolY(y0, y, uuvvww, dt) {
     const dt0 = dt * this.N;
     const c0 = 1.0 - this.cooling * dt;
-    const result = this.gpuManager.advectCoolFunc(y0, y, uuvvww, dt0, c0, this.boundaryBuf);
-    y.delete();
-    return result;
+    return this.texturePool.replace(y, this.gpuManager.advectCoolFunc(y0, y, uuvvww, dt0, c0, this.boundaryBuf));
   }
 
   diffuse3(dt, numIter = DIFFUSE_PER_FRAME_LOOPS) {
-    let temp = null;
     const a = dt * this.viscosity * this.N * this.N * this.N;
-    for (let l = 0; l < numIter; l++) {
-      temp = this.uvw;
-      this.uvw = this.gpuManager.diffuseStep3Func(this.uvw0, this.uvw, a, this.boundaryBuf);
-      temp.delete();
-    }
+    this.uvw = this.texturePool.iterate(this.uvw, numIter, uvw => this.gpuManager.diffuseStep3Func(this.uvw0, uvw, a, this.boundaryBuf));
   }
   diffuse(x0, x, diff, dt, numIter = DIFFUSE_PER_FRAME_LOOPS) {
-    let temp = null;
-    let result = x;
     const a = dt * diff * this.N * this.N * this.N;
-    for (let l = 0; l < numIter; l++) {
-      temp = result;
-      result = this.gpuManager.diffuseStepFunc(x0, result, a, this.boundaryBuf);
-      temp.delete();
-    }
-    return result;
+    return this.texturePool.iterate(x, numIter, result => this.gpuManager.diffuseStepFunc(x0, result, a, this.boundaryBuf));
   }
 
   advect3(dt) {
     const dt0 = dt*this.N;
-    let temp = this.uvw;
-    this.uvw = this.gpuManager.advect3Func(this.uvw0, this.uvw, dt0, this.boundaryBuf);
-    temp.delete();
+    this.uvw = this.texturePool.replace(this.uvw, this.gpuManager.advect3Func(this.uvw0, this.uvw, dt0, this.boundaryBuf));
   }
 
   project(numIter = PROJECT_PER_FRAME_LOOPS) {
-    let temp = this.uvw0;
-    this.uvw0 = this.gpuManager.projectStep1Func(this.uvw0, this.uvw);
-    temp.delete();
-
-    for (let l = 0; l < numIter; l++) {
-      temp = this.uvw0;
-      this.uvw0 = this.gpuManager.projectStep2Func(this.uvw0);
-      temp.delete();
-    }
-
-    temp = this.uvw;
-    this.uvw = this.gpuManager.projectStep3Func(this.uvw, this.uvw0, this.boundaryBuf);
-    temp.delete();
+    const {texturePool} = this;
+    this.uvw0 = texturePool.replace(this.uvw0, this.gpuManager.projectStep1Func(this.uvw0, this.uvw));
+    this.uvw0 = texturePool.iterate(this.uvw0, numIter, uvw0 => this.gpuManager.projectStep2Func(uvw0));
+    this.uvw = texturePool.replace(this.uvw, this.gpuManager.projectStep3Func(this.uvw, this.uvw0, this.boundaryBuf));
   }
 
   velocityStep(dt) {
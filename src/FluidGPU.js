@@ -7,6 +7,7 @@ class FluidGPU {
     this.N = gridSize;
     this.dx = this.dy = this.dz = 1;
     this.gpuManager = gpuManager;
+    this.texturePool = gpuManager.texturePool;
     this.gpuManager.initFluidKernels(this.N);
 
     // Boundary buffer (non-zero where there are solid obstacles)
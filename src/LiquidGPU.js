@@ -48,129 +48,97 @@ class LiquidGPU extends FluidGPU {
   }
 
   injectSphere(center=[1 + this.N/2, this.N-4, 1 + this.N/2], radius=3) {
-    let temp = this.levelSet;
-    this.levelSet = this.gpuManager.injectLiquidSphere(center, radius, this.levelSet, this.boundaryBuf);
-    temp.delete();
+    this.levelSet = this.texturePool.replace(this.levelSet, this.gpuManager.injectLiquidSphere(center, radius, this.levelSet, this.boundaryBuf));
     this._restartSimulation();
   }
 
   advectLevelSet(dt) {
-    let temp = this.levelSet;
-    this.levelSet = this.gpuManager.advectLiquidLevelSet(dt, this.vel0, this.levelSet, this.boundaryBuf, 1, 1);
-    temp.delete();
+    this.levelSet = this.texturePool.replace(this.levelSet, this.gpuManager.advectLiquidLevelSet(dt, this.vel0, this.levelSet, this.boundaryBuf, 1, 1));
   }
   advectLevelSetRK3(dt) {
+    const {texturePool} = this;
     const phi1 = this.gpuManager.advectLiquidLevelSet(dt, this.vel0, this.levelSet, this.boundaryBuf, 1, 1);
     const phi2 = this.gpuManager.advectLiquidLevelSetOrder2(dt, this.vel0, this.levelSet, phi1, this.boundaryBuf);
-    phi1.delete();
-    let temp = this.levelSet;
-    this.levelSet = this.gpuManager.advectLiquidLevelSetOrder3(dt, this.vel0, this.levelSet, phi2, this.boundaryBuf, this.decay, this.lsAdvectionDamping);
-    temp.delete();
-    phi2.delete();
+    texturePool.release(phi1);
+    this.levelSet = texturePool.replace(this.levelSet,
+      this.gpuManager.advectLiquidLevelSetOrder3(dt, this.vel0, this.levelSet, phi2, this.boundaryBuf, this.decay, this.lsAdvectionDamping));
+    texturePool.release(phi2);
   }
 
   _rkReinitLevelSet(dt, levelSet0, levelSetN) {
+    const {texturePool} = this;
     const levelSetNPlus1 = this.gpuManager.reinitLevelSet(dt, levelSet0, levelSetN, this.boundaryBuf, this.levelSetDamping);
     const levelSetNPlus2 = this.gpuManager.reinitLevelSet(dt, levelSet0, levelSetNPlus1, this.boundaryBuf, this.levelSetDamping);
-    levelSetNPlus1.delete();
+    texturePool.release(levelSetNPlus1);
     const rkLevelSet = this.gpuManager.rungeKuttaLevelSet(levelSetN, levelSetNPlus2, this.boundaryBuf);
-    levelSetNPlus2.delete();
+    texturePool.release(levelSetNPlus2);
     return rkLevelSet;
   }
   reinitLevelSetRK(dt, numIter=REINIT_PER_FRAME_LOOPS) {
     const levelSet0 = this.levelSet;
-    let levelSetN = this._rkReinitLevelSet(dt, levelSet0, levelSet0);
-    let temp = null;
-    for (let i = 0; i < numIter-1; i++) {
-      temp = levelSetN;
-      levelSetN = this._rkReinitLevelSet(dt, levelSet0, levelSetN);
-      temp.delete();
-    }
-    this.levelSet = levelSetN;
-    levelSet0.delete();
+    const levelSetN = this._rkReinitLevelSet(dt, levelSet0, levelSet0);
+    this.levelSet = this.texturePool.iterate(levelSetN, numIter-1, levelSet => this._rkReinitLevelSet(dt, levelSet0, levelSet));
+    this.texturePool.release(levelSet0);
   }
   reinitLevelSetFE(dt, numIter=REINIT_PER_FRAME_LOOPS) {
     const levelSet0 = this.levelSet;
-    let levelSetN = this.gpuManager.reinitLevelSet(dt, levelSet0, levelSet0, this.boundaryBuf, this.levelSetDamping);
-    let temp = null;
-    for (let i = 0; i < numIter-1; i++) {
-      temp = levelSetN;
-      levelSetN = this.gpuManager.reinitLevelSet(dt, levelSet0, levelSetN, this.boundaryBuf, this.levelSetDamping);
-      temp.delete();
-    }
-    this.levelSet = levelSetN;
-    levelSet0.delete();
+    const levelSetN = this.gpuManager.reinitLevelSet(dt, levelSet0, levelSet0, this.boundaryBuf, this.levelSetDamping);
+    this.levelSet = this.texturePool.iterate(levelSetN, numIter-1,
+      levelSet => this.gpuManager.reinitLevelSet(dt, levelSet0, levelSet, this.boundaryBuf, this.levelSetDamping));
+    this.texturePool.release(levelSet0);
   }
 
   advectVelocity(dt) {
-    let temp = this.vel;
-    this.vel = this.gpuManager.advectLiquidVelocity(dt, this.vel0, this.boundaryBuf, this.velAdvectionDamping);
-    temp.delete();
+    this.vel = this.texturePool.replace(this.vel, this.gpuManager.advectLiquidVelocity(dt, this.vel0, this.boundaryBuf, this.velAdvectionDamping));
   }
 
   applyVorticityConfinement(dt) {
-    let temp = this.tempVec3Buf;
-    this.tempVec3Buf = this.gpuManager.applyLiquidVorticity(this.vel, this.boundaryBuf, this.levelSet);
-    temp.delete();
-
-    temp = this.vel;
-    this.vel = this.gpuManager.applyLiquidConfinement(dt, this.confinementScale, this.tempVec3Buf, this.vel, this.boundaryBuf, this.levelSet);
-    temp.delete();
+    const {texturePool} = this;
+    this.tempVec3Buf = texturePool.replace(this.tempVec3Buf, this.gpuManager.applyLiquidVorticity(this.vel, this.boundaryBuf, this.levelSet));
+    this.vel = texturePool.replace(this.vel,
+      this.gpuManager.applyLiquidConfinement(dt, this.confinementScale, this.tempVec3Buf, this.vel, this.boundaryBuf, this.levelSet));
   }
 
   applyExternalForces(dt) {
+    const {texturePool} = this;
     // NOTE: We only apply forces to the liquid (i.e., when levelSet[x][y][z] < this.levelEpsilon)!
     const force = [0,-this.gravity,0];
-    let temp = this.vel;
-    this.vel = this.gpuManager.applyExternalForcesToLiquid(
+    this.vel = texturePool.replace(this.vel, this.gpuManager.applyExternalForcesToLiquid(
       dt, force, this.vel, this.levelSet, this.levelEpsilon, this.boundaryBuf
-    );
-    temp.delete();
+    ));
 
     if (this.forceBlob) {
       const {center, impulseStrength, size} = this.forceBlob;
-      temp = this.vel;
-      this.vel = this.gpuManager.injectForceBlob(center, impulseStrength, size, this.vel, this.boundaryBuf);
-      temp.delete();
+      this.vel = texturePool.replace(this.vel, this.gpuManager.injectForceBlob(center, impulseStrength, size, this.vel, this.boundaryBuf));
       this.forceBlob = null;
     }
   }
 
   computeVelocityDivergence() {
-    let temp = this.tempScalarBuf1;
-    this.tempScalarBuf1 = this.gpuManager.computeLiquidVelDiv(this.vel, this.levelSet, this.levelEpsilon, this.boundaryBuf);
-    temp.delete();
+    this.tempScalarBuf1 = this.texturePool.replace(this.tempScalarBuf1,
+      this.gpuManager.computeLiquidVelDiv(this.vel, this.levelSet, this.levelEpsilon, this.boundaryBuf));
   }
 
   computePressure(numIter=PRESSURE_PER_FRAME_LOOPS) {
     // Set the pressure outside the liquid to zero
-    this.pressure.clear();
-    let temp = null;
-    for (let i = 0; i < numIter; i++) {
-      temp = this.pressure;
-      this.pressure = this.gpuManager.jacobiLiquid(this.pressure, this.tempScalarBuf1, this.boundaryBuf, this.levelSet, this.levelEpsilon);
-      temp.delete();
-    }
+    this.texturePool.clear(this.pressure);
+    this.pressure = this.texturePool.iterate(this.pressure, numIter,
+      pressure => this.gpuManager.jacobiLiquid(pressure, this.tempScalarBuf1, this.boundaryBuf, this.levelSet, this.levelEpsilon));
   }
 
   projectVelocity() {
-    let temp = this.vel0;
-    this.vel0 = this.gpuManager.projectLiquidVelocity(
+    this.vel0 = this.texturePool.replace(this.vel0, this.gpuManager.projectLiquidVelocity(
       this.pressure, this.vel, this.boundaryBuf, this.levelSet, this.levelEpsilon, this.pressureModulation
-    );
-    temp.delete();
+    ));
   }
 
   calcPressureDiff(dt) {
-    let temp = null;
-
-    temp = this.pressureDiff;
-    this.pressureDiff = this.gpuManager.pressureDiff(this.pressure, this.prevPressure);
-    temp.delete();
+    const {texturePool} = this;
+    this.pressureDiff = texturePool.replace(this.pressureDiff, this.gpuManager.pressureDiff(this.pressure, this.prevPressure));
 
     let avg = 0;
     let count = 0;
-    const pDiffArr = this.pressureDiff.toArray();
+    const pDiffArr = texturePool.toArray(this.pressureDiff);
     for (let x = 0; x < pDiffArr.length; x++) {
       for (let y = 0; y < pDiffArr[x].length; y++) {
         for (let z = 0; z < pDiffArr[x][y].length; z++) {
@@ -195,9 +163,7 @@ class LiquidGPU extends FluidGPU {
       this.lsAdvectionDamping = Math.max(0, this.lsAdvectionDamping - dt*1.0);
     }
 
-    temp = this.prevPressure;
-    this.prevPressure = this.pressure.clone();
-    temp.delete();
+    this.prevPressure = texturePool.replace(this.prevPressure, texturePool.clone(this.pressure));
   }
 
   step(dt) {
@@ -0,0 +1,19 @@
+import path from 'path';
+
+/**
+ * Load one of the native addons that node-gyp builds from binding.gyp when running 'npm install'. They're loaded at
+ * runtime from the build directory rather than being bundled by webpack.
+ * @param {String} name - The addon's target name in binding.gyp.
+ * @returns {Object} The addon's exports, or null if it isn't available (callers fall back to JS).
+ */
+export const loadNativeAddon = (name) => {
+  try {
+    if (typeof __non_webpack_require__ === 'function') {
+      return __non_webpack_require__(path.resolve('build/Release/' + name + '.node'));
+    }
+  }
+  catch (err) {
+    console.log("Native addon '" + name + "' isn't available, run 'npm install' to build it.");
+  }
+  return null;
+};
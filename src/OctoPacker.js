@@ -0,0 +1,115 @@
+import {loadNativeAddon} from './NativeAddons';
+
+const NUM_OCTO_PINS = 8;
+const OCTO_ROW_SIZE = NUM_OCTO_PINS*3;
+
+const nativeOctoPack = loadNativeAddon('octopack');
+if (nativeOctoPack) {
+  console.log("Using the native octo packer (" + nativeOctoPack.simdPath() + ").");
+}
+
+/**
+ * Packs the voxel framebuffer into the OctoWS2811 bit-transposed frames that each slave shows as-is.
+ * Slave s drives the x-slices [s*8, s*8+8), one per octo pin, its frame has OCTO_ROW_SIZE bytes for each (z,y)
+ * where byte k of each colour channel holds bit (7-k) of that channel for every pin (pin i in bit i).
+ */
+class OctoPacker {
+
+  static get NUM_OCTO_PINS() { return NUM_OCTO_PINS; }
+  static get OCTO_ROW_SIZE() { return OCTO_ROW_SIZE; }
+  static get isNative() { return nativeOctoPack !== null; }
+
+  static numSlaves(xSize) { return Math.floor(xSize / NUM_OCTO_PINS); }
+  static slaveFrameSize(ySize, zSize) { return ySize*zSize*OCTO_ROW_SIZE; }
+
+  /**
+   * Pack the frame of every slave in one go. Brightness and gamma are applied together: a colour channel c
+   * becomes gammaTable[c*brightness*255] for a Float32Array framebuffer (colours in [0,1]) or gammaTable[c*brightness]
+   * for a Uint8Array framebuffer (colours in [0,255]), clamped to the table.
+   * @param {Float32Array|Uint8Array} framebuffer - Flat voxel colours, voxel (x,y,z) starts at ((x*ySize + y)*zSize + z)*3.
+   * @param {Number} xSize
+   * @param {Number} ySize
+   * @param {Number} zSize
+   * @param {Number} brightness - Brightness multiplier.
+   * @param {Uint8Array} gammaTable - 256 entry gamma correction table.
+   * @param {Buffer|Uint8Array} out - Receives every slave's frame, slave s's frame is at s*(headerSize + frame size) + headerSize.
+   * @param {Number} headerSize - Number of bytes to leave in front of each frame for its packet header.
+   */
+  static packSlaveFrames(framebuffer, xSize, ySize, zSize, brightness, gammaTable, out, headerSize) {
+    if (nativeOctoPack) {
+      nativeOctoPack.packSlaveFrames(framebuffer, xSize, ySize, zSize, brightness, gammaTable, out, headerSize);
+      return;
+    }
+
+    const numRows = ySize*zSize;
+    const xSliceSize = ySize*zSize*3;
+    const outStride = headerSize + OctoPacker.slaveFrameSize(ySize, zSize);
+    const scale = (framebuffer instanceof Float32Array) ? 255*brightness : brightness;
+    const channelValues = new Uint8Array(3*NUM_OCTO_PINS);
+
+    for (let s = 0; s < OctoPacker.numSlaves(xSize); s++) {
+      const slaveStartIdx = s*NUM_OCTO_PINS*xSliceSize;
+      let byteCount = s*outStride + headerSize;
+
+      for (let row = 0; row < numRows; row++) {
+        const y = row % ySize;
+        const z = (row - y) / ySize;
+
+        // Gather the gamma corrected channels of the voxel driven by each of the pins...
+        let voxelIdx = slaveStartIdx + (y*zSize + z)*3;
+        for (let i = 0; i < NUM_OCTO_PINS; i++, voxelIdx += xSliceSize) {
+          for (let c = 0; c < 3; c++) {
+            const value = framebuffer[voxelIdx+c]*scale;
+            channelValues[c*NUM_OCTO_PINS + i] = gammaTable[value >= 255 ? 255 : (value > 0 ? Math.floor(value) : 0)];
+          }
+        }
+
+        // ... and transpose their bits, most significant bit first
+        for (let c = 0; c < 3; c++) {
+          const channelStartIdx = c*NUM_OCTO_PINS;
+          for (let bit = 7; bit >= 0; bit--) {
+            let b = 0;
+            for (let i = 0; i < NUM_OCTO_PINS; i++) {
+              b |= ((channelValues[channelStartIdx + i] >> bit) & 1) << i;
+            }
+            out[byteCount++] = b;
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Pack the frame of every slave as raw colours, for slaves that apply their own colour LUT (gamma, colour correction
+   * and brightness) and do the bit-transposing themselves. Each row has the r,g,b of every pin in turn, Float32Array
+   * colours in [0,1] become bytes in [0,255]. See packSlaveFrames for the arguments.
+   */
+  static packSlaveRawFrames(framebuffer, xSize, ySize, zSize, out, headerSize) {
+    if (nativeOctoPack) {
+      nativeOctoPack.packSlaveRawFrames(framebuffer, xSize, ySize, zSize, out, headerSize);
+      return;
+    }
+
+    const xSliceSize = ySize*zSize*3;
+    const outStride = headerSize + OctoPacker.slaveFrameSize(ySize, zSize);
+    const scale = (framebuffer instanceof Float32Array) ? 255 : 1;
+
+    for (let s = 0; s < OctoPacker.numSlaves(xSize); s++) {
+      const slaveStartIdx = s*NUM_OCTO_PINS*xSliceSize;
+      let byteCount = s*outStride + headerSize;
+      for (let z = 0; z < zSize; z++) {
+        for (let y = 0; y < ySize; y++) {
+          let voxelIdx = slaveStartIdx + (y*zSize + z)*3;
+          for (let i = 0; i < NUM_OCTO_PINS; i++, voxelIdx += xSliceSize) {
+            for (let c = 0; c < 3; c++) {
+              const value = framebuffer[voxelIdx+c]*scale;
+              out[byteCount++] = value >= 255 ? 255 : (value > 0 ? Math.floor(value) : 0);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+export default OctoPacker;
@@ -0,0 +1,415 @@
+import fs from 'fs';
+import path from 'path';
+import crypto from 'crypto';
+
+import {loadNativeAddon} from '../NativeAddons';
+import VoxelProtocol from '../VoxelProtocol';
+import VoxelFramebuffer from './VoxelFramebuffer';
+import {bytesToColours} from './Recording/VoxelRecordingFormat';
+
+const nativeMmapFile = loadNativeAddon('mmapfile');
+
+export const DEFAULT_ANIMATION_CACHE_SECS = 30;
+
+// Cache files: a header, the frames (3 bytes per voxel at full brightness, see VoxelProtocol.buildViewerFrameBytes)
+// starting on a page boundary so that each one can be read straight out of the mapping, then the frame timestamps.
+// Header: magic "VXAC", version (u16), reserved (u16), grid x, y and z sizes (u16 each), reserved (u16),
+// frame count (u32), reserved (u32), loop duration in milliseconds (f64). All numbers are little endian.
+const CACHE_FILE_MAGIC = "VXAC";
+const CACHE_FILE_VERSION = 1;
+const CACHE_FILE_EXTENSION = ".vxac";
+const CACHE_HEADER_SIZE = 32;
+const CACHE_FRAMES_OFFSET = 4096;
+const TIMESTAMP_SIZE = 8;
+
+// The end of each cached loop is crossfaded into its start over this long so that it loops without a seam
+const LOOP_CROSSFADE_SECS = 1;
+// Most cached animations kept mapped at once
+const MAX_LOADED_ANIMATIONS = 16;
+
+// JSON with the keys of every object sorted, so that equal configs always hash the same
+const stableStringify = (value) => {
+  if (Array.isArray(value)) {
+    return "[" + value.map(stableStringify).join(",") + "]";
+  }
+  if (value && typeof value === 'object') {
+    return "{" + Object.keys(value).sort().filter(key => value[key] !== undefined).map(key =>
+      JSON.stringify(key) + ":" + stableStringify(value[key])).join(",") + "}";
+  }
+  return JSON.stringify(value);
+};
+
+/**
+ * A cached animation loop, played out of its (memory mapped) cache file.
+ */
+class CachedAnimation {
+  /**
+   * @param {String} filePath
+   * @param {Number[]} gridSize - The x, y and z sizes of the voxel grid.
+   * @param {Number} startTimeMs - Where to start in the loop, wrapped around its duration.
+   */
+  constructor(filePath, gridSize, startTimeMs=0) {
+    this.filePath = filePath;
+    let fileBuf = null;
+    if (nativeMmapFile) {
+      try {
+        fileBuf = nativeMmapFile.map(filePath);
+      }
+      catch (err) {
+        console.error(`Failed to map ${filePath}, reading it instead: ${err.message}`);
+      }
+    }
+    if (!fileBuf) {
+      fileBuf = fs.readFileSync(filePath);
+    }
+
+    if (fileBuf.length < CACHE_HEADER_SIZE || fileBuf.toString('latin1', 0, 4) !== CACHE_FILE_MAGIC ||
+        fileBuf.readUInt16LE(4) !== CACHE_FILE_VERSION) {
+      throw new Error(`${filePath} isn't an animation cache file.`);
+    }
+    if (gridSize.some((size, i) => fileBuf.readUInt16LE(8 + 2*i) !== size)) {
+      throw new Error(`${filePath} is for a different grid size.`);
+    }
+    this.numFrames = fileBuf.readUInt32LE(16);
+    this.durationMs = fileBuf.readDoubleLE(24);
+    this.frameLength = 3*gridSize[0]*gridSize[1]*gridSize[2];
+    const timestampsOffset = CACHE_FRAMES_OFFSET + this.numFrames*this.frameLength;
+    if (this.numFrames === 0 || fileBuf.length < timestampsOffset + this.numFrames*TIMESTAMP_SIZE) {
+      throw new Error(`${filePath} is truncated.`);
+    }
+
+    this._fileBuf = fileBuf;
+    this._timestamps = new Float64Array(this.numFrames);
+    for (let i = 0; i < this.numFrames; i++) {
+      this._timestamps[i] = fileBuf.readDoubleLE(timestampsOffset + i*TIMESTAMP_SIZE);
+    }
+    this._timeMs = startTimeMs % this.durationMs;
+  }
+
+  /**
+   * Read the frame that's showing into data and advance the loop by dt seconds.
+   */
+  render(dt, data) {
+    const timestamps = this._timestamps;
+    let low = 0;
+    let high = this.numFrames - 1;
+    while (low < high) {
+      const mid = (low + high + 1) >> 1;
+      if (timestamps[mid] <= this._timeMs) { low = mid; }
+      else { high = mid - 1; }
+    }
+    const start = CACHE_FRAMES_OFFSET + low*this.frameLength;
+    bytesToColours(this._fileBuf.subarray(start, start + this.frameLength), data);
+    this._timeMs = (this._timeMs + dt*1000) % this.durationMs;
+  }
+}
+
+/**
+ * Captures the frames of an animator's first loopDurationMs (plus the crossfade) into a new cache file.
+ */
+class AnimationCapture {
+  constructor(animator, key, filePath, gridSize, loopDurationMs) {
+    this.animator = animator;
+    this.key = key;
+    this.filePath = filePath;
+    this.gridSize = gridSize;
+    this.frameLength = 3*gridSize[0]*gridSize[1]*gridSize[2];
+    this.loopDurationMs = loopDurationMs;
+    this.crossfadeMs = Math.min(LOOP_CROSSFADE_SECS*1000, loopDurationMs/2);
+
+    this._tempPath = filePath + ".tmp";
+    this.timeMs = 0; // Time of the animator's next frame since the capture started
+    this._timestamps = [];
+    this._headFrames = []; // Frames of the loop's first crossfadeMs, which the frames after its end are faded into
+    this._tailFrames = []; // Frames after the end of the loop
+    this._writes = fs.promises.open(this._tempPath, 'w').then(fileHandle => {
+      this._fileHandle = fileHandle;
+    }).catch(err => this._fail(err));
+    this.complete = false;
+    this.failed = false; // Its file couldn't be written, it's been dropped (see _fail)
+    this._error = null;
+  }
+
+  /**
+   * Add the animator's next frame.
+   * @returns {Boolean} Whether the capture has all of its frames, see finish.
+   */
+  addFrame(data, dt) {
+    const frameBytes = new Uint8Array(this.frameLength);
+    VoxelProtocol.stuffVoxelDataAll(0, frameBytes, data, 1);
+    const timeMs = this.timeMs;
+    this.timeMs += dt*1000;
+
+    if (timeMs < this.loopDurationMs) {
+      const frameIdx = this._timestamps.length;
+      this._timestamps.push(timeMs);
+      if (timeMs < this.crossfadeMs) {
+        this._headFrames.push(frameBytes);
+      }
+      this._write(frameBytes, CACHE_FRAMES_OFFSET + frameIdx*this.frameLength);
+    }
+    else {
+      this._tailFrames.push(frameBytes);
+      this.complete = this._tailFrames.length >= this._headFrames.length;
+    }
+    return this.complete;
+  }
+
+  /**
+   * Write out the rest of the cache file.
+   * @returns {Promise} Resolves once the cache file is in place.
+   */
+  finish() {
+    // The start of the loop is faded in from the frames that followed its end, so the last frame leads into the first
+    const {frameLength} = this;
+    const numFadedFrames = Math.min(this._headFrames.length, this._tailFrames.length);
+    for (let j = 0; j < numFadedFrames; j++) {
+      const alpha = j / numFadedFrames;
+      const headFrame = this._headFrames[j];
+      const tailFrame = this._tailFrames[j];
+      const fadedFrame = new Uint8Array(frameLength);
+      for (let i = 0; i < frameLength; i++) {
+        fadedFrame[i] = Math.round(tailFrame[i]*(1-alpha) + headFrame[i]*alpha);
+      }
+      this._write(fadedFrame, CACHE_FRAMES_OFFSET + j*frameLength);
+    }
+
+    const numFrames = this._timestamps.length;
+    const timestampBuf = Buffer.alloc(numFrames*TIMESTAMP_SIZE);
+    this._timestamps.forEach((timestamp, i) => timestampBuf.writeDoubleLE(timestamp, i*TIMESTAMP_SIZE));
+    this._write(timestampBuf, CACHE_FRAMES_OFFSET + numFrames*frameLength);
+
+    const header = Buffer.alloc(CACHE_HEADER_SIZE);
+    header.write(CACHE_FILE_MAGIC, 0, 'latin1');
+    header.writeUInt16LE(CACHE_FILE_VERSION, 4);
+    this.gridSize.forEach((size, i) => header.writeUInt16LE(size, 8 + 2*i));
+    header.writeUInt32LE(numFrames, 16);
+    header.writeDoubleLE(this.loopDurationMs, 24);
+    this._write(header, 0);
+
+    this._headFrames = this._tailFrames = null;
+    return this._writes.then(async () => {
+      if (this.failed) {
+        throw this._error;
+      }
+      await this._fileHandle.close();
+      this._fileHandle = null;
+      await fs.promises.rename(this._tempPath, this.filePath);
+    }).catch(async err => {
+      await this._removeTempFile().catch(() => {});
+      throw err;
+    });
+  }
+
+  /**
+   * Drop the capture and its temporary file.
+   * @returns {Promise} Resolves once the file is gone.
+   */
+  abort() {
+    this._headFrames = this._tailFrames = null;
+    this._writes = this._writes.then(() => this._removeTempFile()).catch(() => {});
+    return this._writes;
+  }
+
+  _write(buf, position) {
+    if (this.failed) { return; }
+    this._writes = this._writes.then(() => {
+      if (!this.failed) {
+        return this._fileHandle.write(buf, 0, buf.length, position);
+      }
+    }).catch(err => this._fail(err));
+  }
+
+  _fail(err) {
+    if (this.failed) { return; }
+    console.error(`Caching to ${this.filePath} failed: ${err}`);
+    this.failed = true;
+    this._error = err;
+    this._headFrames = this._tailFrames = null;
+    return this._removeTempFile().catch(() => {});
+  }
+
+  async _removeTempFile() {
+    if (this._fileHandle) {
+      await this._fileHandle.close();
+      this._fileHandle = null;
+    }
+    await fs.promises.unlink(this._tempPath);
+  }
+}
+
+/**
+ * Caches loops of the animators whose frames are the same every time they're run with the same config (e.g., fire
+ * and the voxel tracer scenes, see VoxelAnimator.isCacheable), so that showing them again doesn't cost their
+ * simulation and rendering all over again.
+ *
+ * The first time an animator is shown with a given config its first durationSecs (plus a second to crossfade the
+ * loop's end into its start) are captured into a cache file named by a hash of the animator's type, config, the grid
+ * size and the simulation rate. Once the capture is complete, and whenever that animator and config are shown again
+ * (even after a restart), its frames are played from the cache file, memory mapped through the mmapfile addon (or
+ * read in whole without it) so the frames are paged in from disk as they're needed.
+ *
+ * Cached animators render to a CPU framebuffer (see rendersToCPU), everything else about them, e.g., crossfading
+ * between animators in VoxelModel, works the same. An animator whose loop was just captured keeps rendering live
+ * until its cache file is written out, then the cached loop picks up from wherever the live animator got to.
+ */
+class AnimationCache {
+  /**
+   * @param {String} dirPath - Directory of the cache files, made if it doesn't exist.
+   * @param {Number[]} gridSize - The x, y and z sizes of the voxel grid.
+   * @param {Object} options
+   * @param {Number} options.durationSecs - Length of each cached loop.
+   * @param {Number} options.simulationRateHz - The simulation rate, animations are cached separately for each rate.
+   */
+  constructor(dirPath, gridSize, options={}) {
+    const {durationSecs = DEFAULT_ANIMATION_CACHE_SECS, simulationRateHz = 0} = options;
+    this.dirPath = dirPath;
+    this.gridSize = gridSize;
+    this.frameLength = 3*gridSize[0]*gridSize[1]*gridSize[2];
+    this.durationSecs = durationSecs;
+    this.simulationRateHz = simulationRateHz;
+    fs.mkdirSync(dirPath, {recursive: true});
+
+    this._keys = new WeakMap();     // Animator -> its config and the key for it
+    this._loaded = new Map();       // Key -> CachedAnimation, oldest first
+    this._missing = new Set();      // Keys that have no cache file yet
+    this._capture = null;           // The capture in progress
+    this._liveTimes = new Map();    // Key -> time of the live animator's next frame since its capture started, from
+                                    // when the capture is complete until its cache file is loaded
+    this._failed = new Set();       // Keys whose cache files couldn't be written, they aren't captured again
+  }
+
+  /**
+   * Drop the capture in progress, captures that are already being written out still finish.
+   * @returns {Promise} Resolves once its temporary file is gone.
+   */
+  stop() {
+    const capture = this._capture;
+    this._capture = null;
+    return capture ? capture.abort() : Promise.resolve();
+  }
+
+  /**
+   * Whether the animator's current config is being played from the cache.
+   */
+  rendersToCPU(animator) {
+    return this._cachedAnimation(animator) !== null;
+  }
+
+  /**
+   * Render the animator's next frame from the cache into the given framebuffer.
+   * @returns {Boolean} Whether it was, if not the animator has to render it.
+   */
+  render(animator, dt, framebuffer) {
+    const cachedAnimation = this._cachedAnimation(animator);
+    if (!cachedAnimation || framebuffer.getType() !== VoxelFramebuffer.VOXEL_FRAMEBUFFER_CPU_TYPE) {
+      return false;
+    }
+    cachedAnimation.render(dt, framebuffer.getCPUBuffer());
+    return true;
+  }
+
+  /**
+   * Capture a frame that the animator rendered (live) into the framebuffer, only the current animator should be
+   * captured. Starts a new capture if its config isn't cached yet.
+   */
+  capture(animator, dt, framebuffer) {
+    const key = this._key(animator);
+    let capture = this._capture;
+    if (capture && capture.failed) {
+      // Its file couldn't be written (e.g., the disk is full), don't keep trying with the same config
+      this._failed.add(capture.key);
+      capture = this._capture = null;
+    }
+    if (capture && (capture.animator !== animator || capture.key !== key)) {
+      // The animator, its config or whether it can be cached changed before the loop was captured
+      capture.abort();
+      capture = this._capture = null;
+    }
+    if (!key || this._loaded.has(key) || this._failed.has(key)) {
+      return;
+    }
+    if (this._liveTimes.has(key)) {
+      // Keep track of where the live animator is so that the cached loop can start from there
+      this._liveTimes.set(key, this._liveTimes.get(key) + dt*1000);
+      return;
+    }
+
+    if (!capture) {
+      const filePath = path.join(this.dirPath, key + CACHE_FILE_EXTENSION);
+      capture = this._capture = new AnimationCapture(animator, key, filePath, this.gridSize, this.durationSecs*1000);
+      console.log(`Caching ${this.durationSecs}s of ${animator.getType()} to ${filePath}...`);
+    }
+    if (capture.addFrame(framebuffer.getCPUBuffer(), dt)) {
+      this._capture = null;
+      this._liveTimes.set(key, capture.timeMs);
+      capture.finish().then(() => {
+        console.log(`Cached ${animator.getType()} to ${capture.filePath}.`);
+        this._missing.delete(key);
+      }).catch(err => {
+        console.error(`Failed to cache ${animator.getType()}: ${err}`);
+        this._liveTimes.delete(key);
+        this._failed.add(key);
+      });
+    }
+  }
+
+  _key(animator) {
+    if (!animator.isCacheable()) {
+      return null;
+    }
+    const keyEntry = this._keys.get(animator);
+    if (keyEntry && keyEntry.config === animator.config) {
+      return keyEntry.key;
+    }
+
+    const hash = crypto.createHash('sha1').update(stableStringify({
+      version: CACHE_FILE_VERSION,
+      type: animator.getType(),
+      config: animator.config,
+      gridSize: this.gridSize,
+      simulationRateHz: this.simulationRateHz,
+      durationSecs: this.durationSecs,
+    })).digest('hex');
+    const key = String(animator.getType()).toLowerCase().replace(/[^a-z0-9]+/g, "-") + "-" + hash;
+    this._keys.set(animator, {config: animator.config, key});
+    return key;
+  }
+
+  _cachedAnimation(animator) {
+    const key = this._key(animator);
+    if (!key || this._missing.has(key)) {
+      return null;
+    }
+    let cachedAnimation = this._loaded.get(key);
+    if (cachedAnimation) {
+      return cachedAnimation;
+    }
+
+    const filePath = path.join(this.dirPath, key + CACHE_FILE_EXTENSION);
+    if (!fs.existsSync(filePath)) {
+      this._missing.add(key);
+      return null;
+    }
+    try {
+      cachedAnimation = new CachedAnimation(filePath, this.gridSize, this._liveTimes.get(key));
+    }
+    catch (err) {
+      console.error(`Failed to load the animation cache ${filePath}: ${err.message}`);
+      this._missing.add(key);
+      return null;
+    }
+    finally {
+      this._liveTimes.delete(key);
+    }
+    console.log(`Playing ${animator.getType()} from the animation cache ${filePath}.`);
+    this._loaded.set(key, cachedAnimation);
+    if (this._loaded.size > MAX_LOADED_ANIMATIONS) {
+      // Dropping the least recently loaded one unmaps it once it's garbage collected
+      this._loaded.delete(this._loaded.keys().next().value);
+    }
+    return cachedAnimation;
+  }
+}
+
+export default AnimationCache;
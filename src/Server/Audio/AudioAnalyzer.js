@@ -0,0 +1,146 @@
+import AudioFFT from './AudioFFT';
+
+export const DEFAULT_FFT_SIZE = 2048;
+export const DEFAULT_NUM_BANDS = 64; // Enough for the audio visualizers to resample their levels from (see calcAudioLevels)
+const MIN_BAND_HZ = 30;
+const MAX_BAND_HZ = 16000;
+// Energy of the spectrum below the rolloff frequency, as in Meyda's spectralRolloff
+const ROLLOFF_ENERGY = 0.99;
+const STATS_INTERVAL_MS = 30000;
+
+/**
+ * Turns a stream of audio samples into the audio info that the audio reactive animators take (see
+ * AudioVisualizerAnimator.setAudioInfo): the amplitude spectrum, rms, spectral centroid and rolloff, the same features
+ * that the controller used to compute with Meyda, plus the levels of log frequency bands of the spectrum, which the
+ * audio visualizers use in place of distributing the FFT bins themselves (see AudioVisualizerAnimator.calcAudioLevels).
+ *
+ * Samples are kept in a ring buffer as they arrive and only analyzed when the render loop asks for them, on the latest
+ * fftSize samples and only once a hop's worth of new samples has come in. Hops that were overtaken by newer samples
+ * before being asked for are skipped rather than queued, so the audio info is never more than a hop plus a frame
+ * behind the input, however the input arrives.
+ *
+ * The returned audio info and its arrays belong to the analyzer and are only good until the next analysis.
+ */
+class AudioAnalyzer {
+  /**
+   * @param {Object} options
+   * @param {Number} options.sampleRate - Samples per second of the input.
+   * @param {Number} options.fftSize - Samples in each analysis, a power of two.
+   * @param {Number} options.hopSize - New samples between analyses, half the FFT size by default.
+   * @param {Number} options.numBands - Log frequency bands to split the spectrum into.
+   */
+  constructor(options={}) {
+    const {sampleRate, fftSize = DEFAULT_FFT_SIZE, numBands = DEFAULT_NUM_BANDS} = options;
+    const {hopSize = fftSize/2} = options;
+    if (!AudioFFT.isValidSize(fftSize)) {
+      throw new Error(`Invalid FFT size ${fftSize}, it must be a power of two from 16 to 65536.`);
+    }
+    this.sampleRate = sampleRate;
+    this.fftSize = fftSize;
+    this.hopSize = Math.max(1, Math.min(fftSize, hopSize));
+
+    this._ring = new Float32Array(2*fftSize);
+    this._numSamples = 0;     // Total samples added
+    this._analyzedAt = fftSize - this.hopSize; // _numSamples as of the last analysis, the first is due at fftSize
+    this._samples = new Float32Array(fftSize);
+    this._bandStarts = AudioFFT.buildLogBands(fftSize, sampleRate, numBands, MIN_BAND_HZ, Math.min(MAX_BAND_HZ, sampleRate/2));
+    this.audioInfo = {
+      fft: new Float32Array(fftSize/2),
+      bands: new Float32Array(numBands),
+      rms: 0,
+      spectralCentroid: 0,
+      spectralRolloff: 0,
+    };
+    this.resetStats();
+  }
+
+  resetStats() {
+    this.stats = {startTime: Date.now(), samples: 0, analyses: 0, skippedHops: 0, analysisMs: 0};
+  }
+
+  /**
+   * Add mono samples in [-1,1] to the input.
+   * @param {Float32Array} samples
+   */
+  addSamples(samples) {
+    const ring = this._ring;
+    // Only the last ring's worth can ever be analyzed
+    const start = Math.max(0, samples.length - ring.length);
+    let pos = (this._numSamples + start) % ring.length;
+    for (let i = start; i < samples.length; i++) {
+      ring[pos] = samples[i];
+      pos = pos+1 === ring.length ? 0 : pos+1;
+    }
+    this._numSamples += samples.length;
+    this.stats.samples += samples.length;
+  }
+
+  /**
+   * Analyze the latest samples if a hop's worth of new ones has come in since the last analysis.
+   * @returns {Object} The audio info, null if there's nothing new.
+   */
+  takeAudioInfo() {
+    this._logStats();
+    const numNew = this._numSamples - this._analyzedAt;
+    if (numNew < this.hopSize) {
+      return null;
+    }
+    this.stats.skippedHops += Math.floor(numNew/this.hopSize) - 1;
+    this._analyzedAt = this._numSamples;
+
+    const startTime = performance.now();
+    this._analyze();
+    this.stats.analyses++;
+    this.stats.analysisMs += performance.now() - startTime;
+    return this.audioInfo;
+  }
+
+  _analyze() {
+    const {fftSize, audioInfo} = this;
+    const ring = this._ring;
+    const samples = this._samples;
+    const start = (this._numSamples - fftSize) % ring.length;
+    const firstPart = Math.min(fftSize, ring.length - start);
+    samples.set(ring.subarray(start, start + firstPart));
+    samples.set(ring.subarray(0, fftSize - firstPart), firstPart);
+
+    let sumSquares = 0;
+    for (let i = 0; i < fftSize; i++) { sumSquares += samples[i]*samples[i]; }
+    audioInfo.rms = Math.sqrt(sumSquares/fftSize);
+
+    const spectrum = audioInfo.fft;
+    AudioFFT.amplitudeSpectrum(samples, spectrum);
+    AudioFFT.bandLevels(spectrum, this._bandStarts, audioInfo.bands);
+
+    // The centroid is in bins and the rolloff in Hz, as Meyda has them
+    let sum = 0;
+    let weightedSum = 0;
+    for (let k = 0; k < spectrum.length; k++) {
+      sum += spectrum[k];
+      weightedSum += k*spectrum[k];
+    }
+    audioInfo.spectralCentroid = sum > 0 ? weightedSum/sum : 0;
+    const rolloffThreshold = ROLLOFF_ENERGY*sum;
+    let rolloffBin = spectrum.length - 1;
+    let partialSum = sum;
+    while (rolloffBin > 0 && partialSum > rolloffThreshold) {
+      partialSum -= spectrum[rolloffBin];
+      rolloffBin--;
+    }
+    audioInfo.spectralRolloff = (this.sampleRate/2) / (spectrum.length-1) * (rolloffBin+1);
+  }
+
+  _logStats() {
+    const {stats} = this;
+    const elapsedMs = Date.now() - stats.startTime;
+    if (elapsedMs < STATS_INTERVAL_MS) {
+      return;
+    }
+    console.log(`Audio: ${(stats.samples*1000/elapsedMs).toFixed(0)} samples/s in, ${stats.analyses} analyses ` +
+      `(${(stats.analysisMs/Math.max(1, stats.analyses)).toFixed(2)}ms avg), ${stats.skippedHops} stale hops skipped` +
+      (stats.samples === 0 ? ", no input!" : "."));
+    this.resetStats();
+  }
+}
+
+export default AudioAnalyzer;
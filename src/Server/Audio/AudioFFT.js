@@ -0,0 +1,125 @@
+import {loadNativeAddon} from '../../NativeAddons';
+
+const nativeAudioFFT = loadNativeAddon('audiofft');
+if (nativeAudioFFT) {
+  console.log("Using the native audio FFT.");
+}
+
+// JS fallback plans (Hann window, bit reversal and twiddles) by FFT size
+const plans = new Map();
+
+const buildPlan = (size) => {
+  const window = new Float32Array(size);
+  for (let n = 0; n < size; n++) { window[n] = 0.5 - 0.5*Math.cos(2*Math.PI*n/(size-1)); }
+  const bitReversed = new Int32Array(size);
+  const bits = Math.log2(size);
+  for (let n = 0; n < size; n++) {
+    let reversed = 0;
+    for (let b = 0; b < bits; b++) { reversed |= ((n >> b) & 1) << (bits-1-b); }
+    bitReversed[n] = reversed;
+  }
+  const twiddleRe = new Float64Array(size/2);
+  const twiddleIm = new Float64Array(size/2);
+  for (let j = 0; j < size/2; j++) {
+    twiddleRe[j] = Math.cos(-2*Math.PI*j/size);
+    twiddleIm[j] = Math.sin(-2*Math.PI*j/size);
+  }
+  return {window, bitReversed, twiddleRe, twiddleIm, re: new Float64Array(size), im: new Float64Array(size)};
+};
+
+/**
+ * Spectrum analysis for the server's audio input (see AudioAnalyzer), run by the native audiofft addon (an SSE2 real
+ * FFT) when it's built and by a plain radix-2 FFT in JS otherwise.
+ */
+class AudioFFT {
+
+  static get isNative() { return nativeAudioFFT !== null; }
+
+  static isValidSize(size) {
+    return Number.isInteger(size) && size >= 16 && size <= 65536 && (size & (size-1)) === 0;
+  }
+
+  /**
+   * Amplitude spectrum of the samples after a Hann window, the same as Meyda's amplitudeSpectrum.
+   * @param {Float32Array} samples - The FFT size's worth of samples, a power of two.
+   * @param {Float32Array} spectrum - Gets the magnitudes of the first samples.length/2 frequency bins, bin k is
+   * k*sampleRate/samples.length Hz.
+   */
+  static amplitudeSpectrum(samples, spectrum) {
+    if (nativeAudioFFT) {
+      nativeAudioFFT.amplitudeSpectrum(samples, spectrum);
+      return;
+    }
+
+    const size = samples.length;
+    let plan = plans.get(size);
+    if (!plan) {
+      plan = buildPlan(size);
+      plans.set(size, plan);
+    }
+    const {window, bitReversed, twiddleRe, twiddleIm, re, im} = plan;
+    for (let n = 0; n < size; n++) {
+      re[bitReversed[n]] = samples[n]*window[n];
+      im[n] = 0;
+    }
+    for (let half = 1; half < size; half *= 2) {
+      const twiddleStep = size / (2*half);
+      for (let start = 0; start < size; start += 2*half) {
+        for (let j = 0; j < half; j++) {
+          const a = start + j;
+          const b = a + half;
+          const wr = twiddleRe[j*twiddleStep];
+          const wi = twiddleIm[j*twiddleStep];
+          const tr = re[b]*wr - im[b]*wi;
+          const ti = re[b]*wi + im[b]*wr;
+          re[b] = re[a] - tr; im[b] = im[a] - ti;
+          re[a] += tr;        im[a] += ti;
+        }
+      }
+    }
+    for (let k = 0; k < size/2; k++) {
+      spectrum[k] = Math.sqrt(re[k]*re[k] + im[k]*im[k]);
+    }
+  }
+
+  /**
+   * Level of each band of the spectrum, the largest magnitude of its bins.
+   * @param {Float32Array} spectrum
+   * @param {Int32Array} bandStarts - The first bin of each band followed by the end of the last band (see buildLogBands).
+   * @param {Float32Array} levels - Gets the level of each band.
+   */
+  static bandLevels(spectrum, bandStarts, levels) {
+    if (nativeAudioFFT) {
+      nativeAudioFFT.bandLevels(spectrum, bandStarts, levels);
+      return;
+    }
+    for (let i = 0; i < bandStarts.length-1; i++) {
+      let level = 0;
+      for (let k = bandStarts[i]; k < bandStarts[i+1]; k++) { level = Math.max(level, spectrum[k]); }
+      levels[i] = level;
+    }
+  }
+
+  /**
+   * Split the spectrum into bands that are evenly spaced in log frequency between minHz and maxHz. Each band gets
+   * at least one bin, so at the low end (where the bins are farthest apart in log frequency) the bands are wider.
+   * @returns {Int32Array} The first bin of each band followed by the end of the last band.
+   */
+  static buildLogBands(fftSize, sampleRate, numBands, minHz, maxHz) {
+    const numBins = fftSize/2;
+    const hzPerBin = sampleRate / fftSize;
+    const minBin = Math.max(1, Math.floor(minHz / hzPerBin));
+    const maxBin = Math.min(numBins, Math.ceil(maxHz / hzPerBin));
+    const bandStarts = new Int32Array(numBands+1);
+    const logMin = Math.log(minBin);
+    const logMax = Math.log(maxBin);
+    bandStarts[0] = minBin;
+    for (let i = 1; i <= numBands; i++) {
+      const edge = Math.round(Math.exp(logMin + (logMax - logMin)*i/numBands));
+      bandStarts[i] = Math.min(numBins, Math.max(bandStarts[i-1] + 1, edge));
+    }
+    return bandStarts;
+  }
+}
+
+export default AudioFFT;
@@ -0,0 +1,173 @@
+import fs from 'fs';
+
+import AudioAnalyzer from './AudioAnalyzer';
+
+export const DEFAULT_SAMPLE_RATE = 44100;
+// How often a file is fed to the analyzer, its samples are fed as they come due in real time
+const FILE_FEED_INTERVAL_MS = 10;
+
+const SAMPLE_FORMAT_S16 = 's16';
+const SAMPLE_FORMAT_F32 = 'f32';
+const WAVE_FORMAT_PCM = 1;
+const WAVE_FORMAT_IEEE_FLOAT = 3;
+const WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+/**
+ * @returns {Object} The sample format, channels, sample rate and sample bytes of a WAV file, null if the buffer isn't
+ * a WAV file.
+ * @throws {Error} If it's a WAV file in a format other than 16-bit integer or 32-bit float samples.
+ */
+const readWav = (buf) => {
+  if (buf.length < 12 || buf.toString('latin1', 0, 4) !== "RIFF" || buf.toString('latin1', 8, 12) !== "WAVE") {
+    return null;
+  }
+  let format = null;
+  let offset = 12;
+  while (offset + 8 <= buf.length) {
+    const chunkId = buf.toString('latin1', offset, offset+4);
+    const chunkSize = buf.readUInt32LE(offset+4);
+    const chunkStart = offset + 8;
+    if (chunkId === "fmt ") {
+      let audioFormat = buf.readUInt16LE(chunkStart);
+      if (audioFormat === WAVE_FORMAT_EXTENSIBLE && chunkSize >= 26) {
+        audioFormat = buf.readUInt16LE(chunkStart+24);
+      }
+      const bitsPerSample = buf.readUInt16LE(chunkStart+14);
+      format = {
+        channels: buf.readUInt16LE(chunkStart+2),
+        sampleRate: buf.readUInt32LE(chunkStart+4),
+        sampleFormat: (audioFormat === WAVE_FORMAT_PCM && bitsPerSample === 16) ? SAMPLE_FORMAT_S16 :
+          (audioFormat === WAVE_FORMAT_IEEE_FLOAT && bitsPerSample === 32) ? SAMPLE_FORMAT_F32 : null,
+      };
+      if (!format.sampleFormat) {
+        throw new Error("only 16-bit integer and 32-bit float WAV files are supported");
+      }
+    }
+    else if (chunkId === "data" && format) {
+      return {...format, data: buf.subarray(chunkStart, Math.min(buf.length, chunkStart + chunkSize))};
+    }
+    offset = chunkStart + chunkSize + (chunkSize & 1);
+  }
+  throw new Error("the WAV file has no format or data");
+};
+
+/**
+ * Audio input for the server's audio reactive animators, so that they work without a controller open in a browser.
+ * Samples come in as raw PCM on stdin (e.g., piped from arecord or ffmpeg capturing a sound card) or from a WAV or raw
+ * PCM file, which is played in real time on a loop. They're mixed down to mono and analyzed by an AudioAnalyzer that
+ * the render loop takes the latest audio info from.
+ */
+class AudioInput {
+  /**
+   * @param {String} source - "-" for stdin, otherwise the path of a WAV or raw PCM file.
+   * @param {Object} options - The raw PCM format (WAV files have their own) and the analysis options (see AudioAnalyzer).
+   * @param {Number} options.sampleRate - Samples per second of raw PCM.
+   * @param {Number} options.channels - Interleaved channels of raw PCM, which is 16-bit signed little endian.
+   * @throws {Error} If the file can't be read.
+   */
+  constructor(source, options={}) {
+    const {sampleRate = DEFAULT_SAMPLE_RATE, channels = 1} = options;
+    this.source = source;
+    this._fileData = null;
+    this._format = {sampleFormat: SAMPLE_FORMAT_S16, channels, sampleRate};
+    if (source !== "-") {
+      const buf = fs.readFileSync(source);
+      const wav = readWav(buf);
+      if (wav) {
+        const {data, ...format} = wav;
+        this._format = format;
+        this._fileData = data;
+      }
+      else {
+        this._fileData = buf;
+      }
+    }
+    this.sampleRate = this._format.sampleRate;
+    this.channels = this._format.channels;
+    this._bytesPerFrame = (this._format.sampleFormat === SAMPLE_FORMAT_F32 ? 4 : 2)*this.channels;
+    this._pendingBytes = null;  // Part of a sample frame left over from the last chunk of stdin
+    this._fileInterval = null;
+    this._onStdinData = this._onStdinData.bind(this);
+
+    this.analyzer = new AudioAnalyzer({...options, sampleRate: this.sampleRate});
+  }
+
+  start() {
+    const {sampleRate, channels} = this;
+    if (this._fileData) {
+      const numFrames = Math.floor(this._fileData.length / this._bytesPerFrame);
+      if (numFrames === 0) {
+        console.error(`The audio file ${this.source} has no samples.`);
+        return;
+      }
+      // Feed each interval's worth of samples as it comes due, looping the file. After a stall only the last
+      // analysis' worth is fed, the analyzer wouldn't look at the rest anyway.
+      const startTime = performance.now();
+      let numFramesFed = 0;
+      this._fileInterval = setInterval(() => {
+        const numFramesDue = Math.floor((performance.now() - startTime)*sampleRate/1000);
+        numFramesFed = Math.max(numFramesFed, numFramesDue - this.analyzer.fftSize);
+        while (numFramesFed < numFramesDue) {
+          const fileFrame = numFramesFed % numFrames;
+          const count = Math.min(numFramesDue - numFramesFed, numFrames - fileFrame);
+          this._addBytes(this._fileData.subarray(fileFrame*this._bytesPerFrame, (fileFrame+count)*this._bytesPerFrame));
+          numFramesFed += count;
+        }
+      }, FILE_FEED_INTERVAL_MS);
+      console.log(`Playing audio from ${this.source} (${sampleRate}Hz, ${channels} channel(s)) on a loop.`);
+    }
+    else {
+      process.stdin.on('data', this._onStdinData);
+      process.stdin.once('end', () => console.log("Audio input on stdin ended."));
+      console.log(`Reading ${sampleRate}Hz ${channels} channel 16-bit PCM audio from stdin.`);
+    }
+  }
+
+  stop() {
+    if (this._fileInterval) {
+      clearInterval(this._fileInterval);
+      this._fileInterval = null;
+    }
+    process.stdin.off('data', this._onStdinData);
+  }
+
+  /**
+   * The latest audio info, null if there's been no new audio since the last time (see AudioAnalyzer.takeAudioInfo).
+   */
+  takeAudioInfo() {
+    return this.analyzer.takeAudioInfo();
+  }
+
+  _onStdinData(chunk) {
+    if (this._pendingBytes) {
+      chunk = Buffer.concat([this._pendingBytes, chunk]);
+      this._pendingBytes = null;
+    }
+    const numBytes = chunk.length - (chunk.length % this._bytesPerFrame);
+    if (numBytes < chunk.length) {
+      this._pendingBytes = Buffer.from(chunk.subarray(numBytes));
+    }
+    this._addBytes(chunk.subarray(0, numBytes));
+  }
+
+  // Mix whole sample frames down to mono and hand them to the analyzer
+  _addBytes(bytes) {
+    const {channels} = this;
+    const isFloat = this._format.sampleFormat === SAMPLE_FORMAT_F32;
+    const bytesPerSample = isFloat ? 4 : 2;
+    const numFrames = Math.floor(bytes.length / this._bytesPerFrame);
+    const samples = new Float32Array(numFrames);
+    const scale = isFloat ? 1/channels : 1/(32768*channels);
+    let offset = 0;
+    for (let i = 0; i < numFrames; i++) {
+      let sum = 0;
+      for (let c = 0; c < channels; c++, offset += bytesPerSample) {
+        sum += isFloat ? bytes.readFloatLE(offset) : bytes.readInt16LE(offset);
+      }
+      samples[i] = sum*scale;
+    }
+    this.analyzer.addSamples(samples);
+  }
+}
+
+export default AudioInput;
@@ -0,0 +1,188 @@
+export const DEFAULT_PIPELINE_DEPTH = 1;
+
+const STATS_INTERVAL_MS = 30000;
+
+/**
+ * Takes the frames that the render loop produces through the rest of their way to the display in two more stages:
+ * packing (building the slave and viewer packets, see VoxelServer.packVoxelData) and transmitting (handing them to
+ * the slave writers and the viewer socket, see VoxelServer.transmitVoxelData). Each stage runs on its own turn of the
+ * event loop, so while frame N+1 is being rendered (e.g., while the render procs are busy with it) frame N can be
+ * packed and frame N-1 sent, rather than every frame going through all three before the next one can start.
+ *
+ * The stages are joined by queues of at most depth frames, when a queue is full its oldest frame is dropped so the
+ * display always gets the newest ones: a depth of 1 keeps latency to a minimum, deeper queues soak up the stages'
+ * hiccups at the cost of latency. A depth of 0 packs and transmits each frame as soon as it's rendered.
+ */
+class FramePipeline {
+  /**
+   * @param {VoxelServer} voxelServer
+   * @param {Object} options
+   * @param {Number} options.depth - Most frames waiting between any two stages.
+   */
+  constructor(voxelServer, options={}) {
+    const {depth = DEFAULT_PIPELINE_DEPTH} = options;
+    this.voxelServer = voxelServer;
+    this.depth = Math.max(0, Math.floor(depth));
+
+    this._packQueue = [];     // Rendered frames waiting to be packed
+    this._transmitQueue = []; // Packed frames waiting to be sent
+    this._freeBuffers = [];   // Voxel data buffers of frames that have been packed, for reuse
+    this._packImmediate = null;
+    this._transmitImmediate = null;
+    this._runPackStage = this._runPackStage.bind(this);
+    this._runTransmitStage = this._runTransmitStage.bind(this);
+    this._resetStats();
+  }
+
+  /**
+   * Render stage output: queue a rendered frame to be packed and sent. The voxel data is copied, the caller is free
+   * to render into it again right away.
+   * @param {Float32Array} data - Flat array of the voxel colours, laid out like VoxelFramebufferCPU's buffer.
+   */
+  submitFrame(data, brightnessMultiplier, frameId) {
+    const buffer = this._acquireBuffer(data.length);
+    buffer.set(data);
+    const frame = {voxelData: this.voxelServer.voxelDataFrame(buffer, brightnessMultiplier, frameId), submitTime: performance.now()};
+    this.stats.framesSubmitted++;
+
+    if (this.depth === 0) {
+      this._transmit(this._pack(frame));
+      return;
+    }
+    if (this._packQueue.length >= this.depth) {
+      this._releaseBuffer(this._packQueue.shift().voxelData.data);
+      this.stats.framesDroppedBeforePack++;
+    }
+    this._packQueue.push(frame);
+    if (this._packImmediate === null) {
+      this._packImmediate = setImmediate(this._runPackStage);
+    }
+  }
+
+  stop() {
+    if (this._packImmediate !== null) {
+      clearImmediate(this._packImmediate);
+      this._packImmediate = null;
+    }
+    if (this._transmitImmediate !== null) {
+      clearImmediate(this._transmitImmediate);
+      this._transmitImmediate = null;
+    }
+    this._packQueue.forEach(frame => this._releaseBuffer(frame.voxelData.data));
+    this._packQueue = [];
+    this._transmitQueue = [];
+  }
+
+  /**
+   * One line summary of the stats, e.g., for logging.
+   */
+  statsSummary() {
+    const {framesSubmitted, framesSent, framesDroppedBeforePack, framesDroppedBeforeSend, packMs, transmitMs, latencyMs, maxLatencyMs} = this.stats;
+    const avg = (total, count) => (total / Math.max(1, count)).toFixed(2);
+    return `depth ${this.depth}, ${framesSubmitted} frames rendered, ${framesSent} sent, ` +
+      `${framesDroppedBeforePack + framesDroppedBeforeSend} dropped (${framesDroppedBeforePack} before packing, ${framesDroppedBeforeSend} before sending), ` +
+      `avg pack ${avg(packMs, framesSubmitted - framesDroppedBeforePack)}ms, avg send ${avg(transmitMs, framesSent)}ms, ` +
+      `render to send latency avg ${avg(latencyMs, framesSent)}ms max ${maxLatencyMs.toFixed(2)}ms`;
+  }
+
+  _resetStats() {
+    this.stats = {
+      startTime: performance.now(),
+      framesSubmitted: 0,
+      framesSent: 0,
+      framesDroppedBeforePack: 0,
+      framesDroppedBeforeSend: 0,
+      packMs: 0,
+      transmitMs: 0,
+      latencyMs: 0,
+      maxLatencyMs: 0,
+    };
+  }
+
+  _runPackStage() {
+    this._packImmediate = null;
+    const frame = this._packQueue.shift();
+    if (!frame) { return; }
+
+    const packedFrame = this._pack(frame);
+    if (this._transmitQueue.length >= this.depth) {
+      this._transmitQueue.shift();
+      this.stats.framesDroppedBeforeSend++;
+    }
+    this._transmitQueue.push(packedFrame);
+    if (this._transmitImmediate === null) {
+      this._transmitImmediate = setImmediate(this._runTransmitStage);
+    }
+
+    // Pack one frame per turn of the event loop so that the other stages get their turns in between
+    if (this._packQueue.length > 0) {
+      this._packImmediate = setImmediate(this._runPackStage);
+    }
+  }
+
+  _runTransmitStage() {
+    this._transmitImmediate = null;
+    const packedFrame = this._transmitQueue.shift();
+    if (!packedFrame) { return; }
+
+    this._transmit(packedFrame);
+    if (this._transmitQueue.length > 0) {
+      this._transmitImmediate = setImmediate(this._runTransmitStage);
+    }
+  }
+
+  _pack(frame) {
+    const startTime = performance.now();
+    let packedFrame = null;
+    try {
+      packedFrame = this.voxelServer.packVoxelData(frame.voxelData);
+    }
+    catch (err) {
+      console.error("Failed to pack frame: " + err);
+    }
+    this._releaseBuffer(frame.voxelData.data);
+    this.stats.packMs += performance.now() - startTime;
+    return {packedFrame, submitTime: frame.submitTime};
+  }
+
+  _transmit({packedFrame, submitTime}) {
+    const startTime = performance.now();
+    if (packedFrame) {
+      try {
+        this.voxelServer.transmitVoxelData(packedFrame);
+      }
+      catch (err) {
+        console.error("Failed to send frame: " + err);
+      }
+    }
+
+    const {stats} = this;
+    const endTime = performance.now();
+    const latencyMs = endTime - submitTime;
+    stats.framesSent++;
+    stats.transmitMs += endTime - startTime;
+    stats.latencyMs += latencyMs;
+    stats.maxLatencyMs = Math.max(stats.maxLatencyMs, latencyMs);
+    if (endTime - stats.startTime >= STATS_INTERVAL_MS) {
+      console.log(`Frame pipeline: ${this.statsSummary()}.`);
+      this._resetStats();
+    }
+  }
+
+  _acquireBuffer(length) {
+    while (this._freeBuffers.length > 0) {
+      const buffer = this._freeBuffers.pop();
+      if (buffer.length === length) { return buffer; }
+    }
+    return new Float32Array(length);
+  }
+
+  _releaseBuffer(buffer) {
+    // Only as many buffers as can be waiting to be packed (plus the one being packed) are ever needed
+    if (this._freeBuffers.length <= this.depth) {
+      this._freeBuffers.push(buffer);
+    }
+  }
+}
+
+export default FramePipeline;
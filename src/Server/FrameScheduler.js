@@ -0,0 +1,196 @@
+export const DEFAULT_FRAME_RATE_HZ = 60; // If this is too high then we overwhelm our clients
+
+// Most simulation steps that a single frame will catch up on, beyond that the simulated time is dropped
+const DEFAULT_MAX_CATCH_UP_STEPS = 4;
+// setTimeout is only good to a millisecond or so, the last bit of each wait yields with setImmediate instead
+const SPIN_THRESHOLD_MS = 2;
+// Slack for rounding when counting how many whole simulation steps fit into the elapsed time
+const STEP_EPSILON = 1e-6;
+// Upper bounds of the frame period histogram's buckets, in multiples of the frame interval
+const PERIOD_BUCKETS = [0.5, 0.9, 1.1, 1.5, 2, 3, 5, Infinity];
+const STATS_INTERVAL_MS = 30000;
+
+/**
+ * Runs frames on a fixed timeline: frame n is due at start + n*interval (on the monotonic, high resolution
+ * performance.now() clock) and each frame is started as close to its due time as possible, no matter how long the
+ * frames before it took.
+ *
+ * Overload is handled deterministically: a frame that finishes after the next one was due is a deadline miss and the
+ * next frame starts right away, any frame whose whole slot has passed by then is dropped (the timeline never shifts).
+ *
+ * Simulation runs in fixed steps of its own rate, decoupled from the frame rate. Each frame is told how much time to
+ * simulate, which is always a whole number of steps: usually one step per frame when the rates are the same, more
+ * after dropped frames (at most maxCatchUpSteps, the rest is dropped) and none on some frames when the simulation
+ * rate is the lower one.
+ *
+ * Frame periods (from the start of one frame to the next), deadline misses and drops are counted in stats, which are
+ * logged and reset every STATS_INTERVAL_MS.
+ */
+class FrameScheduler {
+  /**
+   * @param {Object} options
+   * @param {Number} options.frameRateHz - Target frames per second.
+   * @param {Number} options.simulationRateHz - Simulation steps per second, the frame rate by default.
+   * @param {Number} options.maxCatchUpSteps - Most simulation steps a single frame will run.
+   */
+  constructor(options={}) {
+    const {
+      frameRateHz = DEFAULT_FRAME_RATE_HZ,
+      simulationRateHz = frameRateHz,
+      maxCatchUpSteps = DEFAULT_MAX_CATCH_UP_STEPS,
+    } = options;
+
+    this.frameRateHz = frameRateHz;
+    this.simulationRateHz = simulationRateHz;
+    this.frameIntervalMs = 1000 / frameRateHz;
+    this.simulationStepMs = 1000 / simulationRateHz;
+    this.maxCatchUpSteps = Math.max(1, maxCatchUpSteps);
+
+    this._running = false;
+    this._timeout = null;
+    this._immediate = null;
+    this._wait = this._wait.bind(this);
+    this.resetStats();
+  }
+
+  /**
+   * Start running frames, the first one is due one frame interval from now.
+   * @param {Function} onFrame - Called (and awaited) for each frame with the time to simulate in seconds and the
+   * number of simulation steps that it's made of.
+   */
+  start(onFrame) {
+    this.stop();
+    this._onFrame = onFrame;
+    this._running = true;
+
+    const now = performance.now();
+    this._startTime = now;
+    this._nextFrameTime = now + this.frameIntervalMs;
+    this._lastFrameStart = null;
+    this._simulatedMs = 0;
+    this.resetStats();
+    this._wait();
+  }
+
+  stop() {
+    this._running = false;
+    if (this._timeout !== null) {
+      clearTimeout(this._timeout);
+      this._timeout = null;
+    }
+    if (this._immediate !== null) {
+      clearImmediate(this._immediate);
+      this._immediate = null;
+    }
+  }
+
+  resetStats() {
+    this.stats = {
+      startTime: performance.now(),
+      frames: 0,
+      deadlineMisses: 0,
+      droppedFrames: 0,
+      droppedSimulationSteps: 0,
+      workMs: 0,
+      maxWorkMs: 0,
+      maxPeriodMs: 0,
+      periodBucketsMs: PERIOD_BUCKETS.map(multiple => multiple*this.frameIntervalMs),
+      periodCounts: new Array(PERIOD_BUCKETS.length).fill(0),
+    };
+  }
+
+  /**
+   * One line summary of the stats, e.g., for logging.
+   */
+  statsSummary() {
+    const {frames, deadlineMisses, droppedFrames, droppedSimulationSteps, workMs, maxWorkMs, maxPeriodMs, periodBucketsMs, periodCounts} = this.stats;
+    const periods = [];
+    for (let i = 0; i < periodCounts.length; i++) {
+      if (periodCounts[i] > 0) {
+        const bound = periodBucketsMs[i] === Infinity ? "inf" : periodBucketsMs[i].toFixed(1);
+        periods.push(`<${bound}ms: ${periodCounts[i]}`);
+      }
+    }
+    return `${frames} frames at ${this.frameRateHz}Hz, ${deadlineMisses} deadline misses, ${droppedFrames} dropped frames ` +
+      `(${droppedSimulationSteps} simulation steps), work avg ${(workMs / Math.max(1, frames)).toFixed(2)}ms max ${maxWorkMs.toFixed(2)}ms, ` +
+      `period max ${maxPeriodMs.toFixed(2)}ms [${periods.join(", ")}]`;
+  }
+
+  _wait() {
+    this._timeout = null;
+    this._immediate = null;
+    if (!this._running) {
+      return;
+    }
+
+    const remainingMs = this._nextFrameTime - performance.now();
+    if (remainingMs > SPIN_THRESHOLD_MS) {
+      this._timeout = setTimeout(this._wait, remainingMs - SPIN_THRESHOLD_MS);
+    }
+    else if (remainingMs > 0) {
+      this._immediate = setImmediate(this._wait);
+    }
+    else {
+      this._runFrame();
+    }
+  }
+
+  async _runFrame() {
+    const frameStart = performance.now();
+    const dueTime = this._nextFrameTime;
+
+    // Simulate up to this frame's place on the timeline, in whole steps
+    const behindMs = (dueTime - this._startTime) - this._simulatedMs;
+    let numSteps = Math.max(0, Math.floor(behindMs / this.simulationStepMs + STEP_EPSILON));
+    if (numSteps > this.maxCatchUpSteps) {
+      this.stats.droppedSimulationSteps += numSteps - this.maxCatchUpSteps;
+      this._simulatedMs += (numSteps - this.maxCatchUpSteps)*this.simulationStepMs;
+      numSteps = this.maxCatchUpSteps;
+    }
+    this._simulatedMs += numSteps*this.simulationStepMs;
+
+    try {
+      await this._onFrame(numSteps*this.simulationStepMs / 1000, numSteps);
+    }
+    catch (err) {
+      console.error("Frame failed: " + err);
+    }
+
+    const frameEnd = performance.now();
+    this._updateStats(frameStart, frameEnd);
+    if (frameEnd - this.stats.startTime >= STATS_INTERVAL_MS) {
+      console.log(`Frame scheduler: ${this.statsSummary()}.`);
+      this.resetStats();
+    }
+
+    // The next frame is due one interval later, if we're already past that then it's late and starts now. Any
+    // frames whose slots have passed completely are dropped.
+    this._nextFrameTime = dueTime + this.frameIntervalMs;
+    if (frameEnd > this._nextFrameTime) {
+      this.stats.deadlineMisses++;
+      const numDropped = Math.floor((frameEnd - this._nextFrameTime) / this.frameIntervalMs);
+      this.stats.droppedFrames += numDropped;
+      this._nextFrameTime += numDropped*this.frameIntervalMs;
+    }
+    this._wait();
+  }
+
+  _updateStats(frameStart, frameEnd) {
+    const {stats} = this;
+    const workMs = frameEnd - frameStart;
+    stats.frames++;
+    stats.workMs += workMs;
+    stats.maxWorkMs = Math.max(stats.maxWorkMs, workMs);
+
+    if (this._lastFrameStart !== null) {
+      const periodMs = frameStart - this._lastFrameStart;
+      stats.maxPeriodMs = Math.max(stats.maxPeriodMs, periodMs);
+      let bucket = 0;
+      while (periodMs >= stats.periodBucketsMs[bucket]) { bucket++; }
+      stats.periodCounts[bucket]++;
+    }
+    this._lastFrameStart = frameStart;
+  }
+}
+
+export default FrameScheduler;
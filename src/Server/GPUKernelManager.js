@@ -2,17 +2,29 @@ import {GPU} from 'gpu.js';
 
 import VoxelConstants from '../VoxelConstants';
 import {FIRE_SPECTRUM_WIDTH} from '../Spectrum';
+import GPUTexturePool from './GPUTexturePool';
 
 class GPUKernelManager {
-  constructor(gridSize) {
-    this.gpu = new GPU({mode: 'headlessgl'});
+  constructor(xSize, ySize, zSize) {
+    // Without headless GL (e.g., a server with no GPU) the kernels run on the CPU, see GPUTexturePool
+    const mode = GPU.isHeadlessGLSupported ? 'headlessgl' : 'cpu';
+    if (mode === 'cpu') {
+      console.log("Headless GL isn't supported, running the GPU kernels on the CPU.");
+    }
+    this.gpu = new GPU({mode});
+    // Outputs of the immutable kernels belong to their callers, who give them back with texturePool.release
+    this.texturePool = new GPUTexturePool();
+
+    // The cubic simulations and visualizers are sized by the largest dimension of the grid
+    const gridSize = Math.max(xSize, ySize, zSize);
 
     this.gpu.addFunction(function clampValue(value, min, max) {
       return Math.min(max, Math.max(min, value));
     });
 
+    // Voxel (x,y,z) is computed by thread (z,y,x)
     this.pipelineFuncSettings = {
-      output: [gridSize, gridSize, gridSize],
+      output: [zSize, ySize, xSize],
       pipeline: true, // We use pipelining for most things in order to get a texture output from kernels
       constants: {
         VOXEL_ERR_UNITS_SQR: VoxelConstants.VOXEL_ERR_UNITS*VoxelConstants.VOXEL_ERR_UNITS,
@@ -27,31 +39,41 @@ class GPUKernelManager {
     // Setup the GPU/Compute kernels...
 
     // Utility kernels
-    this.clearFunc = this.gpu.createKernel(function(colour) {
+    this.clearFunc = this._createKernel('clearFunc', function(colour) {
       return [colour[0], colour[1], colour[2]];
     }, {...this.pipelineFuncSettings, immutable: false, argumentTypes: {colour: 'Array(3)'}});
 
-    this.multiplyColourFunc = this.gpu.createKernel(function(pipelineTex, colour) {
+    this.multiplyColourFunc = this._createKernel('multiplyColourFunc', function(pipelineTex, colour) {
       const currVoxel = pipelineTex[this.thread.z][this.thread.y][this.thread.x];
       return [currVoxel[0]*colour[0], currVoxel[1]*colour[1], currVoxel[2]*colour[2]];
     }, {...this.pipelineFuncSettings, argumentTypes: {pipelineTex: 'Array3D(3)', colour: 'Array(3)'}});
 
     // Framebuffer combination kernels
-    this.addFramebuffersFunc = this.gpu.createKernel(function(framebufTexA, framebufTexB) {
+    this.addFramebuffersFunc = this._createKernel('addFramebuffersFunc', function(framebufTexA, framebufTexB) {
       const fbAVoxel = framebufTexA[this.thread.z][this.thread.y][this.thread.x];
       const fbBVoxel = framebufTexB[this.thread.z][this.thread.y][this.thread.x];
       return [clampValue(fbAVoxel[0]+fbBVoxel[0], 0.0, 1.0), clampValue(fbAVoxel[1]+fbBVoxel[1], 0.0, 1.0), clampValue(fbAVoxel[2]+fbBVoxel[2], 0.0, 1.0)];
     }, {...this.pipelineFuncSettings, argumentTypes: {framebufTexA: 'Array3D(3)', framebufTexB: 'Array3D(3)'}});
 
-    this.copyFramebufferFunc = this.gpu.createKernel(function(framebufTex) {
+    this.copyFramebufferFunc = this._createKernel('copyFramebufferFunc', function(framebufTex) {
       return framebufTex[this.thread.z][this.thread.y][this.thread.x];
     }, {...this.pipelineFuncSettings, argumentTypes: {framebufTex: 'Array3D(3)'}});
     
-    this.copyFramebufferFuncImmutable = this.gpu.createKernel(function(framebufTex) {
+    this.copyFramebufferFuncImmutable = this._createKernel('copyFramebufferFuncImmutable', function(framebufTex) {
       return framebufTex[this.thread.z][this.thread.y][this.thread.x];
     }, {...this.pipelineFuncSettings, immutable: true, argumentTypes: {framebufTex: 'Array3D(3)'}});
     
-    this.combineFramebuffersAlphaOneMinusAlphaFunc = this.gpu.createKernel(function(fb1Tex, fb2Tex, alpha, oneMinusAlpha) {
+    // Copies a flat CPU framebuffer, given as input(buffer, [3*zSize, ySize, xSize]) (see VoxelFramebufferCPU)
+    this.copyFlatFramebufferFuncImmutable = this._createKernel('copyFlatFramebufferFuncImmutable', function(flatFramebuf) {
+      const idx = this.thread.x*3;
+      return [
+        flatFramebuf[this.thread.z][this.thread.y][idx],
+        flatFramebuf[this.thread.z][this.thread.y][idx+1],
+        flatFramebuf[this.thread.z][this.thread.y][idx+2]
+      ];
+    }, {...this.pipelineFuncSettings, immutable: true});
+
+    this.combineFramebuffersAlphaOneMinusAlphaFunc = this._createKernel('combineFramebuffersAlphaOneMinusAlphaFunc', function(fb1Tex, fb2Tex, alpha, oneMinusAlpha) {
       const fb1Voxel = fb1Tex[this.thread.z][this.thread.y][this.thread.x];
       const fb2Voxel = fb2Tex[this.thread.z][this.thread.y][this.thread.x];
       return [
@@ -63,14 +85,14 @@ class GPUKernelManager {
 
     // Animation-specific Kernels
     /*
-    this.boxFillMaskFunc = this.gpu.createKernel(function(minPt, maxPt) {
+    this.boxFillMaskFunc = this._createKernel('boxFillMaskFunc', function(minPt, maxPt) {
       const currVoxelPos = [this.thread.z, this.thread.y, this.thread.x];
       return (currVoxelPos[0] > minPt[0] && currVoxelPos[0] < maxPt[0] &&
               currVoxelPos[1] > minPt[1] && currVoxelPos[1] < maxPt[1] &&
               currVoxelPos[2] > minPt[2] && currVoxelPos[2] < maxPt[2]) 
           ? [1.0, 1.0, 1.0] : [0.0, 0.0, 0.0];
     }, this.pipelineFuncSettings);
-    this.boxOutlineMaskFunc = this.gpu.createKernel(function(minPt, maxPt) {
+    this.boxOutlineMaskFunc = this._createKernel('boxOutlineMaskFunc', function(minPt, maxPt) {
       const currVoxelPos = [this.thread.z, this.thread.y, this.thread.x];
       // Is the voxel within the outer boundary voxels of the box?
       const dx = Math.max(Math.max(minPt[0] - currVoxelPos[0], 0), currVoxelPos[0] - maxPt[0]);
@@ -79,14 +101,14 @@ class GPUKernelManager {
       const sqrDist = dx*dx + dy*dy + dz*dz;
       return (sqrDist < this.constants.VOXEL_ERR_UNITS_SQR) ? [1.0, 1.0, 1.0] : [0.0, 0.0, 0.0];
     }, this.pipelineFuncSettings);
-    this.sphereOutlineMaskFunc = this.gpu.createKernel(function(c, rSqr) {
+    this.sphereOutlineMaskFunc = this._createKernel('sphereOutlineMaskFunc', function(c, rSqr) {
       // Check whether the voxel is on the outside-ish of the sphere
       const currVoxelPos = [this.thread.z, this.thread.y, this.thread.x];
       // Find the squared distance from the center of the sphere to the voxel
       const sqrDist = Math.pow(currVoxelPos[0]-c[0],2) + Math.pow(currVoxelPos[1]-c[1],2) + Math.pow(currVoxelPos[2]-c[2],2);
       return Math.abs(rSqr-sqrDist) <= this.constants.VOXEL_ERR_UNITS_SQR ?  [1.0, 1.0, 1.0]  : [0.0, 0.0, 0.0];
     }, this.pipelineFuncSettings);
-    this.overwriteMaskedColourFuncImmutable = this.gpu.createKernel(function(framebufTex, maskTex, colour) {
+    this.overwriteMaskedColourFuncImmutable = this._createKernel('overwriteMaskedColourFuncImmutable', function(framebufTex, maskTex, colour) {
       const originalVoxel = framebufTex[this.thread.z][this.thread.y][this.thread.x];
       const maskVoxel  = maskTex[this.thread.z][this.thread.y][this.thread.x];
       return maskVoxel[0] <= 0 ? [originalVoxel[0], originalVoxel[1], originalVoxel[2]] : [colour[0], colour[1], colour[2]];
@@ -98,7 +120,7 @@ class GPUKernelManager {
         framebufTex: 'Array3D(3)', c: 'Array(3)', radiiSqr: 'Array', colours: 'Array1D(3)', brightness: 'Float', numSpheres: 'Integer'
       }
     }
-    this.spheresFillOverwrite = this.gpu.createKernel(function(framebufTex, c, radiiSqr, colours, brightness) {
+    this.spheresFillOverwrite = this._createKernel('spheresFillOverwrite', function(framebufTex, c, radiiSqr, colours, brightness) {
       // Find the squared distance from the center of the sphere to the voxel
       const currVoxelPos = [this.thread.z, this.thread.y, this.thread.x];
       const framebufColour = framebufTex[this.thread.z][this.thread.y][this.thread.x];
@@ -114,7 +136,7 @@ class GPUKernelManager {
       return [framebufColour[0], framebufColour[1], framebufColour[2]];
     }, shapesDrawSettings);
 
-    this.cubesFillOverwrite = this.gpu.createKernel(function(framebufTex, c, radii, colours, brightness) {
+    this.cubesFillOverwrite = this._createKernel('cubesFillOverwrite', function(framebufTex, c, radii, colours, brightness) {
       // Find the squared distance from the center of the sphere to the voxel
       const currVoxelPos = [this.thread.z, this.thread.y, this.thread.x];
       const framebufColour = framebufTex[this.thread.z][this.thread.y][this.thread.x];
@@ -147,7 +169,7 @@ class GPUKernelManager {
       returnType: 'Array(4)',
       argumentTypes: {spectrum: 'Array1D(4)'}
     };
-    this.fireLookupGen = this.gpu.createKernel(function(spectrum) {
+    this.fireLookupGen = this._createKernel('fireLookupGen', function(spectrum) {
       const idx = this.thread.x;
       const result = [0,0,0,0];
       if (idx >= this.constants.FIRE_THRESHOLD) {
@@ -160,7 +182,7 @@ class GPUKernelManager {
       return result;
     }, fireLookupSettings);
 
-    this.fireOverwrite = this.gpu.createKernel(function(fireLookup, temperatureArr, offsetXYZ) {
+    this.fireOverwrite = this._createKernel('fireOverwrite', function(fireLookup, temperatureArr, offsetXYZ) {
       const temperature = temperatureArr[this.thread.z + offsetXYZ[2]][this.thread.y + offsetXYZ[1]][this.thread.x + offsetXYZ[0]];
       const temperatureIdx = clampValue(Math.round(temperature*(this.constants.FIRE_SPECTRUM_WIDTH-1)), 0, this.constants.FIRE_SPECTRUM_WIDTH-1);
       const voxelColour = fireLookup[temperatureIdx];
@@ -175,7 +197,7 @@ class GPUKernelManager {
       constants: {...this.pipelineFuncSettings.constants, FIRE_SPECTRUM_WIDTH: FIRE_SPECTRUM_WIDTH}
     });
 
-    this.waterOverwrite = this.gpu.createKernel(function(waterLookup, airLookup, levelSet, boundaryBuf, levelEpsilon, offsetXYZ) {
+    this.waterOverwrite = this._createKernel('waterOverwrite', function(waterLookup, airLookup, levelSet, boundaryBuf, levelEpsilon, offsetXYZ) {
       // The water level is negative if in water, 0 at boundary, and positive outside of the water
       const x = this.thread.z + offsetXYZ[2];
       const y = this.thread.y + offsetXYZ[1];
@@ -190,7 +212,7 @@ class GPUKernelManager {
       argumentTypes: { waterLookup: 'Array1D(4)', airLookup: 'Array1D(4)', levelSet: 'Array', boundaryBuf: 'Array', levelEpsilon: 'Float', offsetXYZ: 'Array'},
     });
 
-    this.simpleWaterOverwrite = this.gpu.createKernel(function(
+    this.simpleWaterOverwrite = this._createKernel('simpleWaterOverwrite', function(
       cells, pressure, vel, maxLiquidVol, offsetXYZ) {
 
       const x = this.thread.z + offsetXYZ[2];
@@ -210,6 +232,14 @@ class GPUKernelManager {
     });
   }
 
+  _createKernel(name, kernelFunc, settings) {
+    return this.texturePool.trackKernel(name, () => this.gpu.createKernel(kernelFunc, settings), settings);
+  }
+  // For kernels that are run on their own outputs, see GPUTexturePool.trackPingPongKernel
+  _createPingPongKernel(name, kernelFunc, settings) {
+    return this.texturePool.trackPingPongKernel(name, () => this.gpu.createKernel(kernelFunc, settings), settings);
+  }
+
   initFluidKernels(N) {
     if (this._fluidKernelsInit) { return; }
 
@@ -254,10 +284,10 @@ class GPUKernelManager {
       return y0 + (x-x0) * ((y1-y0) / (x1 - x0 + 0.00001));
     });
 
-    this.initFluidBufferFunc = this.gpu.createKernel(function(value) {
+    this.initFluidBufferFunc = this._createKernel('initFluidBufferFunc', function(value) {
       return value;
     }, {...pipelineFuncSettings, argumentTypes: {value: 'Float'}});
-    this.initFluidBuffer3Func = this.gpu.createKernel(function(x,y,z) {
+    this.initFluidBuffer3Func = this._createKernel('initFluidBuffer3Func', function(x,y,z) {
       return [x, y, z];
     }, {...pipelineFuncSettings, returnType: 'Array(3)', argumentTypes: {x: 'Float', y: 'Float', z: 'Float'}});
     
@@ -286,18 +316,18 @@ class GPUKernelManager {
     const ARRAY3D_TYPE = 'Array';
     const ARRAY3D_3_TYPE = 'Array3D(3)';
     
-    this.addFluidSourceFunc = this.gpu.createKernel(function(srcBuffer, dstBuffer, dt) {
+    this.addFluidSourceFunc = this._createKernel('addFluidSourceFunc', function(srcBuffer, dstBuffer, dt) {
       const [i,j,k] = ijkLookup();
       return dstBuffer[i][j][k] + srcBuffer[i][j][k] * dt;
     }, {...pipelineFuncSettings, returnType: 'Float', argumentTypes: {srcBuffer: ARRAY3D_TYPE, dstBuffer: ARRAY3D_TYPE, dt: 'Float'}});
 
-    this.addBuoyancyFunc = this.gpu.createKernel(function(T, uvw, dtBuoy) {
+    this.addBuoyancyFunc = this._createKernel('addBuoyancyFunc', function(T, uvw, dtBuoy) {
       const [i,j,k] = ijkLookup();
       const uvwVec = uvw[i][j][k];
       return [uvwVec[0], uvwVec[1]  + T[i][j][k] * dtBuoy, uvwVec[2]];
     }, {...pipelineFuncSettings, returnType: 'Array(3)', argumentTypes: {T: ARRAY3D_TYPE, uvw: ARRAY3D_3_TYPE, dtBuoy: 'Float'}});
 
-    this.diffuseStepFunc = this.gpu.createKernel(function (x0, x, a, boundaryBuf) {
+    this.diffuseStepFunc = this._createPingPongKernel('diffuseStepFunc', function (x0, x, a, boundaryBuf) {
       const [i,j,k] = ijkLookup();
       if (i < 1 || j < 1 || k < 1 || i > this.constants.N || j > this.constants.N || k > this.constants.N) {
         return x[i][j][k];
@@ -316,7 +346,7 @@ class GPUKernelManager {
       }
     });
 
-    this.diffuseStep3Func = this.gpu.createKernel(function (uvw0, uvw, a, boundaryBuf) {
+    this.diffuseStep3Func = this._createPingPongKernel('diffuseStep3Func', function (uvw0, uvw, a, boundaryBuf) {
       const [i,j,k] = ijkLookup();
       const uvwijk = uvw[i][j][k];
       if (i < 1 || j < 1 || k < 1 || i > this.constants.N || j > this.constants.N || k > this.constants.N) {
@@ -342,7 +372,7 @@ class GPUKernelManager {
       }
     });
     
-    this.advectCoolFunc = this.gpu.createKernel(function (x0, x, uuvvww, dt0, c0, boundaryBuf) {
+    this.advectCoolFunc = this._createPingPongKernel('advectCoolFunc', function (x0, x, uuvvww, dt0, c0, boundaryBuf) {
       const [i,j,k] = ijkLookup();
       if (boundaryBuf[i][j][k] > this.constants.BOUNDARY) {
         return 0;
@@ -370,7 +400,7 @@ class GPUKernelManager {
         }
     });
 
-    this.advect3Func = this.gpu.createKernel(function(uvw0, uvw, dt0, boundaryBuf) {
+    this.advect3Func = this._createKernel('advect3Func', function(uvw0, uvw, dt0, boundaryBuf) {
       const [i,j,k] = ijkLookup();
       if (boundaryBuf[i][j][k] > this.constants.BOUNDARY) {
         return [0,0,0];
@@ -409,7 +439,7 @@ class GPUKernelManager {
     }, {...pipelineFuncSettings, returnType: 'Array(3)', 
         argumentTypes: { uvw0: ARRAY3D_3_TYPE, uvw: ARRAY3D_3_TYPE, dt0: 'Float', boundaryBuf: ARRAY3D_TYPE}});
 
-    this.projectStep1Func = this.gpu.createKernel(function(uvw0, uvw) {
+    this.projectStep1Func = this._createKernel('projectStep1Func', function(uvw0, uvw) {
       const [i,j,k] = ijkLookup();
       const uvw0ijk = uvw0[i][j][k];
       if (i < 1 || j < 1 || k < 1 ||  i > this.constants.N || j > this.constants.N || k > this.constants.N) {
@@ -428,7 +458,7 @@ class GPUKernelManager {
       ];
     }, {...pipelineFuncSettings, returnType: 'Array(3)', argumentTypes: {uvw0: ARRAY3D_3_TYPE, uvw: ARRAY3D_3_TYPE}});
 
-    this.projectStep2Func = this.gpu.createKernel(function(uvw0) {
+    this.projectStep2Func = this._createPingPongKernel('projectStep2Func', function(uvw0) {
       const [i,j,k] = ijkLookup();
       const uvw0ijk = uvw0[i][j][k];
       if (i < 1 || j < 1 || k < 1 ||  i > this.constants.N || j > this.constants.N || k > this.constants.N) {
@@ -450,7 +480,7 @@ class GPUKernelManager {
       ];
     }, {...pipelineFuncSettings, returnType: 'Array(3)', argumentTypes: {uvw0: ARRAY3D_3_TYPE}});
 
-    this.projectStep3Func = this.gpu.createKernel(function(uvw, uvw0, boundaryBuf) {
+    this.projectStep3Func = this._createKernel('projectStep3Func', function(uvw, uvw0, boundaryBuf) {
       const [i,j,k] = ijkLookup();
       const uvwijk = uvw[i][j][k];
       const obstVel = [0,0,0];
@@ -497,7 +527,7 @@ class GPUKernelManager {
       }
     });
 
-    this.curlFunc = this.gpu.createKernel(function(curlxyz, uvw) {
+    this.curlFunc = this._createKernel('curlFunc', function(curlxyz, uvw) {
       const [i,j,k] = ijkLookup();
       if (i < 1 || j < 1 || k < 1 ||  i > this.constants.N || j > this.constants.N || k > this.constants.N) {
         return curlxyz[i][j][k];
@@ -516,7 +546,7 @@ class GPUKernelManager {
       ];
     },  {...pipelineFuncSettings, returnType: 'Array(3)', argumentTypes: {curlxyz: ARRAY3D_3_TYPE, uvw: ARRAY3D_3_TYPE}});
 
-    this.vorticityConfinementStep1Func = this.gpu.createKernel(function(curlxyz) {
+    this.vorticityConfinementStep1Func = this._createKernel('vorticityConfinementStep1Func', function(curlxyz) {
       const [i,j,k] = ijkLookup();
       const curlxyzijk = curlxyz[i][j][k];
       const x = curlxyzijk[0];
@@ -525,7 +555,7 @@ class GPUKernelManager {
       return Math.sqrt(x*x + y*y + z*z);
     }, {...pipelineFuncSettings, returnType: 'Float', argumentTypes: {curlxyz: ARRAY3D_3_TYPE}});
   
-    this.vorticityConfinementStep2Func = this.gpu.createKernel(function(uvw, T0, curlxyz, dt0) {
+    this.vorticityConfinementStep2Func = this._createKernel('vorticityConfinementStep2Func', function(uvw, T0, curlxyz, dt0) {
       const [i,j,k] = ijkLookup();
       const uvwVal  = uvw[i][j][k];
       if (i < 1 || j < 1 || k < 1 ||  i > this.constants.N || j > this.constants.N || k > this.constants.N) {
@@ -695,7 +725,7 @@ class GPUKernelManager {
     });
    
 
-    this.injectLiquidSphere = this.gpu.createKernel(function(center, radius, levelSet, boundaryBuf) {
+    this.injectLiquidSphere = this._createKernel('injectLiquidSphere', function(center, radius, levelSet, boundaryBuf) {
       const [x,y,z] = xyzLookup();
       const centerToLookup = [x-center[0], y-center[1], z-center[2]];
       const lsVal = length3(centerToLookup) - radius;
@@ -705,7 +735,7 @@ class GPUKernelManager {
       center: 'Array', radius: 'Float', levelSet: 'Array', boundaryBuf: 'Array'
     }});
 
-    this.injectForceBlob = this.gpu.createKernel(function(center, impulseStrength, size, vel, boundaryBuf) {
+    this.injectForceBlob = this._createKernel('injectForceBlob', function(center, impulseStrength, size, vel, boundaryBuf) {
       const [x,y,z] = xyzLookup();
       if (boundaryBuf[x][y][z] > this.constants.BOUNDARY || x < 1 || y < 1 || z < 1 || 
           x > this.constants.N || y > this.constants.N || z > this.constants.N) { return [0,0,0]; }
@@ -718,14 +748,14 @@ class GPUKernelManager {
       center: 'Array', impulseStrength: 'Float', size: 'Float', vel: 'Array3D(3)', boundaryBuf: 'Array'
     }});
 
-    this.pressureDiff = this.gpu.createKernel(function(p0, p1) {
+    this.pressureDiff = this._createKernel('pressureDiff', function(p0, p1) {
       const [x,y,z] = xyzLookup();
       return p0[x][y][z] - p1[x][y][z];
     }, {...pipelineFuncSettings, returnType: 'Float', argumentTypes: {
       p0: 'Array', p1: 'Array',
     }});
 
-    this.advectLiquidLevelSet = this.gpu.createKernel(function(dt, vel, levelSet, boundaryBuf, forward, decay) {
+    this.advectLiquidLevelSet = this._createKernel('advectLiquidLevelSet', function(dt, vel, levelSet, boundaryBuf, forward, decay) {
       const [x,y,z] = xyzLookup();
       if (boundaryBuf[x][y][z] > this.constants.BOUNDARY || x < 1 || y < 1 || z < 1 ||
           x > this.constants.N || y > this.constants.N || z > this.constants.N) { return levelSet[x][y][z]; }
@@ -742,7 +772,7 @@ class GPUKernelManager {
     }, {...pipelineFuncSettings, returnType: 'Float', argumentTypes: {
       dt: 'Float', vel: 'Array3D(3)', levelSet: 'Array', boundaryBuf: 'Array', forward: 'Float', decay: 'Float'
     }})
-    this.advectLiquidLevelSetOrder2 = this.gpu.createKernel(function(
+    this.advectLiquidLevelSetOrder2 = this._createKernel('advectLiquidLevelSetOrder2', function(
       dt, vel, phiN, phi1, boundaryBuf) {
 
       const [x,y,z] = xyzLookup();
@@ -758,7 +788,7 @@ class GPUKernelManager {
     }, {...pipelineFuncSettings, returnType: 'Float', argumentTypes: {
       dt: 'Float', vel: 'Array3D(3)', phiN: 'Array', phi1: 'Array', boundaryBuf: 'Array'
     }});
-    this.advectLiquidLevelSetOrder3 = this.gpu.createKernel(function(
+    this.advectLiquidLevelSetOrder3 = this._createKernel('advectLiquidLevelSetOrder3', function(
       dt, vel, phiN, phi2, boundaryBuf, decay, damping) {
 
       const [x,y,z] = xyzLookup();
@@ -778,7 +808,7 @@ class GPUKernelManager {
       decay: 'Float', damping: 'Float'
     }});
 
-    this.rungeKuttaLevelSet = this.gpu.createKernel(function(levelSetN, levelSetNPlus2, boundaryBuf) {
+    this.rungeKuttaLevelSet = this._createKernel('rungeKuttaLevelSet', function(levelSetN, levelSetNPlus2, boundaryBuf) {
       const [x,y,z] = xyzLookup();
       if (boundaryBuf[x][y][z] > this.constants.BOUNDARY || x < 1 || y < 1 || z < 1 || 
           x > this.constants.N || y > this.constants.N || z > this.constants.N) { return levelSetN[x][y][z]; }
@@ -787,7 +817,7 @@ class GPUKernelManager {
       levelSetN: 'Array', levelSetNPlus2: 'Array', boundaryBuf: 'Array'
     }});
 
-    this.reinitLevelSet = this.gpu.createKernel(function(dt, levelSet0, levelSetN, boundaryBuf, damping) {
+    this.reinitLevelSet = this._createPingPongKernel('reinitLevelSet', function(dt, levelSet0, levelSetN, boundaryBuf, damping) {
       const [x,y,z] = xyzLookup();
 
       if (boundaryBuf[x][y][z] > this.constants.BOUNDARY || x < 1 || y < 1 || z < 1 || 
@@ -963,7 +993,7 @@ class GPUKernelManager {
       dt: 'Float', levelSet0: 'Array', levelSetN: 'Array', boundaryBuf: 'Array', damping: 'Float'
     }});
 
-    this.advectLiquidVelocity = this.gpu.createKernel(function(dt, vel0, boundaryBuf, damping) {
+    this.advectLiquidVelocity = this._createKernel('advectLiquidVelocity', function(dt, vel0, boundaryBuf, damping) {
       const [x,y,z] = xyzLookup();
       const u = vel0[x][y][z];
 
@@ -1007,7 +1037,7 @@ class GPUKernelManager {
       dt: 'Float', vel0: 'Array3D(3)', boundaryBuf: 'Array', damping: 'Float'
     }});
 
-    this.applyLiquidVorticity = this.gpu.createKernel(function(vel, boundaryBuf, levelSet) {
+    this.applyLiquidVorticity = this._createKernel('applyLiquidVorticity', function(vel, boundaryBuf, levelSet) {
       const [x,y,z] = xyzLookup();
       if (boundaryBuf[x][y][z] > this.constants.BOUNDARY || x < 1 || y < 1 || z < 1 || 
           x > this.constants.N || y > this.constants.N || z > this.constants.N) { return vel[x][y][z]; }
@@ -1022,7 +1052,7 @@ class GPUKernelManager {
       ];
     }, {...pipelineFuncSettings, returnType: 'Array(3)', argumentTypes:{vel: 'Array3D(3)', boundaryBuf: 'Array', levelSet: 'Array'}});
 
-    this.applyLiquidConfinement = this.gpu.createKernel(function(dt, epsilon, tempVec3, vel, boundaryBuf, levelSet) {
+    this.applyLiquidConfinement = this._createKernel('applyLiquidConfinement', function(dt, epsilon, tempVec3, vel, boundaryBuf, levelSet) {
       const [x,y,z] = xyzLookup();
       let velxyz = vel[x][y][z];
       if (boundaryBuf[x][y][z] > this.constants.BOUNDARY || x < 1 || y < 1 || z < 1 || 
@@ -1047,7 +1077,7 @@ class GPUKernelManager {
       dt: 'Float', epsilon: 'Float', tempVec3: 'Array3D(3)', vel: 'Array3D(3)', boundaryBuf: 'Array', levelSet: 'Array'
     }});
 
-    this.computeLiquidVelDiv = this.gpu.createKernel(function(vel, levelSet, levelEpsilon, boundaryBuf) {
+    this.computeLiquidVelDiv = this._createKernel('computeLiquidVelDiv', function(vel, levelSet, levelEpsilon, boundaryBuf) {
       const [x,y,z] = xyzLookup();
 
       if (levelSet[x][y][z] > 2 || boundaryBuf[x][y][z] > this.constants.BOUNDARY || x < 1 || y < 1 || z < 1 || 
@@ -1071,7 +1101,7 @@ class GPUKernelManager {
       vel:'Array3D(3)', levelSet: 'Array', levelEpsilon: 'Float', boundaryBuf:'Array'
     }});
 
-    this.applyExternalForcesToLiquid = this.gpu.createKernel(function(dt, force, vel, levelSet, levelEpsilon, boundaryBuf) {
+    this.applyExternalForcesToLiquid = this._createKernel('applyExternalForcesToLiquid', function(dt, force, vel, levelSet, levelEpsilon, boundaryBuf) {
       const [x,y,z] = xyzLookup();
       const u = vel[x][y][z];
 
@@ -1090,7 +1120,7 @@ class GPUKernelManager {
       levelEpsilon: 'Float', boundaryBuf: 'Array'
     }});
 
-    this.jacobiLiquid = this.gpu.createKernel(function(pressure, tempScalar, boundaryBuf, levelSet, levelEpsilon) {
+    this.jacobiLiquid = this._createPingPongKernel('jacobiLiquid', function(pressure, tempScalar, boundaryBuf, levelSet, levelEpsilon) {
       const [x,y,z] = xyzLookup();
       const pC = pressure[x][y][z]; //heavisideP(levelSet[x][y][z], pressure[x][y][z], levelEpsilon);
       if (boundaryBuf[x][y][z] > this.constants.BOUNDARY || x < 1 || y < 1 || z < 1 || 
@@ -1128,7 +1158,7 @@ class GPUKernelManager {
       pressure: 'Array', tempScalar: 'Array', boundaryBuf: 'Array', levelSet: 'Array', levelEpsilon: 'Float'
     }});
 
-    this.projectLiquidVelocity = this.gpu.createKernel(function(pressure, vel, boundaryBuf, levelSet, levelEpsilon, modulate) {
+    this.projectLiquidVelocity = this._createKernel('projectLiquidVelocity', function(pressure, vel, boundaryBuf, levelSet, levelEpsilon, modulate) {
       const [x,y,z] = xyzLookup();
       
 
@@ -1219,7 +1249,7 @@ class GPUKernelManager {
       },
     };
 
-    this.initBarVisualizerBuffer3Func = this.gpu.createKernel(function(valueX, valueY, valueZ, valueW) {
+    this.initBarVisualizerBuffer3Func = this._createKernel('initBarVisualizerBuffer3Func', function(valueX, valueY, valueZ, valueW) {
       return [valueX, valueY, valueZ, valueW];
     }, {...barVisFuncSettings, immutable: true, argumentTypes: {valueX: 'Float', valueY: 'Float', valueZ: 'Float', valueW: 'Float'}});
 
@@ -1274,23 +1304,23 @@ class GPUKernelManager {
 
     const barVisArgs = {audioLevels: 'Array', levelMax: 'Float', fadeFactor: 'Float', levelColours: 'Array', prevVisTex: 'Array3D(4)', dt: 'Float'};
 
-    this.staticBarVisFunc = this.gpu.createKernel(function(audioLevels, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
+    this.staticBarVisFunc = this._createPingPongKernel('staticBarVisFunc', function(audioLevels, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
       const cutoff = barVisCutoff(audioLevels, levelMax, this.constants.gridSize);
       return drawBarVis(prevVisTex, levelColours, cutoff, this.constants.gridSize, fadeFactor, dt, this.thread.y, 0.02);
     }, {...barVisFuncSettings, immutable: true, argumentTypes: barVisArgs});
 
-    this.staticSplitLevelBarVisFunc = this.gpu.createKernel(function(audioLevels, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
+    this.staticSplitLevelBarVisFunc = this._createPingPongKernel('staticSplitLevelBarVisFunc', function(audioLevels, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
       const cutoff = barVisCutoff(audioLevels, levelMax, this.constants.halfGridSize);
       const yIndex = Math.floor(Math.abs(this.thread.y + 1 - this.constants.halfGridSize));
       return drawBarVis(prevVisTex, levelColours, cutoff, this.constants.halfGridSize, fadeFactor, dt, yIndex, 0.02);
     }, {...barVisFuncSettings, immutable: true, argumentTypes: barVisArgs});
 
-    this.staticCenteredBarVisFunc = this.gpu.createKernel(function(audioLevels, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
+    this.staticCenteredBarVisFunc = this._createPingPongKernel('staticCenteredBarVisFunc', function(audioLevels, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
       const cutoff = barVisCutoffCentered(audioLevels, levelMax, this.constants.gridSize);
       return drawBarVis(prevVisTex, levelColours, cutoff, this.constants.gridSize, fadeFactor, dt, this.thread.y, 0.01);
     }, {...barVisFuncSettings, immutable: true, argumentTypes: barVisArgs});
 
-    this.staticCenteredSplitLevelBarVisFunc = this.gpu.createKernel(function(audioLevels, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
+    this.staticCenteredSplitLevelBarVisFunc = this._createPingPongKernel('staticCenteredSplitLevelBarVisFunc', function(audioLevels, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
       const cutoff = barVisCutoffCentered(audioLevels, levelMax, this.constants.halfGridSize);
       const yIndex = Math.floor(Math.abs(this.thread.y + 1 - this.constants.halfGridSize));
       return drawBarVis(prevVisTex, levelColours, cutoff, this.constants.halfGridSize, fadeFactor, dt, yIndex, 0.01);
@@ -1298,7 +1328,7 @@ class GPUKernelManager {
 
 
     const historyBarVisArgs = {audioHistoryLevels: 'Array', directionVec: 'Array', levelMax: 'Float', fadeFactor: 'Float', levelColours: 'Array', prevVisTex: 'Array3D(4)', dt: 'Float'};
-    this.historyBarVisFunc = this.gpu.createKernel(function(audioHistoryLevels, directionVec, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
+    this.historyBarVisFunc = this._createPingPongKernel('historyBarVisFunc', function(audioHistoryLevels, directionVec, levelMax, fadeFactor, levelColours, prevVisTex, dt) {
       // The audioHistoryLevels is 2D history buffer - depending on the given direction we may have to reverse how we look-up into it
       let historyIdx = Math.floor(directionVec[0]*this.thread.z + directionVec[1]*this.thread.x);
       let levelIdx = Math.floor(directionVec[1]*this.thread.z + directionVec[0]*this.thread.x);
@@ -1311,14 +1341,14 @@ class GPUKernelManager {
       return drawBarVis(prevVisTex, levelColours, cutoff, this.constants.gridSize, fadeFactor, dt, this.thread.y, 0.02);
     }, {...barVisFuncSettings, immutable: true, argumentTypes: historyBarVisArgs});
 
-    this.renderBarVisualizerAlphaFunc = this.gpu.createKernel(function(barVisTex) {
+    this.renderBarVisualizerAlphaFunc = this._createKernel('renderBarVisualizerAlphaFunc', function(barVisTex) {
       const currVoxel = barVisTex[this.thread.z][this.thread.y][this.thread.x];
       return [
         clampValue(currVoxel[0]*currVoxel[3], 0, 1), 
         clampValue(currVoxel[1]*currVoxel[3], 0, 1), 
         clampValue(currVoxel[2]*currVoxel[3], 0, 1)
       ];
-    }, {...barVisFuncSettings, returnType: 'Array(3)', argumentTypes: {barVisTex: 'Array3D(4)'}});
+    }, {...barVisFuncSettings, output: this.pipelineFuncSettings.output, returnType: 'Array(3)', argumentTypes: {barVisTex: 'Array3D(4)'}});
 
     this._barVisKernelsInit = true;
   }
@@ -1354,16 +1384,16 @@ class GPUKernelManager {
       return Math.abs(ui * this.constants.unitArea);
     });
 
-    this.buildSimpleWaterBufferScalar = this.gpu.createKernel(function() {
+    this.buildSimpleWaterBufferScalar = this._createKernel('buildSimpleWaterBufferScalar', function() {
       return 0;
     }, {...settings, returnType:'Float'});
-    this.buildSimpleWaterBufferVec3 = this.gpu.createKernel(function() {
+    this.buildSimpleWaterBufferVec3 = this._createKernel('buildSimpleWaterBufferVec3', function() {
       return [0,0,0];
     }, {...settings, returnType:'Array(3)'});
-    this.buildSimpleWaterBufferVec4 = this.gpu.createKernel(function() {
+    this.buildSimpleWaterBufferVec4 = this._createKernel('buildSimpleWaterBufferVec4', function() {
       return [0,0,0,0];
     }, {...settings, returnType:'Array(4)'});
-    this.buildSimpleWaterCellBuffer = this.gpu.createKernel(function() {
+    this.buildSimpleWaterCellBuffer = this._createKernel('buildSimpleWaterCellBuffer', function() {
       const [x,y,z] = xyzLookup();
       // Set the boundaries along the outside in all dimensions
       if (z < 1 || z > this.constants.N || y < 1 || y > this.constants.N || x < 1 || x > this.constants.N) { 
@@ -1393,7 +1423,7 @@ class GPUKernelManager {
     const VEL_TYPE  = 'Array3D(3)';
     const CELL_TYPE = 'Array3D(3)';
 
-    this.simpleWaterAdvectVel = this.gpu.createKernel(function(dt, vel, cellData) {
+    this.simpleWaterAdvectVel = this._createKernel('simpleWaterAdvectVel', function(dt, vel, cellData) {
       const [x,y,z] = xyzLookup();
       const cell = cellData[x][y][z];
       const u = vel[x][y][z];
@@ -1423,7 +1453,7 @@ class GPUKernelManager {
       return result;
     }, {...settings, returnType:'Array(3)', argumentTypes:{dt:'Float', vel:VEL_TYPE, cellData:CELL_TYPE}});
 
-    this.simpleWaterApplyExtForces = this.gpu.createKernel(function(dt, gravity, vel, cellData) {
+    this.simpleWaterApplyExtForces = this._createKernel('simpleWaterApplyExtForces', function(dt, gravity, vel, cellData) {
       const [x,y,z] = xyzLookup();
 
       // Boundary condition - no forces are applied outside of the liquid
@@ -1495,7 +1525,7 @@ class GPUKernelManager {
       dt:'Float', gravity:'Float', vel:VEL_TYPE, cellData:CELL_TYPE
     }});
 
-    this.simpleWaterInjectForceBlob = this.gpu.createKernel(function(center, impulseStrength, size, vel, cellData) {
+    this.simpleWaterInjectForceBlob = this._createKernel('simpleWaterInjectForceBlob', function(center, impulseStrength, size, vel, cellData) {
       const [x,y,z] = xyzLookup();
 
       // Boundary condition - no forces are applied outside of the liquid
@@ -1517,7 +1547,7 @@ class GPUKernelManager {
       center: 'Array', impulseStrength: 'Float', size: 'Float', vel:VEL_TYPE, cellData:CELL_TYPE
     }});
 
-    this.simpleWaterCurl = this.gpu.createKernel(function(vel, cellData) {
+    this.simpleWaterCurl = this._createKernel('simpleWaterCurl', function(vel, cellData) {
       const [x,y,z] = xyzLookup();
 
       const xm1 = clampm1(x), xp1 = clampp1(x);
@@ -1535,12 +1565,12 @@ class GPUKernelManager {
       ];
     }, {...settings, returnType:'Array(3)', argumentTypes:{vel:VEL_TYPE, cellData:CELL_TYPE}});
 
-    this.simpleWaterCurlLen = this.gpu.createKernel(function(curl) {
+    this.simpleWaterCurlLen = this._createKernel('simpleWaterCurlLen', function(curl) {
       const [x,y,z] = xyzLookup();
       return length3(curl[x][y][z]);
     }, {...settings, returnType:'Float', argumentTypes:{curl:'Array3D(3)'}});
 
-    this.simpleWaterApplyVC = this.gpu.createKernel(function(dtVC, vel, cellData, curl, curlLen) {
+    this.simpleWaterApplyVC = this._createKernel('simpleWaterApplyVC', function(dtVC, vel, cellData, curl, curlLen) {
       const [x,y,z] = xyzLookup();
 
       const xm1 = clampm1(x), xp1 = clampp1(x);
@@ -1569,7 +1599,7 @@ class GPUKernelManager {
       dtVC:'Float', vel:VEL_TYPE, cellData:CELL_TYPE, curl:'Array3D(3)', curlLen:'Array'
     }});
 
-    this.simpleWaterDiv = this.gpu.createKernel(function(vel, cellData) {
+    this.simpleWaterDiv = this._createKernel('simpleWaterDiv', function(vel, cellData) {
       const [x,y,z] = xyzLookup();
 
       const xm1 = clampm1(x), xp1 = clampp1(x);
@@ -1593,7 +1623,7 @@ class GPUKernelManager {
 
     }, {...settings, returnType:'Float', argumentTypes:{vel:VEL_TYPE, cellData:CELL_TYPE}});
 
-    this.simpleWaterComputePressure = this.gpu.createKernel(function(pressure, cellData, div) {
+    this.simpleWaterComputePressure = this._createPingPongKernel('simpleWaterComputePressure', function(pressure, cellData, div) {
       // NOTE: The pressure buffer MUST be cleared before calling this!!
       const [x,y,z] = xyzLookup();
       const pC = pressure[x][y][z];
@@ -1622,7 +1652,7 @@ class GPUKernelManager {
 
     }, {...settings, returnType:'Float', argumentTypes:{pressure:'Array', cellData:CELL_TYPE, div:'Array'}});
 
-    this.simpleWaterProjVel = this.gpu.createKernel(function(pressure, vel, cellData) {
+    this.simpleWaterProjVel = this._createKernel('simpleWaterProjVel', function(pressure, vel, cellData) {
       const [x,y,z] = xyzLookup();
       const cell = cellData[x][y][z];
       if (cellType(cell) === this.constants.SOLID_CELL_TYPE || x < 1 || y < 1 || z < 1 || 
@@ -1666,7 +1696,7 @@ class GPUKernelManager {
       pressure:'Array', vel:VEL_TYPE, cellData:CELL_TYPE
     }});
 
-    this.simpleWaterDiffuseVel = this.gpu.createKernel(function(vel0, vel, cellData, a) {
+    this.simpleWaterDiffuseVel = this._createPingPongKernel('simpleWaterDiffuseVel', function(vel0, vel, cellData, a) {
       const [x,y,z] = xyzLookup();
       const cell = cellData[x][y][z];
       
@@ -1810,7 +1840,7 @@ class GPUKernelManager {
 
     }, {returnType:'Array(2)'});
 
-    this.simpleWaterCalcFlowsLRB = this.gpu.createKernel(function(dt, vel, cellData) {
+    this.simpleWaterCalcFlowsLRB = this._createKernel('simpleWaterCalcFlowsLRB', function(dt, vel, cellData) {
       const [x,y,z] = xyzLookup();
       const cell = cellData[x][y][z];
       const liquidVol = cellLiquidVol(cell);
@@ -1836,7 +1866,7 @@ class GPUKernelManager {
       ];
     }, {...settings, returnType:'Array(3)', argumentTypes:{dt:'Float', vel:VEL_TYPE, cellData:CELL_TYPE }});
 
-    this.simpleWaterCalcFlowsDUT = this.gpu.createKernel(function(dt, vel, cellData) {
+    this.simpleWaterCalcFlowsDUT = this._createKernel('simpleWaterCalcFlowsDUT', function(dt, vel, cellData) {
       const [x,y,z] = xyzLookup();
       const cell = cellData[x][y][z];
       const liquidVol = cellLiquidVol(cell);
@@ -1862,7 +1892,7 @@ class GPUKernelManager {
       ];
     }, {...settings, returnType:'Array(3)', argumentTypes:{dt:'Float', vel:VEL_TYPE, cellData:CELL_TYPE }});
 
-    this.simpleWaterSumFlows = this.gpu.createKernel(function(cellFlowsLRB, cellFlowsDUT, cellData) {
+    this.simpleWaterSumFlows = this._createKernel('simpleWaterSumFlows', function(cellFlowsLRB, cellFlowsDUT, cellData) {
       const [x,y,z] = xyzLookup();
       const cell = cellData[x][y][z];
       if (cellType(cell) === this.constants.SOLID_CELL_TYPE || x < 1 || y < 1 || z < 1 || 
@@ -1888,7 +1918,7 @@ class GPUKernelManager {
       cellFlowsLRB: 'Array3D(3)', cellFlowsDUT: 'Array3D(3)', cellData:CELL_TYPE
     }});
 
-    this.simpleWaterAdjustFlows = this.gpu.createKernel(function(cellFlowSums, cellData) {
+    this.simpleWaterAdjustFlows = this._createKernel('simpleWaterAdjustFlows', function(cellFlowSums, cellData) {
       const [x,y,z] = xyzLookup();
       const cell = cellData[x][y][z];
       if (cellType(cell) === this.constants.SOLID_CELL_TYPE || x < 1 || y < 1 || z < 1 || 
@@ -0,0 +1,172 @@
+const STATS_INTERVAL_MS = 30000;
+// Live outputs of a single kernel past which (and each doubling after) they're reported as a possible leak
+const LEAK_WARNING_LIVE_OUTPUTS = 16;
+
+/**
+ * Keeps track of the textures made by the immutable pipeline kernels of a GPUKernelManager, the ones whose outputs
+ * belong to the caller until they're released.
+ *
+ * GPU.js reuses the output texture of an immutable kernel when every earlier output of that kernel has been released
+ * by the time it runs again, otherwise it allocates a new texture and copies the old one over. Most of our steps
+ * release the texture they replace right away, so they reuse, but a kernel that's run on its own output (e.g., the
+ * iterations of a diffusion or pressure solve) always has its previous output alive. Those are created as ping-pong
+ * kernels: a pair of the same kernel that take turns, each one's output is the other one's input and is released
+ * before the pair comes back around to it, so the two of them keep reusing the same two textures.
+ *
+ * Outputs are counted while they're live, a kernel whose live outputs keep growing is reported as a leak. On
+ * GPU-less servers GPU.js falls back to running kernels on the CPU, their outputs are plain (nested) arrays rather
+ * than textures, the pool tracks those the same way and its helpers (toArray, clone, clear) work on either.
+ */
+class GPUTexturePool {
+  constructor() {
+    this._liveOutputs = new Map();    // Live output -> name of the kernel that made it
+    this._liveCounts = new Map();     // Kernel name -> number of live outputs
+    this._leakWarnings = new Map();   // Kernel name -> live outputs at the last leak warning
+    this._seenTextures = new WeakSet(); // Underlying textures that have been handed out before
+    this._resetStats();
+  }
+
+  /**
+   * Wrap a kernel so that its outputs are tracked.
+   * @param {String} name - Name of the kernel for the stats and leak warnings.
+   * @param {Function} createKernel - Makes the GPU.js kernel.
+   * @param {Object} settings - The kernel's settings, only immutable pipeline kernels are tracked.
+   */
+  trackKernel(name, createKernel, settings) {
+    const kernel = createKernel();
+    if (!settings.pipeline || !settings.immutable) {
+      return kernel;
+    }
+    return (...args) => this._track(kernel(...args), name);
+  }
+
+  /**
+   * Make a tracked ping-pong pair of the same kernel that are run in turns, for kernels that are run on their own
+   * outputs, see iterate.
+   */
+  trackPingPongKernel(name, createKernel, settings) {
+    if (!settings.pipeline || !settings.immutable) {
+      return createKernel();
+    }
+    const kernels = [createKernel(), createKernel()];
+    let nextKernelIdx = 0;
+    return (...args) => {
+      const kernel = kernels[nextKernelIdx];
+      nextKernelIdx ^= 1;
+      return this._track(kernel(...args), name);
+    };
+  }
+
+  /**
+   * Release an output, it must not be used after this.
+   */
+  release(texture) {
+    if (!texture) { return; }
+    const name = this._liveOutputs.get(texture);
+    if (name !== undefined) {
+      this._liveOutputs.delete(texture);
+      this._liveCounts.set(name, this._liveCounts.get(name) - 1);
+      this.stats.released++;
+    }
+    if (typeof texture.delete === 'function') {
+      texture.delete();
+    }
+  }
+
+  /**
+   * Release the given output and take its replacement, for updating a buffer with a kernel that reads the old one,
+   * e.g., buf = pool.replace(buf, kernel(buf, ...)).
+   */
+  replace(oldTexture, newTexture) {
+    if (oldTexture !== newTexture) {
+      this.release(oldTexture);
+    }
+    return newTexture;
+  }
+
+  /**
+   * Run a step numIter times, each on the output of the one before, releasing each output once the next is made.
+   * Steps should be ping-pong kernels (see trackPingPongKernel) so that they don't allocate.
+   * @param {Object} texture - The input of the first step, it's released unless numIter is 0.
+   * @param {Number} numIter
+   * @param {Function} step - Takes the current output and returns the next.
+   * @returns {Object} The output of the last step.
+   */
+  iterate(texture, numIter, step) {
+    let result = texture;
+    for (let i = 0; i < numIter; i++) {
+      result = this.replace(result, step(result));
+    }
+    return result;
+  }
+
+  toArray(texture) {
+    return (typeof texture.toArray === 'function') ? texture.toArray() : texture;
+  }
+
+  clone(texture) {
+    const name = this._liveOutputs.get(texture) || 'clone';
+    if (typeof texture.clone === 'function') {
+      return this._track(texture.clone(), name);
+    }
+    const cloneArray = (arr) => (typeof arr[0] === 'object') ? Array.from(arr, cloneArray) : arr.slice();
+    return this._track(cloneArray(texture), name);
+  }
+
+  clear(texture) {
+    if (typeof texture.clear === 'function') {
+      texture.clear();
+      return;
+    }
+    const clearArray = (arr) => (typeof arr[0] === 'object') ? arr.forEach(clearArray) : arr.fill(0);
+    clearArray(texture);
+  }
+
+  /**
+   * Number of live outputs, in total and by kernel.
+   */
+  liveCounts() {
+    const byKernel = {};
+    this._liveCounts.forEach((count, name) => { if (count > 0) { byKernel[name] = count; } });
+    return {live: this._liveOutputs.size, byKernel};
+  }
+
+  _track(output, name) {
+    const {stats} = this;
+    stats.outputs++;
+    const texture = output.texture; // The underlying texture that GPU.js textures share with their clones
+    if (texture && typeof texture === 'object') {
+      if (this._seenTextures.has(texture)) { stats.reused++; }
+      else { this._seenTextures.add(texture); }
+    }
+
+    this._liveOutputs.set(output, name);
+    const liveCount = (this._liveCounts.get(name) || 0) + 1;
+    this._liveCounts.set(name, liveCount);
+    if (liveCount >= LEAK_WARNING_LIVE_OUTPUTS && liveCount >= 2*(this._leakWarnings.get(name) || LEAK_WARNING_LIVE_OUTPUTS/2)) {
+      console.error(`Possible GPU texture leak: ${liveCount} outputs of ${name} haven't been released.`);
+      this._leakWarnings.set(name, liveCount);
+    }
+
+    const now = Date.now();
+    if (now - stats.startTime >= STATS_INTERVAL_MS) {
+      const {live, byKernel} = this.liveCounts();
+      const kernelCounts = Object.entries(byKernel).map(([kernelName, count]) => `${kernelName} ${count}`);
+      console.log(`GPU textures: ${live} live (${kernelCounts.join(", ")}), ${stats.outputs} kernel outputs ` +
+        `(${stats.reused} in reused textures), ${stats.released} released.`);
+      this._resetStats();
+    }
+    return output;
+  }
+
+  _resetStats() {
+    this.stats = {
+      startTime: Date.now(),
+      outputs: 0,
+      reused: 0,
+      released: 0,
+    };
+  }
+}
+
+export default GPUTexturePool;
@@ -0,0 +1,188 @@
+import fs from 'fs';
+import zlib from 'zlib';
+
+import {
+  RECORDING_HEADER_SIZE, CHUNK_HEADER_SIZE, FOOTER_SIZE, TIMESTAMP_SIZE,
+  readHeader, readChunkHeader, readIndex, readFooter, decodeChunkFrames, bytesToColours,
+} from './VoxelRecordingFormat';
+
+/**
+ * Plays back a voxel recording (see VoxelRecorder). Frames are looked up by index or by time through the recording's
+ * index, the chunk that a frame is in is decoded as a whole when it's first needed and the next chunk is decoded in
+ * the background while the current one plays, so playing back costs little more than copying each frame.
+ */
+class VoxelPlayer {
+  /**
+   * Open a recording, its header and index are read right away.
+   * @throws {Error} If the file can't be read or isn't a voxel recording.
+   */
+  constructor(filePath) {
+    this.filePath = filePath;
+    this._fd = fs.openSync(filePath, 'r');
+    const fileSize = fs.fstatSync(this._fd).size;
+
+    const header = readHeader(this._read(0, RECORDING_HEADER_SIZE));
+    if (!header) {
+      fs.closeSync(this._fd);
+      throw new Error(`${filePath} isn't a voxel recording.`);
+    }
+    this.gridSize = header.gridSize;
+    this.frameRateHz = header.frameRateHz;
+    this.frameLength = 3*this.gridSize[0]*this.gridSize[1]*this.gridSize[2];
+
+    const index = this._readIndex(fileSize) || this._scanChunks(fileSize);
+    this._chunks = index.chunks;
+    this.timestamps = index.timestamps;
+    this.numFrames = this.timestamps.length;
+    this.durationMs = this.numFrames > 0 ? this.timestamps[this.numFrames-1] : 0;
+
+    this._decodedChunks = new Map(); // Chunk index -> decoded frames, at most the current and next chunks
+    this._pendingChunks = new Map(); // Chunk index -> promise of its decoded frames
+  }
+
+  close() {
+    if (this._fd !== null) {
+      fs.closeSync(this._fd);
+      this._fd = null;
+    }
+    this._decodedChunks.clear();
+  }
+
+  /**
+   * Index of the frame that's showing at the given time, i.e., the last one whose timestamp isn't after it.
+   */
+  frameIndexAtTime(timeMs) {
+    const {timestamps} = this;
+    let low = 0;
+    let high = this.numFrames - 1;
+    while (low < high) {
+      const mid = (low + high + 1) >> 1;
+      if (timestamps[mid] <= timeMs) { low = mid; }
+      else { high = mid - 1; }
+    }
+    return low;
+  }
+
+  /**
+   * The bytes of a frame, 3 per voxel in the flat voxel order at full brightness. They belong to the player and are
+   * only good until the next call.
+   */
+  readFrameBytes(frameIdx) {
+    const chunkIdx = this._chunkIndexOf(frameIdx);
+    const chunk = this._chunks[chunkIdx];
+    let decoded = this._decodedChunks.get(chunkIdx);
+    if (!decoded) {
+      // Not decoded ahead of time (e.g., after seeking), so we have to wait on it
+      decoded = this._decodeChunk(chunk, this._read(chunk.offset, chunk.dataOffset - chunk.offset + chunk.compressedSize), zlib.inflateSync);
+      this._decodedChunks.set(chunkIdx, decoded);
+    }
+
+    // Only the current chunk and the one after are kept, the next one is decoded in the background
+    this._decodedChunks.forEach((_, idx) => { if (idx !== chunkIdx && idx !== chunkIdx+1) { this._decodedChunks.delete(idx); } });
+    this._prefetchChunk(chunkIdx+1);
+
+    const start = (frameIdx - chunk.firstFrame)*this.frameLength;
+    return decoded.subarray(start, start + this.frameLength);
+  }
+
+  /**
+   * Read a frame into a flat array of voxel colours, laid out like VoxelFramebufferCPU's buffer.
+   */
+  readFrame(frameIdx, data) {
+    return bytesToColours(this.readFrameBytes(frameIdx), data);
+  }
+
+  _chunkIndexOf(frameIdx) {
+    let low = 0;
+    let high = this._chunks.length - 1;
+    while (low < high) {
+      const mid = (low + high + 1) >> 1;
+      if (this._chunks[mid].firstFrame <= frameIdx) { low = mid; }
+      else { high = mid - 1; }
+    }
+    return low;
+  }
+
+  _prefetchChunk(chunkIdx) {
+    if (chunkIdx >= this._chunks.length || this._decodedChunks.has(chunkIdx) || this._pendingChunks.has(chunkIdx)) {
+      return;
+    }
+    const chunk = this._chunks[chunkIdx];
+    const length = chunk.dataOffset - chunk.offset + chunk.compressedSize;
+    const pending = new Promise((resolve, reject) => {
+      fs.read(this._fd, Buffer.alloc(length), 0, length, chunk.offset, (err, bytesRead, buf) => {
+        if (err) { reject(err); return; }
+        zlib.inflate(buf.subarray(chunk.dataOffset - chunk.offset), (inflateErr, inflated) => {
+          if (inflateErr) { reject(inflateErr); return; }
+          // A corrupt chunk throws while it's decoded, which would otherwise escape the callback and never settle
+          try {
+            resolve(this._decodeChunk(chunk, buf, () => inflated));
+          }
+          catch (decodeErr) {
+            reject(decodeErr);
+          }
+        });
+      });
+    });
+    this._pendingChunks.set(chunkIdx, pending);
+    pending.then(decoded => {
+      // Unless playback has moved on (or decoded it itself) in the meantime
+      if (this._pendingChunks.get(chunkIdx) === pending && !this._decodedChunks.has(chunkIdx)) {
+        this._decodedChunks.set(chunkIdx, decoded);
+      }
+    }).catch(err => {
+      console.error(`Failed to read chunk ${chunkIdx} of ${this.filePath}: ${err}`);
+    }).finally(() => {
+      this._pendingChunks.delete(chunkIdx);
+    });
+  }
+
+  _decodeChunk(chunk, chunkBuf, inflate) {
+    const decoded = inflate(chunkBuf.subarray(chunk.dataOffset - chunk.offset));
+    if (decoded.length !== chunk.numFrames*this.frameLength) {
+      throw new Error(`Chunk at ${chunk.offset} of ${this.filePath} is corrupt.`);
+    }
+    decodeChunkFrames(decoded, this.frameLength);
+    return decoded;
+  }
+
+  _readIndex(fileSize) {
+    if (fileSize < RECORDING_HEADER_SIZE + FOOTER_SIZE) { return null; }
+    const indexOffset = readFooter(this._read(fileSize - FOOTER_SIZE, FOOTER_SIZE));
+    if (indexOffset === null || indexOffset < RECORDING_HEADER_SIZE || indexOffset > fileSize - FOOTER_SIZE) { return null; }
+    const index = readIndex(this._read(indexOffset, fileSize - FOOTER_SIZE - indexOffset));
+    if (!index) { return null; }
+    index.chunks.forEach(chunk => { chunk.dataOffset = chunk.offset + CHUNK_HEADER_SIZE + chunk.numFrames*TIMESTAMP_SIZE; });
+    return index;
+  }
+
+  // For recordings that weren't closed (e.g., the server crashed), every complete chunk is still playable
+  _scanChunks(fileSize) {
+    console.log(`${this.filePath} has no index (it wasn't closed), scanning its chunks.`);
+    const chunks = [];
+    const timestamps = [];
+    let offset = RECORDING_HEADER_SIZE;
+    while (offset + CHUNK_HEADER_SIZE <= fileSize) {
+      const chunk = {offset, ...readChunkHeader(this._read(offset, CHUNK_HEADER_SIZE))};
+      chunk.dataOffset = offset + CHUNK_HEADER_SIZE + chunk.numFrames*TIMESTAMP_SIZE;
+      if (chunk.firstFrame !== timestamps.length || chunk.dataOffset + chunk.compressedSize > fileSize) {
+        break;
+      }
+      const timestampBuf = this._read(offset + CHUNK_HEADER_SIZE, chunk.numFrames*TIMESTAMP_SIZE);
+      for (let i = 0; i < chunk.numFrames; i++) {
+        timestamps.push(timestampBuf.readDoubleLE(i*TIMESTAMP_SIZE));
+      }
+      chunks.push(chunk);
+      offset = chunk.dataOffset + chunk.compressedSize;
+    }
+    return {chunks, timestamps: Float64Array.from(timestamps)};
+  }
+
+  _read(offset, length) {
+    const buf = Buffer.alloc(length);
+    fs.readSync(this._fd, buf, 0, length, offset);
+    return buf;
+  }
+}
+
+export default VoxelPlayer;
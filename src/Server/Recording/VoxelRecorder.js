@@ -0,0 +1,130 @@
+import fs from 'fs';
+import zlib from 'zlib';
+import {promisify} from 'util';
+
+import VoxelProtocol from '../../VoxelProtocol';
+import {
+  DEFAULT_FRAMES_PER_CHUNK, writeHeader, writeChunkHeader, writeIndex, writeFooter, encodeChunkFrames,
+} from './VoxelRecordingFormat';
+
+const deflate = promisify(zlib.deflate);
+
+// Chunks waiting to be compressed and written past which the disk is reported as not keeping up
+const MAX_PENDING_CHUNKS_WARNING = 8;
+
+/**
+ * Records every frame that the model renders to a voxel recording file (see VoxelRecordingFormat). Frames are
+ * gathered into chunks in the render loop, each full chunk is compressed (on libuv's thread pool) and appended to the
+ * file in the background, so recording costs the render loop little more than copying each frame.
+ */
+class VoxelRecorder {
+  /**
+   * @param {String} filePath
+   * @param {Number[]} gridSize - The x, y and z sizes of the voxel grid.
+   * @param {Object} options
+   * @param {Number} options.frameRateHz - The rate that the frames are rendered at, for reference.
+   * @param {Number} options.framesPerChunk - Frames in each independently decodable chunk, the seeking granularity.
+   */
+  constructor(filePath, gridSize, options={}) {
+    const {frameRateHz = 0, framesPerChunk = DEFAULT_FRAMES_PER_CHUNK} = options;
+    this.filePath = filePath;
+    this.gridSize = gridSize;
+    this.frameLength = 3*gridSize[0]*gridSize[1]*gridSize[2];
+    this.framesPerChunk = framesPerChunk;
+
+    this.numFrames = 0;
+    this.bytesWritten = 0;
+    this._chunks = [];       // Offset, first frame, frame count and compressed size of each written chunk
+    this._timestamps = [];   // Timestamp of every frame
+    this._chunkBytes = new Uint8Array(framesPerChunk*this.frameLength);
+    this._chunkNumFrames = 0;
+    this._pendingChunks = 0;
+    this._closed = false;
+
+    // Writes are chained so that they land in the file in order
+    const header = writeHeader(gridSize, frameRateHz, framesPerChunk);
+    this._writes = fs.promises.open(filePath, 'w').then(fileHandle => {
+      this._fileHandle = fileHandle;
+      return this._append(header);
+    }).catch(err => this._fail(err));
+  }
+
+  /**
+   * Record a frame.
+   * @param {Float32Array} data - Flat array of the voxel colours, laid out like VoxelFramebufferCPU's buffer.
+   * @param {Number} timeMs - Time of the frame since the start of the recording.
+   */
+  recordFrame(data, timeMs) {
+    if (this._closed) { return; }
+    VoxelProtocol.stuffVoxelDataAll(this._chunkNumFrames*this.frameLength, this._chunkBytes, data, 1);
+    this._timestamps.push(timeMs);
+    this._chunkNumFrames++;
+    this.numFrames++;
+    if (this._chunkNumFrames === this.framesPerChunk) {
+      this._flushChunk();
+    }
+  }
+
+  /**
+   * Write out the rest of the frames and the index, the recording is complete once the returned promise resolves.
+   */
+  close() {
+    if (this._closed) { return this._writes; }
+    this._flushChunk();
+    this._closed = true;
+    this._writes = this._writes.then(async () => {
+      if (!this._fileHandle) { return; }
+      const indexOffset = this.bytesWritten;
+      await this._append(writeIndex(this._chunks, this._timestamps));
+      await this._append(writeFooter(indexOffset));
+      await this._fileHandle.close();
+      this._fileHandle = null;
+      console.log(`Recorded ${this.numFrames} frames (${(this.bytesWritten/(1024*1024)).toFixed(1)}MB, ` +
+        `${(this.bytesWritten/Math.max(1, this.numFrames*this.frameLength)*100).toFixed(1)}% of their raw size) to ${this.filePath}.`);
+    }).catch(err => this._fail(err));
+    return this._writes;
+  }
+
+  _flushChunk() {
+    const numFrames = this._chunkNumFrames;
+    if (numFrames === 0) { return; }
+    const firstFrame = this.numFrames - numFrames;
+    const chunkBytes = this._chunkBytes.subarray(0, numFrames*this.frameLength);
+    const timestamps = this._timestamps.slice(firstFrame);
+    this._chunkBytes = new Uint8Array(this.framesPerChunk*this.frameLength);
+    this._chunkNumFrames = 0;
+
+    encodeChunkFrames(chunkBytes, this.frameLength);
+    const compressed = deflate(chunkBytes);
+    this._pendingChunks++;
+    if (this._pendingChunks === MAX_PENDING_CHUNKS_WARNING) {
+      console.error(`Recording to ${this.filePath} isn't keeping up, ${this._pendingChunks} chunks are waiting to be written.`);
+    }
+
+    this._writes = this._writes.then(async () => {
+      const compressedBytes = await compressed;
+      this._pendingChunks--;
+      if (!this._fileHandle) { return; }
+      const offset = this.bytesWritten;
+      await this._append(writeChunkHeader(firstFrame, timestamps, compressedBytes.length));
+      await this._append(compressedBytes);
+      this._chunks.push({offset, firstFrame, numFrames, compressedSize: compressedBytes.length});
+    }).catch(err => this._fail(err));
+  }
+
+  async _append(buf) {
+    await this._fileHandle.write(buf, 0, buf.length, this.bytesWritten);
+    this.bytesWritten += buf.length;
+  }
+
+  _fail(err) {
+    console.error(`Recording to ${this.filePath} failed: ${err}`);
+    this._closed = true;
+    if (this._fileHandle) {
+      this._fileHandle.close().catch(() => {});
+      this._fileHandle = null;
+    }
+  }
+}
+
+export default VoxelRecorder;
@@ -0,0 +1,178 @@
+import VoxelProtocol from '../../VoxelProtocol';
+
+/**
+ * Layout of voxel recordings (.vxr files), see VoxelRecorder and VoxelPlayer. All numbers are little endian.
+ *
+ * Header: magic "VXRC", version (u16), flags (u16), grid x, y and z sizes (u16 each), reserved (u16),
+ *   frame rate (f32), frames per chunk (u32).
+ * Chunks, one after the other: first frame (u32), frame count (u32), compressed size (u32), the frame timestamps
+ *   (f64 each, milliseconds of simulated time since the start of the recording), then the deflated frames. Each frame
+ *   is 3 bytes per voxel in the flat voxel order (see VoxelProtocol.buildViewerFrameBytes) at full brightness, the
+ *   first frame of a chunk is whole and the rest are XORed with the frame before so that what doesn't change
+ *   compresses to almost nothing. A chunk only depends on itself, so seeking costs at most one chunk's decoding.
+ * Index: magic "VXRI", chunk count (u32), frame count (u32), then for each chunk its file offset (f64), first frame
+ *   (u32), frame count (u32) and compressed size (u32), then the timestamps of every frame (f64 each).
+ * Footer: file offset of the index (f64), magic "VXRE", reserved (u32).
+ *
+ * The index and footer are written when the recording is closed, a recording that wasn't closed is played by
+ * scanning its chunks instead.
+ */
+
+export const RECORDING_MAGIC = "VXRC";
+export const RECORDING_INDEX_MAGIC = "VXRI";
+export const RECORDING_FOOTER_MAGIC = "VXRE";
+export const RECORDING_VERSION = 1;
+
+export const RECORDING_HEADER_SIZE = 24;
+export const CHUNK_HEADER_SIZE = 12;         // Not including the timestamps
+export const INDEX_HEADER_SIZE = 12;
+export const INDEX_CHUNK_ENTRY_SIZE = 20;
+export const FOOTER_SIZE = 16;
+export const TIMESTAMP_SIZE = 8;
+
+export const DEFAULT_FRAMES_PER_CHUNK = 60;
+
+export const writeHeader = (gridSize, frameRateHz, framesPerChunk) => {
+  const buf = Buffer.alloc(RECORDING_HEADER_SIZE);
+  buf.write(RECORDING_MAGIC, 0, 'latin1');
+  buf.writeUInt16LE(RECORDING_VERSION, 4);
+  buf.writeUInt16LE(0, 6);
+  buf.writeUInt16LE(gridSize[0], 8);
+  buf.writeUInt16LE(gridSize[1], 10);
+  buf.writeUInt16LE(gridSize[2], 12);
+  buf.writeUInt16LE(0, 14);
+  buf.writeFloatLE(frameRateHz, 16);
+  buf.writeUInt32LE(framesPerChunk, 20);
+  return buf;
+};
+
+/**
+ * @returns {Object} The header's fields, null if the buffer isn't a recording header.
+ */
+export const readHeader = (buf) => {
+  if (buf.length < RECORDING_HEADER_SIZE || buf.toString('latin1', 0, 4) !== RECORDING_MAGIC) {
+    return null;
+  }
+  return {
+    version: buf.readUInt16LE(4),
+    gridSize: [buf.readUInt16LE(8), buf.readUInt16LE(10), buf.readUInt16LE(12)],
+    frameRateHz: buf.readFloatLE(16),
+    framesPerChunk: buf.readUInt32LE(20),
+  };
+};
+
+export const writeChunkHeader = (firstFrame, timestamps, compressedSize) => {
+  const buf = Buffer.alloc(CHUNK_HEADER_SIZE + timestamps.length*TIMESTAMP_SIZE);
+  buf.writeUInt32LE(firstFrame, 0);
+  buf.writeUInt32LE(timestamps.length, 4);
+  buf.writeUInt32LE(compressedSize, 8);
+  timestamps.forEach((timestamp, i) => buf.writeDoubleLE(timestamp, CHUNK_HEADER_SIZE + i*TIMESTAMP_SIZE));
+  return buf;
+};
+
+export const readChunkHeader = (buf) => ({
+  firstFrame: buf.readUInt32LE(0),
+  numFrames: buf.readUInt32LE(4),
+  compressedSize: buf.readUInt32LE(8),
+});
+
+/**
+ * @param {Object[]} chunks - Each chunk's offset, firstFrame, numFrames and compressedSize.
+ * @param {Float64Array} timestamps - Every frame's timestamp.
+ */
+export const writeIndex = (chunks, timestamps) => {
+  const buf = Buffer.alloc(INDEX_HEADER_SIZE + chunks.length*INDEX_CHUNK_ENTRY_SIZE + timestamps.length*TIMESTAMP_SIZE);
+  buf.write(RECORDING_INDEX_MAGIC, 0, 'latin1');
+  buf.writeUInt32LE(chunks.length, 4);
+  buf.writeUInt32LE(timestamps.length, 8);
+  let idx = INDEX_HEADER_SIZE;
+  chunks.forEach(({offset, firstFrame, numFrames, compressedSize}) => {
+    buf.writeDoubleLE(offset, idx);
+    buf.writeUInt32LE(firstFrame, idx+8);
+    buf.writeUInt32LE(numFrames, idx+12);
+    buf.writeUInt32LE(compressedSize, idx+16);
+    idx += INDEX_CHUNK_ENTRY_SIZE;
+  });
+  timestamps.forEach(timestamp => {
+    buf.writeDoubleLE(timestamp, idx);
+    idx += TIMESTAMP_SIZE;
+  });
+  return buf;
+};
+
+/**
+ * @returns {Object} The index's chunks and timestamps (see writeIndex), null if the buffer isn't a valid index.
+ */
+export const readIndex = (buf) => {
+  if (buf.length < INDEX_HEADER_SIZE || buf.toString('latin1', 0, 4) !== RECORDING_INDEX_MAGIC) {
+    return null;
+  }
+  const numChunks = buf.readUInt32LE(4);
+  const numFrames = buf.readUInt32LE(8);
+  if (buf.length < INDEX_HEADER_SIZE + numChunks*INDEX_CHUNK_ENTRY_SIZE + numFrames*TIMESTAMP_SIZE) {
+    return null;
+  }
+  const chunks = [];
+  let idx = INDEX_HEADER_SIZE;
+  for (let i = 0; i < numChunks; i++) {
+    chunks.push({
+      offset: buf.readDoubleLE(idx),
+      firstFrame: buf.readUInt32LE(idx+8),
+      numFrames: buf.readUInt32LE(idx+12),
+      compressedSize: buf.readUInt32LE(idx+16),
+    });
+    idx += INDEX_CHUNK_ENTRY_SIZE;
+  }
+  const timestamps = new Float64Array(numFrames);
+  for (let i = 0; i < numFrames; i++) {
+    timestamps[i] = buf.readDoubleLE(idx);
+    idx += TIMESTAMP_SIZE;
+  }
+  return {chunks, timestamps};
+};
+
+export const writeFooter = (indexOffset) => {
+  const buf = Buffer.alloc(FOOTER_SIZE);
+  buf.writeDoubleLE(indexOffset, 0);
+  buf.write(RECORDING_FOOTER_MAGIC, 8, 'latin1');
+  return buf;
+};
+
+/**
+ * @returns {Number} The file offset of the index, null if the buffer isn't a footer.
+ */
+export const readFooter = (buf) => {
+  if (buf.length < FOOTER_SIZE || buf.toString('latin1', 8, 12) !== RECORDING_FOOTER_MAGIC) {
+    return null;
+  }
+  return buf.readDoubleLE(0);
+};
+
+/**
+ * XOR each frame of a chunk with the one before (in place), the first frame is left as is.
+ */
+export const encodeChunkFrames = (chunkBytes, frameLength) => {
+  for (let i = chunkBytes.length - 1; i >= frameLength; i--) {
+    chunkBytes[i] ^= chunkBytes[i - frameLength];
+  }
+};
+
+/**
+ * Undo encodeChunkFrames (in place).
+ */
+export const decodeChunkFrames = (chunkBytes, frameLength) => {
+  for (let i = frameLength; i < chunkBytes.length; i++) {
+    chunkBytes[i] ^= chunkBytes[i - frameLength];
+  }
+};
+
+/**
+ * Convert a recorded frame's bytes into a flat array of voxel colours, laid out like VoxelFramebufferCPU's buffer.
+ */
+export const bytesToColours = (frameBytes, data) => {
+  const byteToColour = VoxelProtocol.VIEWER_BYTE_TO_COLOUR;
+  for (let i = 0; i < frameBytes.length; i++) {
+    data[i] = byteToColour[frameBytes[i]];
+  }
+  return data;
+};
@@ -0,0 +1,122 @@
+import path from 'path';
+import {Worker} from 'worker_threads';
+
+import SlaveWriterProc from './SlaveWriterProc';
+
+/**
+ * The transmit pipeline for a single slave data port. Frames are encoded by a worker thread of the port's own
+ * (see SlaveWriterProc) and written to the port one at a time, each only once the previous one has fully drained.
+ * Frames that arrive in the meantime wait in a mailbox that only holds the latest one, so a slow or blocked port
+ * drops its stale frames instead of holding up the render loop and the other ports.
+ */
+class SlaveSerialWriter {
+  constructor(serialPort) {
+    this.serialPort = serialPort;
+    this.pendingFrame = null; // Mailbox: the latest frame that's waiting on the port, replaced by any newer one
+    this.busy = false;        // Whether a frame is being encoded or written
+    this._resetStats();
+
+    this.worker = new Worker(path.resolve('dist/slavewriterproc.js'));
+    this.worker.on('message', message => {
+      const {type, data} = message;
+      switch (type) {
+        case SlaveWriterProc.FROM_PROC_ENCODED:
+          this._writeEncodedFrame(data);
+          break;
+        default:
+          console.log("Invalid message type received from SlaveWriterProc.");
+          break;
+      }
+    });
+    this.worker.on('error', err => console.error("SlaveWriterProc error (" + serialPort.path + "): " + err));
+  }
+
+  dispose() {
+    this.pendingFrame = null;
+    this.worker.terminate();
+  }
+
+  /**
+   * Queue a frame to be sent to the slave, replacing any frame that's still waiting to be sent.
+   * @param {Number} slaveId - The ID of the slave on this port.
+   * @param {Buffer} frameBuf - The slave's full frame packet (see VoxelProtocol.buildVoxelDataPacketsForSlaves).
+   * @param {?Number} brightness - The brightness for the slave's colour LUT, null when the frame already has it applied.
+   */
+  postFrame(slaveId, frameBuf, brightness) {
+    // Copied so that it can be transferred to the worker, frameBuf shares its memory with every other slave's frame
+    const frame = {slaveId, frameBuf: new Uint8Array(frameBuf), brightness};
+    this.stats.framesQueued++;
+    if (this.busy) {
+      if (this.pendingFrame) { this.stats.framesDropped++; }
+      this.pendingFrame = frame;
+    }
+    else {
+      this._encodeFrame(frame);
+    }
+  }
+
+  /**
+   * The slave (re)connected or is missing frames, the next frame it's sent will be a full one.
+   */
+  reset() {
+    this.worker.postMessage({type: SlaveWriterProc.TO_PROC_RESET});
+  }
+
+  /**
+   * Number of frames that are waiting on the port (in the mailbox or being encoded/written) and the number of
+   * bytes written to the port that haven't been handed to the OS yet.
+   */
+  queueDepth() {
+    return {frames: (this.pendingFrame ? 1 : 0) + (this.busy ? 1 : 0), bytes: this.serialPort.writableLength};
+  }
+
+  /**
+   * Get the stats since the last time they were taken, then start over.
+   */
+  takeStats() {
+    const stats = {...this.stats, ...this.queueDepth()};
+    this._resetStats();
+    return stats;
+  }
+
+  _resetStats() {
+    this.stats = {
+      framesQueued: 0,
+      framesWritten: 0,
+      framesDropped: 0, // Replaced in the mailbox before they could be sent
+      bytesWritten: 0,
+      totalEncodeTimeMs: 0,
+    };
+  }
+
+  _encodeFrame(frame) {
+    this.busy = true;
+    this.worker.postMessage({type: SlaveWriterProc.TO_PROC_ENCODE_FRAME, data: frame}, [frame.frameBuf.buffer]);
+  }
+
+  _writeEncodedFrame(data) {
+    const {encodedBuf, encodeTimeMs} = data;
+    this.stats.totalEncodeTimeMs += encodeTimeMs;
+
+    if (!this.serialPort.isOpen) {
+      this.pendingFrame = null;
+      this.busy = false;
+      return;
+    }
+
+    this.serialPort.write(Buffer.from(encodedBuf.buffer, encodedBuf.byteOffset, encodedBuf.length));
+    this.serialPort.drain((err) => {
+      if (err) { console.error(err); }
+      this.stats.framesWritten++;
+      this.stats.bytesWritten += encodedBuf.length;
+      this.busy = false;
+      if (this.pendingFrame) {
+        const nextFrame = this.pendingFrame;
+        this.pendingFrame = null;
+        this._encodeFrame(nextFrame);
+      }
+    });
+  }
+}
+
+export default SlaveSerialWriter;
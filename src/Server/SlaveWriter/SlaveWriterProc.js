@@ -0,0 +1,96 @@
+import {parentPort} from 'worker_threads';
+import cobs from 'cobs';
+
+import VoxelProtocol from '../../VoxelProtocol';
+
+const SLAVE_KEYFRAME_INTERVAL_FRAMES = 60; // Send a full frame at least this often so slaves recover from any missed dirty row packets
+
+/**
+ * Runs in a worker thread for each slave data port (see SlaveSerialWriter): turns each full slave frame that it's
+ * given into the packet that goes out to the slave (only the rows that changed since the last frame it encoded,
+ * unless it's time for a keyframe) and COBS encodes it, keeping all of that work off the main thread.
+ */
+class SlaveWriterProc {
+  static get TO_PROC_ENCODE_FRAME() { return 'e'; }
+  static get TO_PROC_RESET() { return 'r'; }
+
+  static get FROM_PROC_ENCODED() { return 'f'; }
+
+  constructor() {
+    this.reset();
+  }
+
+  reset() {
+    this.lastFramePacketBuf = null;
+    this.framesSinceKeyframe = 0;
+    this.brightness = null; // Brightness last sent to the slave's colour LUT
+  }
+
+  run() {
+    parentPort.on('message', message => {
+      const {type, data} = message;
+
+      switch (type) {
+        case SlaveWriterProc.TO_PROC_ENCODE_FRAME: {
+          const startTime = process.hrtime.bigint();
+          const encodedBuf = this.encodeFrame(data);
+          const encodeTimeMs = Number(process.hrtime.bigint() - startTime) / 1e6;
+          parentPort.postMessage({type: SlaveWriterProc.FROM_PROC_ENCODED, data: {encodedBuf, encodeTimeMs}}, [encodedBuf.buffer]);
+          break;
+        }
+
+        case SlaveWriterProc.TO_PROC_RESET:
+          // The slave (re)connected or couldn't apply a dirty row packet, the next frame it gets must be a full one
+          this.reset();
+          break;
+
+        default:
+          console.log("Invalid message type received by SlaveWriterProc.");
+          break;
+      }
+    });
+  }
+
+  /**
+   * @param {{slaveId: Number, frameBuf: Uint8Array, brightness: ?Number}} data - The slave's full frame packet (see
+   * VoxelProtocol.buildVoxelDataPacketsForSlaves) and, for slaves with a colour LUT, the brightness to show it at.
+   * @returns {Uint8Array} The COBS encoded packets to write to the slave, in their own ArrayBuffer.
+   */
+  encodeFrame(data) {
+    const {slaveId, frameBuf, brightness} = data;
+    const fullPacketBuf = Buffer.from(frameBuf.buffer, frameBuf.byteOffset, frameBuf.length);
+    const encodedBufs = [];
+
+    // Raw frames don't have the brightness in them, the slave's colour LUT applies it
+    if (brightness !== null && brightness !== this.brightness) {
+      encodedBufs.push(cobs.encode(VoxelProtocol.buildBrightnessPacketForSlaves(slaveId, brightness), true));
+      this.brightness = brightness;
+    }
+
+    // Only send the rows that changed since the last frame we sent, unless it's time for a full (key) frame
+    let packetToSendBuf = null;
+    if (this.framesSinceKeyframe < SLAVE_KEYFRAME_INTERVAL_FRAMES) {
+      packetToSendBuf = VoxelProtocol.buildDirtyVoxelDataPacketForSlaves(fullPacketBuf, this.lastFramePacketBuf);
+    }
+    if (packetToSendBuf) {
+      this.framesSinceKeyframe++;
+    }
+    else {
+      packetToSendBuf = fullPacketBuf;
+      this.framesSinceKeyframe = 0;
+    }
+    this.lastFramePacketBuf = fullPacketBuf;
+    encodedBufs.push(cobs.encode(packetToSendBuf, true));
+
+    // Copy into a buffer of our own so that it can be transferred rather than cloned (cobs may hand back pooled buffers)
+    const encodedBuf = new Uint8Array(encodedBufs.reduce((size, buf) => size + buf.length, 0));
+    let offset = 0;
+    encodedBufs.forEach(buf => {
+      encodedBuf.set(buf, offset);
+      offset += buf.length;
+    });
+    return encodedBuf;
+  }
+}
+
+export default SlaveWriterProc;
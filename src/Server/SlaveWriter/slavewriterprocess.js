@@ -0,0 +1,4 @@
+import SlaveWriterProc from './SlaveWriterProc';
+
+const writerProc = new SlaveWriterProc();
+writerProc.run();
@@ -0,0 +1,131 @@
+import VoxelProtocol from '../VoxelProtocol';
+import ViewerStream from './ViewerStream';
+
+/**
+ * Sends each frame to every connected viewer, encoding it once for all of them: the frame's bytes and keyframe are
+ * built once and each delta is built once per distinct frame that it's based on. A viewer is given a delta that was
+ * already built for another one whenever it has that delta's base too, so viewers that keep up share a single delta.
+ * Every viewer gets the same (immutable) packet buffers, the cost of packing a frame doesn't grow with the number of
+ * viewers, only the cost of handing the packets to their sockets does.
+ */
+class ViewerBroadcast {
+  constructor() {
+    this.streams = new Map(); // Socket -> ViewerStream
+    this._resetStats();
+  }
+
+  get numViewers() { return this.streams.size; }
+
+  addViewer(socket, options={}) {
+    const stream = new ViewerStream(socket, options);
+    this.streams.set(socket, stream);
+    return stream;
+  }
+
+  removeViewer(socket) {
+    this.streams.delete(socket);
+  }
+
+  /**
+   * Read a packet from a viewer.
+   * @returns {Boolean} Whether it was a viewer stream packet, see ViewerStream.readClientPacketStr.
+   */
+  readClientPacketStr(packetStr, socket) {
+    const stream = this.streams.get(socket);
+    return stream ? stream.readClientPacketStr(packetStr) : false;
+  }
+
+  /**
+   * Build the packets of a frame for all of the connected viewers. The packets don't share memory with the voxel data.
+   * @param {Object} voxelData - The voxel data object, see VoxelServer.voxelDataFrame.
+   * @returns {Object} The packed frame for transmitFrame, null if there are no viewers.
+   */
+  packFrame(voxelData) {
+    if (this.streams.size === 0) {
+      return null;
+    }
+
+    const frameBytes = VoxelProtocol.buildViewerFrameBytes(voxelData);
+    const frameId = voxelData.frameId % 65536;
+    const {stats} = this;
+    let keyframePacket = null;
+    const frame = {
+      frameBytes,
+      frameId,
+      baseFrameIds: new Map(), // ViewerStream -> the frame it gets a delta against, null for a keyframe
+      deltaPackets: new Map(), // Base frame bytes -> the delta against them, null when a keyframe is smaller
+      // The keyframe is only built if some viewer ends up needing it
+      keyframePacket: () => {
+        if (keyframePacket === null) {
+          keyframePacket = VoxelProtocol.buildViewerKeyframePacket(frameBytes, frameId);
+          stats.packetsEncoded++;
+        }
+        return keyframePacket;
+      },
+    };
+
+    const deltaBaseFrameIds = []; // Frames that the deltas built so far are based on, first built first
+    this.streams.forEach(stream => {
+      let baseFrameId = stream.nextBaseFrameId();
+      if (baseFrameId === null) {
+        frame.baseFrameIds.set(stream, null);
+        return;
+      }
+      const sharedBaseFrameId = deltaBaseFrameIds.find(frameId => stream.hasFrame(frameId));
+      if (sharedBaseFrameId !== undefined) {
+        baseFrameId = sharedBaseFrameId;
+      }
+
+      const baseFrameBytes = stream.sentFrameBytes(baseFrameId);
+      frame.baseFrameIds.set(stream, baseFrameBytes ? baseFrameId : null);
+      if (baseFrameBytes && !frame.deltaPackets.has(baseFrameBytes)) {
+        frame.deltaPackets.set(baseFrameBytes, VoxelProtocol.buildViewerDeltaPacket(frameBytes, baseFrameBytes, frameId, baseFrameId));
+        deltaBaseFrameIds.push(baseFrameId);
+        stats.packetsEncoded++;
+      }
+    });
+    stats.framesPacked++;
+    return frame;
+  }
+
+  /**
+   * Send a packed frame (see packFrame) to the viewers that it was packed for and are still connected.
+   */
+  transmitFrame(frame) {
+    if (!frame) { return; }
+    frame.baseFrameIds.forEach((baseFrameId, stream) => {
+      if (this.streams.get(stream.socket) === stream && stream.send(frame)) {
+        this.stats.packetsSent++;
+      }
+    });
+  }
+
+  logStats() {
+    const {framesPacked, packetsEncoded, packetsSent} = this.stats;
+    this._resetStats();
+    if (this.streams.size === 0) { return; }
+
+    console.log("[Viewers] Connected: " + this.streams.size + ", frames packed: " + framesPacked +
+      ", packets encoded: " + packetsEncoded + ", sent: " + packetsSent);
+    let viewerIdx = 0;
+    this.streams.forEach(stream => {
+      const stats = stream.takeStats();
+      const framesSent = stats.keyframesSent + stats.deltasSent;
+      console.log("[Viewer " + (viewerIdx++) + " @ " + stream.name + "] Frames sent: " + framesSent +
+        " (" + stats.keyframesSent + " keyframes, " + stats.deltasSent + " deltas)" +
+        ", skipped: " + stats.framesSkipped + ", keyframe requests: " + stats.keyframeRequests +
+        ", KB sent: " + (stats.bytesSent/1024).toFixed(1) +
+        ", avg frame: " + (framesSent > 0 ? stats.bytesSent/framesSent : 0).toFixed(0) + " bytes");
+    });
+  }
+
+  _resetStats() {
+    this.stats = {
+      framesPacked: 0,
+      packetsEncoded: 0, // Keyframes and deltas built, at most one of each per distinct base frame
+      packetsSent: 0,
+    };
+  }
+}
+
+export default ViewerBroadcast;
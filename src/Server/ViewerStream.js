@@ -0,0 +1,162 @@
+import ws from 'ws';
+
+import VoxelProtocol from '../VoxelProtocol';
+
+// Frames that a viewer keeps to rebuild deltas from, deltas are only ever built against one of the last this many
+// frames sent to it (see DisplayClient)
+export const VIEWER_FRAME_HISTORY = 16;
+// A keyframe is sent at least this often, so a viewer that went wrong somewhere recovers on its own
+const KEYFRAME_INTERVAL_FRAMES = 300;
+// Frames skipped rather than sent when more than this many frames' worth of data are still waiting in the socket
+export const DEFAULT_MAX_BUFFERED_FRAMES = 2;
+
+/**
+ * The frame stream of a viewer websocket. Rather than the whole frame every time, the viewer is sent the XOR of each
+ * frame against the newest frame that it has acknowledged having (run length coded, see
+ * VoxelProtocol.buildViewerDeltaPacket), so only the voxels that changed cost anything. A keyframe (the whole frame)
+ * is sent to start with, every KEYFRAME_INTERVAL_FRAMES, whenever the viewer asks for one and whenever the delta
+ * wouldn't be any smaller.
+ *
+ * The packets are built once for all of the viewers (see ViewerBroadcast), each stream picks the one for the frame
+ * its viewer has and skips frames while its socket is backed up.
+ */
+class ViewerStream {
+  /**
+   * @param {WebSocket} socket
+   * @param {Object} options
+   * @param {String} options.name - Name of the viewer for the stats, e.g., its address.
+   * @param {Number} options.maxBufferedFrames - Frames are skipped while the socket has more than this many frames'
+   * worth of data waiting to go out.
+   */
+  constructor(socket, options={}) {
+    const {name = "viewer", maxBufferedFrames = DEFAULT_MAX_BUFFERED_FRAMES} = options;
+    this.socket = socket;
+    this.name = name;
+    this.maxBufferedFrames = maxBufferedFrames;
+    this._sentFrames = new Map(); // 16-bit frame ID -> bytes of the last VIEWER_FRAME_HISTORY frames sent, oldest first
+    this._ackedFrameId = null;    // Newest sent frame that the viewer has acknowledged
+    this._ackedFrames = new Set(); // Sent frames that the viewer has (frames arrive in order, so up to the acknowledged one)
+    this._framesSinceKeyframe = 0;
+    this._resetStats();
+  }
+
+  /**
+   * The frame that the next frame sent to this viewer should be a delta against, null if it should be a keyframe.
+   */
+  nextBaseFrameId() {
+    return (this._framesSinceKeyframe < KEYFRAME_INTERVAL_FRAMES) ? this._ackedFrameId : null;
+  }
+
+  /**
+   * Bytes of a frame that was sent to this viewer and may still be in its history.
+   */
+  sentFrameBytes(frameId) {
+    return this._sentFrames.get(frameId);
+  }
+
+  /**
+   * Whether the viewer has the given frame in its history to base a delta on.
+   */
+  hasFrame(frameId) {
+    return this._ackedFrames.has(frameId);
+  }
+
+  /**
+   * Send a frame, unless the socket is backed up with earlier ones, in which case it's skipped.
+   * @param {Object} frame - The frame packed for every viewer, see ViewerBroadcast.packFrame.
+   * @returns {Boolean} Whether the frame was sent.
+   */
+  send(frame) {
+    const {frameBytes, frameId} = frame;
+    if (this.socket.readyState !== ws.OPEN || this.socket.bufferedAmount > this.maxBufferedFrames*frameBytes.length) {
+      this.stats.framesSkipped++;
+      return false;
+    }
+
+    // The base may have fallen out of the viewer's history (or been thrown out by a keyframe request) since packing
+    let baseFrameId = frame.baseFrameIds.get(this);
+    const packet = (baseFrameId !== undefined && baseFrameId !== null && this._sentFrames.has(baseFrameId)) ?
+      frame.deltaPackets.get(this._sentFrames.get(baseFrameId)) : null;
+    if (!packet) { baseFrameId = null; }
+    const sentPacket = packet || frame.keyframePacket();
+    this.socket.send(sentPacket);
+
+    const {stats} = this;
+    stats.bytesSent += sentPacket.length;
+    if (baseFrameId === null) {
+      stats.keyframesSent++;
+      this._framesSinceKeyframe = 0;
+    }
+    else {
+      stats.deltasSent++;
+      this._framesSinceKeyframe++;
+    }
+
+    this._sentFrames.delete(frameId);
+    this._ackedFrames.delete(frameId);
+    this._sentFrames.set(frameId, frameBytes);
+    if (this._sentFrames.size > VIEWER_FRAME_HISTORY) {
+      const oldestFrameId = this._sentFrames.keys().next().value;
+      this._sentFrames.delete(oldestFrameId);
+      this._ackedFrames.delete(oldestFrameId);
+      if (oldestFrameId === this._ackedFrameId) {
+        this._ackedFrameId = null;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Read a packet from the viewer.
+   * @returns {Boolean} Whether it was a viewer stream packet, if not it's left for VoxelProtocol.readClientPacketStr.
+   */
+  readClientPacketStr(packetStr) {
+    let dataObj = null;
+    try {
+      dataObj = JSON.parse(packetStr);
+    }
+    catch (err) {
+      return false;
+    }
+
+    switch (dataObj && dataObj.packetType) {
+      case VoxelProtocol.VIEWER_FRAME_ACK_HEADER:
+        if (this._sentFrames.has(dataObj.frameId)) {
+          this._ackedFrameId = dataObj.frameId;
+          for (const frameId of this._sentFrames.keys()) {
+            this._ackedFrames.add(frameId);
+            if (frameId === dataObj.frameId) { break; }
+          }
+        }
+        return true;
+
+      case VoxelProtocol.VIEWER_KEYFRAME_REQUEST_HEADER:
+        this._sentFrames.clear();
+        this._ackedFrames.clear();
+        this._ackedFrameId = null;
+        this.stats.keyframeRequests++;
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+  takeStats() {
+    const stats = this.stats;
+    this._resetStats();
+    return stats;
+  }
+
+  _resetStats() {
+    this.stats = {
+      keyframesSent: 0,
+      deltasSent: 0,
+      framesSkipped: 0, // The socket was backed up with earlier frames
+      bytesSent: 0,
+      keyframeRequests: 0,
+    };
+  }
+}
+
+export default ViewerStream;
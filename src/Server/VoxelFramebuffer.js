@@ -25,6 +25,7 @@ class VoxelFramebuffer {
   clear(colour) { console.error("clear abstract method call."); }
 
   drawFramebuffer(framebuffer, blendMode) { console.error("drawFramebuffer abstract method call."); }
+  drawBuffer(buffer, blendMode) { console.error("drawBuffer abstract method call."); } // buffer is laid out like VoxelFramebufferCPU's
   drawCombinedFramebuffers(fb1, fb2, options) { console.error("drawCombinedFramebuffers abstract method call."); }
 
   drawPoint(pt, colour, blendMode) { console.error("drawPoint abstract method call."); }
@@ -1,41 +1,39 @@
+import {input} from 'gpu.js';
+
 import VoxelFramebuffer from './VoxelFramebuffer';
 import VoxelModel, {BLEND_MODE_ADDITIVE, BLEND_MODE_OVERWRITE} from './VoxelModel';
+import VoxelKernels from './VoxelKernels';
 import {clamp} from '../MathUtils';
 import VoxelGeometryUtils from '../VoxelGeometryUtils';
+import VoxelConstants from '../VoxelConstants';
 
 class VoxelFramebufferCPU extends VoxelFramebuffer {
-  constructor(index, gridSize, gpuKernelMgr) {
+  constructor(index, xSize, ySize, zSize, gpuKernelMgr) {
     super(index);
 
-    this.gridSize = gridSize;
+    this.xSize = xSize;
+    this.ySize = ySize;
+    this.zSize = zSize;
     this.gpuKernelMgr = gpuKernelMgr;
 
-    // Build the 3D array of voxels for the _buffer itself
-    this._buffer = [];
-    for (let x = 0; x < gridSize; x++) {
-      let currXArr = [];
-      this._buffer.push(currXArr);
-      for (let y = 0; y < gridSize; y++) {
-        let currYArr = [];
-        currXArr.push(currYArr);
-        for (let z = 0; z < gridSize; z++) {
-          currYArr.push([0,0,0]);
-        }
-      }
-    }
+    // The voxels are kept in one flat array, the colour of voxel (x,y,z) starts at ((x*ySize + y)*zSize + z)*3
+    this._buffer = new Float32Array(xSize*ySize*zSize*3);
+    this._gpuInputSize = [3*zSize, ySize, xSize];
   }
 
   getType() { return VoxelFramebuffer.VOXEL_FRAMEBUFFER_CPU_TYPE; }
 
   getBuffer() { return this._buffer; }
   getCPUBuffer() { return this._buffer; }
-  getGPUBuffer() { return this.gpuKernelMgr.copyFramebufferFuncImmutable(this._buffer); } // NOTE: The resulting texture must be deleted by calling delete() on it!
+  getGPUBuffer() { return this.gpuKernelMgr.copyFlatFramebufferFuncImmutable(input(this._buffer, this._gpuInputSize)); } // NOTE: The resulting texture must be released with gpuKernelMgr.texturePool.release!
+
+  _voxelIdx(x, y, z) { return ((x*this.ySize + y)*this.zSize + z)*3; }
 
   _setVoxelNoCheck(pt, colour) {
-    const voxelColour = this._buffer[pt[0]][pt[1]][pt[2]];
-    voxelColour[0] = colour[0];
-    voxelColour[1] = colour[1];
-    voxelColour[2] = colour[2];
+    const idx = this._voxelIdx(pt[0], pt[1], pt[2]);
+    this._buffer[idx]   = colour[0];
+    this._buffer[idx+1] = colour[1];
+    this._buffer[idx+2] = colour[2];
   }
 
   setVoxel(pt, colour) {
@@ -43,18 +41,18 @@ class VoxelFramebufferCPU extends VoxelFramebuffer {
     const adjustedY = Math.floor(pt[1]);
     const adjustedZ = Math.floor(pt[2]);
 
-    if (adjustedX >= 0 && adjustedX < this.gridSize &&
-        adjustedY >= 0 && adjustedY < this.gridSize &&
-        adjustedZ >= 0 && adjustedZ < this.gridSize) {
+    if (adjustedX >= 0 && adjustedX < this.xSize &&
+        adjustedY >= 0 && adjustedY < this.ySize &&
+        adjustedZ >= 0 && adjustedZ < this.zSize) {
       this._setVoxelNoCheck([adjustedX, adjustedY, adjustedZ], colour);
-    } 
+    }
   }
 
   _addToVoxelNoCheck(pt, colour) {
-    const voxelColour = this._buffer[pt[0]][pt[1]][pt[2]];
-    voxelColour[0] = clamp(voxelColour[0] + colour[0], 0, 1);
-    voxelColour[1] = clamp(voxelColour[1] + colour[1], 0, 1);
-    voxelColour[2] = clamp(voxelColour[2] + colour[2], 0, 1);
+    const idx = this._voxelIdx(pt[0], pt[1], pt[2]);
+    this._buffer[idx]   = clamp(this._buffer[idx]   + colour[0], 0, 1);
+    this._buffer[idx+1] = clamp(this._buffer[idx+1] + colour[1], 0, 1);
+    this._buffer[idx+2] = clamp(this._buffer[idx+2] + colour[2], 0, 1);
   }
 
   addToVoxel(pt, colour) {
@@ -62,42 +60,36 @@ class VoxelFramebufferCPU extends VoxelFramebuffer {
     const adjustedY = Math.floor(pt[1]);
     const adjustedZ = Math.floor(pt[2]);
 
-    if (adjustedX >= 0 && adjustedX < this.gridSize &&
-        adjustedY >= 0 && adjustedY < this.gridSize &&
-        adjustedZ >= 0 && adjustedZ < this.gridSize) {
+    if (adjustedX >= 0 && adjustedX < this.xSize &&
+        adjustedY >= 0 && adjustedY < this.ySize &&
+        adjustedZ >= 0 && adjustedZ < this.zSize) {
       this._addToVoxelNoCheck([adjustedX, adjustedY, adjustedZ], colour);
-    } 
+    }
   }
   addToVoxelFast(pt, colour) { this._addToVoxelNoCheck(pt, colour); }
 
   clear(colour) {
-    for (let x = 0; x < this.gridSize; x++) {
-      for (let y = 0; y < this.gridSize; y++) {
-        for (let z = 0; z < this.gridSize; z++) {
-          const voxelColour = this._buffer[x][y][z];
-          voxelColour[0] = colour[0];
-          voxelColour[1] = colour[1];
-          voxelColour[2] = colour[2];
-        }
-      }
-    }
+    VoxelKernels.clear(this._buffer, this.xSize, this.ySize, this.zSize, colour);
   }
 
   drawFramebuffer(framebuffer, blendMode) {
-    const bufferToDraw = framebuffer.getCPUBuffer();
-    const blendFunc = this._getBlendFuncNoCheck(blendMode);
-
-    for (let x = 0; x < this.gridSize; x++) {
-      for (let y = 0; y < this.gridSize; y++) {
-        for (let z = 0; z < this.gridSize; z++) {
-          blendFunc([x,y,z], bufferToDraw[x][y][z]);
-        }
-      }
-    }
+    VoxelKernels.blend(this._buffer, framebuffer.getCPUBuffer(), blendMode);
+  }
+  drawBuffer(buffer, blendMode) {
+    VoxelKernels.blend(this._buffer, buffer, blendMode);
   }
 
   drawCombinedFramebuffers(fb1, fb2, options) {
-    console.error("drawCombinedFramebuffers called on CPU Framebuffer.");
+    switch (options.mode) {
+      case VoxelModel.FB1_ALPHA_FB2_ONE_MINUS_ALPHA:
+        // Safe to do in place, i.e., when this is one of the framebuffers being combined
+        VoxelKernels.combineAlpha(this._buffer, fb1.getCPUBuffer(), fb2.getCPUBuffer(), options.alpha);
+        break;
+
+      default:
+        console.log("Invalid framebuffer combination mode.");
+        break;
+    }
   }
 
   drawPoint(pt, colour, blendMode) {
@@ -110,25 +102,13 @@ class VoxelFramebufferCPU extends VoxelFramebuffer {
   }
 
   drawAABB(minPt, maxPt, colour, fill, blendMode) {
-    const gridSize = this._buffer.length;
-    const boxPts = VoxelGeometryUtils.voxelAABBList(minPt, maxPt, fill, VoxelGeometryUtils.voxelBoundingBox(gridSize));
-    const blendDrawPointFunc = this._getBlendFuncNoCheck(blendMode);
-    const colourArr = [colour.r, colour.g, colour.b];
-
-    boxPts.forEach((pt) => {
-      blendDrawPointFunc([pt.x, pt.y, pt.z], colourArr);
-    });
+    VoxelKernels.drawAABB(this._buffer, this.xSize, this.ySize, this.zSize,
+      minPt, maxPt, [colour.r, colour.g, colour.b], fill, blendMode);
   }
 
   drawSphere(center, radius, colour, fill, blendMode) {
-    const gridSize = this._buffer.length;
-    const spherePts = VoxelGeometryUtils.voxelSphereList(center, radius, fill, VoxelGeometryUtils.voxelBoundingBox(gridSize));
-    const blendDrawPointFunc = this._getBlendFuncNoCheck(blendMode);
-    const colourArr = [colour.r, colour.g, colour.b];
-
-    spherePts.forEach((pt) => {
-      blendDrawPointFunc([pt.x, pt.y, pt.z], colourArr);
-    });
+    VoxelKernels.drawSphere(this._buffer, this.xSize, this.ySize, this.zSize,
+      center, radius, VoxelConstants.VOXEL_ERR_UNITS, [colour.r, colour.g, colour.b], fill, blendMode);
   }
 
   drawBox(center, eulerRot, size, colour, fill, blendMode) {
@@ -139,8 +119,8 @@ class VoxelFramebufferCPU extends VoxelFramebuffer {
     minPt.sub(halfSize);
     maxPt.add(halfSize);
 
-    const boxPts = VoxelGeometryUtils.voxelAABBList(minPt, maxPt, fill, VoxelGeometryUtils.voxelBoundingBox(gridSize));
-    const blendDrawPointFunc = this._getBlendFuncNoCheck(blendMode);
+    const boxPts = VoxelGeometryUtils.voxelAABBList(minPt, maxPt, fill, VoxelGeometryUtils.voxelBoundingBox(this.xSize, this.ySize, this.zSize));
+    const blendDrawPointFunc = this._getBlendFunc(blendMode);
     const colourArr = [colour.r, colour.g, colour.b];
 
     // Transform all the box points by the rotation, make sure we're doing this from the given center point...
@@ -153,7 +133,7 @@ class VoxelFramebufferCPU extends VoxelFramebuffer {
       }
     }
 
-    // Draw the box
+    // Draw the box, rotated points can land outside of the grid so they're checked
     boxPts.forEach((pt) => {
       blendDrawPointFunc([pt.x, pt.y, pt.z], colourArr);
     });
@@ -167,4 +147,4 @@ class VoxelFramebufferCPU extends VoxelFramebuffer {
   }
 }
 
-export default VoxelFramebufferCPU;
\ No newline at end of file
+export default VoxelFramebufferCPU;
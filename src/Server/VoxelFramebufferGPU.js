@@ -1,3 +1,5 @@
+import {input} from 'gpu.js';
+
 import VoxelFramebuffer from './VoxelFramebuffer';
 import VoxelModel, {BLEND_MODE_ADDITIVE, BLEND_MODE_OVERWRITE} from './VoxelModel';
 
@@ -7,6 +9,7 @@ class VoxelFramebufferGPU extends VoxelFramebuffer {
 
     this.gpuKernelMgr = gpuKernelMgr;
     this._bufferTexture = this.gpuKernelMgr.clearFunc([0,0,0]);
+    this._cpuBuffer = null;
   }
 
   getType() { return VoxelFramebuffer.VOXEL_FRAMEBUFFER_GPU_TYPE; }
@@ -14,7 +17,28 @@ class VoxelFramebufferGPU extends VoxelFramebuffer {
   setBufferTexture(bufferTex) { this._bufferTexture = bufferTex; }
 
   getBuffer() { return this._bufferTexture; }
-  getCPUBuffer() { return this._bufferTexture.toArray(); }
+  getCPUBuffer() {
+    // Read the texture back into a flat array laid out like the CPU framebuffer's (see VoxelFramebufferCPU)
+    const data = this.gpuKernelMgr.texturePool.toArray(this._bufferTexture);
+    const xSize = data.length, ySize = data[0].length, zSize = data[0][0].length;
+    if (!this._cpuBuffer || this._cpuBuffer.length !== xSize*ySize*zSize*3) {
+      this._cpuBuffer = new Float32Array(xSize*ySize*zSize*3);
+    }
+    let idx = 0;
+    for (let x = 0; x < xSize; x++) {
+      const dataX = data[x];
+      for (let y = 0; y < ySize; y++) {
+        const dataXY = dataX[y];
+        for (let z = 0; z < zSize; z++) {
+          const voxelColour = dataXY[z];
+          this._cpuBuffer[idx++] = voxelColour[0];
+          this._cpuBuffer[idx++] = voxelColour[1];
+          this._cpuBuffer[idx++] = voxelColour[2];
+        }
+      }
+    }
+    return this._cpuBuffer;
+  }
   getGPUBuffer() { return this._bufferTexture; }
 
   setVoxel(pt, colour) {
@@ -33,6 +57,21 @@ class VoxelFramebufferGPU extends VoxelFramebuffer {
 
   drawFramebuffer(framebuffer, blendMode) {
     const bufferToDraw = framebuffer.getGPUBuffer();
+    this._drawBufferTexture(bufferToDraw, blendMode);
+
+    if (framebuffer.getType() === VoxelFramebuffer.VOXEL_FRAMEBUFFER_CPU_TYPE) {
+      this.gpuKernelMgr.texturePool.release(bufferToDraw);
+    }
+  }
+
+  drawBuffer(buffer, blendMode) {
+    const [zSize, ySize, xSize] = this.gpuKernelMgr.pipelineFuncSettings.output;
+    const bufferToDraw = this.gpuKernelMgr.copyFlatFramebufferFuncImmutable(input(buffer, [3*zSize, ySize, xSize]));
+    this._drawBufferTexture(bufferToDraw, blendMode);
+    this.gpuKernelMgr.texturePool.release(bufferToDraw);
+  }
+
+  _drawBufferTexture(bufferToDraw, blendMode) {
     switch (blendMode) {
       case BLEND_MODE_ADDITIVE:
         this._bufferTexture = this.gpuKernelMgr.addFramebuffersFunc(this._bufferTexture, bufferToDraw);
@@ -44,10 +83,6 @@ class VoxelFramebufferGPU extends VoxelFramebuffer {
         console.log("Invalid blend mode.");
         break;
     }
-
-    if (framebuffer.getType() === VoxelFramebuffer.VOXEL_FRAMEBUFFER_CPU_TYPE) {
-      bufferToDraw.delete();
-    }
   }
 
   drawCombinedFramebuffers(fb1, fb2, options) {
@@ -59,10 +94,10 @@ class VoxelFramebufferGPU extends VoxelFramebuffer {
         this._bufferTexture = this.gpuKernelMgr.combineFramebuffersAlphaOneMinusAlphaFunc(fb1GPUBuffer, fb2GPUBuffer, options.alpha, 1.0-options.alpha);
 
         if (fb1.getType() === VoxelFramebuffer.VOXEL_FRAMEBUFFER_CPU_TYPE) {
-          fb1GPUBuffer.delete();
+          this.gpuKernelMgr.texturePool.release(fb1GPUBuffer);
         }
         if (fb2.getType() === VoxelFramebuffer.VOXEL_FRAMEBUFFER_CPU_TYPE) {
-          fb2GPUBuffer.delete();
+          this.gpuKernelMgr.texturePool.release(fb2GPUBuffer);
         }
 
         break;
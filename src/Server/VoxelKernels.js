@@ -0,0 +1,123 @@
+import {loadNativeAddon} from '../NativeAddons';
+import {BLEND_MODE_ADDITIVE} from './VoxelModel';
+
+const nativeVoxelKernels = loadNativeAddon('voxelkernels');
+if (nativeVoxelKernels) {
+  console.log("Using the native voxel framebuffer kernels.");
+}
+
+const clamp01 = (value) => value < 0 ? 0 : (value > 1 ? 1 : value);
+
+/**
+ * Whole-framebuffer and primitive kernels for the flat CPU voxel framebuffer (see VoxelFramebufferCPU), run by
+ * the native voxelkernels addon when it's built and in JS otherwise. Framebuffers are Float32Arrays where the colour
+ * of voxel (x,y,z) starts at ((x*ySize + y)*zSize + z)*3.
+ */
+class VoxelKernels {
+
+  static get isNative() { return nativeVoxelKernels !== null; }
+
+  static clear(buffer, xSize, ySize, zSize, colour) {
+    if (nativeVoxelKernels) {
+      nativeVoxelKernels.clear(buffer, xSize, ySize, zSize, colour[0], colour[1], colour[2]);
+      return;
+    }
+    const [r, g, b] = colour;
+    const numValues = xSize*ySize*zSize*3;
+    for (let i = 0; i < numValues; i += 3) {
+      buffer[i] = r; buffer[i+1] = g; buffer[i+2] = b;
+    }
+  }
+
+  static blend(dst, src, blendMode) {
+    if (nativeVoxelKernels) {
+      nativeVoxelKernels.blend(dst, src, blendMode);
+      return;
+    }
+    if (blendMode === BLEND_MODE_ADDITIVE) {
+      for (let i = 0; i < dst.length; i++) { dst[i] = clamp01(dst[i] + src[i]); }
+    }
+    else if (dst !== src) {
+      dst.set(src);
+    }
+  }
+
+  // dst = alpha*fb1 + (1-alpha)*fb2, dst may be one of fb1 or fb2
+  static combineAlpha(dst, fb1, fb2, alpha) {
+    if (nativeVoxelKernels) {
+      nativeVoxelKernels.combineAlpha(dst, fb1, fb2, alpha);
+      return;
+    }
+    const oneMinusAlpha = 1-alpha;
+    for (let i = 0; i < dst.length; i++) { dst[i] = alpha*fb1[i] + oneMinusAlpha*fb2[i]; }
+  }
+
+  /**
+   * Draw the voxels of the box [floor(minPt), ceil(maxPt)] clipped to the grid, only its outer layer when it isn't filled.
+   * @param {THREE.Vector3} minPt
+   * @param {THREE.Vector3} maxPt
+   * @param {Number[]} colour - [r,g,b]
+   */
+  static drawAABB(buffer, xSize, ySize, zSize, minPt, maxPt, colour, fill, blendMode) {
+    if (nativeVoxelKernels) {
+      nativeVoxelKernels.drawAABB(buffer, xSize, ySize, zSize, minPt.x, minPt.y, minPt.z, maxPt.x, maxPt.y, maxPt.z,
+        colour[0], colour[1], colour[2], fill, blendMode);
+      return;
+    }
+    const loX = Math.max(Math.floor(minPt.x), 0), hiX = Math.min(Math.ceil(maxPt.x), xSize-1);
+    const loY = Math.max(Math.floor(minPt.y), 0), hiY = Math.min(Math.ceil(maxPt.y), ySize-1);
+    const loZ = Math.max(Math.floor(minPt.z), 0), hiZ = Math.min(Math.ceil(maxPt.z), zSize-1);
+    for (let x = loX; x <= hiX; x++) {
+      for (let y = loY; y <= hiY; y++) {
+        const onSide = fill || x === loX || x === hiX || y === loY || y === hiY;
+        for (let z = loZ; z <= hiZ; z++) {
+          if (onSide || z === loZ || z === hiZ) {
+            VoxelKernels._blendVoxel(buffer, ((x*ySize + y)*zSize + z)*3, colour, blendMode);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Draw the voxels whose centers are within errUnits of the sphere (or inside it when it's filled).
+   * @param {THREE.Vector3} center
+   * @param {Number[]} colour - [r,g,b]
+   */
+  static drawSphere(buffer, xSize, ySize, zSize, center, radius, errUnits, colour, fill, blendMode) {
+    if (nativeVoxelKernels) {
+      nativeVoxelKernels.drawSphere(buffer, xSize, ySize, zSize, center.x, center.y, center.z, radius, errUnits,
+        colour[0], colour[1], colour[2], fill, blendMode);
+      return;
+    }
+    const loX = Math.max(Math.floor(center.x-radius), 0), hiX = Math.min(Math.ceil(center.x+radius), xSize-1);
+    const loY = Math.max(Math.floor(center.y-radius), 0), hiY = Math.min(Math.ceil(center.y+radius), ySize-1);
+    const loZ = Math.max(Math.floor(center.z-radius), 0), hiZ = Math.min(Math.ceil(center.z+radius), zSize-1);
+    for (let x = loX; x <= hiX; x++) {
+      const dx = x-center.x;
+      for (let y = loY; y <= hiY; y++) {
+        const dy = y-center.y;
+        for (let z = loZ; z <= hiZ; z++) {
+          const dz = z-center.z;
+          const dist = Math.sqrt(dx*dx + dy*dy + dz*dz) - radius;
+          if (fill ? dist < errUnits : Math.abs(dist) < errUnits) {
+            VoxelKernels._blendVoxel(buffer, ((x*ySize + y)*zSize + z)*3, colour, blendMode);
+          }
+        }
+      }
+    }
+  }
+
+  static _blendVoxel(buffer, idx, colour, blendMode) {
+    if (blendMode === BLEND_MODE_ADDITIVE) {
+      buffer[idx]   = clamp01(buffer[idx]   + colour[0]);
+      buffer[idx+1] = clamp01(buffer[idx+1] + colour[1]);
+      buffer[idx+2] = clamp01(buffer[idx+2] + colour[2]);
+    }
+    else {
+      buffer[idx] = colour[0]; buffer[idx+1] = colour[1]; buffer[idx+2] = colour[2];
+    }
+  }
+}
+
+export default VoxelKernels;
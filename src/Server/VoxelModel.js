@@ -16,14 +16,15 @@ import VTScene from '../VoxelTracer/VTScene';
 import VoxelFramebufferCPU from './VoxelFramebufferCPU';
 import VoxelFramebufferGPU from './VoxelFramebufferGPU';
 import GPUKernelManager from './GPUKernelManager';
+import FrameScheduler from './FrameScheduler';
+import FramePipeline from './FramePipeline';
+import VoxelRecorder from './Recording/VoxelRecorder';
+import AnimationCache from './AnimationCache';
 
 
 export const BLEND_MODE_OVERWRITE = 0;
 export const BLEND_MODE_ADDITIVE  = 1;
 
-const DEFAULT_POLLING_FREQUENCY_HZ = 60; // Render Frames per second - if this is too high then we overwhelm our clients
-const DEFAULT_POLLING_INTERVAL_MS  = 1000 / DEFAULT_POLLING_FREQUENCY_HZ;
-
 class VoxelModel {
 
   // Framebuffer index constants
@@ -48,18 +49,22 @@ class VoxelModel {
   // Framebuffer combination constants
   static get FB1_ALPHA_FB2_ONE_MINUS_ALPHA() { return 0; }
 
-  constructor(gridSize) {
+  constructor(xSize, ySize=xSize, zSize=xSize) {
 
-    this.gridSize = gridSize;
+    this._xSize = xSize;
+    this._ySize = ySize;
+    this._zSize = zSize;
+    // The largest dimension of the grid, used by the animators and simulations that work on a cube
+    this.gridSize = Math.max(xSize, ySize, zSize);
     this.blendMode = BLEND_MODE_OVERWRITE;
-    this.gpuKernelMgr = new GPUKernelManager(gridSize);
+    this.gpuKernelMgr = new GPUKernelManager(xSize, ySize, zSize);
 
     // Note: Indices MUST match up with the constants for *_FRAMEBUFFER_IDX_* !!!!
     this._framebuffers = [
       new VoxelFramebufferGPU(0, this.gpuKernelMgr),
       new VoxelFramebufferGPU(1, this.gpuKernelMgr),
-      new VoxelFramebufferCPU(2, gridSize, this.gpuKernelMgr),
-      new VoxelFramebufferCPU(3, gridSize, this.gpuKernelMgr),
+      new VoxelFramebufferCPU(2, xSize, ySize, zSize, this.gpuKernelMgr),
+      new VoxelFramebufferCPU(3, xSize, ySize, zSize, this.gpuKernelMgr),
     ];
     this._framebufferIdx = VoxelModel.GPU_FRAMEBUFFER_IDX_0;
 
@@ -77,6 +82,12 @@ class VoxelModel {
 
     this.currentAnimator = this._animators[VoxelAnimator.VOXEL_ANIM_TYPE_COLOUR];
 
+    this.frameScheduler = null;
+    this.framePipeline = null;
+    this.recorder = null;
+    this.player = null;
+    this.animationCache = null;
+    this.audioInput = null;
     this.currFrameTime = Date.now();
     this.frameCounter = 0;
     this.globalBrightnessMultiplier = VoxelConstants.DEFAULT_BRIGHTNESS_MULTIPLIER;
@@ -88,9 +99,9 @@ class VoxelModel {
     this.prevAnimator = null;
   }
 
-  xSize() { return this.gridSize; }
-  ySize() { return this.gridSize; }
-  zSize() { return this.gridSize; }
+  xSize() { return this._xSize; }
+  ySize() { return this._ySize; }
+  zSize() { return this._zSize; }
   numVoxels() { return this.xSize()*this.ySize()*this.zSize(); }
 
   setFramebuffer(idx=0) { this._framebufferIdx = idx; }
@@ -107,7 +118,8 @@ class VoxelModel {
       for (let y = 0; y < this.ySize(); y++) {
         const temp = [];
         for (let z = 0; z < this.zSize(); z++) {
-          const currColour = arr[x][y][z];
+          const idx = ((x*this.ySize() + y)*this.zSize() + z)*3;
+          const currColour = [arr[idx], arr[idx+1], arr[idx+2]];
           temp.push("("+currColour[0].toFixed(0)+","+currColour[1].toFixed(0)+","+currColour[2].toFixed(0)+")")
         }
         strArr.push(temp.join(", "));
@@ -146,18 +158,79 @@ class VoxelModel {
     //console.log("Global brightness set to " + this.globalBrightnessMultiplier);
   }
 
-  run(voxelServer) {
-    let self = this;
-    let lastFrameTime = Date.now();
-    let dt = 0;
-    let framesOnQueue = 0;
+  /**
+   * Start rendering frames and sending them to the voxel server.
+   * @param {VoxelServer} voxelServer
+   * @param {Object} options - Frame and simulation rates (see FrameScheduler) and the pipelineDepth between
+   * rendering, packing and sending frames (see FramePipeline).
+   * @param {String} options.recordPath - Record every frame to this file (see VoxelRecorder).
+   * @param {VoxelPlayer} options.player - Play back this recording instead of running the animators, its grid size
+   * must match the model's.
+   * @param {Boolean} options.loopReplay - Start the recording over when it ends, rather than holding its last frame.
+   * @param {String} options.animationCacheDir - Cache loops of the animators that can be cached here (see AnimationCache).
+   * @param {Number} options.animationCacheSecs - Length of each cached loop.
+   * @param {AudioInput} options.audioInput - Audio for the audio reactive animators, in place of any that the
+   * controllers send.
+   */
+  run(voxelServer, options={}) {
+    const self = this;
+    this.stop();
+    this.frameScheduler = new FrameScheduler(options);
+    this.framePipeline = new FramePipeline(voxelServer, {depth: options.pipelineDepth});
+
+    const gridSize = [this.xSize(), this.ySize(), this.zSize()];
+    this.animationCache = options.animationCacheDir ? new AnimationCache(options.animationCacheDir, gridSize, {
+      durationSecs: options.animationCacheSecs, simulationRateHz: this.frameScheduler.simulationRateHz,
+    }) : null;
+    this.audioInput = options.audioInput || null;
+    let recordTimeMs = 0;
+    if (options.recordPath) {
+      this.recorder = new VoxelRecorder(options.recordPath, gridSize, {frameRateHz: this.frameScheduler.frameRateHz});
+      console.log(`Recording frames to ${options.recordPath}.`);
+    }
+
+    // Replaying skips the animators altogether, the recorded frames go straight to the voxel server
+    this.player = options.player || null;
+    let replayTimeMs = 0;
+    let replayFinished = false;
+    const replayData = this.player ? new Float32Array(this.player.frameLength) : null;
+    const replayFrame = function(dt) {
+      const {player} = self;
+      replayTimeMs += dt*1000;
+      if (replayTimeMs > player.durationMs) {
+        if (options.loopReplay && player.durationMs > 0) {
+          replayTimeMs %= player.durationMs;
+        }
+        else if (!replayFinished) {
+          console.log("Replay finished, holding the last frame.");
+          replayFinished = true;
+        }
+      }
+      return player.readFrame(player.frameIndexAtTime(replayTimeMs), replayData);
+    };
 
-    const renderLoop = async function() {
+    // The animators simulate and render in one go, they're given the fixed step time that the scheduler
+    // has simulated since the last frame (which may be zero when simulating slower than the frame rate)
+    const renderFrame = async function(dt) {
       self.currFrameTime = Date.now();
-      dt = (self.currFrameTime - lastFrameTime) / 1000;
+
+      if (self.player) {
+        self.framePipeline.submitFrame(replayFrame(dt), self.globalBrightnessMultiplier, self.frameCounter);
+        self.frameCounter++;
+        return;
+      }
+
+      // The latest audio goes to the current animator right before it renders, so it's never more than a frame
+      // behind the analysis
+      if (self.audioInput) {
+        const audioInfo = self.audioInput.takeAudioInfo();
+        if (audioInfo && self.currentAnimator && self.currentAnimator.setAudioInfo) {
+          self.currentAnimator.setAudioInfo(audioInfo);
+        }
+      }
 
       // Simulate the model based on the current animation...
-      this.blendMode = BLEND_MODE_OVERWRITE;
+      self.blendMode = BLEND_MODE_OVERWRITE;
 
       // Deal with crossfading between animators
       if (self.prevAnimator) {
@@ -177,50 +250,91 @@ class VoxelModel {
 
         // Blend the currentAnimtor with the previous one via framebuffer - we need to do this so that we
         // aren't just overwriting the voxel framebuffer despite the crossfade amounts for each animation
-        const prevAnimatorFBIdx = prevAnimator.rendersToCPUOnly() ? VoxelModel.CPU_FRAMEBUFFER_IDX_0 : VoxelModel.GPU_FRAMEBUFFER_IDX_0;
+        const prevAnimatorCPUOnly = self._rendersToCPUOnly(prevAnimator);
+        const prevAnimatorFBIdx = prevAnimatorCPUOnly ? VoxelModel.CPU_FRAMEBUFFER_IDX_0 : VoxelModel.GPU_FRAMEBUFFER_IDX_0;
         self.setFramebuffer(prevAnimatorFBIdx);
         self.clear();
-        await prevAnimator.render(dt);
+        await self._renderAnimator(prevAnimator, dt, false);
 
-        const currAnimatorFBIdx = self.currentAnimator.rendersToCPUOnly() ? VoxelModel.CPU_FRAMEBUFFER_IDX_1 : VoxelModel.GPU_FRAMEBUFFER_IDX_1;
+        const currAnimatorCPUOnly = self._rendersToCPUOnly(self.currentAnimator);
+        const currAnimatorFBIdx = currAnimatorCPUOnly ? VoxelModel.CPU_FRAMEBUFFER_IDX_1 : VoxelModel.GPU_FRAMEBUFFER_IDX_1;
         self.setFramebuffer(currAnimatorFBIdx);
         self.clear();
-        await self.currentAnimator.render(dt);
+        await self._renderAnimator(self.currentAnimator, dt, true);
 
-        self.setFramebuffer(VoxelModel.GPU_FRAMEBUFFER_IDX_0);
+        // When both animators render on the CPU they're combined in place, saving the round trip through the GPU
+        const bothCPUOnly = prevAnimatorCPUOnly && currAnimatorCPUOnly;
+        self.setFramebuffer(bothCPUOnly ? currAnimatorFBIdx : VoxelModel.GPU_FRAMEBUFFER_IDX_0);
         self.drawCombinedFramebuffers(currAnimatorFBIdx, prevAnimatorFBIdx, {mode: VoxelModel.FB1_ALPHA_FB2_ONE_MINUS_ALPHA, alpha: percentFade});
       }
       else {
         // No crossfade, just render the current animation
-        const currFBIdx = self.currentAnimator.rendersToCPUOnly() ? VoxelModel.CPU_FRAMEBUFFER_IDX_0 : VoxelModel.GPU_FRAMEBUFFER_IDX_0;
+        const currFBIdx = self._rendersToCPUOnly(self.currentAnimator) ? VoxelModel.CPU_FRAMEBUFFER_IDX_0 : VoxelModel.GPU_FRAMEBUFFER_IDX_0;
         self.setFramebuffer(currFBIdx);
         self.clear();
-        await self.currentAnimator.render(dt);
+        await self._renderAnimator(self.currentAnimator, dt, true);
       }
 
-      // Let the server know to broadcast the new voxel data to all clients
-      voxelServer.setVoxelData(self.framebuffer.getCPUBuffer(), self.globalBrightnessMultiplier, self.frameCounter);
+      // Hand the frame on to be packed and broadcast to all clients while the next one renders
+      const frameData = self.framebuffer.getCPUBuffer();
+      self.framePipeline.submitFrame(frameData, self.globalBrightnessMultiplier, self.frameCounter);
       self.frameCounter++;
-
-      lastFrameTime = self.currFrameTime;
-
-      // Make sure we're keeping up with the set framerate, accounting for the time it took to execute the current frame
-      framesOnQueue--;
-      if (framesOnQueue === 0) {
-        const currTotalFrameTime = Date.now() - self.currFrameTime;
-        const timeToNextFrame = DEFAULT_POLLING_INTERVAL_MS-currTotalFrameTime;
-        if (timeToNextFrame <= 0) {
-          setImmediate(renderLoop);
-        }
-        else {
-          setTimeout(renderLoop, timeToNextFrame);
-        }
-        framesOnQueue++;
+      if (self.recorder) {
+        // Recordings are timed by the simulation so that they play back as they were meant to be seen, no matter
+        // how long the frames took to render
+        recordTimeMs += dt*1000;
+        self.recorder.recordFrame(frameData, recordTimeMs);
       }
     };
 
-    setTimeout(renderLoop, DEFAULT_POLLING_INTERVAL_MS);
-    framesOnQueue = 1;
+    const {frameRateHz, simulationRateHz} = this.frameScheduler;
+    if (this.player) {
+      const {numFrames, durationMs, filePath} = this.player;
+      console.log(`Replaying ${numFrames} frames (${(durationMs/1000).toFixed(1)}s) from ${filePath} at ${frameRateHz}Hz.`);
+    }
+    else {
+      console.log(`Rendering at ${frameRateHz}Hz` + (simulationRateHz !== frameRateHz ? `, simulating at ${simulationRateHz}Hz.` : "."));
+    }
+    this.frameScheduler.start(renderFrame);
+  }
+
+  // Animators that are played from the animation cache render to the CPU, whatever they'd render to live
+  _rendersToCPUOnly(animator) {
+    return animator.rendersToCPUOnly() || (this.animationCache !== null && this.animationCache.rendersToCPU(animator));
+  }
+
+  /**
+   * Render the animator into the current framebuffer, from the animation cache when it's cached there.
+   * @param {Boolean} isCurrent - Whether it's the current animator, only its live frames are cached.
+   */
+  async _renderAnimator(animator, dt, isCurrent) {
+    const {animationCache} = this;
+    if (animationCache && animationCache.render(animator, dt, this.framebuffer)) {
+      return;
+    }
+    await animator.render(dt);
+    if (animationCache && isCurrent) {
+      animationCache.capture(animator, dt, this.framebuffer);
+    }
+  }
+
+  /**
+   * Stop rendering frames.
+   * @returns {Promise} Resolves once any recording has been written out and any partial animation cache removed.
+   */
+  stop() {
+    if (this.frameScheduler) {
+      this.frameScheduler.stop();
+    }
+    if (this.framePipeline) {
+      this.framePipeline.stop();
+    }
+    const recorder = this.recorder;
+    this.recorder = null;
+    return Promise.all([
+      recorder ? recorder.close() : Promise.resolve(),
+      this.animationCache ? this.animationCache.stop() : Promise.resolve(),
+    ]);
   }
  
   /**
@@ -250,6 +364,10 @@ class VoxelModel {
   addToVoxelFast(pt, colour) {
     this.framebuffer.addToVoxelFast([pt.x, pt.y, pt.z], [colour.r, colour.g, colour.b]);
   }
+  // Add a whole flat voxel colour buffer (laid out like VoxelFramebufferCPU's) into the current framebuffer
+  addBuffer(buffer) {
+    this.framebuffer.drawBuffer(buffer, BLEND_MODE_ADDITIVE);
+  }
 
   drawFramebuffer(idx) {
     if (idx === this._framebufferIdx) {
@@ -260,6 +378,7 @@ class VoxelModel {
     this.framebuffer.drawFramebuffer(this._framebuffers[idx], this.blendMode);
   }
 
+  // The current framebuffer may be one of the two being combined when it's a CPU framebuffer
   drawCombinedFramebuffers(fb1Idx, fb2Idx, options) {
     this.framebuffer.drawCombinedFramebuffers(this._framebuffers[fb1Idx], this._framebuffers[fb2Idx], options);
   }
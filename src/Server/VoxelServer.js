@@ -4,11 +4,26 @@ import Readline from '@serialport/parser-readline';
 import cobs from 'cobs';
 
 import VoxelProtocol from '../VoxelProtocol';
-import VoxelConstants from '../VoxelConstants';
+import SlaveSerialWriter from './SlaveWriter/SlaveSerialWriter';
+import ViewerBroadcast from './ViewerBroadcast';
 
 const DEFAULT_TEENSY_USB_SERIAL_BAUD = 9600;
 const DEFAULT_TEENSY_HW_SERIAL_BAUD  = 3000000;
 const SERIAL_POLLING_INTERVAL_MS = 10000;
+const SLAVE_WRITER_STATS_INTERVAL_MS = 30000;
+
+// Frame sync mode: each slave stages the frames it receives and acknowledges them, once every slave has
+// acknowledged a frame the sync master slave pulses the shared frame sync line and they all show it at once.
+// Only turn this on when the FRAME_SYNC_PIN of every slave is wired together, otherwise frames never get shown.
+const FRAME_SYNC_ENABLED = false;
+const FRAME_SYNC_TIMEOUT_MS = 100; // Stop waiting on slaves that didn't acknowledge a frame (e.g., it was thrown out) after this long
+
+// Slave colour LUT mode: the slaves get raw (linear) colours and apply gamma, colour correction and brightness themselves
+// through a colour LUT that's uploaded to them when they connect, with temporal dithering to show the colours that
+// 8-bit gamma corrected output can't. Brightness changes are then a tiny packet instead of re-packing every frame.
+const SLAVE_COLOUR_LUT_ENABLED = true;
+const SLAVE_COLOUR_CORRECTION = [1, 1, 1];
+const SLAVE_DITHERING_ENABLED = true;
 
 class VoxelServer {
 
@@ -17,11 +32,12 @@ class VoxelServer {
     this.voxelModel = voxelModel;
 
     // Setup websockets
-    this.viewerWS = null;
-    this.controllerWS = null;
+    // Any number of viewers (which are streamed the frames) and controllers can be connected at once
+    this.viewers = new ViewerBroadcast();
+    this.controllerSockets = new Set();
     this.webSocketServer = new ws.Server({
       port: VoxelProtocol.WEBSOCKET_PORT,
-      perMessageDeflate: true, // Enable compression... lots of repetitive data.
+      perMessageDeflate: false, // Viewer frames are delta coded (see ViewerStream), deflating them costs more than it saves
     });
 
     this.webSocketServer.on('open', function() {
@@ -29,13 +45,14 @@ class VoxelServer {
     });
 
     this.webSocketServer.on('connection', function(socket, request, client) {
-      console.log("Websocket opened.");
+      const remoteName = request.socket.remoteAddress + ":" + request.socket.remotePort;
+      console.log("Websocket opened (" + socket.protocol + " @ " + remoteName + ").");
       switch (socket.protocol) {
         case VoxelProtocol.WEBSOCKET_PROTOCOL_VIEWER:
-          self.viewerWS = socket;
+          self.viewers.addViewer(socket, {name: remoteName});
           break;
         case VoxelProtocol.WEBSOCKET_PROTOCOL_CONTROLLER:
-          self.controllerWS = socket;
+          self.controllerSockets.add(socket);
           break;
         default:
           console.error("Invalid websocket protocol found: " + socket.protocol);
@@ -45,13 +62,16 @@ class VoxelServer {
 
       socket.on('message', function(data) {
         //console.log("Websocket message received: " + data);
+        if (self.viewers.readClientPacketStr(data, socket)) {
+          return;
+        }
         VoxelProtocol.readClientPacketStr(data, voxelModel, socket);
       });
 
       socket.on('close', function() {
-        console.log("Websocket closed.");
-        if (socket === self.controllerWS) { self.controllerWS = null; }
-        else if (socket === self.viewerWS) { self.viewerWS = null; }
+        console.log("Websocket closed (" + socket.protocol + " @ " + remoteName + ").");
+        self.controllerSockets.delete(socket);
+        self.viewers.removeViewer(socket);
       });
 
       socket.send(VoxelProtocol.buildClientWelcomePacketStr(voxelModel));
@@ -64,11 +84,18 @@ class VoxelServer {
     this.availableSerialPorts = [];
     this.connectedSerialPorts = [];
     this.slaveDataMap = {};
+
+    this.frameSyncEnabled = FRAME_SYNC_ENABLED;
+    this.syncFrameId = null;          // The frame that the slaves are currently staging, null when not waiting on one
+    this.syncFrameRequested = false;  // Whether the sync master has been told to pulse the frame sync line for it
+    this.syncFrameTime = 0;
+    this.frameSyncMasterMissing = false;
+
+    this.slaveColourLUTEnabled = SLAVE_COLOUR_LUT_ENABLED;
   }
 
   start() {
     const self = this;
-    const parser = new Readline();
 
     setInterval(function() {
 
@@ -114,7 +141,7 @@ class VoxelServer {
                   autoOpen: false,
                   baudRate: DEFAULT_TEENSY_HW_SERIAL_BAUD,
                   rtscts: true,
-                  highWaterMark: (8*VoxelConstants.VOXEL_GRID_SIZE*VoxelConstants.VOXEL_GRID_SIZE*3+4+64),
+                  highWaterMark: (8*self.voxelModel.ySize()*self.voxelModel.zSize()*3+4+64),
                 });
                 newSerialPort.isVoxelDataConnection = true;
               }
@@ -126,17 +153,22 @@ class VoxelServer {
 
                 newSerialPort.on('close', () => {
                   console.log("Serial port closed: " + availablePort.path);
+                  if (newSerialPort.slaveWriter) {
+                    newSerialPort.slaveWriter.dispose();
+                    newSerialPort.slaveWriter = null;
+                  }
                   delete self.slaveDataMap[availablePort.path];
                   self.connectedSerialPorts.splice(self.connectedSerialPorts.indexOf(newSerialPort), 1);
                 });
 
                
                 newSerialPort.on('open', () => {
+                  const parser = new Readline();
                   newSerialPort.pipe(parser);
-                  newSerialPort.lastWriteResult = true;
 
                   if (isDataSerial) {
-                    const welcomePacketBuf = VoxelProtocol.buildWelcomePacketForSlaves(self.voxelModel);
+                    newSerialPort.slaveWriter = new SlaveSerialWriter(newSerialPort);
+                    const welcomePacketBuf = VoxelProtocol.buildWelcomePacketForSlaves(self.voxelModel, self.frameSyncEnabled);
                     welcomePacketBuf[0] = 255;
                     newSerialPort.write(cobs.encode(welcomePacketBuf, true));
                     console.log("Sent welcome packet to " + availablePort.path);
@@ -148,7 +180,8 @@ class VoxelServer {
                       if (slaveInfoMatch) {
                         if (!(availablePort.path in self.slaveDataMap)) {
                           const slaveDataObj = {
-                            id: parseInt(slaveInfoMatch[1])
+                            id: parseInt(slaveInfoMatch[1]),
+                            lastAckedFrameId: -1,
                           };
                           self.slaveDataMap[availablePort.path] = slaveDataObj;
             
@@ -156,14 +189,34 @@ class VoxelServer {
                           console.log("Slave ID at " + availablePort.path + " = " + self.slaveDataMap[availablePort.path].id);
                           console.log("Sending welcome packet to " + availablePort.path + "...");
             
-                          const welcomePacketBuf = VoxelProtocol.buildWelcomePacketForSlaves(self.voxelModel);
+                          const welcomePacketBuf = VoxelProtocol.buildWelcomePacketForSlaves(self.voxelModel, self.frameSyncEnabled);
                           welcomePacketBuf[0] = slaveDataObj.id;
                           newSerialPort.write(cobs.encode(welcomePacketBuf, true));
+                          newSerialPort.slaveWriter.reset();
+                          if (self.slaveColourLUTEnabled) {
+                            const colourLUTPacketBuf = VoxelProtocol.buildColourLUTPacketForSlaves(
+                              slaveDataObj.id, SLAVE_COLOUR_CORRECTION, SLAVE_DITHERING_ENABLED);
+                            newSerialPort.write(cobs.encode(colourLUTPacketBuf, true));
+                          }
                         }
                         else {
                           self.slaveDataMap[availablePort.path].id = parseInt(slaveInfoMatch[1]);
                         }
                       }
+                      else if (data.match(/KEYFRAME/) && availablePort.path in self.slaveDataMap) {
+                        // The slave couldn't apply a dirty row packet, the next frame it gets must be a full one
+                        newSerialPort.slaveWriter.reset();
+                      }
+                      else if (data.match(/FRAME_ACK (\d+)/) && availablePort.path in self.slaveDataMap) {
+                        self.slaveDataMap[availablePort.path].lastAckedFrameId = parseInt(data.match(/FRAME_ACK (\d+)/)[1]);
+                        self.updateFrameSync();
+                      }
+                      else if (data.match(/FRAME_SYNC (\d+)/)) {
+                        // The sync master pulsed the frame sync line, the slaves are ready for the next frame
+                        if (self.syncFrameRequested && parseInt(data.match(/FRAME_SYNC (\d+)/)[1]) === self.syncFrameId) {
+                          self.syncFrameId = null;
+                        }
+                      }
                     }
                     else {
                       console.log(data);
@@ -194,16 +247,107 @@ class VoxelServer {
         }
       );
     }, SERIAL_POLLING_INTERVAL_MS);
+
+    setInterval(function() {
+      self.logSlaveWriterStats();
+      self.viewers.logStats();
+    }, SLAVE_WRITER_STATS_INTERVAL_MS);
   }
 
   stop() {
     this.connectedSerialPorts.forEach((currSerialPort) => {
+      if (currSerialPort.slaveWriter) { currSerialPort.slaveWriter.dispose(); }
       currSerialPort.close();
     });
   }
 
-  sendClientSocketVoxelData(voxelData) {
-    if (this.connectedSerialPorts.length > 0) {
+  logSlaveWriterStats() {
+    this.connectedSerialPorts.forEach((currSerialPort) => {
+      if (!currSerialPort.slaveWriter) { return; }
+      const slaveData = this.slaveDataMap[currSerialPort.path];
+      const stats = currSerialPort.slaveWriter.takeStats();
+      console.log("[Slave " + (slaveData ? slaveData.id : "?") + " @ " + currSerialPort.path + "] " +
+        "Frames queued: " + stats.framesQueued + ", written: " + stats.framesWritten + ", dropped: " + stats.framesDropped +
+        ", KB written: " + (stats.bytesWritten/1024).toFixed(1) +
+        ", avg encode: " + (stats.framesWritten > 0 ? stats.totalEncodeTimeMs/stats.framesWritten : 0).toFixed(3) + " ms" +
+        ", queue depth: " + stats.frames + " frames, " + stats.bytes + " bytes");
+    });
+  }
+
+  /**
+   * Request the frame sync for the frame that the slaves are staging once every connected slave has
+   * acknowledged it (or after waiting too long for them to).
+   */
+  updateFrameSync() {
+    if (this.syncFrameId === null || this.syncFrameRequested) {
+      return;
+    }
+
+    const slaveDataPorts = this.connectedSerialPorts.filter(port => port.isOpen && port.isVoxelDataConnection && this.slaveDataMap[port.path]);
+    const masterPort = slaveDataPorts.find(port => this.slaveDataMap[port.path].id === VoxelProtocol.FRAME_SYNC_MASTER_SLAVE_ID);
+    if (!masterPort) {
+      if (!this.frameSyncMasterMissing) {
+        console.error("Frame sync master slave (ID " + VoxelProtocol.FRAME_SYNC_MASTER_SLAVE_ID + ") isn't connected, frames can't be synced.");
+        this.frameSyncMasterMissing = true;
+      }
+      this.syncFrameId = null;
+      return;
+    }
+    this.frameSyncMasterMissing = false;
+
+    const allAcked = slaveDataPorts.every(port => this.slaveDataMap[port.path].lastAckedFrameId === this.syncFrameId);
+    const timedOut = Date.now() - this.syncFrameTime > FRAME_SYNC_TIMEOUT_MS;
+    if (allAcked || timedOut) {
+      if (!allAcked) {
+        console.log("Timed out waiting on slaves to acknowledge frame " + this.syncFrameId + ", syncing anyway.");
+      }
+      masterPort.write(cobs.encode(VoxelProtocol.buildFrameSyncPacketForSlaves(this.syncFrameId), true));
+      this.syncFrameRequested = true;
+      this.syncFrameTime = Date.now();
+    }
+  }
+
+  /**
+   * Pack a frame of voxel data into the packets for the slaves and the viewers, only building the ones that someone
+   * is connected to receive. Each packet is built once no matter how many are connected to receive it. The packets don't share memory with the voxel data, which is free to be reused once this
+   * returns.
+   * @param {Object} voxelData - The voxel data object, see voxelDataFrame.
+   * @returns {Object} The packed frame for transmitVoxelData.
+   */
+  packVoxelData(voxelData) {
+    const {type, gridSize, brightnessMultiplier, frameId} = voxelData;
+    const hasSlaves = this.connectedSerialPorts.some(port => port.isVoxelDataConnection && port.slaveWriter && this.slaveDataMap[port.path]);
+    return {
+      voxelData: {type, gridSize, brightnessMultiplier, frameId},
+      // Every slave's packet is packed in one go
+      slavePacketBufs: hasSlaves ? (VoxelProtocol.buildVoxelDataPacketsForSlaves(voxelData, this.slaveColourLUTEnabled) || []) : null,
+      viewerFrame: this.viewers.packFrame(voxelData),
+    };
+  }
+
+  /**
+   * Send a packed frame (see packVoxelData) to the slaves and the viewers.
+   */
+  transmitVoxelData(packedFrame) {
+    const {voxelData, slavePacketBufs, viewerFrame} = packedFrame;
+
+    // In frame sync mode the slaves can't be sent a new frame until the staged one has been shown
+    let waitingOnFrameSync = false;
+    if (this.frameSyncEnabled && this.syncFrameId !== null) {
+      if (this.syncFrameRequested) {
+        if (Date.now() - this.syncFrameTime > FRAME_SYNC_TIMEOUT_MS) {
+          console.log("Timed out waiting on the frame sync for frame " + this.syncFrameId + ".");
+          this.syncFrameId = null;
+        }
+      }
+      else {
+        this.updateFrameSync();
+      }
+      waitingOnFrameSync = this.syncFrameId !== null;
+    }
+
+    if (this.connectedSerialPorts.length > 0 && !waitingOnFrameSync) {
+      let numSlavesSent = 0;
       // Send data frames out through all connected serial ports
       this.connectedSerialPorts.forEach((currSerialPort) => {
         if (!currSerialPort.isOpen) {
@@ -213,44 +357,56 @@ class VoxelServer {
         }
         else if (currSerialPort.isVoxelDataConnection) {
           const slaveData = this.slaveDataMap[currSerialPort.path];
-          //console.log(slaveData);
-          if (slaveData && currSerialPort.lastWriteResult) {
-            //console.log("Sending slave data.");
-            const voxelDataSlavePacketBuf = VoxelProtocol.buildVoxelDataPacketForSlaves(voxelData, slaveData.id);
-            const encodedPacketBuf = cobs.encode(voxelDataSlavePacketBuf, true);
-            currSerialPort.lastWriteResult = currSerialPort.write(encodedPacketBuf);
-            currSerialPort.drain((err) => {
-              if (err) {  console.error(err); }
-              currSerialPort.lastWriteResult = true;
-              //console.log("Drained.");
-            });
-          }
-          else {
-            //console.log("Failed to send slave data: " + (slaveData ? "" : "Data empty") + " " + (currSerialPort.lastWriteResult ? "" : "Not finished writing."));
+          if (slaveData && currSerialPort.slaveWriter && slavePacketBufs) {
+            const voxelDataSlavePacketBuf = slavePacketBufs[slaveData.id];
+            if (!voxelDataSlavePacketBuf) {
+              return;
+            }
+
+            // The port's writer encodes and sends the frame once the port is free, the render loop never waits on it
+            currSerialPort.slaveWriter.postFrame(slaveData.id, voxelDataSlavePacketBuf,
+              this.slaveColourLUTEnabled ? voxelData.brightnessMultiplier : null);
+            numSlavesSent++;
           }
         }
       });
-    }
 
-    // Send voxel data to the viewer websocket client
-    const voxelDataPacketBuf = VoxelProtocol.buildVoxelDataPacket(voxelData);
-    if (this.viewerWS && this.viewerWS.bufferedAmount === 0) {
-      this.viewerWS.send(voxelDataPacketBuf);
+      if (this.frameSyncEnabled && numSlavesSent > 0) {
+        this.syncFrameId = voxelData.frameId % 65536;
+        this.syncFrameRequested = false;
+        this.syncFrameTime = Date.now();
+      }
     }
+
+    // Send voxel data to the viewer websocket clients, each one skips frames while its socket is backed up
+    this.viewers.transmitFrame(viewerFrame);
+  }
+
+  sendClientSocketVoxelData(voxelData) {
+    this.transmitVoxelData(this.packVoxelData(voxelData));
   }
 
   /**
-   * Sets all of the voxel data to the given full set of each voxel in the display.
-   * This will result in a full refresh of the display.
-   * @param {[][][]} data - A 3D array of the voxel data for display, where each voxel has an RGB colour (getColour() accessor function).
+   * Build the voxel data object for a full frame of the display.
+   * @param {Float32Array} data - Flat array of the voxel colours for display, laid out like VoxelFramebufferCPU's buffer.
    */
-  setVoxelData(data, brightnessMultiplier, frameCounter) {
-    this.sendClientSocketVoxelData({
+  voxelDataFrame(data, brightnessMultiplier, frameCounter) {
+    return {
       type: VoxelProtocol.VOXEL_DATA_ALL_TYPE,
       data: data,
+      gridSize: [this.voxelModel.xSize(), this.voxelModel.ySize(), this.voxelModel.zSize()],
       brightnessMultiplier: brightnessMultiplier,
       frameId: frameCounter,
-    });
+    };
+  }
+
+  /**
+   * Sets all of the voxel data to the given full set of each voxel in the display.
+   * This will result in a full refresh of the display.
+   * @param {Float32Array} data - Flat array of the voxel colours for display, laid out like VoxelFramebufferCPU's buffer.
+   */
+  setVoxelData(data, brightnessMultiplier, frameCounter) {
+    this.sendClientSocketVoxelData(this.voxelDataFrame(data, brightnessMultiplier, frameCounter));
   }
 }
 
@@ -3,14 +3,109 @@ import express from 'express';
 import watch from 'watch';
 import http from 'http';
 import reload from 'reload';
+import minimist from 'minimist';
 
 import VoxelServer from './VoxelServer';
 import VoxelModel from './VoxelModel';
 import VoxelConstants from '../VoxelConstants';
+import OctoPacker from '../OctoPacker';
+import {DEFAULT_FRAME_RATE_HZ} from './FrameScheduler';
+import {DEFAULT_PIPELINE_DEPTH} from './FramePipeline';
+import VoxelPlayer from './Recording/VoxelPlayer';
+import {DEFAULT_ANIMATION_CACHE_SECS} from './AnimationCache';
+import AudioInput, {DEFAULT_SAMPLE_RATE} from './Audio/AudioInput';
 
 const LOCALHOST_WEB_PORT = 4000;
 const DISTRIBUTION_DIRNAME = "dist";
 
+// The size of the voxel grid is given as "--grid N" for an NxNxN cube or "--grid XxYxZ", e.g., "--grid 24x16x32".
+// Each slave drives an x-slice per OctoWS2811 pin, so the x size must be a multiple of the number of pins.
+const parseGridSize = (gridArg) => {
+  const sizes = String(gridArg).toLowerCase().split('x').map(size => parseInt(size));
+  const [xSize, ySize, zSize] = sizes.length === 1 ? [sizes[0], sizes[0], sizes[0]] : sizes;
+  if ((sizes.length !== 1 && sizes.length !== 3) || [xSize, ySize, zSize].some(size => !(size > 0))) {
+    console.error("Invalid grid size '" + gridArg + "', expected N or XxYxZ.");
+    process.exit(1);
+  }
+  if (xSize % OctoPacker.NUM_OCTO_PINS !== 0) {
+    console.error("The x size of the grid must be a multiple of " + OctoPacker.NUM_OCTO_PINS + ", got " + xSize + ".");
+    process.exit(1);
+  }
+  return [xSize, ySize, zSize];
+};
+// Frames are rendered and sent at "--fps N", the animations are simulated in fixed steps of "--sim-hz N" (the frame rate by default).
+// Up to "--pipeline-depth N" frames wait between rendering, packing and sending, 0 sends each frame as soon as it's rendered.
+const parseRate = (rateArg, name) => {
+  const rate = parseFloat(rateArg);
+  if (!(rate > 0)) {
+    console.error("Invalid " + name + " '" + rateArg + "', expected a positive number.");
+    process.exit(1);
+  }
+  return rate;
+};
+const argv = minimist(process.argv.slice(2), {
+  default: {
+    fps: DEFAULT_FRAME_RATE_HZ, 'pipeline-depth': DEFAULT_PIPELINE_DEPTH, 'anim-cache-secs': DEFAULT_ANIMATION_CACHE_SECS,
+    'audio-rate': DEFAULT_SAMPLE_RATE, 'audio-channels': 1,
+  },
+  string: ['record', 'replay', 'anim-cache', 'audio'],
+  boolean: ['loop'],
+});
+
+// "--record FILE" records every frame to the given file, "--replay FILE" plays a recording back instead of running
+// the animators ("--loop" to keep starting it over), on a grid of the recording's size unless "--grid" is given.
+let player = null;
+if (argv.replay) {
+  try {
+    player = new VoxelPlayer(argv.replay);
+  }
+  catch (err) {
+    console.error("Failed to open the recording '" + argv.replay + "': " + err.message);
+    process.exit(1);
+  }
+  if (player.numFrames === 0) {
+    console.error("The recording '" + argv.replay + "' has no frames.");
+    process.exit(1);
+  }
+}
+const [gridXSize, gridYSize, gridZSize] = (argv.grid === undefined && player) ? player.gridSize :
+  parseGridSize(argv.grid === undefined ? VoxelConstants.VOXEL_GRID_SIZE : argv.grid);
+if (player && player.gridSize.some((size, i) => size !== [gridXSize, gridYSize, gridZSize][i])) {
+  console.error("The recording '" + argv.replay + "' is of a " + player.gridSize.join("x") + " grid, not " +
+    gridXSize + "x" + gridYSize + "x" + gridZSize + ".");
+  process.exit(1);
+}
+const frameRateHz = parseRate(argv.fps, "frame rate");
+const simulationRateHz = argv['sim-hz'] === undefined ? frameRateHz : parseRate(argv['sim-hz'], "simulation rate");
+const pipelineDepth = parseInt(argv['pipeline-depth']);
+if (!(pipelineDepth >= 0)) {
+  console.error("Invalid pipeline depth '" + argv['pipeline-depth'] + "', expected a whole number of frames.");
+  process.exit(1);
+}
+// "--anim-cache DIR" caches loops of the animators whose frames only depend on their config in the given directory
+const animationCacheSecs = parseFloat(argv['anim-cache-secs']);
+if (!(animationCacheSecs > 0)) {
+  console.error("Invalid animation cache length '" + argv['anim-cache-secs'] + "', expected a positive number of seconds.");
+  process.exit(1);
+}
+// "--audio -" analyzes raw 16-bit PCM from stdin ("--audio-rate" and "--audio-channels" give its format) and
+// "--audio FILE" a WAV (or raw PCM) file on a loop, for the audio reactive animators in place of a controller's audio
+let audioInput = null;
+if (argv.audio) {
+  const audioChannels = parseInt(argv['audio-channels']);
+  if (!(audioChannels >= 1)) {
+    console.error("Invalid number of audio channels '" + argv['audio-channels'] + "'.");
+    process.exit(1);
+  }
+  try {
+    audioInput = new AudioInput(argv.audio, {sampleRate: parseRate(argv['audio-rate'], "audio sample rate"), channels: audioChannels});
+  }
+  catch (err) {
+    console.error("Failed to open the audio input '" + argv.audio + "': " + err.message);
+    process.exit(1);
+  }
+}
+
 // Create the web server
 const app = express();
 let distPath = path.resolve();
@@ -54,7 +149,8 @@ reload(app).then((reloadReturned) => {
 
 // Create the voxel model - this maintains all of the voxel states and provides the data
 // that we send to various clients
-const voxelModel = new VoxelModel(VoxelConstants.VOXEL_GRID_SIZE);
+const voxelModel = new VoxelModel(gridXSize, gridYSize, gridZSize);
+console.log("Voxel grid: " + gridXSize + "x" + gridYSize + "x" + gridZSize);
 //voxelModel.test();
 
 // Create the voxel server - this will handle discovery and transmission of voxel data to both
@@ -62,11 +158,22 @@ const voxelModel = new VoxelModel(VoxelConstants.VOXEL_GRID_SIZE);
 const voxelServer = new VoxelServer(voxelModel);
 
 voxelServer.start();
-voxelModel.run(voxelServer);
+if (audioInput) {
+  audioInput.start();
+}
+voxelModel.run(voxelServer, {
+  frameRateHz, simulationRateHz, pipelineDepth, recordPath: argv.record, player, loopReplay: argv.loop,
+  animationCacheDir: argv['anim-cache'], animationCacheSecs, audioInput,
+});
 
 process.once('SIGINT', function (code) {
   console.log('SIGINT received...');
-  voxelServer.stop();
-  webServer.close();
-  process.exit(code);
+  // Wait on any recording to be written out before exiting
+  voxelModel.stop().then(() => {
+    if (player) { player.close(); }
+    if (audioInput) { audioInput.stop(); }
+    voxelServer.stop();
+    webServer.close();
+    process.exit(code);
+  });
 });
\ No newline at end of file
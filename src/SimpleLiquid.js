@@ -45,6 +45,7 @@ class LiquidSim {
     this.forceBlobs = [];
 
     this.gpuManager = gpuManager;
+    this.texturePool = gpuManager.texturePool;
 
     this.gravity = GRAVITY;
     this.vorticityConfinement = 0;
@@ -77,80 +78,53 @@ class LiquidSim {
   }
 
   advectVelocity(dt) {
-    let temp = this.velField;
-    this.velField = this.gpuManager.simpleWaterAdvectVel(dt, this.velField, this.cells);
-    temp.delete();
+    this.velField = this.texturePool.replace(this.velField, this.gpuManager.simpleWaterAdvectVel(dt, this.velField, this.cells));
   }
 
   applyExternalForces(dt) {
-    let temp = this.velField;
-    this.velField = this.gpuManager.simpleWaterApplyExtForces(dt, this.gravity, this.velField, this.cells);
-    temp.delete();
+    const {texturePool} = this;
+    this.velField = texturePool.replace(this.velField, this.gpuManager.simpleWaterApplyExtForces(dt, this.gravity, this.velField, this.cells));
 
     for (const forceBlob of this.forceBlobs) {
       const {center, impulseStrength, size} = forceBlob;
       console.log(forceBlob);
-      temp = this.velField;
-      this.velField = this.gpuManager.simpleWaterInjectForceBlob(
+      this.velField = texturePool.replace(this.velField, this.gpuManager.simpleWaterInjectForceBlob(
         center, impulseStrength, size, this.velField, this.cells
-      );
-      temp.delete();
+      ));
     }
     this.forceBlobs = [];
   }
 
   applyVorticityConfinement(dt) {
-    let temp = this.tempBuffVec3;
-    this.tempBuffVec3 = this.gpuManager.simpleWaterCurl(this.velField, this.cells);
-    temp.delete();
-
-    temp = this.tempBuffScalar;
-    this.tempBuffScalar = this.gpuManager.simpleWaterCurlLen(this.tempBuffVec3);
-    temp.delete();
+    const {texturePool} = this;
+    this.tempBuffVec3 = texturePool.replace(this.tempBuffVec3, this.gpuManager.simpleWaterCurl(this.velField, this.cells));
+    this.tempBuffScalar = texturePool.replace(this.tempBuffScalar, this.gpuManager.simpleWaterCurlLen(this.tempBuffVec3));
 
     const dtVC = this.applyCFL(dt*this.vorticityConfinement);
-    temp = this.velField;
-    this.velField = this.gpuManager.simpleWaterApplyVC(
+    this.velField = texturePool.replace(this.velField, this.gpuManager.simpleWaterApplyVC(
       dtVC, this.velField, this.cells, this.tempBuffVec3, this.tempBuffScalar
-    );
-    temp.delete();
+    ));
   }
 
   computeDivergence() {
-    let temp = this.tempBuffScalar;
-    this.tempBuffScalar = this.gpuManager.simpleWaterDiv(this.velField, this.cells);
-    temp.delete();
+    this.tempBuffScalar = this.texturePool.replace(this.tempBuffScalar, this.gpuManager.simpleWaterDiv(this.velField, this.cells));
   }
 
   computePressure(numIter=PRESSURE_ITERS) {
-    this.pressureField.clear();
-    let temp = null;
-    for (let i = 0; i < numIter; i++) {
-      temp = this.pressureField;
-      this.pressureField = this.gpuManager.simpleWaterComputePressure(
-        this.pressureField, this.cells, this.tempBuffScalar
-      );
-      temp.delete();
-    }
+    this.texturePool.clear(this.pressureField);
+    this.pressureField = this.texturePool.iterate(this.pressureField, numIter,
+      pressureField => this.gpuManager.simpleWaterComputePressure(pressureField, this.cells, this.tempBuffScalar));
   }
   
   projectVelocityFromPressure() {
-    let temp = this.velField;
-    this.velField = this.gpuManager.simpleWaterProjVel(this.pressureField, this.velField, this.cells);
-    temp.delete();
+    this.velField = this.texturePool.replace(this.velField, this.gpuManager.simpleWaterProjVel(this.pressureField, this.velField, this.cells));
   }
 
   diffuseVelocity(dt, numIter=DIFFUSE_ITERS) {
-    let temp = null;
-
     const a = dt*this.viscosity*Math.pow(this.gridSize-2,3);
-    for (let i = 0; i < numIter; i++) {
-      temp = this.tempBuffVec3;
-      this.tempBuffVec3 = this.gpuManager.simpleWaterDiffuseVel(this.velField, this.tempBuffVec3, this.cells, a);
-      temp.delete();
-    }
-    this.velField.delete();
-    this.velField = this.tempBuffVec3;
+    this.tempBuffVec3 = this.texturePool.iterate(this.tempBuffVec3, numIter,
+      tempBuffVec3 => this.gpuManager.simpleWaterDiffuseVel(this.velField, tempBuffVec3, this.cells, a));
+    this.velField = this.texturePool.replace(this.velField, this.tempBuffVec3);
   }
   
   simulate(dt) {
@@ -165,20 +139,11 @@ class LiquidSim {
     this.computePressure();
     this.projectVelocityFromPressure();
     
-    let temp = this.flowFieldLRB;
-    this.flowFieldLRB = this.gpuManager.simpleWaterCalcFlowsLRB(dt, this.velField, this.cells);
-    temp.delete();
-    temp = this.flowFieldDUT;
-    this.flowFieldDUT = this.gpuManager.simpleWaterCalcFlowsDUT(dt, this.velField, this.cells);
-    temp.delete();
-    
-    temp = this.flowSumField;
-    this.flowSumField = this.gpuManager.simpleWaterSumFlows(this.flowFieldLRB, this.flowFieldDUT, this.cells);
-    temp.delete();
-
-    temp = this.cells;
-    this.cells = this.gpuManager.simpleWaterAdjustFlows(this.flowSumField, this.cells);
-    temp.delete();
+    const {texturePool} = this;
+    this.flowFieldLRB = texturePool.replace(this.flowFieldLRB, this.gpuManager.simpleWaterCalcFlowsLRB(dt, this.velField, this.cells));
+    this.flowFieldDUT = texturePool.replace(this.flowFieldDUT, this.gpuManager.simpleWaterCalcFlowsDUT(dt, this.velField, this.cells));
+    this.flowSumField = texturePool.replace(this.flowSumField, this.gpuManager.simpleWaterSumFlows(this.flowFieldLRB, this.flowFieldDUT, this.cells));
+    this.cells = texturePool.replace(this.cells, this.gpuManager.simpleWaterAdjustFlows(this.flowSumField, this.cells));
   }
 }
 
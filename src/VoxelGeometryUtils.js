@@ -3,9 +3,8 @@ import VoxelConstants from './VoxelConstants';
 
 class VoxelGeometryUtils {
 
-  static voxelBoundingBox(gridSize) {
-    const gridSizeMinus1 = gridSize-1;
-    return new THREE.Box3(new THREE.Vector3(0,0,0), new THREE.Vector3(gridSizeMinus1,gridSizeMinus1,gridSizeMinus1));
+  static voxelBoundingBox(xSize, ySize=xSize, zSize=xSize) {
+    return new THREE.Box3(new THREE.Vector3(0,0,0), new THREE.Vector3(xSize-1, ySize-1, zSize-1));
   }
 
   static singleVoxelBoundingBox(voxelPt) {
@@ -19,8 +18,8 @@ class VoxelGeometryUtils {
     );
   }
 
-  static voxelFlatIdx(voxelPt, gridSize) {
-    return voxelPt.x*gridSize*gridSize + voxelPt.y*gridSize + voxelPt.z;
+  static voxelFlatIdx(voxelPt, ySize, zSize=ySize) {
+    return (voxelPt.x*ySize + voxelPt.y)*zSize + voxelPt.z;
   }
   static closestVoxelIdxPt(pt) {
     return new THREE.Vector3(Math.floor(pt.x), Math.floor(pt.y), Math.floor(pt.z));
@@ -29,11 +28,11 @@ class VoxelGeometryUtils {
     return voxelPt.x.toFixed(0) + "_" + voxelPt.y.toFixed(0) + "_" + voxelPt.z.toFixed(0);
   }
 
-  static voxelIndexList(gridSize) {
+  static voxelIndexList(xSize, ySize=xSize, zSize=xSize) {
     const idxList = [];
-    for (let x = 0; x < gridSize; x++) {
-      for (let y = 0; y < gridSize; y++) {
-        for (let z = 0; z < gridSize; z++) {
+    for (let x = 0; x < xSize; x++) {
+      for (let y = 0; y < ySize; y++) {
+        for (let z = 0; z < zSize; z++) {
           idxList.push(new THREE.Vector3(x,y,z));
         }
       }
@@ -1,8 +1,8 @@
 import * as THREE from 'three';
-import { hashCode } from './MathUtils';
-import VoxelConstants from './VoxelConstants';
+import OctoPacker from './OctoPacker';
 
-const NUM_OCTO_DATA_PINS = 8;
+const NUM_OCTO_DATA_PINS = OctoPacker.NUM_OCTO_PINS;
+const OCTO_ROW_SIZE = OctoPacker.OCTO_ROW_SIZE; // Bytes for one bit-transposed LED index across all of the Octo pins
 
 const DISCOVERY_REQ_PACKET_HEADER = "REQ";
 const DISCOVERY_ACK_PACKET_HEADER = "ACK";
@@ -15,6 +15,29 @@ const WEBSOCKET_PROTOCOL_VIEWER = "viewer";
 const VOXEL_DATA_HEADER = "D";
 // Data type constants
 const VOXEL_DATA_ALL_TYPE   = "A";
+const VOXEL_DATA_DIRTY_TYPE = "P";
+const FRAME_SYNC_TYPE       = "S";
+const VOXEL_DATA_RAW_TYPE   = "R"; // Full frame of raw (linear) colours for slaves that apply their own colour LUT
+const VOXEL_DATA_DELTA_TYPE = "V"; // Viewer frame as the run length coded XOR against a frame the viewer acknowledged
+const SLAVE_COLOUR_LUT_TYPE = "G";
+const SLAVE_BRIGHTNESS_TYPE = "B";
+
+// Slave packet layout constants
+const SLAVE_VOXEL_DATA_ALL_HEADER_SIZE   = 4; // slaveid (1 byte), type (1 byte), frame id (2 bytes)
+const SLAVE_VOXEL_DATA_DIRTY_HEADER_SIZE = 8; // slaveid (1 byte), type (1 byte), frame id (2 bytes), base frame id (2 bytes), row count (2 bytes)
+const SLAVE_DIRTY_ROW_SIZE = 2 + OCTO_ROW_SIZE; // row index (2 bytes), row data (OCTO_ROW_SIZE bytes)
+const SLAVE_WELCOME_SIZE = 7; // slaveid (1 byte), type (1 byte), y-size (2 bytes), z-size (2 bytes), flags (1 byte)
+const SLAVE_WELCOME_FLAG_FRAME_SYNC = 0x01; // Slaves stage each frame and only show it when the frame sync line is pulsed
+const FRAME_SYNC_MASTER_SLAVE_ID = 0;       // The slave that drives the frame sync line
+const SLAVE_COLOUR_LUT_FLAG_DITHERING = 0x01;
+const SLAVE_COLOUR_LUT_SIZE = 256;
+const SLAVE_GAMMA = 2.24; // Best fit to GAMMA_MAP_RGB123, slaves get the curve at 8.8 fixed point precision for dithering
+
+// Viewer packet layout constants
+const VIEWER_KEYFRAME_HEADER_SIZE = 4; // type (1 byte), subtype (1 byte), frame id (2 bytes)
+const VIEWER_DELTA_HEADER_SIZE    = 6; // type (1 byte), subtype (1 byte), frame id (2 bytes), base frame id (2 bytes)
+const VIEWER_DELTA_MIN_SKIP = 4;       // Unchanged bytes shorter than this are sent in with the changed ones around them
+const VIEWER_BYTE_TO_COLOUR = Float32Array.from({length: 256}, (_, i) => i/255); // Colour channel for each byte of a viewer frame
 
 // Server-to-Client Headers
 const SERVER_TO_CLIENT_WELCOME_HEADER = "W";
@@ -29,6 +52,9 @@ const VOXEL_CLEAR_COMMAND_HEADER = "L";
 const AUDIO_INFO_HEADER = "A";
 const CROSSFADE_UPDATE_HEADER = "X";
 const BRIGHTNESS_UPDATE_HEADER = "B";
+// Viewer-to-Server Headers
+const VIEWER_FRAME_ACK_HEADER = "K";
+const VIEWER_KEYFRAME_REQUEST_HEADER = "Q";
 
 const PACKET_END = ";";
 
@@ -77,6 +103,7 @@ const GAMMA_MAP_RGB123 = [
   191,193,194,196,198,200,202,204,206,208,210,212,214,216,218,220,
   222,224,227,229,231,233,235,237,239,241,244,246,248,250,252,255
 ];
+const GAMMA_TABLE_RGB123 = Uint8Array.from(GAMMA_MAP_RGB123);
 
 class VoxelProtocol {
 
@@ -89,6 +116,11 @@ class VoxelProtocol {
 
   static get VOXEL_DATA_HEADER() {return VOXEL_DATA_HEADER;}
   static get VOXEL_DATA_ALL_TYPE() {return VOXEL_DATA_ALL_TYPE;}
+  static get VOXEL_DATA_DIRTY_TYPE() {return VOXEL_DATA_DIRTY_TYPE;}
+  static get FRAME_SYNC_TYPE() {return FRAME_SYNC_TYPE;}
+  static get VOXEL_DATA_RAW_TYPE() {return VOXEL_DATA_RAW_TYPE;}
+  static get VOXEL_DATA_DELTA_TYPE() {return VOXEL_DATA_DELTA_TYPE;}
+  static get FRAME_SYNC_MASTER_SLAVE_ID() {return FRAME_SYNC_MASTER_SLAVE_ID;}
 
   static get WEBSOCKET_HOST() {return WEBSOCKET_HOST;}
   static get WEBSOCKET_PORT() {return WEBSOCKET_PORT;}
@@ -104,12 +136,70 @@ class VoxelProtocol {
   static get AUDIO_INFO_HEADER() {return AUDIO_INFO_HEADER;}
   static get CROSSFADE_UPDATE_HEADER() {return CROSSFADE_UPDATE_HEADER;}
   static get BRIGHTNESS_UPDATE_HEADER() {return BRIGHTNESS_UPDATE_HEADER;}
-
-  static buildWelcomePacketForSlaves(voxelModel) {
-    const packetDataBuf = new Uint8Array(3); // slaveid (1 byte), type (1 byte), y-size (1 byte)
+  static get VIEWER_FRAME_ACK_HEADER() {return VIEWER_FRAME_ACK_HEADER;}
+  static get VIEWER_KEYFRAME_REQUEST_HEADER() {return VIEWER_KEYFRAME_REQUEST_HEADER;}
+
+  /**
+   * Build the packet that tells the slaves the size of their module of the grid: each slave drives
+   * NUM_OCTO_DATA_PINS x-slices (one per strip) of ySize*zSize LEDs.
+   * @param {VoxelModel} voxelModel - The model whose y and z sizes the slaves display.
+   * @param {Boolean} frameSyncEnabled - Whether the slaves only show frames when the frame sync line is pulsed.
+   * @returns {Buffer} The packet for the slaves.
+   */
+  static buildWelcomePacketForSlaves(voxelModel, frameSyncEnabled=false) {
+    const packetDataBuf = Buffer.alloc(SLAVE_WELCOME_SIZE);
     packetDataBuf[0] = 0;
     packetDataBuf[1] = SERVER_TO_CLIENT_WELCOME_HEADER.charCodeAt(0);
-    packetDataBuf[2] = voxelModel.ySize();
+    packetDataBuf.writeUInt16BE(voxelModel.ySize(), 2);
+    packetDataBuf.writeUInt16BE(voxelModel.zSize(), 4);
+    packetDataBuf[6] = frameSyncEnabled ? SLAVE_WELCOME_FLAG_FRAME_SYNC : 0;
+    return packetDataBuf;
+  }
+
+  /**
+   * Build the packet that uploads a colour LUT to a slave, for slaves that are sent raw colours.
+   * @param {Number} slaveId - The slave to send the packet to.
+   * @param {Number[]} colourCorrection - Multiplier for each of r, g and b (e.g., for white balance).
+   * @param {Boolean} dithering - Whether the slave should use temporal dithering to show the fractional part of each colour.
+   * @returns {Buffer} The packet for the slave.
+   */
+  static buildColourLUTPacketForSlaves(slaveId, colourCorrection=[1,1,1], dithering=true) {
+    // slaveid (1 byte), type (1 byte), flags (1 byte), curve for each of r, g and b (SLAVE_COLOUR_LUT_SIZE 8.8 fixed point values, 2 bytes each)
+    const packetDataBuf = Buffer.alloc(3 + 3*SLAVE_COLOUR_LUT_SIZE*2);
+    packetDataBuf[0] = slaveId;
+    packetDataBuf[1] = SLAVE_COLOUR_LUT_TYPE.charCodeAt(0);
+    packetDataBuf[2] = dithering ? SLAVE_COLOUR_LUT_FLAG_DITHERING : 0;
+    let byteCount = 3;
+    for (let c = 0; c < 3; c++) {
+      for (let i = 0; i < SLAVE_COLOUR_LUT_SIZE; i++) {
+        const value = Math.round(colourCorrection[c] * Math.pow(i/(SLAVE_COLOUR_LUT_SIZE-1), SLAVE_GAMMA) * 255 * 256);
+        packetDataBuf.writeUInt16BE(Math.min(0xFFFF, Math.max(0, value)), byteCount);
+        byteCount += 2;
+      }
+    }
+    return packetDataBuf;
+  }
+
+  static buildBrightnessPacketForSlaves(slaveId, brightness) {
+    const packetDataBuf = Buffer.alloc(4); // slaveid (1 byte), type (1 byte), brightness in [0,1] as [0,0xFFFF] (2 bytes)
+    packetDataBuf[0] = slaveId;
+    packetDataBuf[1] = SLAVE_BRIGHTNESS_TYPE.charCodeAt(0);
+    packetDataBuf.writeUInt16BE(Math.round(Math.min(1, Math.max(0, brightness)) * 0xFFFF), 2);
+    return packetDataBuf;
+  }
+
+  /**
+   * Build the packet that tells the frame sync master slave to pulse the frame sync line, which has every
+   * slave show the frame that it has staged.
+   * @param {Number} frameId - The ID of the frame that every slave has acknowledged.
+   * @returns {Buffer} The packet for the frame sync master slave.
+   */
+  static buildFrameSyncPacketForSlaves(frameId) {
+    const packetDataBuf = new Uint8Array(4); // slaveid (1 byte), type (1 byte), frame id (2 bytes)
+    packetDataBuf[0] = FRAME_SYNC_MASTER_SLAVE_ID;
+    packetDataBuf[1] = FRAME_SYNC_TYPE.charCodeAt(0);
+    packetDataBuf[2] = (frameId % 65536) >> 8;
+    packetDataBuf[3] = frameId % 256;
     return Buffer.from(packetDataBuf);
   }
 
@@ -118,22 +208,13 @@ class VoxelProtocol {
       currentAnimatorType: voxelModel.currentAnimator ? voxelModel.currentAnimator.getType() : null,
       currentAnimatorConfig: voxelModel.currentAnimator ? voxelModel.currentAnimator.config : null,
       globalBrightness: voxelModel.globalBrightnessMultiplier,
+      gridSize: [voxelModel.xSize(), voxelModel.ySize(), voxelModel.zSize()],
+      serverAudio: voxelModel.audioInput !== null,
     };
-    const gridSizeCharCode = String.fromCharCode(voxelModel.gridSize);
-    if (gridSizeCharCode.length !== 1) {
-      console.log("ERROR: Grid size is too large!");
-    } 
-
-    return SERVER_TO_CLIENT_WELCOME_HEADER + String.fromCharCode(voxelModel.gridSize).charAt(0) + JSON.stringify(welcomeDataObj) + ";";
+    return SERVER_TO_CLIENT_WELCOME_HEADER + JSON.stringify(welcomeDataObj) + PACKET_END;
   }
   static getDataObjFromWelcomePacketStr(packetStr) {
-    const gridSize = packetStr.charCodeAt(SERVER_TO_CLIENT_WELCOME_HEADER.length);
-    const welcomeDataObj = JSON.parse(packetStr.substring(SERVER_TO_CLIENT_WELCOME_HEADER.length+1, packetStr.length-1));
-    if (!welcomeDataObj) {
-      return null;
-    }
-    welcomeDataObj['gridSize'] = gridSize;
-    return welcomeDataObj;
+    return JSON.parse(packetStr.substring(SERVER_TO_CLIENT_WELCOME_HEADER.length, packetStr.length-PACKET_END.length));
   }
 
   static buildClientPacketStr(packetType, voxelAnimType, config) {
@@ -164,6 +245,18 @@ class VoxelProtocol {
       },
     });
   }
+  static buildViewerFrameAckPacketStr(frameId) {
+    return JSON.stringify({
+      packetType: VIEWER_FRAME_ACK_HEADER,
+      frameId: frameId,
+    });
+  }
+  static buildViewerKeyframeRequestPacketStr() {
+    return JSON.stringify({
+      packetType: VIEWER_KEYFRAME_REQUEST_HEADER,
+    });
+  }
+
   static readClientPacketStr(packetStr, voxelModel, socket) {
     const dataObj = JSON.parse(packetStr);
     if (!dataObj || !dataObj.packetType) {
@@ -211,7 +304,8 @@ class VoxelProtocol {
         break;
 
       case AUDIO_INFO_HEADER:
-        if (voxelModel.currentAnimator && voxelModel.currentAnimator.setAudioInfo) {
+        // The server's own audio input takes the place of the controllers'
+        if (!voxelModel.audioInput && voxelModel.currentAnimator && voxelModel.currentAnimator.setAudioInfo) {
           voxelModel.currentAnimator.setAudioInfo(dataObj.audioInfo);
         }
         break;
@@ -232,66 +326,13 @@ class VoxelProtocol {
   }
 
   
-  static stuffVoxelDataAll(startIdx, packetBuf, data, brightnessMultiplier, slaveId = null) {
-    let byteCount = startIdx;
-
-    if (slaveId !== null) {
-      // For Teensy OctoWS2812 clients...
-      const VOXEL_MODULE_X_SIZE = VoxelConstants.VOXEL_GRID_SIZE;
-      const VOXEL_MODULE_Y_SIZE = VoxelConstants.VOXEL_GRID_SIZE;
-      const VOXEL_MODULE_Z_SIZE = VoxelConstants.VOXEL_GRID_SIZE;
-      const startX = slaveId * VOXEL_MODULE_X_SIZE;
-      const endX = startX + NUM_OCTO_DATA_PINS;
-      const octoVoxels = new Array(NUM_OCTO_DATA_PINS).fill(0);
-
-      // Go through z-coords first
-      for (let z = 0; z < VOXEL_MODULE_Z_SIZE; z++) {
-        // ... then y-coords
-        for (let y = 0; y < VOXEL_MODULE_Y_SIZE; y++) {
-
-          // We interleave the voxel data by fetching 8 voxels from the cube, each one is from an individual board and corresponds
-          // to a different pin on the Teensy's Octo
-          let octoVoxIdx = 0;
-          for (let x = startX; x < endX; x++) { // Always NUM_OCTO_DATA_PINS iterations!
-            const voxelColour = data[x][y][z];
-            const r = GAMMA_MAP_RGB123[parseInt(brightnessMultiplier*voxelColour[0]*255)];
-            const g = GAMMA_MAP_RGB123[parseInt(brightnessMultiplier*voxelColour[1]*255)];
-            const b = GAMMA_MAP_RGB123[parseInt(brightnessMultiplier*voxelColour[2]*255)];
-            // Store as a hex/int colour as one of the NUM_OCTO_DATA_PINS colour values
-            octoVoxels[octoVoxIdx++] = (0xFF0000 & (r << 16)) | (0x00FF00 & (g << 8)) | (0x0000FF & b);
-          }
-
-          // Now convert the 8 voxel colour integers to 24 bytes and store it in the packetBuf
-          for (let mask = 0x800000; mask != 0; mask >>= 1) {
-            let b = 0;
-            for (let i = 0; i < 8; i++) {
-              if ((octoVoxels[i] & mask) != 0) {
-                b |= (1 << i);
-              }
-            }
-            packetBuf[byteCount++] = b;
-          }
-        }
-      }
+  // For websocket clients, slave frames are packed by OctoPacker (see buildVoxelDataPacketsForSlaves)
+  static stuffVoxelDataAll(startIdx, packetBuf, data, brightnessMultiplier) {
+    // The flat voxel data is already in the order the clients expect, the typed array truncates each value to a byte
+    const scale = brightnessMultiplier*255;
+    for (let i = 0; i < data.length; i++) {
+      packetBuf[startIdx+i] = data[i]*scale;
     }
-    else {
-      const xLen = data.length;
-      for (let x = 0; x < xLen; x++) {
-        const yLen = data[x].length;
-        for (let y = 0; y < yLen; y++) {
-          const zLen = data[x][y].length;
-          for (let z = 0; z < zLen; z++) {
-            const voxelColour = data[x][y][z];
-
-            packetBuf[byteCount]   = parseInt(brightnessMultiplier*voxelColour[0]*255);
-            packetBuf[byteCount+1] = parseInt(brightnessMultiplier*voxelColour[1]*255);
-            packetBuf[byteCount+2] = parseInt(brightnessMultiplier*voxelColour[2]*255);
-            byteCount += 3;
-          }
-        }
-      }
-    }
-    
   }
 
   // For websocket clients
@@ -309,7 +350,7 @@ class VoxelProtocol {
 
     switch (type) {
       case VOXEL_DATA_ALL_TYPE:
-        packetDataBuf = new Uint8Array(5 + data.length*data[0].length*data[0][0].length*3); // type (1 byte), subtype (1 byte), frame id (2 bytes), end delimiter (1 byte), and data (3*O(n^3) bytes)
+        packetDataBuf = new Uint8Array(5 + data.length); // type (1 byte), subtype (1 byte), frame id (2 bytes), end delimiter (1 byte), and data (3*O(n^3) bytes)
         this.stuffVoxelDataAll(4, packetDataBuf, data, brightnessMultiplier);
         break;
 
@@ -332,7 +373,13 @@ class VoxelProtocol {
     return Buffer.from(packetDataBuf);
   }
 
-  static buildVoxelDataPacketForSlaves(voxelData, slaveId = 0) {
+  /**
+   * Build the full voxel data packet for every slave at once.
+   * @param {Object} voxelData - The voxel data object (type, data, gridSize, brightnessMultiplier, frameId).
+   * @param {Boolean} rawColours - Send raw colours (VOXEL_DATA_RAW_TYPE) to slaves that apply their own colour LUT, brightness is ignored.
+   * @returns {Buffer[]} The packet for each slave, indexed by slave ID (they share one underlying buffer), or null if the data is invalid.
+   */
+  static buildVoxelDataPacketsForSlaves(voxelData, rawColours=false) {
     if (voxelData === null) {
       return null;
     }
@@ -341,30 +388,92 @@ class VoxelProtocol {
       console.log("Invalid voxel data object found!");
       return null;
     }
+    if (type !== VOXEL_DATA_ALL_TYPE) {
+      console.error("Invalid packet data type, could not construct.");
+      return null;
+    }
 
-    let packetDataBuf = null;
+    const [xSize, ySize, zSize] = voxelData.gridSize;
 
-    switch (type) {
-      case VOXEL_DATA_ALL_TYPE:
-        packetDataBuf = new Uint8Array(4 + NUM_OCTO_DATA_PINS * data[0].length * data[0][0].length * 3); // slaveid (1 byte), type (1 byte), frame id (2 bytes), data (NUM_OCTO_DATA_PINS*size*size*3 bytes)
-        this.stuffVoxelDataAll(4, packetDataBuf, data, brightnessMultiplier, slaveId);
-        break;
+    // Each packet is the slaveid (1 byte), type (1 byte), frame id (2 bytes) and data (NUM_OCTO_DATA_PINS*ySize*zSize*3 bytes)
+    const numSlaves = OctoPacker.numSlaves(xSize);
+    const packetSize = SLAVE_VOXEL_DATA_ALL_HEADER_SIZE + OctoPacker.slaveFrameSize(ySize, zSize);
+    const packetsBuf = Buffer.alloc(numSlaves*packetSize);
+    if (rawColours) {
+      OctoPacker.packSlaveRawFrames(data, xSize, ySize, zSize, packetsBuf, SLAVE_VOXEL_DATA_ALL_HEADER_SIZE);
+    }
+    else {
+      OctoPacker.packSlaveFrames(data, xSize, ySize, zSize, brightnessMultiplier, GAMMA_TABLE_RGB123, packetsBuf, SLAVE_VOXEL_DATA_ALL_HEADER_SIZE);
+    }
 
-      default:
-        console.error("Invalid packet data type, could not construct.");
-        return null;
+    const frameId0 = (voxelData.frameId % 65536) >> 8;
+    const frameId1 = (voxelData.frameId % 256);
+    const packetBufs = [];
+    for (let slaveId = 0; slaveId < numSlaves; slaveId++) {
+      const packetBuf = packetsBuf.subarray(slaveId*packetSize, (slaveId+1)*packetSize);
+      packetBuf[0] = slaveId;
+      packetBuf[1] = (rawColours ? VOXEL_DATA_RAW_TYPE : type).charCodeAt(0);
+      packetBuf[2] = frameId0;
+      packetBuf[3] = frameId1;
+      packetBufs.push(packetBuf);
     }
+    return packetBufs;
+  }
 
-    let frameId0 = (voxelData.frameId % 65536) >> 8;
-    let frameId1 = (voxelData.frameId % 256);
+  static buildVoxelDataPacketForSlaves(voxelData, slaveId = 0) {
+    const packetBufs = this.buildVoxelDataPacketsForSlaves(voxelData);
+    return packetBufs && slaveId < packetBufs.length ? packetBufs[slaveId] : null;
+  }
 
-    packetDataBuf[0] = slaveId;
-    packetDataBuf[1] = type.charCodeAt(0);
-    packetDataBuf[2] = frameId0;
-    packetDataBuf[3] = frameId1;
-    //packetDataBuf[packetDataBuf.length-1] = '\n'.charCodeAt(0);
+  /**
+   * Build a packet that only contains the octo-interleaved rows (i.e., the 24 bytes for each (z,y) pair)
+   * that changed between two full voxel data packets for the same slave.
+   * @param {Buffer} fullPacketBuf - The full (VOXEL_DATA_ALL_TYPE) slave packet for the current frame.
+   * @param {Buffer} prevFullPacketBuf - The full slave packet that was last sent to the same slave, the slave
+   * will only apply the resulting packet if that was also the last frame it applied.
+   * @returns {Buffer} The dirty row packet, or null if it wouldn't be any smaller than the full packet.
+   */
+  static buildDirtyVoxelDataPacketForSlaves(fullPacketBuf, prevFullPacketBuf) {
+    if (!fullPacketBuf || !prevFullPacketBuf || fullPacketBuf.length !== prevFullPacketBuf.length) {
+      return null;
+    }
 
-    return Buffer.from(packetDataBuf);
+    const numRows = (fullPacketBuf.length - SLAVE_VOXEL_DATA_ALL_HEADER_SIZE) / OCTO_ROW_SIZE;
+    const dirtyRows = [];
+    for (let row = 0; row < numRows; row++) {
+      const rowStartIdx = SLAVE_VOXEL_DATA_ALL_HEADER_SIZE + row*OCTO_ROW_SIZE;
+      for (let i = rowStartIdx; i < rowStartIdx+OCTO_ROW_SIZE; i++) {
+        if (fullPacketBuf[i] !== prevFullPacketBuf[i]) {
+          dirtyRows.push(row);
+          break;
+        }
+      }
+    }
+
+    const packetSize = SLAVE_VOXEL_DATA_DIRTY_HEADER_SIZE + dirtyRows.length*SLAVE_DIRTY_ROW_SIZE;
+    if (packetSize >= fullPacketBuf.length) {
+      return null;
+    }
+
+    const packetDataBuf = Buffer.alloc(packetSize);
+    packetDataBuf[0] = fullPacketBuf[0];                        // slaveid
+    packetDataBuf[1] = VOXEL_DATA_DIRTY_TYPE.charCodeAt(0);     // type
+    packetDataBuf[2] = fullPacketBuf[2];                        // frame id
+    packetDataBuf[3] = fullPacketBuf[3];
+    packetDataBuf[4] = prevFullPacketBuf[2];                    // base frame id, the frame these rows are patched onto
+    packetDataBuf[5] = prevFullPacketBuf[3];
+    packetDataBuf.writeUInt16BE(dirtyRows.length, 6);           // row count
+
+    let byteCount = SLAVE_VOXEL_DATA_DIRTY_HEADER_SIZE;
+    for (let i = 0; i < dirtyRows.length; i++) {
+      const row = dirtyRows[i];
+      const rowStartIdx = SLAVE_VOXEL_DATA_ALL_HEADER_SIZE + row*OCTO_ROW_SIZE;
+      packetDataBuf.writeUInt16BE(row, byteCount);
+      fullPacketBuf.copy(packetDataBuf, byteCount+2, rowStartIdx, rowStartIdx+OCTO_ROW_SIZE);
+      byteCount += SLAVE_DIRTY_ROW_SIZE;
+    }
+
+    return packetDataBuf;
   }
 
   static readPacketType(packetData) {
@@ -386,35 +495,146 @@ class VoxelProtocol {
     return (parseInt(packetData[2]) << 8) + parseInt(packetData[3]);
   }
 
-  static readAndPaintVoxelDataAll(packetDataBuf, voxelDisplay, lastFrameHashCode) {
-    
-    const displayXSize = voxelDisplay.xSize();
-    const displayYSize = voxelDisplay.ySize();
-    const displayZSize = voxelDisplay.zSize();
+  static readBaseFrameId(packetData) {
+    return (packetData[4] << 8) + packetData[5];
+  }
 
-    let currIdx = VOXEL_DATA_HEADER.length + VOXEL_DATA_ALL_TYPE.length + 2; // skip over the: type (1 byte), subtype (1 byte), frame Id (2 bytes)
+  /**
+   * Build the 8-bit colours of a frame for the viewer, laid out like the voxel data.
+   */
+  static buildViewerFrameBytes(voxelData) {
+    const {data, brightnessMultiplier} = voxelData;
+    const frameBytes = new Uint8Array(data.length);
+    this.stuffVoxelDataAll(0, frameBytes, data, brightnessMultiplier);
+    return frameBytes;
+  }
+
+  /**
+   * Lookup of the colour channel (in [0,1]) for each byte value of a frame from buildViewerFrameBytes.
+   */
+  static get VIEWER_BYTE_TO_COLOUR() {return VIEWER_BYTE_TO_COLOUR;}
 
-    if (packetDataBuf.length < currIdx + 3*displayXSize*displayYSize*displayZSize) {
-      console.log("Voxel data was invalid (package was not long enough).");
-      return -1;
+  static _writeViewerHeader(packetBuf, type, frameId) {
+    packetBuf[0] = VOXEL_DATA_HEADER.charCodeAt(0);
+    packetBuf[1] = type.charCodeAt(0);
+    packetBuf[2] = (frameId % 65536) >> 8;
+    packetBuf[3] = frameId % 256;
+  }
+
+  /**
+   * Build a viewer keyframe, the whole frame (laid out like buildVoxelDataPacket's).
+   * @param {Uint8Array} frameBytes - See buildViewerFrameBytes.
+   */
+  static buildViewerKeyframePacket(frameBytes, frameId) {
+    const packetBuf = Buffer.alloc(VIEWER_KEYFRAME_HEADER_SIZE + frameBytes.length + 1);
+    this._writeViewerHeader(packetBuf, VOXEL_DATA_ALL_TYPE, frameId);
+    packetBuf.set(frameBytes, VIEWER_KEYFRAME_HEADER_SIZE);
+    packetBuf[packetBuf.length-1] = PACKET_END.charCodeAt(0);
+    return packetBuf;
+  }
+
+  /**
+   * Build a viewer delta packet: the XOR of the frame against a base frame that the viewer has, as runs of
+   * (unchanged byte count, changed byte count, the changed bytes XORed with the base's) with varint counts.
+   * @param {Uint8Array} frameBytes - See buildViewerFrameBytes.
+   * @param {Uint8Array} baseFrameBytes - The base frame's bytes.
+   * @returns {Buffer} The delta packet, or null if it wouldn't be smaller than a keyframe.
+   */
+  static buildViewerDeltaPacket(frameBytes, baseFrameBytes, frameId, baseFrameId) {
+    const length = frameBytes.length;
+    if (!baseFrameBytes || baseFrameBytes.length !== length) {
+      return null;
     }
 
-    let currFrameHashCode = hashCode(packetDataBuf.slice(currIdx));
-    if (lastFrameHashCode !== currFrameHashCode) {
-      for (let x = 0; x < displayXSize; x++) {
-        for (let y = 0; y < displayYSize; y++) {
-          for (let z = 0; z < displayZSize; z++) {
-            const r = packetDataBuf[currIdx]/255;
-            const g = packetDataBuf[currIdx+1]/255;
-            const b = packetDataBuf[currIdx+2]/255;
-            voxelDisplay.setVoxelXYZRGB(x, y, z, r, g, b);
-            currIdx += 3;
-          }
-        }
+    const maxPacketSize = VIEWER_KEYFRAME_HEADER_SIZE + length + 1;
+    const packetBuf = Buffer.allocUnsafe(maxPacketSize);
+    const writeVarint = (value, idx) => {
+      while (value >= 0x80) {
+        packetBuf[idx++] = (value & 0x7f) | 0x80;
+        value >>>= 7;
+      }
+      packetBuf[idx++] = value;
+      return idx;
+    };
+
+    let byteCount = VIEWER_DELTA_HEADER_SIZE;
+    let runStart = 0;
+    let i = 0;
+    while (i < length) {
+      // Skip over the unchanged bytes...
+      while (i < length && frameBytes[i] === baseFrameBytes[i]) { i++; }
+      if (i === length) { break; }
+
+      // ...then take the changed ones, up to the next unchanged run that's long enough to be worth skipping
+      const changedStart = i;
+      let lastChanged = i;
+      for (i++; i < length && i - lastChanged <= VIEWER_DELTA_MIN_SKIP; i++) {
+        if (frameBytes[i] !== baseFrameBytes[i]) { lastChanged = i; }
       }
+      const changedEnd = lastChanged + 1;
+      // Worst case of the run's header is two 3-byte varints (the frame is well under 2^21 bytes)
+      if (byteCount + 6 + (changedEnd - changedStart) >= maxPacketSize - 1) {
+        return null;
+      }
+
+      byteCount = writeVarint(changedStart - runStart, byteCount);
+      byteCount = writeVarint(changedEnd - changedStart, byteCount);
+      for (let j = changedStart; j < changedEnd; j++) {
+        packetBuf[byteCount++] = frameBytes[j] ^ baseFrameBytes[j];
+      }
+      runStart = i = changedEnd;
+    }
+
+    this._writeViewerHeader(packetBuf, VOXEL_DATA_DELTA_TYPE, frameId);
+    packetBuf[4] = (baseFrameId % 65536) >> 8;
+    packetBuf[5] = baseFrameId % 256;
+    packetBuf[byteCount++] = PACKET_END.charCodeAt(0);
+    return packetBuf.subarray(0, byteCount);
+  }
+
+  /**
+   * Read the frame bytes out of a viewer keyframe (or any full voxel data packet for websocket clients).
+   * @returns {Uint8Array} The frame bytes, or null if the packet is too short for the given size of frame.
+   */
+  static readViewerKeyframe(packetDataBuf, frameLength) {
+    if (packetDataBuf.length < VIEWER_KEYFRAME_HEADER_SIZE + frameLength) {
+      return null;
     }
+    return packetDataBuf.slice(VIEWER_KEYFRAME_HEADER_SIZE, VIEWER_KEYFRAME_HEADER_SIZE + frameLength);
+  }
 
-    return currFrameHashCode;
+  /**
+   * Rebuild a frame from a viewer delta packet and its base frame (see buildViewerDeltaPacket).
+   * @returns {Uint8Array} The frame bytes, or null if the packet is invalid.
+   */
+  static readViewerDelta(packetDataBuf, baseFrameBytes) {
+    const frameBytes = baseFrameBytes.slice();
+    const end = packetDataBuf.length - PACKET_END.length;
+    let idx = VIEWER_DELTA_HEADER_SIZE;
+    const readVarint = () => {
+      let value = 0;
+      let shift = 0;
+      let byte = 0;
+      do {
+        byte = packetDataBuf[idx++];
+        value |= (byte & 0x7f) << shift;
+        shift += 7;
+      } while ((byte & 0x80) && idx < end);
+      return value;
+    };
+
+    let frameIdx = 0;
+    while (idx < end) {
+      frameIdx += readVarint();
+      const count = readVarint();
+      if (frameIdx + count > frameBytes.length || idx + count > end) {
+        return null;
+      }
+      for (let i = 0; i < count; i++) {
+        frameBytes[frameIdx++] ^= packetDataBuf[idx++];
+      }
+    }
+    return frameBytes;
   }
 };
 
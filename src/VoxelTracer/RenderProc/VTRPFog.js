@@ -19,20 +19,20 @@ class VTRPFog extends VTObject {
     this._temp2Vec3 = new THREE.Vector3();
   }
 
-  static build(jsonVTFog) {
-    const {id, _colour, _boundingBox, _scattering} = jsonVTFog;
-
-    const colour = (new THREE.Color()).setHex(_colour);
-    const {min, max} = _boundingBox;
-    const minPt = new THREE.Vector3(min.x, min.y, min.z);
-    const maxPt = new THREE.Vector3(max.x, max.y, max.z);
-    const result = new VTRPFog(new THREE.Box3(minPt, maxPt), {fogColour: colour, scattering: _scattering});
-    result.id = id;
-    return result;
+  static deserialize(reader) {
+    const minPt = reader.readVec3();
+    const maxPt = reader.readVec3();
+    const colour = reader.readColour();
+    const scattering = reader.readFloat64();
+    return new VTRPFog(new THREE.Box3(minPt, maxPt), {fogColour: colour, scattering: scattering});
   }
 
   dispose() {}
 
+  get boundingBox() { return this._boundingBox; }
+  get colour() { return this._colour; }
+  get scattering() { return this._scattering; }
+
   isShadowCaster() { return false; }
 
   position(target) { 
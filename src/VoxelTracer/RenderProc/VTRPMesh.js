@@ -50,27 +50,45 @@ class VTRPMesh extends VTObject {
     this.voxelIdxToTriSamples = {};
   }
 
-  static build(jsonVTMesh) {
-    const {id, threeMesh, material} = jsonVTMesh;
+  // Build the geometry (and its BVH) from its resource upload (see VTSceneDeltaWriter.writeGeometry), it's shared by
+  // every mesh that uses it and lives until the scene is cleared
+  static buildGeometry(resource) {
+    const {attributes, index} = resource;
+    const geometry = new THREE.BufferGeometry();
+    Object.entries(attributes).forEach(entry => {
+      const [name, {array, itemSize, normalized}] = entry;
+      geometry.setAttribute(name, new THREE.BufferAttribute(array, itemSize, normalized));
+    });
+    if (index) {
+      geometry.setIndex(new THREE.BufferAttribute(index, 1));
+    }
+    geometry.computeBoundingBox();
+    geometry.boundsTree = new MeshBVH(geometry, {strategy: SAH});
+    return geometry;
+  }
+  static disposeGeometry(geometry) {
+    geometry.disposeBoundsTree();
+    geometry.dispose();
+  }
+
+  static deserialize(reader, resources) {
+    const geometry = reader.readResource(resources);
+    const matrixWorld = reader.readMatrix4();
+    const result = new VTRPMesh(VTMaterialFactory.deserialize(reader, resources));
+
+    const threeMesh = new THREE.Mesh(geometry);
+    threeMesh.matrixAutoUpdate = false;
+    threeMesh.matrix.copy(matrixWorld);
+    threeMesh.updateMatrixWorld(true);
+
+    result.geometry = geometry;
+    result.threeMesh = threeMesh;
 
-    const result = new VTRPMesh(VTMaterialFactory.build(material));
-    result.id = id;
-    
-    const loader = new THREE.ObjectLoader();
-    const loadedMesh = loader.parse(threeMesh);
-    loadedMesh.geometry.computeBoundingBox();
-    loadedMesh.geometry.boundsTree = new MeshBVH(loadedMesh.geometry, {strategy: SAH});
-    loadedMesh.updateMatrixWorld();
-    
-    result.geometry = loadedMesh.geometry;
-    result.threeMesh = loadedMesh;
-    
     return result;
   }
 
   dispose() {
-    this.geometry.disposeBoundsTree();
-    this.geometry.dispose();
+    // N.B., The geometry is a resource of the scene, it isn't ours to dispose of
     this.material.dispose();
   }
 
@@ -196,7 +214,7 @@ class VTRPMesh extends VTObject {
   }
 
   calculateVoxelColour(voxelIdxPt, scene) {
-    const voxelId = VoxelGeometryUtils.voxelFlatIdx(voxelIdxPt, scene.gridSize);
+    const voxelId = VoxelGeometryUtils.voxelFlatIdx(voxelIdxPt, scene.gridSize[1], scene.gridSize[2]);
     let finalColour = new THREE.Color(0,0,0);
 
     // Fast-out if we can't even see this mesh
@@ -219,8 +237,12 @@ class VTRPMesh extends VTObject {
     return raycaster.intersectObjects([this.threeMesh]).length > 0;
   }
 
+  getWorldBoundingBox(target) {
+    return target.copy(this.geometry.boundingBox).applyMatrix4(this.threeMesh.matrixWorld);
+  }
+
   getCollidingVoxels(voxelGridBoundingBox) {
-    const worldSpaceBB = this.geometry.boundingBox.clone().applyMatrix4(this.threeMesh.matrixWorld);
+    const worldSpaceBB = this.getWorldBoundingBox(new THREE.Box3());
     return VoxelGeometryUtils.voxelAABBList(worldSpaceBB.min, worldSpaceBB.max, true, voxelGridBoundingBox);
   }
 }
@@ -0,0 +1,167 @@
+import * as THREE from 'three';
+
+import {loadNativeAddon} from '../../NativeAddons';
+
+import VTObject from '../VTObject';
+import VTMaterial from '../VTMaterial';
+import {VTSceneDeltaWriter} from '../VTSceneDelta';
+
+const nativeVTCore = loadNativeAddon('vtcore');
+if (nativeVTCore) {
+  console.log("Using the native voxel tracer core.");
+}
+
+const NO_RESOURCE_ID = VTSceneDeltaWriter.NO_RESOURCE_ID;
+
+// Material types of the native core (see vtcore::MaterialType)
+const NATIVE_LAMBERT_TYPE = 0;
+const NATIVE_EMISSION_TYPE = 1;
+
+/**
+ * Mirror of a VTRPScene in the native voxel tracer core (the vtcore addon, see src/native/vtcore.h), which does the
+ * lighting and shadows of the render procs' work items in C++ when the addon is built. VTRPScene still reads the
+ * scene updates into its own objects and passes each one along here, the native scene gets the plain parameters of
+ * each object and refers to the geometry and textures that it shares by their resource IDs (see VTSceneDelta).
+ */
+class VTRPNativeScene {
+  static get isAvailable() { return nativeVTCore !== null; }
+
+  constructor(gridSize) {
+    const [xSize, ySize, zSize] = gridSize;
+    this._scene = new nativeVTCore.Scene(xSize, ySize, zSize);
+    this._resourceIds = new WeakMap(); // Resource IDs of the (JS) geometry and textures of VTRPScene
+
+    this._materialParams = new Float64Array(10);
+    this._matrixParams = new Float64Array(16);
+    this._lightParams = new Float64Array(13);
+    this._voxelParams = new Float64Array(4);
+    this._fogParams = new Float64Array(10);
+    this._tempVec3 = new THREE.Vector3();
+  }
+
+  clear() {
+    this._scene.clear();
+  }
+
+  clearResources() {
+    this._scene.clearResources();
+    this._resourceIds = new WeakMap();
+  }
+
+  /**
+   * Add a resource upload (see VTSceneDeltaWriter.writeGeometry/writeTexture) along with what VTRPScene built from it.
+   */
+  addResource(upload, resource) {
+    const {id, type} = upload;
+    switch (type) {
+      case VTObject.MESH_TYPE: {
+        const {attributes, index} = upload;
+        const attributeArray = (name) => {
+          const attribute = attributes[name];
+          if (!attribute) { return null; }
+          return (attribute.array instanceof Float32Array) ? attribute.array : Float32Array.from(attribute.array);
+        };
+        const indexArray = (index && !(index instanceof Uint16Array) && !(index instanceof Uint32Array)) ? Uint32Array.from(index) : index;
+        this._scene.addGeometry(id, attributeArray('position'), attributeArray('normal'), attributeArray('uv'), indexArray);
+        break;
+      }
+      case VTSceneDeltaWriter.TEXTURE_TYPE: {
+        const {data, shape, stride, offset} = upload;
+        const data32 = (data instanceof Float32Array) ? data : Float32Array.from(data);
+        this._scene.addTexture(id, data32, Float64Array.of(shape[0], shape[1], shape[2], stride[0], stride[1], stride[2], offset));
+        break;
+      }
+      default:
+        return;
+    }
+    this._resourceIds.set(resource, id);
+  }
+
+  setObject(obj) {
+    const {id} = obj;
+    switch (obj.type) {
+      case VTObject.AMBIENT_LIGHT_TYPE: {
+        const {r, g, b} = obj.colour;
+        this._scene.setAmbientLight(r, g, b);
+        break;
+      }
+
+      case VTObject.POINT_LIGHT_TYPE: {
+        const {position, colour, attenuation} = obj;
+        this._lightParams.set([position.x, position.y, position.z, colour.r, colour.g, colour.b, attenuation.quadratic, attenuation.linear]);
+        this._scene.setPointLight(id, this._lightParams);
+        break;
+      }
+
+      case VTObject.SPOT_LIGHT_TYPE: {
+        const {position, direction, colour, innerAngle, outerAngle, rangeAttenuation} = obj;
+        this._lightParams.set([
+          position.x, position.y, position.z, direction.x, direction.y, direction.z, colour.r, colour.g, colour.b,
+          innerAngle, outerAngle, rangeAttenuation.quadratic, rangeAttenuation.linear
+        ]);
+        this._scene.setSpotLight(id, this._lightParams);
+        break;
+      }
+
+      case VTObject.VOXEL_TYPE: {
+        const position = obj.position(this._tempVec3);
+        this._voxelParams.set([position.x, position.y, position.z, obj.receivesShadow ? 1 : 0]);
+        this._scene.setVoxel(id, this._voxelParams, this._setMaterialParams(obj.material));
+        break;
+      }
+
+      case VTObject.FOG_TYPE: {
+        const {boundingBox: {min, max}, colour, scattering} = obj;
+        this._fogParams.set([min.x, min.y, min.z, max.x, max.y, max.z, colour.r, colour.g, colour.b, scattering]);
+        this._scene.setFog(id, this._fogParams);
+        break;
+      }
+
+      case VTObject.MESH_TYPE: {
+        const geometryId = this._resourceId(obj.geometry);
+        this._matrixParams.set(obj.threeMesh.matrixWorld.elements);
+        this._scene.setMesh(id, geometryId, this._matrixParams, this._setMaterialParams(obj.material));
+        break;
+      }
+
+      default:
+        console.error(`Unknown VTObject type for the native voxel tracer: ${obj.type}`);
+        this._scene.remove(id);
+        break;
+    }
+  }
+
+  removeObject(id) {
+    this._scene.remove(id);
+  }
+
+  removeAmbientLight() {
+    this._scene.removeAmbientLight();
+  }
+
+  renderWorkItems(workItems, startItem, endItem, renderBuffer, lightingCacheValid) {
+    this._scene.renderWorkItems(workItems, startItem, endItem, renderBuffer, lightingCacheValid);
+  }
+
+  _resourceId(resource) {
+    const resourceId = resource ? this._resourceIds.get(resource) : undefined;
+    return (resourceId === undefined) ? NO_RESOURCE_ID : resourceId;
+  }
+
+  // Layout: [type, colour rgb, emissive rgb, alpha, reflect, texture resource ID]
+  _setMaterialParams(material) {
+    const params = this._materialParams;
+    const isEmission = material.type === VTMaterial.EMISSION_TYPE;
+    const {colour} = material;
+    const emissive = isEmission ? null : material.emissive;
+    params[0] = isEmission ? NATIVE_EMISSION_TYPE : NATIVE_LAMBERT_TYPE;
+    params[1] = colour.r; params[2] = colour.g; params[3] = colour.b;
+    params[4] = emissive ? emissive.r : 0; params[5] = emissive ? emissive.g : 0; params[6] = emissive ? emissive.b : 0;
+    params[7] = material.alpha;
+    params[8] = (!isEmission && material.reflect) ? 1 : 0;
+    params[9] = this._resourceId(material.texture);
+    return params;
+  }
+}
+
+export default VTRPNativeScene;
@@ -4,22 +4,36 @@ import VoxelConstants from '../../VoxelConstants';
 import {clamp} from '../../MathUtils';
 
 import VTObject from '../VTObject';
+import VTBVH from '../VTBVH';
+import VTTexture from '../VTTexture';
+import {VTSceneDeltaReader, VTSceneDeltaWriter} from '../VTSceneDelta';
 import VTAmbientLight from '../VTAmbientLight';
 import VTPointLight from '../VTPointLight';
 import VTSpotLight from '../VTSpotLight';
 
-import VTRenderProc from './VTRenderProc';
 import VTRPMesh from './VTRPMesh';
 import VTRPFog from './VTRPFog';
 import VTRPVoxel from './VTRPVoxel';
+import VTRPNativeScene from './VTRPNativeScene';
 
 
 class VTRPScene {
   constructor() {
-    this.gridSize = 0;
+    this.gridSize = [0,0,0]; // [x,y,z] sizes of the voxel grid
+    this._tempVoxelPt = new THREE.Vector3();
+    this._tempBox = new THREE.Box3();
+    this.resources = {}; // Geometry and textures uploaded by VTScene, by resource ID (see VTSceneDelta)
+    this.nativeScene = null; // Does the rendering when the native voxel tracer core is available (see VTRPNativeScene)
     this.clear();
   }
 
+  setGridSize(gridSize) {
+    this.gridSize = gridSize;
+    if (VTRPNativeScene.isAvailable) {
+      this.nativeScene = new VTRPNativeScene(gridSize);
+    }
+  }
+
   dispose() {
     Object.values(this.renderables).forEach(renderable => {
       renderable.dispose();
@@ -31,30 +45,49 @@ class VTRPScene {
     // All renderables and lights are stored by their IDs
     this.renderables = {};
     this.lights = {};
-    this.shadowCasters = {};
+    this.shadowCasters = new VTBVH(); // Shadow casters by ID, for culling the ones that can't block a shadow ray
     this.ambientLight = null;
+    if (this.nativeScene) {
+      this.nativeScene.clear();
+    }
   }
 
-  render(renderableToVoxelMapping) {
-    const result = [];
-    const currVoxelPt = new THREE.Vector3();
-    Object.entries(renderableToVoxelMapping).forEach(entry => {
-      const [id, voxelPts] = entry;
-      const renderable = this._getRenderable(id);
-      for (let i = 0; i < voxelPts.length; i++) {
-        const {x,y,z} = voxelPts[i];
-        currVoxelPt.set(x, y, z);
-        const calcColour = renderable.calculateVoxelColour(currVoxelPt, this);
-        if (calcColour.r > 0 || calcColour.g > 0 || calcColour.b > 0) {
-          result.push({
-            pt: currVoxelPt.clone(),
-            colour: calcColour
-          });
-        }
+  // Renders the work items [startItem, endItem) of the given (voxel index, renderable ID) pairs, adding the colour
+  // of each one into its voxel in the (shared) render buffer (see VTRPWorkQueue), voxels that are flagged as valid in
+  // the lighting cache still have their colours from a previous frame and are skipped (see VTLightingCache)
+  renderWorkItems(workItems, startItem, endItem, renderBuffer, lightingCacheValid) {
+    if (this.nativeScene) {
+      this.nativeScene.renderWorkItems(workItems, startItem, endItem, renderBuffer, lightingCacheValid);
+      return;
+    }
+
+    const [, ySize, zSize] = this.gridSize;
+    const yzSize = ySize*zSize;
+    const currVoxelPt = this._tempVoxelPt;
+    let i = startItem;
+    while (i < endItem) {
+      // Each voxel's work items are consecutive and it's either still lit from a previous frame or all of them get rendered
+      const voxelIdx = workItems[2*i];
+      let voxelEnd = i+1;
+      while (voxelEnd < endItem && workItems[2*voxelEnd] === voxelIdx) { voxelEnd++; }
+      if (lightingCacheValid[voxelIdx]) {
+        i = voxelEnd;
+        continue;
       }
-    });
 
-    process.send({type: VTRenderProc.FROM_PROC_RENDERED, data: result});
+      currVoxelPt.set(Math.floor(voxelIdx / yzSize), Math.floor(voxelIdx / zSize) % ySize, voxelIdx % zSize);
+      const bufferIdx = voxelIdx*3;
+      for (; i < voxelEnd; i++) {
+        const renderable = this._getRenderable(workItems[2*i+1]);
+        if (!renderable) { continue; }
+
+        const calcColour = renderable.calculateVoxelColour(currVoxelPt, this);
+        renderBuffer[bufferIdx]   += calcColour.r;
+        renderBuffer[bufferIdx+1] += calcColour.g;
+        renderBuffer[bufferIdx+2] += calcColour.b;
+      }
+      lightingCacheValid[voxelIdx] = 1;
+    }
   }
 
   _getRenderable(id) {
@@ -63,126 +96,140 @@ class VTRPScene {
     return result;
   }
 
-  update(sceneData) {
-    const {removedIds, reinit, ambientLight, renderables, lights} = sceneData;
-
+  /**
+   * Apply a scene update from VTScene: its new resources and the binary stream of scene object records (see VTSceneDelta).
+   */
+  applyUpdate(update) {
+    const {reinit, resources} = update;
     if (reinit) {
       this.dispose();
+      this._disposeResources();
     }
-    else if (removedIds) {
-      for (let i = 0; i < removedIds.length; i++) {
-        const removedId = removedIds[i];
-        delete this.renderables[removedId];
-        delete this.lights[removedId];
-        delete this.shadowCasters[removedId];
-        if (this.ambientLight.id === removedId) {
-          this.ambientLight = null;
-        }
+    this._addResources(resources);
+
+    const reader = new VTSceneDeltaReader(update);
+    while (reader.hasMore()) {
+      const type = reader.readType();
+      const id = reader.readInt32();
+      if (type === VTSceneDeltaWriter.REMOVE_TYPE) {
+        this._removeObject(id);
+        continue;
       }
-    }
-
-    if (ambientLight) {
-      this.ambientLight = VTAmbientLight.build(ambientLight);
-    }
 
-    const updatedMap = {};
-    if (renderables) {
-      for (let i = 0; i < renderables.length; i++) {
-        const renderableData = renderables[i];
-        this._updateRenderable(renderableData, updatedMap);
+      const obj = this._deserializeObject(type, reader);
+      if (!obj) {
+        // There's no way to tell where the next record starts
+        return;
       }
-    }
-    if (lights) {
-      for (let i = 0; i < lights.length; i++) {
-        const lightData = lights[i];
-        this._updateLight(lightData, updatedMap);
+      obj.id = id;
+      this._setObject(obj);
+      if (this.nativeScene) {
+        this.nativeScene.setObject(obj);
       }
     }
-
-    Object.entries(updatedMap).forEach(entry => {
-      const [id, obj] = entry;
-
-      if (id in this.renderables) {
-        this.renderables[id].dispose();
-      }
-      else if (id in this.lights) {
-        this.lights[id].dispose();
-      }
-
-      switch (obj.type) {
-
-        case VTObject.POINT_LIGHT_TYPE:
-        case VTObject.SPOT_LIGHT_TYPE:
-          this.renderables[id] = obj;
-          this.lights[id] = obj;
-          break;
-
-        default:
-          this.renderables[id] = obj;
-          if (obj.isShadowCaster()) {
-            this.shadowCasters[id] = obj;
-          }
-          break;
-      }
-    });
   }
 
-  _updateRenderable(renderableData, updatedMap) {
-    const {id, type} = renderableData;
-    if (id in updatedMap) {
-      return;
-    }
-
-    let buildFunc = null;
+  _deserializeObject(type, reader) {
     switch (type) {
       case VTObject.MESH_TYPE:
-        buildFunc = VTRPMesh.build;
-        break;
-      case VTObject.POINT_LIGHT_TYPE:
-        buildFunc = VTPointLight.build;
-        break;
-      case VTObject.SPOT_LIGHT_TYPE:
-        buildFunc = VTSpotLight.build;
-        break;
+        return VTRPMesh.deserialize(reader, this.resources);
       case VTObject.VOXEL_TYPE:
-        buildFunc = VTRPVoxel.build;
-        break;
+        return VTRPVoxel.deserialize(reader, this.resources);
       case VTObject.FOG_TYPE:
-        buildFunc = VTRPFog.build;
-        break;
+        return VTRPFog.deserialize(reader);
+      case VTObject.POINT_LIGHT_TYPE:
+        return VTPointLight.deserialize(reader);
+      case VTObject.SPOT_LIGHT_TYPE:
+        return VTSpotLight.deserialize(reader);
+      case VTObject.AMBIENT_LIGHT_TYPE:
+        return VTAmbientLight.deserialize(reader);
 
       default:
-        console.error(`Unknown VTObject renderable type found: ${type}`);
-        return;
+        console.error(`Unknown VTObject type found in scene update: ${type}`);
+        return null;
     }
-
-    updatedMap[id] = buildFunc(renderableData);
   }
 
-  _updateLight(lightData, updatedMap) {
-    const {id, type} = lightData;
-    if (id in updatedMap) {
+  _setObject(obj) {
+    const {id} = obj;
+
+    if (obj.type === VTObject.AMBIENT_LIGHT_TYPE) {
+      this.ambientLight = obj;
       return;
     }
 
-    let buildFunc = null;
-    switch (type) {
+    if (id in this.renderables) {
+      this.renderables[id].dispose();
+    }
+    else if (id in this.lights) {
+      this.lights[id].dispose();
+    }
+
+    switch (obj.type) {
 
       case VTObject.POINT_LIGHT_TYPE:
-        buildFunc = VTPointLight.build;
-        break;
       case VTObject.SPOT_LIGHT_TYPE:
-        buildFunc = VTSpotLight.build;
+        this.renderables[id] = obj;
+        this.lights[id] = obj;
         break;
-      case VTObject.AMBIENT_LIGHT_TYPE:
-        this.ambientLight = VTAmbientLight.build(lightData);
-        return;
 
       default:
-        console.error(`Unknown VTObject light type found: ${type}`);
-        return;
+        this.renderables[id] = obj;
+        if (obj.isShadowCaster()) {
+          this.shadowCasters.update(id, obj, obj.getWorldBoundingBox(this._tempBox));
+        }
+        else {
+          this.shadowCasters.remove(id);
+        }
+        break;
+    }
+  }
+
+  _removeObject(id) {
+    delete this.renderables[id];
+    delete this.lights[id];
+    this.shadowCasters.remove(id);
+    if (this.ambientLight && this.ambientLight.id === id) {
+      this.ambientLight = null;
+      if (this.nativeScene) {
+        this.nativeScene.removeAmbientLight();
+      }
+    }
+    if (this.nativeScene) {
+      this.nativeScene.removeObject(id);
+    }
+  }
+
+  _addResources(resources) {
+    for (let i = 0; i < resources.length; i++) {
+      const resource = resources[i];
+      switch (resource.type) {
+        case VTObject.MESH_TYPE:
+          this.resources[resource.id] = VTRPMesh.buildGeometry(resource);
+          break;
+        case VTSceneDeltaWriter.TEXTURE_TYPE:
+          this.resources[resource.id] = VTTexture.fromResource(resource);
+          break;
+        default:
+          console.error(`Unknown resource type found in scene update: ${resource.type}`);
+          break;
+      }
+      if (this.nativeScene && this.resources[resource.id]) {
+        this.nativeScene.addResource(resource, this.resources[resource.id]);
+      }
+    }
+  }
+
+  _disposeResources() {
+    Object.values(this.resources).forEach(resource => {
+      if (resource instanceof THREE.BufferGeometry) {
+        VTRPMesh.disposeGeometry(resource);
+      }
+    });
+    this.resources = {};
+    if (this.nativeScene) {
+      this.nativeScene.clearResources();
     }
-    updatedMap[id] = buildFunc(lightData);
   }
 
   // Calculates the accumulated effect of shadow casters between the current voxel (point) and a light
@@ -190,17 +237,19 @@ class VTRPScene {
   _calculateShadowCasterLightMultiplier(point, nToLightVec, distanceToLight) {
     let lightMultiplier = 1.0;
     
-    // Check to see if the voxel is in shadow
+    // Check to see if the voxel is in shadow, only the shadow casters whose bounds the ray passes through can block it
     // NOTE: We currently only use point lights so there's only umbra shadow (no soft shadows/sampling)
-    const shadowCasters = Object.values(this.shadowCasters);
+    if (this.shadowCasters.root === null) {
+      return lightMultiplier;
+    }
     const raycaster = new THREE.Raycaster(point, nToLightVec, VoxelConstants.VOXEL_EPSILON, distanceToLight);
-    for (let k = 0; k < shadowCasters.length && lightMultiplier > 0; k++) {
-      const shadowCaster = shadowCasters[k];
+    this.shadowCasters.queryRay(raycaster.ray, raycaster.near, raycaster.far, shadowCaster => {
       const shadowCasterResult = shadowCaster.calculateShadow(raycaster);
       if (shadowCasterResult.inShadow) {
         lightMultiplier -= shadowCasterResult.lightReduction;
       }
-    }
+      return lightMultiplier <= 0;
+    });
 
     return lightMultiplier;
   }
@@ -8,17 +8,18 @@ class VTRPVoxel extends VTVoxelAbstract  {
     super(voxelIdxPt, material, options);
   }
 
-  static build(jsonVTVoxel) {
-    const {id, _voxelIdxPt, _material, matrixArray, _receivesShadow} = jsonVTVoxel;
-    const result = new VTRPVoxel(
-      new THREE.Vector3(_voxelIdxPt.x, _voxelIdxPt.y, _voxelIdxPt.z), 
-      VTMaterialFactory.build(_material), 
-      {receivesShadow: _receivesShadow, matrixWorld: (new THREE.Matrix4()).fromArray(matrixArray)}
-    );
-    result.id = id;
-    return result;
+  static deserialize(reader, resources) {
+    const voxelIdxPt = reader.readVec3();
+    const matrixWorld = reader.readMatrix4();
+    const receivesShadow = reader.readBool();
+    const material = VTMaterialFactory.deserialize(reader, resources);
+    return new VTRPVoxel(voxelIdxPt, material, {receivesShadow, matrixWorld});
   }
 
+  get material() { return this._material; }
+  get receivesShadow() { return this._receivesShadow; }
+  position(target) { return this._getWorldSpacePosition(target); }
+
   calculateShadow(raycaster) {
     return {
       inShadow: this.intersectsRay(raycaster),
@@ -0,0 +1,180 @@
+const TILES_PER_WORKER = 32;    // Tiles each worker starts a frame with, more means finer grained stealing
+const MIN_ITEMS_PER_TILE = 16;  // ...but don't bother splitting the work up any smaller than this
+const MAX_TILES = 0xFFFF;       // Each worker's queue is a packed pair of 16-bit tile indices (see _packQueue)
+const NO_TILE = -1;
+
+// Per worker stats (in a Float64Array, each worker only writes its own)
+const STAT_BUSY_MS      = 0;
+const STAT_TILES        = 1;
+const STAT_STOLEN_TILES = 2;
+const NUM_STATS         = 3;
+
+/**
+ * Work-stealing queue of the voxels that the render procs have to render each frame, all of it lives in shared
+ * memory. VTScene fills it in with every (voxel index, renderable ID) work item in the scene, sorted by voxel and cut
+ * up into small tiles that never split a voxel (so only one worker ever writes to any voxel in the render buffer).
+ * Each worker starts the frame with its own contiguous run of tiles, takes them from the front and, once it runs dry,
+ * steals from the back of whichever worker has the most left. Lopsided scenes (e.g., a single spotlight in a corner
+ * of the grid) keep every core busy instead of leaving the one that owns that corner to do it all.
+ */
+class VTRPWorkQueue {
+  static get NO_TILE() { return NO_TILE; }
+
+  constructor(numWorkers, buffers=null) {
+    this.numWorkers = numWorkers;
+    if (buffers) {
+      this.setBuffers(buffers);
+    }
+    else {
+      this.setBuffers({
+        items: new SharedArrayBuffer(0),
+        tiles: new SharedArrayBuffer(Int32Array.BYTES_PER_ELEMENT),
+        queues: new SharedArrayBuffer(numWorkers*Int32Array.BYTES_PER_ELEMENT),
+        stats: new SharedArrayBuffer(numWorkers*NUM_STATS*Float64Array.BYTES_PER_ELEMENT),
+      });
+    }
+    this.numItems = 0;
+    this.numTiles = 0;
+  }
+
+  // The shared buffers to hand over to the render procs, they're replaced whenever the queue outgrows them
+  getBuffers() { return this._buffers; }
+  setBuffers(buffers) {
+    this._buffers = buffers;
+    this.items  = new Int32Array(buffers.items);  // Pairs of [voxel index, renderable ID]
+    this.tiles  = new Int32Array(buffers.tiles);  // Start item of each tile, with the end of the last tile at numTiles
+    this.queues = new Int32Array(buffers.queues); // Packed [head, tail) tile range left to each worker
+    this.stats  = new Float64Array(buffers.stats);
+  }
+
+  /**
+   * Fill the queue with the frame's work items (main thread only).
+   * @param {Object} voxelIdxsByRenderable - Flat voxel indices (see VoxelGeometryUtils.voxelFlatIdx) of each renderable, by ID.
+   * @param {Number} numVoxels - The number of voxels in the grid.
+   * @returns {Boolean} true if the shared buffers had to be reallocated (see getBuffers).
+   */
+  build(voxelIdxsByRenderable, numVoxels) {
+    // Counting sort the work items by voxel index so that each voxel's items are consecutive
+    const voxelCounts = new Int32Array(numVoxels+1);
+    let numItems = 0;
+    Object.values(voxelIdxsByRenderable).forEach(voxelIdxs => {
+      for (let i = 0; i < voxelIdxs.length; i++) { voxelCounts[voxelIdxs[i]+1]++; }
+      numItems += voxelIdxs.length;
+    });
+    for (let i = 1; i <= numVoxels; i++) { voxelCounts[i] += voxelCounts[i-1]; }
+
+    const numWorkers = this.numWorkers;
+    const itemsPerTile = Math.max(MIN_ITEMS_PER_TILE, Math.ceil(numItems / Math.min(MAX_TILES, numWorkers*TILES_PER_WORKER)));
+    const maxTiles = Math.ceil(numItems / itemsPerTile);
+
+    let reallocated = false;
+    if (this.items.length < 2*numItems || this.tiles.length < maxTiles+1) {
+      // Leave some headroom so that animated scenes don't have to reallocate every other frame
+      this.setBuffers({
+        ...this._buffers,
+        items: new SharedArrayBuffer(Math.ceil(1.5*numItems)*2*Int32Array.BYTES_PER_ELEMENT),
+        tiles: new SharedArrayBuffer((Math.ceil(1.5*maxTiles)+1)*Int32Array.BYTES_PER_ELEMENT),
+      });
+      reallocated = true;
+    }
+
+    const items = this.items;
+    Object.entries(voxelIdxsByRenderable).forEach(entry => {
+      const [id, voxelIdxs] = entry;
+      for (let i = 0; i < voxelIdxs.length; i++) {
+        const itemIdx = 2*voxelCounts[voxelIdxs[i]]++;
+        items[itemIdx] = voxelIdxs[i];
+        items[itemIdx+1] = id;
+      }
+    });
+
+    // Cut the items up into tiles, each tile ends on a voxel boundary
+    const tiles = this.tiles;
+    let numTiles = 0;
+    let tileStart = 0;
+    while (tileStart < numItems) {
+      tiles[numTiles++] = tileStart;
+      let tileEnd = Math.min(numItems, tileStart + itemsPerTile);
+      while (tileEnd < numItems && items[2*tileEnd] === items[2*(tileEnd-1)]) { tileEnd++; }
+      tileStart = tileEnd;
+    }
+    tiles[numTiles] = numItems;
+
+    this.numItems = numItems;
+    this.numTiles = numTiles;
+    return reallocated;
+  }
+
+  /**
+   * Hand each worker an even, contiguous share of the tiles and clear their stats, call this before every frame.
+   */
+  reset() {
+    for (let i = 0; i < this.numWorkers; i++) {
+      const head = Math.floor(i*this.numTiles / this.numWorkers);
+      const tail = Math.floor((i+1)*this.numTiles / this.numWorkers);
+      Atomics.store(this.queues, i, VTRPWorkQueue._packQueue(head, tail));
+    }
+    this.stats.fill(0);
+  }
+
+  // Take the next tile from the front of the worker's own queue
+  popTile(workerIdx) {
+    const queues = this.queues;
+    let queue = Atomics.load(queues, workerIdx);
+    while (true) {
+      const head = queue & 0xFFFF, tail = queue >>> 16;
+      if (head >= tail) { return NO_TILE; }
+      const prevQueue = Atomics.compareExchange(queues, workerIdx, queue, VTRPWorkQueue._packQueue(head+1, tail));
+      if (prevQueue === queue) { return head; }
+      queue = prevQueue;
+    }
+  }
+
+  // Take a tile from the back of the queue of whichever other worker has the most tiles left
+  stealTile(workerIdx) {
+    const queues = this.queues;
+    while (true) {
+      let victimIdx = -1;
+      let victimQueue = 0;
+      let mostTiles = 0;
+      for (let i = 0; i < this.numWorkers; i++) {
+        if (i === workerIdx) { continue; }
+        const queue = Atomics.load(queues, i);
+        const numTiles = (queue >>> 16) - (queue & 0xFFFF);
+        if (numTiles > mostTiles) {
+          victimIdx = i;
+          victimQueue = queue;
+          mostTiles = numTiles;
+        }
+      }
+      if (victimIdx === -1) { return NO_TILE; }
+
+      const head = victimQueue & 0xFFFF, tail = victimQueue >>> 16;
+      if (Atomics.compareExchange(queues, victimIdx, victimQueue, VTRPWorkQueue._packQueue(head, tail-1)) === victimQueue) {
+        return tail-1;
+      }
+      // Lost the race for it (to its owner or another thief), look again
+    }
+  }
+
+  tileItemRange(tileIdx) { return [this.tiles[tileIdx], this.tiles[tileIdx+1]]; }
+
+  addWorkerStats(workerIdx, busyMs, stolen) {
+    const offset = workerIdx*NUM_STATS;
+    this.stats[offset + STAT_BUSY_MS] += busyMs;
+    this.stats[offset + STAT_TILES]++;
+    if (stolen) { this.stats[offset + STAT_STOLEN_TILES]++; }
+  }
+  getWorkerStats(workerIdx) {
+    const offset = workerIdx*NUM_STATS;
+    return {
+      busyMs: this.stats[offset + STAT_BUSY_MS],
+      tiles: this.stats[offset + STAT_TILES],
+      stolenTiles: this.stats[offset + STAT_STOLEN_TILES],
+    };
+  }
+
+  static _packQueue(head, tail) { return (tail << 16) | head; }
+}
+
+export default VTRPWorkQueue;
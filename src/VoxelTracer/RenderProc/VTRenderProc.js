@@ -1,95 +1,56 @@
+import {parentPort} from 'worker_threads';
+
 import VTRPScene from "./VTRPScene";
-import VoxelGeometryUtils from "../../VoxelGeometryUtils";
+import VTRPWorkQueue from "./VTRPWorkQueue";
 
 class VTRenderProc {
   static get TO_PROC_INIT() { return 'i'; }
   static get TO_PROC_UPDATE_SCENE() { return 'u'; }
-  static get TO_PROC_UPDATE_VOXEL_INFO() { return 'm'; }
+  static get TO_PROC_UPDATE_WORK_QUEUE() { return 'w'; }
   static get TO_PROC_RENDER() { return 'r'; }
-  
-  static get FROM_PROC_RENDERED() { return 'f'; }
 
   constructor() {
     this.rpScene = new VTRPScene();
-    this.renderableToVoxelMapping = {};
-    this.voxelIndexRange = [0,0];
+    this.workerIdx = 0;
+    this.workQueue = null;    // Shared with VTScene and the other render procs, see VTRPWorkQueue
+    this.renderBuffer = null; // Framebuffer shared with VTScene, we only write to the voxels in the tiles we take
+    this.renderSync = null;   // Shared with VTScene, where we check in with the generation of each frame we finish
+    this.lightingCacheValid = null; // Shared flags of the voxels whose colours in the render buffer are still valid (see VTLightingCache)
   }
 
   run() {
-    process.on('message', message => {
+    parentPort.on('message', message => {
       const {type, data} = message;
 
       switch (type) {
         case VTRenderProc.TO_PROC_INIT: {
-          const {gridSize, voxelIndexRange} = data;
-          this.rpScene.gridSize = parseInt(gridSize);
-          this.voxelIndexRange = voxelIndexRange;
+          const {gridSize, workerIdx, numWorkers, workQueueBuffers, renderBuffer, renderSync, lightingCacheValid} = data;
+          this.rpScene.setGridSize(gridSize.map(size => parseInt(size)));
+          this.workerIdx = workerIdx;
+          this.workQueue = new VTRPWorkQueue(numWorkers, workQueueBuffers);
+          this.renderBuffer = renderBuffer;
+          this.renderSync = renderSync;
+          this.lightingCacheValid = lightingCacheValid;
           break;
         }
 
-        case VTRenderProc.TO_PROC_UPDATE_SCENE: {
-          const {removedIds} = data;
-          // The data is an object with all of the scene objects that need to be updated inside of it
-          this.rpScene.update(data);
-          // Remove mappings if necessary
-          if (removedIds) {
-            for (let i = 0; i < removedIds.length; i++) {
-              const removedId = removedIds[i];
-              delete this.renderableToVoxelMapping[removedId];
-            }
-          }
-
+        case VTRenderProc.TO_PROC_UPDATE_SCENE:
+          // The data is the binary scene delta with all of the scene objects that need to be updated (see VTSceneDelta)
+          this.rpScene.applyUpdate(data);
           break;
-        }
-
-        case VTRenderProc.TO_PROC_UPDATE_VOXEL_INFO: {
-          if (data.reinit) {
-            this.renderableToVoxelMapping = data.mapping;
-          }
-          else {
-            const {mapping, updatedRenderableVoxels} = data;
-            if (this.renderableToVoxelMapping.length === 0) {
-              // In this case it's likely that this is the first call with new scene data,
-              // in this case we just make it our direct mapping
-              this.renderableToVoxelMapping = mapping;
-            }
-            else {
-              Object.entries(mapping).forEach(entry => {
-                this.renderableToVoxelMapping[entry[0]] = entry[1];
-              });
-
-              // Update renderable to voxel mappings - we may no longer be rendering some of the assets that got updated 
-              // if an asset changed positions to voxel(s) that this child doesn't render or vice versa)
-              const newRenderableToVoxelPtsMappings = {};
-              for (let i = 0; i < updatedRenderableVoxels.length; i++) {
-                const {voxelPt, renderableId} = updatedRenderableVoxels[i];
-
-                if (!(renderableId in newRenderableToVoxelPtsMappings)) {
-                  newRenderableToVoxelPtsMappings[renderableId] = [];
-                }
-
-                // If the voxel point is going to be rendered by this process then we include it
-                const voxelIdx = VoxelGeometryUtils.voxelFlatIdx(voxelPt, this.rpScene.gridSize);
-                if (voxelIdx >= this.voxelIndexRange[0] && voxelIdx <= this.voxelIndexRange[1]) {
-                  newRenderableToVoxelPtsMappings[renderableId].push(voxelPt);
-                }
-              }
 
-              Object.entries(newRenderableToVoxelPtsMappings).forEach(entry => {
-                const [renderableId, voxelPts] = entry;
-                delete this.renderableToVoxelMapping[renderableId];
-                if (voxelPts.length > 0) {
-                  this.renderableToVoxelMapping[renderableId] = voxelPts;
-                }
-              });
-            }
-          }
-          
+        case VTRenderProc.TO_PROC_UPDATE_WORK_QUEUE:
+          // The work queue outgrew its shared buffers and VTScene replaced them
+          this.workQueue.setBuffers(data);
           break;
-        }
 
         case VTRenderProc.TO_PROC_RENDER:
-          this.rpScene.render(this.renderableToVoxelMapping);
+          // The data is the frame's generation
+          this.render();
+          // Let VTScene know that we've run out of work for the frame
+          Atomics.store(this.renderSync, 1+this.workerIdx, data);
+          Atomics.add(this.renderSync, 0, 1);
+          Atomics.notify(this.renderSync, 0);
           break;
 
         default:
@@ -99,6 +60,26 @@ class VTRenderProc {
     });
   }
 
+  render() {
+    const {workQueue, workerIdx} = this;
+
+    // Work through our own tiles first, then help out whoever has the most left until there's nothing left anywhere
+    let stealing = false;
+    while (true) {
+      let tileIdx = stealing ? VTRPWorkQueue.NO_TILE : workQueue.popTile(workerIdx);
+      if (tileIdx === VTRPWorkQueue.NO_TILE) {
+        stealing = true;
+        tileIdx = workQueue.stealTile(workerIdx);
+        if (tileIdx === VTRPWorkQueue.NO_TILE) { break; }
+      }
+
+      const startTime = performance.now();
+      const [startItem, endItem] = workQueue.tileItemRange(tileIdx);
+      this.rpScene.renderWorkItems(workQueue.items, startItem, endItem, this.renderBuffer, this.lightingCacheValid);
+      workQueue.addWorkerStats(workerIdx, performance.now() - startTime, stealing);
+    }
+  }
+
 }
 
 export default VTRenderProc;
\ No newline at end of file
@@ -9,12 +9,8 @@ class VTAmbientLight extends VTObject {
     this.makeDirty();
   }
 
-  static build(jsonData) {
-    const {id, _colour} = jsonData;
-    const colour = (new THREE.Color()).setHex(_colour);
-    const result = new VTAmbientLight(colour);
-    result.id = id;
-    return result;
+  static deserialize(reader) {
+    return new VTAmbientLight(reader.readColour());
   }
 
   get colour() { return this._colour; }
@@ -32,9 +28,8 @@ class VTAmbientLight extends VTObject {
     return false;
   }
 
-  toJSON() {
-    const {id, type, _colour} = this;
-    return {id, type, _colour};
+  serialize(writer) {
+    writer.writeColour(this._colour);
   }
 
   dispose() {}
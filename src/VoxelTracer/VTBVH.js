@@ -0,0 +1,261 @@
+import * as THREE from 'three';
+
+// Leaf boxes are fattened by this much (in voxels) so that objects can move around a little without the tree changing
+const FAT_BOX_MARGIN = 0.5;
+
+class VTBVHNode {
+  constructor() {
+    this.box = new THREE.Box3();
+    this.parent = null;
+    this.left = null;
+    this.right = null;
+    this.object = null; // Only for leaves
+    this.height = 0;    // Leaves are at height 0
+  }
+
+  isLeaf() { return this.left === null; }
+}
+
+/**
+ * Bounding volume hierarchy over scene objects (a dynamic AABB tree): each object sits in a leaf with a slightly
+ * fattened copy of its bounding box and the tree is kept balanced with AVL rotations as objects are added, moved and
+ * removed, so ray queries only visit the O(log n) parts of the tree that they actually touch.
+ */
+class VTBVH {
+  constructor() {
+    this.clear();
+    this._stack = [];
+    this._tempBox = new THREE.Box3();
+  }
+
+  clear() {
+    this.root = null;
+    this._leaves = {}; // Leaf node of each object, by ID
+  }
+
+  size() { return Object.keys(this._leaves).length; }
+  has(id) { return id in this._leaves; }
+
+  /**
+   * Add or move an object in the tree.
+   * @param {Number} id - The object's ID, an existing object with the same ID is replaced.
+   * @param {Object} object - The object.
+   * @param {THREE.Box3} box - The object's world space bounding box.
+   */
+  update(id, object, box) {
+    let leaf = this._leaves[id];
+    if (leaf) {
+      leaf.object = object;
+      if (leaf.box.containsBox(box)) {
+        // It's still inside its fat box, nothing in the tree needs to change
+        return;
+      }
+      this._removeLeaf(leaf);
+    }
+    else {
+      leaf = new VTBVHNode();
+      leaf.object = object;
+      this._leaves[id] = leaf;
+    }
+
+    leaf.box.copy(box).expandByScalar(FAT_BOX_MARGIN);
+    this._insertLeaf(leaf);
+  }
+
+  remove(id) {
+    const leaf = this._leaves[id];
+    if (leaf) {
+      this._removeLeaf(leaf);
+      delete this._leaves[id];
+    }
+  }
+
+  /**
+   * Visit every object whose (fattened) bounding box is hit by the given ray segment.
+   * @param {THREE.Ray} ray - The ray, its direction must be normalized.
+   * @param {Number} near - Distance along the ray where the segment starts.
+   * @param {Number} far - Distance along the ray where the segment ends.
+   * @param {Function} callback - Called with each object that may be hit, return true to stop the query early.
+   */
+  queryRay(ray, near, far, callback) {
+    const {origin, direction} = ray;
+    const invDirX = 1 / direction.x, invDirY = 1 / direction.y, invDirZ = 1 / direction.z;
+
+    const stack = this._stack;
+    stack.length = 0;
+    if (this.root) { stack.push(this.root); }
+    while (stack.length > 0) {
+      const node = stack.pop();
+      const {min, max} = node.box;
+
+      // Slab test, clipped to [near, far]
+      let tMin = near, tMax = far;
+      let t0 = (min.x - origin.x)*invDirX, t1 = (max.x - origin.x)*invDirX;
+      if (invDirX < 0) { [t0, t1] = [t1, t0]; }
+      tMin = t0 > tMin ? t0 : tMin; tMax = t1 < tMax ? t1 : tMax;
+      t0 = (min.y - origin.y)*invDirY; t1 = (max.y - origin.y)*invDirY;
+      if (invDirY < 0) { [t0, t1] = [t1, t0]; }
+      tMin = t0 > tMin ? t0 : tMin; tMax = t1 < tMax ? t1 : tMax;
+      t0 = (min.z - origin.z)*invDirZ; t1 = (max.z - origin.z)*invDirZ;
+      if (invDirZ < 0) { [t0, t1] = [t1, t0]; }
+      tMin = t0 > tMin ? t0 : tMin; tMax = t1 < tMax ? t1 : tMax;
+      // N.B., NaNs (a zero direction component on the edge of a slab) fail every comparison and count as a hit
+      if (tMin > tMax) { continue; }
+
+      if (node.isLeaf()) {
+        if (callback(node.object)) { break; }
+      }
+      else {
+        stack.push(node.left, node.right);
+      }
+    }
+    stack.length = 0;
+  }
+
+  _insertLeaf(leaf) {
+    if (this.root === null) {
+      this.root = leaf;
+      leaf.parent = null;
+      return;
+    }
+
+    // Find the best sibling for the leaf: walk down the tree choosing whichever child grows the least by having
+    // the leaf added to it, until it's cheaper to make the leaf a sibling of the current node
+    const leafBox = leaf.box;
+    const unionBox = this._tempBox;
+    let node = this.root;
+    while (!node.isLeaf()) {
+      const area = VTBVH._halfSurfaceArea(node.box);
+      const combinedArea = VTBVH._halfSurfaceArea(unionBox.copy(node.box).union(leafBox));
+
+      // Cost of creating a new parent for this node and the new leaf, and of pushing the leaf further down
+      const cost = 2*combinedArea;
+      const inheritanceCost = 2*(combinedArea - area);
+      const leftCost = this._descendCost(node.left, leafBox) + inheritanceCost;
+      const rightCost = this._descendCost(node.right, leafBox) + inheritanceCost;
+
+      if (cost < leftCost && cost < rightCost) { break; }
+      node = (leftCost < rightCost) ? node.left : node.right;
+    }
+
+    const sibling = node;
+    const oldParent = sibling.parent;
+    const newParent = new VTBVHNode();
+    newParent.parent = oldParent;
+    newParent.box.copy(leafBox).union(sibling.box);
+    newParent.height = sibling.height + 1;
+    this._replaceChild(oldParent, sibling, newParent);
+    newParent.left = sibling;
+    newParent.right = leaf;
+    sibling.parent = newParent;
+    leaf.parent = newParent;
+
+    this._refitFrom(leaf.parent);
+  }
+
+  _descendCost(child, leafBox) {
+    const unionArea = VTBVH._halfSurfaceArea(this._tempBox.copy(child.box).union(leafBox));
+    return child.isLeaf() ? unionArea : (unionArea - VTBVH._halfSurfaceArea(child.box));
+  }
+
+  _removeLeaf(leaf) {
+    if (leaf === this.root) {
+      this.root = null;
+      return;
+    }
+
+    const parent = leaf.parent;
+    const grandParent = parent.parent;
+    const sibling = (parent.left === leaf) ? parent.right : parent.left;
+
+    // The sibling takes the parent's place
+    sibling.parent = grandParent;
+    this._replaceChild(grandParent, parent, sibling);
+    leaf.parent = null;
+
+    this._refitFrom(grandParent);
+  }
+
+  // Rebalance and recompute the boxes and heights of the given node and all of its ancestors
+  _refitFrom(node) {
+    while (node !== null) {
+      node = this._balance(node);
+      node.height = 1 + Math.max(node.left.height, node.right.height);
+      node.box.copy(node.left.box).union(node.right.box);
+      node = node.parent;
+    }
+  }
+
+  _replaceChild(parent, oldChild, newChild) {
+    if (parent === null) {
+      this.root = newChild;
+    }
+    else if (parent.left === oldChild) {
+      parent.left = newChild;
+    }
+    else {
+      parent.right = newChild;
+    }
+  }
+
+  // If one of the node's subtrees is more than one level taller than the other then rotate it up (into the node's
+  // place), returns whichever node is now at the node's old place in the tree
+  _balance(a) {
+    if (a.isLeaf() || a.height < 2) {
+      return a;
+    }
+
+    const b = a.left;
+    const c = a.right;
+    const balance = c.height - b.height;
+
+    if (balance > 1) {
+      // Rotate c up, a keeps b and takes the shorter of c's children
+      const f = c.left;
+      const g = c.right;
+      c.left = a;
+      c.parent = a.parent;
+      a.parent = c;
+      this._replaceChild(c.parent, a, c);
+
+      const [taller, shorter] = (f.height > g.height) ? [f, g] : [g, f];
+      c.right = taller;
+      a.right = shorter;
+      shorter.parent = a;
+      a.box.copy(b.box).union(shorter.box);
+      c.box.copy(a.box).union(taller.box);
+      a.height = 1 + Math.max(b.height, shorter.height);
+      c.height = 1 + Math.max(a.height, taller.height);
+      return c;
+    }
+
+    if (balance < -1) {
+      // Rotate b up, a keeps c and takes the shorter of b's children
+      const d = b.left;
+      const e = b.right;
+      b.left = a;
+      b.parent = a.parent;
+      a.parent = b;
+      this._replaceChild(b.parent, a, b);
+
+      const [taller, shorter] = (d.height > e.height) ? [d, e] : [e, d];
+      b.right = taller;
+      a.left = shorter;
+      shorter.parent = a;
+      a.box.copy(c.box).union(shorter.box);
+      b.box.copy(a.box).union(taller.box);
+      a.height = 1 + Math.max(c.height, shorter.height);
+      b.height = 1 + Math.max(a.height, taller.height);
+      return b;
+    }
+
+    return a;
+  }
+
+  static _halfSurfaceArea(box) {
+    const dx = box.max.x - box.min.x, dy = box.max.y - box.min.y, dz = box.max.z - box.min.z;
+    return dx*dy + dy*dz + dz*dx;
+  }
+}
+
+export default VTBVH;
@@ -1,7 +1,6 @@
 import * as THREE from 'three';
 
 import VTMaterial from './VTMaterial';
-import VTTexture from './VTTexture';
 import {clamp} from '../MathUtils';
 
 class VTEmissionMaterial extends VTMaterial {
@@ -12,17 +11,20 @@ class VTEmissionMaterial extends VTMaterial {
     this.texture = texture;
   }
 
-  static build(jsonData) {
-    const {colour, alpha, texture} = jsonData;
-    const threeColour = (new THREE.Color()).setHex(colour);
-    return new VTEmissionMaterial(threeColour, alpha, VTTexture.build(texture));
+  static deserialize(reader, resources) {
+    const colour = reader.readColour();
+    const alpha = reader.readFloat64();
+    const texture = reader.readResource(resources);
+    return new VTEmissionMaterial(colour, alpha, texture);
   }
 
   dispose() {}
 
-  toJSON() {
-    const {type, colour, alpha, texture} = this;
-    return {type, colour, alpha, texture};
+  serialize(writer) {
+    writer.writeType(this.type);
+    writer.writeColour(this.colour);
+    writer.writeFloat64(this.alpha);
+    writer.writeTexture(this.texture);
   }
 
   emission(uv) {
@@ -51,6 +53,10 @@ class VTEmissionMaterial extends VTMaterial {
     albedoColour.add(lightColour).multiplyScalar(this.alpha);
     return albedoColour;
   }
+
+  basicBrdfAmbient(uv, lightColour) {
+    return this.brdfAmbient(uv, lightColour);
+  }
 }
 
 export default VTEmissionMaterial;
\ No newline at end of file
@@ -40,9 +40,11 @@ class VTFog extends VTObject {
 
   isShadowCaster() { return true; }
 
-  toJSON() {
-    const {id, type, _colour, _boundingBox, _scattering} = this;
-    return {id, type, _colour, _boundingBox, _scattering};
+  serialize(writer) {
+    writer.writeVec3(this._boundingBox.min);
+    writer.writeVec3(this._boundingBox.max);
+    writer.writeColour(this._colour);
+    writer.writeFloat64(this._scattering);
   }
 
   position(target) { 
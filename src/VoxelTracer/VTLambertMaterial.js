@@ -1,7 +1,6 @@
 import * as THREE from 'three';
 
 import VTMaterial from './VTMaterial';
-import VTTexture from './VTTexture';
 import {clamp} from '../MathUtils';
 
 class VTLambertMaterial extends VTMaterial {
@@ -14,18 +13,24 @@ class VTLambertMaterial extends VTMaterial {
     this.reflect = reflect;
   }
 
-  static build(jsonData) {
-    const {colour, emissive, alpha, texture, reflect} = jsonData;
-    const threeColour = (new THREE.Color()).setHex(colour);
-    const threeEmission = (new THREE.Color()).setHex(emissive);
-    return new VTLambertMaterial(threeColour, threeEmission, alpha, VTTexture.build(texture), reflect);
+  static deserialize(reader, resources) {
+    const colour = reader.readColour();
+    const emissive = reader.readColour();
+    const alpha = reader.readFloat64();
+    const reflect = reader.readBool();
+    const texture = reader.readResource(resources);
+    return new VTLambertMaterial(colour, emissive, alpha, texture, reflect);
   }
 
   dispose() {}
 
-  toJSON() {
-    const {type, colour, emissive, alpha, texture, reflect} = this;
-    return {type, colour, emissive, alpha, texture, reflect};
+  serialize(writer) {
+    writer.writeType(this.type);
+    writer.writeColour(this.colour);
+    writer.writeColour(this.emissive);
+    writer.writeFloat64(this.alpha);
+    writer.writeBool(this.reflect);
+    writer.writeTexture(this.texture);
   }
 
   isVisible() {
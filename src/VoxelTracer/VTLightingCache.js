@@ -0,0 +1,145 @@
+import * as THREE from 'three';
+
+// Caster bounds are padded by this much (in voxels) to cover geometry that pokes out of its colliding voxels
+const CASTER_BOX_MARGIN = 1;
+
+/**
+ * Keeps the voxel tracer's shared render buffer around from one frame to the next as a cache of the lit colour of
+ * every voxel. Each voxel has a shared valid flag: the render procs skip the work items of valid voxels and set the
+ * flag once they've rendered the rest. VTScene invalidates (clears the flag and colour of) only the voxels that a
+ * scene change can reach:
+ * - Every voxel that a changed, added or removed renderable covers (before and after the change).
+ * - Every voxel that a changed shadow caster may have started or stopped shadowing from any of the lights, i.e.,
+ *   the (bounding box of the) shadow volume cast by its bounds from each light, clipped to the grid.
+ * - Everything, when any light changes (light has no finite range, attenuation never quite reaches zero).
+ * Static scenes cost next to nothing to render and animated ones only pay for the parts of the grid they touch.
+ *
+ * Invalidations are only recorded as they happen and get applied in flush, right before the render procs are
+ * told to render, so that they never clash with a frame that's still in progress.
+ */
+class VTLightingCache {
+  constructor(renderBuffer, xSize, ySize, zSize) {
+    this.renderBuffer = renderBuffer;
+    this.xSize = xSize;
+    this.ySize = ySize;
+    this.zSize = zSize;
+    this.valid = new Uint8Array(new SharedArrayBuffer(xSize*ySize*zSize)); // Shared with the render procs
+
+    this._pendingAll = true;
+    this._pendingVoxelIdxs = [];
+    this._tempBox = new THREE.Box3();
+    this._tempCorner = new THREE.Vector3();
+  }
+
+  invalidateAll() {
+    this._pendingAll = true;
+    this._pendingVoxelIdxs = [];
+  }
+
+  invalidateVoxels(voxelIdxs) {
+    if (this._pendingAll) { return; }
+    for (let i = 0; i < voxelIdxs.length; i++) {
+      this._pendingVoxelIdxs.push(voxelIdxs[i]);
+    }
+  }
+
+  /**
+   * Invalidate every voxel whose shadow rays to any of the given lights may pass through the shadow caster.
+   * @param {Array} casterVoxelIdxs - Flat indices of the voxels that the shadow caster covers.
+   * @param {Array} lightPositions - World positions (THREE.Vector3) of the lights.
+   */
+  invalidateShadows(casterVoxelIdxs, lightPositions) {
+    if (this._pendingAll || casterVoxelIdxs.length === 0 || lightPositions.length === 0) { return; }
+
+    const {ySize, zSize} = this;
+    const casterBox = this._tempBox.makeEmpty();
+    for (let i = 0; i < casterVoxelIdxs.length; i++) {
+      const voxelIdx = casterVoxelIdxs[i];
+      const x = Math.floor(voxelIdx / (ySize*zSize)), y = Math.floor(voxelIdx / zSize) % ySize, z = voxelIdx % zSize;
+      casterBox.min.set(Math.min(casterBox.min.x, x), Math.min(casterBox.min.y, y), Math.min(casterBox.min.z, z));
+      casterBox.max.set(Math.max(casterBox.max.x, x+1), Math.max(casterBox.max.y, y+1), Math.max(casterBox.max.z, z+1));
+    }
+    casterBox.expandByScalar(CASTER_BOX_MARGIN);
+
+    // Anything that the segment from a voxel to the light crosses the caster box on the way lies in the cone from the
+    // light through the box. Stretching the box's corners away from the light, far enough that the stretched box is
+    // further from the light than any voxel, gives a shape whose hull with the light holds all of the grid's part of that cone
+    const corner = this._tempCorner;
+    for (let i = 0; i < lightPositions.length; i++) {
+      const lightPos = lightPositions[i];
+      const distance = casterBox.distanceToPoint(lightPos);
+      if (distance < 0.5) {
+        // The light is (nearly) inside the caster, it could be shadowing anything
+        this.invalidateAll();
+        return;
+      }
+      // Distance from the light to the grid's furthest corner
+      const dx = Math.max(Math.abs(lightPos.x), Math.abs(this.xSize-1-lightPos.x));
+      const dy = Math.max(Math.abs(lightPos.y), Math.abs(ySize-1-lightPos.y));
+      const dz = Math.max(Math.abs(lightPos.z), Math.abs(zSize-1-lightPos.z));
+      const stretch = Math.max(1, Math.sqrt(dx*dx + dy*dy + dz*dz) / distance);
+
+      let minX = lightPos.x, minY = lightPos.y, minZ = lightPos.z;
+      let maxX = minX, maxY = minY, maxZ = minZ;
+      for (let c = 0; c < 8; c++) {
+        corner.set(
+          (c & 1) ? casterBox.max.x : casterBox.min.x,
+          (c & 2) ? casterBox.max.y : casterBox.min.y,
+          (c & 4) ? casterBox.max.z : casterBox.min.z
+        ).sub(lightPos).multiplyScalar(stretch).add(lightPos);
+        minX = Math.min(minX, corner.x); minY = Math.min(minY, corner.y); minZ = Math.min(minZ, corner.z);
+        maxX = Math.max(maxX, corner.x); maxY = Math.max(maxY, corner.y); maxZ = Math.max(maxZ, corner.z);
+      }
+      this._invalidateBox(minX, minY, minZ, maxX, maxY, maxZ);
+    }
+  }
+
+  /**
+   * Apply everything that was invalidated since the last flush.
+   * @returns {Number} The number of cached voxels that were invalidated.
+   */
+  flush() {
+    let numInvalidated = 0;
+    if (this._pendingAll) {
+      this.valid.fill(0);
+      this.renderBuffer.fill(0);
+      numInvalidated = this.valid.length;
+    }
+    else {
+      const {valid, renderBuffer} = this;
+      const pending = this._pendingVoxelIdxs;
+      for (let i = 0; i < pending.length; i++) {
+        const voxelIdx = pending[i];
+        if (valid[voxelIdx]) {
+          valid[voxelIdx] = 0;
+          numInvalidated++;
+        }
+        const bufferIdx = voxelIdx*3;
+        renderBuffer[bufferIdx] = 0;
+        renderBuffer[bufferIdx+1] = 0;
+        renderBuffer[bufferIdx+2] = 0;
+      }
+    }
+    this._pendingAll = false;
+    this._pendingVoxelIdxs = [];
+    return numInvalidated;
+  }
+
+  _invalidateBox(minX, minY, minZ, maxX, maxY, maxZ) {
+    const {xSize, ySize, zSize} = this;
+    const startX = Math.max(0, Math.floor(minX)), endX = Math.min(xSize-1, Math.ceil(maxX));
+    const startY = Math.max(0, Math.floor(minY)), endY = Math.min(ySize-1, Math.ceil(maxY));
+    const startZ = Math.max(0, Math.floor(minZ)), endZ = Math.min(zSize-1, Math.ceil(maxZ));
+    const pending = this._pendingVoxelIdxs;
+    for (let x = startX; x <= endX; x++) {
+      for (let y = startY; y <= endY; y++) {
+        const rowIdx = (x*ySize + y)*zSize;
+        for (let z = startZ; z <= endZ; z++) {
+          pending.push(rowIdx + z);
+        }
+      }
+    }
+  }
+}
+
+export default VTLightingCache;
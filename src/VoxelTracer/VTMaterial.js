@@ -7,6 +7,8 @@ class VTMaterial {
     this.type = type;
   }
 
+  serialize(writer) { console.error("serialize unimplemented abstract method called."); }
+
   isVisible() { console.error("isVisible unimplemented abstract method called."); return true; }
   albedo(uv) { console.error("albedo unimplemented abstract method called.");  return null; }
   brdf(nObjToLightVec, normal, uv, lightColour) { console.error("brdf unimplemented abstract method called.");  return null; }
@@ -4,23 +4,23 @@ import VTEmissionMaterial from './VTEmissionMaterial';
 
 
 class VTMaterialFactory {
-  static build(jsonData) {
-    const {type} = jsonData;
+  // Read a material written by its serialize method from a scene update (see VTSceneDelta), any texture it has is
+  // one of the given (already uploaded) resources
+  static deserialize(reader, resources) {
+    const type = reader.readType();
     let result = null;
 
-    // TODO: Have texture ids to avoid massive duplications here...
-
     switch (type) {
       case VTMaterial.LAMBERT_TYPE: {
-        result = VTLambertMaterial.build(jsonData);
+        result = VTLambertMaterial.deserialize(reader, resources);
         break;
       }
       case VTMaterial.EMISSION_TYPE: {
-        result = VTEmissionMaterial.build(jsonData);
+        result = VTEmissionMaterial.deserialize(reader, resources);
         break;
       }
       default:
-        console.error(`Invalid material type: ${type}, found in jsonData: ${jsonData}`);
+        console.error(`Invalid material type: ${type}`);
         break;
     }
     return result;
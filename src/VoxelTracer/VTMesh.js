@@ -25,9 +25,11 @@ class VTMesh extends VTObject {
     this.makeDirty();
   }
 
-  toJSON() {
-    const {id, type, threeMesh, material} = this;
-    return {id, type, threeMesh, material};
+  serialize(writer) {
+    // The geometry is only uploaded to the render procs the first time, after that just the transform and material
+    writer.writeGeometry(this.geometry);
+    writer.writeMatrix4(this.threeMesh.matrixWorld);
+    this.material.serialize(writer);
   }
 
   dispose() {
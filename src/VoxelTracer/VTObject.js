@@ -23,6 +23,8 @@ class VTObject {
   dispose() { console.error("dispose unimplemented abstract method called."); }
   isShadowCaster() { console.error("isShadowCaster unimplemented abstract method called."); return false; }
   getCollidingVoxels(voxelGridBoundingBox=null) { console.error("getCollidingVoxels unimplemented abstract method called."); return []; }
+  serialize(writer) { console.error("serialize unimplemented abstract method called."); } // See VTSceneDelta
+  getWorldBoundingBox(target) { console.error("getWorldBoundingBox unimplemented abstract method called."); return target; }
 
   calculateShadow(raycaster=null) { console.error("calculateShadow unimplemented abstract method called."); return null; }
   calculateVoxelColour(voxelIdxPt, scene) { console.error("calculateVoxelColour unimplemented abstract method called."); return null; }
@@ -21,16 +21,17 @@ class VTPointLight extends VTObject {
     this._isDirty = true;
   }
 
-  static build(jsonData) {
-    const {id, _position, _colour, _attenuation} = jsonData;
-    const colour = (new THREE.Color()).setHex(_colour);
-    const result = new VTPointLight(new THREE.Vector3(_position.x, _position.y, _position.z), colour, _attenuation);
-    result.id = id;
-    return result;
+  static deserialize(reader) {
+    const position = reader.readVec3();
+    const colour = reader.readColour();
+    const attenuation = {quadratic: reader.readFloat64(), linear: reader.readFloat64()};
+    return new VTPointLight(position, colour, attenuation);
   }
-  toJSON() {
-    const {id, type, _position, _colour, _attenuation} = this;
-    return {id, type, _position, _colour, _attenuation};
+  serialize(writer) {
+    writer.writeVec3(this._position);
+    writer.writeColour(this._colour);
+    writer.writeFloat64(this._attenuation.quadratic);
+    writer.writeFloat64(this._attenuation.linear);
   }
 
   setPosition(p) { this._position = p; this.makeDirty(); }
@@ -1,19 +1,49 @@
-import * as THREE from 'three';
 import os from 'os';
 import path from 'path';
-import {fork} from 'child_process';
+import {Worker} from 'worker_threads';
 
 import VTAmbientLight from './VTAmbientLight';
+import VTLightingCache from './VTLightingCache';
 import VTRenderProc from './RenderProc/VTRenderProc';
+import VTRPWorkQueue from './RenderProc/VTRPWorkQueue';
+import {VTSceneDeltaWriter} from './VTSceneDelta';
 import VoxelGeometryUtils from '../VoxelGeometryUtils';
 
+const RENDER_TIMEOUT_MS = 1000; // Give up on render procs that haven't finished a frame after this long
+const RENDER_POLL_MS = 1;       // How often to check on the render procs when we can't wait on them asynchronously
+const RENDER_STATS_INTERVAL_MS = 30000;
+
 class VTScene {
   constructor(voxelModel) {
     this.voxelModel = voxelModel;
 
-    this.childProcesses = [];
-
-    // TODO: Octree: Split up among the child processes, who then perform the collision detection to determine what they should draw.
+    this.renderProcs = [];
+
+    // The render procs write the colours of their voxels straight into this shared framebuffer (laid out like
+    // VoxelFramebufferCPU's buffer). Once a render proc is done with a frame it stores the frame's generation in its
+    // slot of the render sync (after the first element) and bumps the first element, which we wait on, so that a
+    // render proc that finishes a frame we already gave up on can't be mistaken for one that finished the current frame
+    const numRenderProcs = VTScene.calcNumRenderProcs();
+    this._renderBuffer = new Float32Array(new SharedArrayBuffer(voxelModel.numVoxels()*3*Float32Array.BYTES_PER_ELEMENT));
+    this._renderSync = new Int32Array(new SharedArrayBuffer((1+numRenderProcs)*Int32Array.BYTES_PER_ELEMENT));
+    this._renderGeneration = 0;
+    this._renderTimedOut = false; // Some of the render procs are still working on the last frame
+    this._renderProcIdxs = new Map(); // Worker index (and render sync slot) of each render proc
+    // ...the render buffer isn't cleared between frames, it's also the cache of each voxel's lit colour
+    this._lightingCache = new VTLightingCache(this._renderBuffer, voxelModel.xSize(), voxelModel.ySize(), voxelModel.zSize());
+
+    // Flat indices of the voxels that each renderable (by ID) collides with, the render procs get them as the tiles of
+    // the work queue, which is rebuilt whenever these change
+    this._voxelIdxsByRenderable = {};
+    this._workQueue = new VTRPWorkQueue(numRenderProcs);
+    this._workQueueDirty = true;
+
+    // Scene updates for the render procs: the binary records of the objects that changed and any new geometry/textures
+    this._sceneDeltaWriter = new VTSceneDeltaWriter();
+
+    // Per render proc busy and idle time for the last frame and the totals since they were last logged
+    this.renderStats = null;
+    this._resetRenderStatsTotals();
 
     this.renderables = [];
     this.shadowCasters = [];
@@ -24,8 +54,7 @@ class VTScene {
 
     this._dirtyRemovedObjIds = [];
 
-    this._renderCount = 0;
-    this._forkChildProcesses();
+    this._startRenderProcs();
   }
 
   get gridSize() { return this.voxelModel.gridSize; }
@@ -82,64 +111,142 @@ class VTScene {
     if (index > -1) {
       this.shadowCasters.splice(index, 1);
     }
+    index = this.lights.indexOf(o);
+    if (index > -1) {
+      this.lights.splice(index, 1);
+      this._lightingCache.invalidateAll();
+    }
   }
 
   async render() {
-    this._renderCount = 0;
-    this._updateChildRenderProcsFromScene();
-    for (let i = 0; i < this.childProcesses.length; i++) {
-      this.childProcesses[i].send({type: VTRenderProc.TO_PROC_RENDER});
+    if (this._renderTimedOut) {
+      // The stragglers of the frame that timed out are still using the work queue, render buffer, lighting cache and
+      // scene updates, leave all of it alone (and skip the frame) until they've checked in
+      if (this._numRenderProcsFinished() < this.renderProcs.length) {
+        return;
+      }
+      this._renderTimedOut = false;
     }
 
-    const self = this;
-    const waitForRenderToFinish = () => {
-      const poll = resolve => {
-        if (self._renderCount === self.childProcesses.length) {
-          resolve();
-        }
-        else {
-          setImmediate(() => poll(resolve));
+    this._updateChildRenderProcsFromScene();
+
+    if (this._workQueueDirty) {
+      if (this._workQueue.build(this._voxelIdxsByRenderable, this.voxelModel.numVoxels())) {
+        for (let i = 0; i < this.renderProcs.length; i++) {
+          this.renderProcs[i].postMessage({type: VTRenderProc.TO_PROC_UPDATE_WORK_QUEUE, data: this._workQueue.getBuffers()});
         }
       }
-      return new Promise(poll);
-    };
+      this._workQueueDirty = false;
+    }
+    this._workQueue.reset();
+    const numRelitVoxels = this._lightingCache.flush();
+
+    const startTime = performance.now();
+    // Scene updates can still be written while we wait on the render procs (e.g., the scene is cleared), only the ones
+    // before this frame are certain to have been read once it's done
+    const sceneDeltaMark = this._sceneDeltaWriter.mark();
+    this._renderGeneration = (this._renderGeneration + 1) | 0;
+    for (let i = 0; i < this.renderProcs.length; i++) {
+      this.renderProcs[i].postMessage({type: VTRenderProc.TO_PROC_RENDER, data: this._renderGeneration});
+    }
+    if (!(await this._waitForRenderProcs())) {
+      this._renderTimedOut = true;
+      return;
+    }
+    this._updateRenderStats(performance.now() - startTime, numRelitVoxels);
 
-    await waitForRenderToFinish();
+    // The render procs have read every scene update that was sent before they rendered
+    this._sceneDeltaWriter.release(sceneDeltaMark);
+
+    this.voxelModel.addBuffer(this._renderBuffer);
   }
 
-  _renderFromChildProcData(renderedVoxels) {
-    if (renderedVoxels && renderedVoxels.length > 0) { 
-      const voxelPt = new THREE.Vector3();
-      const voxelColour = new THREE.Color();
-      for (let i = 0; i < renderedVoxels.length; i++) {
-        const {pt, colour} = renderedVoxels[i];
+  _updateRenderStats(frameMs, numRelitVoxels) {
+    const workers = [];
+    for (let i = 0; i < this._workQueue.numWorkers; i++) {
+      const {busyMs, tiles, stolenTiles} = this._workQueue.getWorkerStats(i);
+      workers.push({busyMs, idleMs: Math.max(0, frameMs - busyMs), tiles, stolenTiles});
+
+      const totals = this._renderStatsTotals.workers[i];
+      totals.busyMs += busyMs;
+      totals.idleMs += workers[i].idleMs;
+      totals.stolenTiles += stolenTiles;
+    }
+    this.renderStats = {frameMs, numTiles: this._workQueue.numTiles, numRelitVoxels, workers};
+    this._renderStatsTotals.frames++;
+    this._renderStatsTotals.frameMs += frameMs;
+    this._renderStatsTotals.relitVoxels += numRelitVoxels;
+
+    const now = Date.now();
+    if (now - this._renderStatsTotals.startTime >= RENDER_STATS_INTERVAL_MS) {
+      const {frames, frameMs: totalFrameMs, relitVoxels, workers: workerTotals} = this._renderStatsTotals;
+      const procStats = workerTotals.map((w, i) =>
+        `#${i} ${(100*w.busyMs / Math.max(1, w.busyMs + w.idleMs)).toFixed(0)}% busy, ${w.stolenTiles} stolen`);
+      console.log(`Voxel tracer: ${frames} frames, avg ${(totalFrameMs / Math.max(1, frames)).toFixed(2)}ms and ` +
+        `${(relitVoxels / Math.max(1, frames)).toFixed(0)} relit voxels per frame (${procStats.join("; ")}).`);
+      this._resetRenderStatsTotals();
+    }
+  }
 
-        voxelPt.set(pt.x, pt.y, pt.z);
-        voxelColour.setHex(colour);
+  _resetRenderStatsTotals() {
+    this._renderStatsTotals = {
+      startTime: Date.now(),
+      frames: 0,
+      frameMs: 0,
+      relitVoxels: 0,
+      workers: new Array(this._workQueue.numWorkers).fill().map(() => ({busyMs: 0, idleMs: 0, stolenTiles: 0})),
+    };
+  }
 
-        this.voxelModel.addToVoxelFast(voxelPt, voxelColour);
+  _numRenderProcsFinished() {
+    let numFinished = 0;
+    for (let i = 0; i < this.renderProcs.length; i++) {
+      const slot = 1 + this._renderProcIdxs.get(this.renderProcs[i]);
+      if (Atomics.load(this._renderSync, slot) === this._renderGeneration) { numFinished++; }
+    }
+    return numFinished;
+  }
+
+  /**
+   * Wait (without blocking the event loop) for the render procs to finish the current frame.
+   * @returns {Boolean} false if we timed out, in which case some of them are still working on it.
+   */
+  async _waitForRenderProcs() {
+    const endTime = Date.now() + RENDER_TIMEOUT_MS;
+    while (true) {
+      // Read the count before checking on the render procs so that we can't miss one that finishes in between
+      const count = Atomics.load(this._renderSync, 0);
+      const numFinished = this._numRenderProcsFinished();
+      if (numFinished === this.renderProcs.length) {
+        return true;
+      }
+      const timeoutMs = endTime - Date.now();
+      if (timeoutMs <= 0) {
+        console.error(`Timed out waiting on the render procs, ${numFinished} of ${this.renderProcs.length} finished the frame.`);
+        return false;
+      }
+      if (Atomics.waitAsync) {
+        await Atomics.waitAsync(this._renderSync, 0, count, timeoutMs).value;
+      }
+      else {
+        await new Promise(resolve => setTimeout(resolve, Math.min(RENDER_POLL_MS, timeoutMs)));
       }
     }
-    this._renderCount++;
   }
 
-  _getChildProcUpdateAndDirty(reinit=false) {
+  _getDirtyObjects(reinit=false) {
     let dirty = [];
     let updatedRenderables = [];
-    let updatedLights = [];
-    let updatedAmbientLight = null;
 
     if (reinit) {
+      // N.B., All lights are renderables as well (so we don't need to add those)
       updatedRenderables = [...this.renderables];
-      updatedLights = [...this.lights];
+      dirty = [...this.renderables];
       if (this.ambientLight) {
-        updatedAmbientLight = this.ambientLight;
         dirty.push(this.ambientLight);
       }
-      dirty = [...this.renderables];
     }
     else {
-      // N.B., All lights are renderables as well (so we don't need to loop through and add those)
       for (let i = 0; i < this.renderables.length; i++) {
         const renderable = this.renderables[i];
         if (renderable.isDirty()) {
@@ -147,190 +254,165 @@ class VTScene {
           dirty.push(renderable);
         }
       }
-      for (let i = 0; i < this.lights.length; i++) {
-        const light = this.lights[i];
-        if (light.isDirty()) {
-          updatedLights.push(light);
-          // N.B., Lights are already renderables so we don't need to add them to the dirty array
-        }
-      }
       if (this.ambientLight && this.ambientLight.isDirty()) {
-        updatedAmbientLight = this.ambientLight;
         dirty.push(this.ambientLight);
       }
     }
 
-    // NOTE: We don't include shadowcasters here because it is memoize-able data and can be derived by the child processes
-    const childProcUpdate = {
-      reinit: reinit,
-      renderables: updatedRenderables,
-      lights: updatedLights,
-      ambientLight: updatedAmbientLight,
-    };
-
-    return {childProcUpdate: childProcUpdate, dirty: dirty};
+    // NOTE: We don't include shadowcasters here because it is memoize-able data and can be derived by the render procs
+    return {updatedRenderables, dirty};
   }
 
   _updateChildRenderProcsFromScene(reinitAll=false) {
-    // Make sure the child processes know about any removed objects
-    if (this._dirtyRemovedObjIds.length > 0) {
-      const updateData = {removedIds: this._dirtyRemovedObjIds};
-      for (let i = 0; i < this.childProcesses.length; i++) {
-        this.childProcesses[i].send({type: VTRenderProc.TO_PROC_UPDATE_SCENE, data: updateData});
+    if (reinitAll) {
+      // The render procs clear their scenes (and resources), everything will be sent to them again
+      this._voxelIdxsByRenderable = {};
+      this._workQueueDirty = true;
+      this._sceneDeltaWriter.resetResources();
+      this._lightingCache.invalidateAll();
+    }
+
+    // Make sure the render procs know about any removed objects
+    const numRemoved = this._dirtyRemovedObjIds.length;
+    for (let i = 0; i < numRemoved; i++) {
+      const removedId = this._dirtyRemovedObjIds[i];
+      this._sceneDeltaWriter.writeRemove(removedId);
+      const voxelIdxs = this._voxelIdxsByRenderable[removedId];
+      if (voxelIdxs) {
+        // N.B., Removed lights already invalidated everything (see removeObject), treat anything else as a shadow caster
+        this._lightingCache.invalidateVoxels(voxelIdxs);
+        this._lightingCache.invalidateShadows(voxelIdxs, this._lightPositions());
+        delete this._voxelIdxsByRenderable[removedId];
       }
+    }
+    if (numRemoved > 0) {
       this._dirtyRemovedObjIds = [];
+      this._workQueueDirty = true;
     }
 
-    const {childProcUpdate, dirty} = this._getChildProcUpdateAndDirty(reinitAll);
+    const {updatedRenderables, dirty} = this._getDirtyObjects(reinitAll);
+    if (!reinitAll && numRemoved === 0 && dirty.length === 0) {
+      return;
+    }
 
     // Update all the dirty items so they have the most up-to-date data in them and
-    // are ready to be sent to the child render processes
+    // write the ones that changed into the scene update for the render procs
     for (let i = 0; i < dirty.length; i++) {
       const dirtyObj = dirty[i];
+      if (dirtyObj === this.ambientLight) {
+        this._lightingCache.invalidateAll();
+      }
       dirtyObj.unDirty();
+      if (!this._sceneDeltaWriter.writeObject(dirtyObj)) {
+        // Some of its resources aren't ready yet, keep sending it until they are
+        dirtyObj.makeDirty();
+      }
     }
-    
-    const boundingBox = this.getVoxelGridBoundingBox();
-    const updatedRenderableVoxels = VTScene.getRenderableVoxels(childProcUpdate.renderables, boundingBox);
-    const chunkedChildProcData = this._chunkRenderableVoxels(updatedRenderableVoxels);
 
-    for (let i = 0; i < this.childProcesses.length; i++) {
-      const currChildProc = this.childProcesses[i];
+    this._updateRenderableVoxels(updatedRenderables);
 
-      const updateVoxelInfoObj = {reinit: reinitAll, mapping: chunkedChildProcData[i]};
-      if (!reinitAll) { updateVoxelInfoObj['updatedRenderableVoxels'] = updatedRenderableVoxels; }
-
-      currChildProc.send({type: VTRenderProc.TO_PROC_UPDATE_VOXEL_INFO, data: updateVoxelInfoObj});
-      currChildProc.send({type: VTRenderProc.TO_PROC_UPDATE_SCENE, data: childProcUpdate});
+    const update = this._sceneDeltaWriter.takeUpdate(reinitAll);
+    for (let i = 0; i < this.renderProcs.length; i++) {
+      this.renderProcs[i].postMessage({type: VTRenderProc.TO_PROC_UPDATE_SCENE, data: update});
     }
   }
 
-  static debugInspectIsOn() {
-    //console.log("DEBUG ON? " + process.execArgv.filter(arg => arg.indexOf('--inspect') !== -1).length > 0);
-    return process.execArgv.filter(arg => arg.indexOf('--inspect') !== -1).length > 0;
-  }
-
-  static calcNumChildProcesses() {
-    return (VTScene.debugInspectIsOn()) ? 1 : os.cpus().length;
-  }
-
-  _killChildProcesses() {
-    for (let i = 0; i < this.childProcesses.length; i++) {
-      if (!this.childProcesses[i].kill()) {
-        console.error("Failed to properly kill child process.");
-      }
+  _updateRenderableVoxels(updatedRenderables) {
+    if (updatedRenderables.length === 0) {
+      return;
     }
-    this.childProcesses = this.childProcesses.filter(c => !c.killed || c.connected);
-  }
-
-  _forkChildProcesses() {
-    const self = this;
 
-    const program = path.resolve('dist/vtrenderproc.js');
-    const programArgs = [];
-    const allChildsOptions = {
-      stdio: [0, 1, 2, 'ipc'],
-      execArgv: [],
-    };
-    
-    const CHILD_PROC_NAME = "VTRenderProc";
-    let childInspectPort = 31310;
-    const debugInspectIsOn = VTScene.debugInspectIsOn();
-    const numForks = VTScene.calcNumChildProcesses();
-    for (let i = 0; i < numForks; i++) {
-      // When debugging node applications we need to make sure each child process has its own inspect port assigned
-      // or the program will crash and burn
-      let childOptions = allChildsOptions;
-      if (debugInspectIsOn) {
-        childOptions = {...allChildsOptions,
-          execArgv: [...allChildsOptions.execArgv,
-            `--inspect=${childInspectPort++}`
-          ]
-        };
+    const boundingBox = this.getVoxelGridBoundingBox();
+    const lightPositions = this._lightPositions();
+    const xSize = this.voxelModel.xSize(), ySize = this.voxelModel.ySize(), zSize = this.voxelModel.zSize();
+    for (let i = 0; i < updatedRenderables.length; i++) {
+      // Get all of the voxels that collide with the renderable object
+      const renderable = updatedRenderables[i];
+      const voxelIdxs = renderable.getCollidingVoxels(boundingBox)
+        .filter(pt => pt.x >= 0 && pt.x < xSize && pt.y >= 0 && pt.y < ySize && pt.z >= 0 && pt.z < zSize)
+        .map(pt => VoxelGeometryUtils.voxelFlatIdx(pt, ySize, zSize));
+
+      // Invalidate the cached lighting of everything that the renderable could have changed, before and after
+      const prevVoxelIdxs = this._voxelIdxsByRenderable[renderable.id] || [];
+      if (this.lights.includes(renderable)) {
+        this._lightingCache.invalidateAll();
       }
-      
-      // This will fork off a new child render process
-      const childProc = fork(program, programArgs, childOptions);
-      this.childProcesses.push(childProc);
-      
-      // Setup the child process for various messages between it and this parent process
-      childProc.on('message', message => {
-        switch (message.type) {
-          case VTRenderProc.FROM_PROC_RENDERED:
-            self._renderFromChildProcData(message.data);
-            break;
-
-          default:
-            console.log(`Invalid message type recieved from ${CHILD_PROC_NAME}.`);
-            break;
+      else {
+        this._lightingCache.invalidateVoxels(prevVoxelIdxs);
+        this._lightingCache.invalidateVoxels(voxelIdxs);
+        if (renderable.isShadowCaster()) {
+          this._lightingCache.invalidateShadows(prevVoxelIdxs, lightPositions);
+          this._lightingCache.invalidateShadows(voxelIdxs, lightPositions);
         }
-      });
-
-      childProc.on('error', err => console.log(`${CHILD_PROC_NAME} error: ${err}`));
-      childProc.on('close', code => console.log(`${CHILD_PROC_NAME} has closed all stdio with code ${code}.`));
+      }
 
-      childProc.on('exit', code => {
-        console.log(`${CHILD_PROC_NAME} has exited with code ${code}.`);
-        // Remove the child process from the renderer
-        this.childProcesses = this.childProcesses.filter(c => c !== childProc);
-      });
+      if (voxelIdxs.length > 0) {
+        this._voxelIdxsByRenderable[renderable.id] = voxelIdxs;
+      }
+      else {
+        delete this._voxelIdxsByRenderable[renderable.id];
+      }
     }
-
-    this._initChildProcesses();
+    this._workQueueDirty = true;
   }
 
-  static getRenderableVoxels(visibleRenderables, boundingBox) {
+  _lightPositions() {
+    return this.lights.map(light => light.position);
+  }
 
-    let renderableVoxels = [];
-    for (let i = 0; i < visibleRenderables.length; i++) {
-      // Get all of the voxels that collide with the renderable object
-      const renderable = visibleRenderables[i];
-      const voxelPts = renderable.getCollidingVoxels(boundingBox);
-      if (voxelPts.length > 0) {
-        renderableVoxels.push.apply(renderableVoxels, voxelPts.map(vPt => ({voxelPt: vPt, renderableId: renderable.id})));
-      }
-    }
+  static debugInspectIsOn() {
+    //console.log("DEBUG ON? " + process.execArgv.filter(arg => arg.indexOf('--inspect') !== -1).length > 0);
+    return process.execArgv.filter(arg => arg.indexOf('--inspect') !== -1).length > 0;
+  }
 
-    return renderableVoxels;
+  static calcNumRenderProcs() {
+    return (VTScene.debugInspectIsOn()) ? 1 : os.cpus().length;
   }
 
-  _chunkRenderableVoxels(renderableVoxels) {
-    const numChildProcs = VTScene.calcNumChildProcesses();
-    if (renderableVoxels.length === 0) {
-      return new Array(numChildProcs).fill().map(() => ({}));
+  _stopRenderProcs() {
+    for (let i = 0; i < this.renderProcs.length; i++) {
+      this.renderProcs[i].terminate();
     }
+    this.renderProcs = [];
+    this._renderProcIdxs.clear();
+  }
 
-    // Ordering is important here - the children are only given the voxels in their respective intervals. These intervals are designated as
-    // the total number of voxels divided by the total number of children (if it's an uneven division then the last child gets the lesser quantity).
-    const numVoxels = this.voxelModel.numVoxels();
-    const numVoxelsPerProc = Math.ceil(numVoxels / numChildProcs);
-
-    const chunkedRenderData = new Array(numChildProcs).fill().map(() => ({}));
-    for (let i = 0; i < renderableVoxels.length; i++) {
-      const renderableVoxel = renderableVoxels[i];
-      const voxelIdx = VoxelGeometryUtils.voxelFlatIdx(renderableVoxel.voxelPt, this.voxelModel.gridSize);
-      if (voxelIdx >= 0 && voxelIdx < numVoxels) { 
-        const childProcIdx = Math.floor(voxelIdx / numVoxelsPerProc);
-        const childProcChunk = chunkedRenderData[childProcIdx];
-
-        if (!(renderableVoxel.renderableId in childProcChunk)) {
-          childProcChunk[renderableVoxel.renderableId] = [];
-        }
-        childProcChunk[renderableVoxel.renderableId].push(renderableVoxel.voxelPt);
-      }
+  _startRenderProcs() {
+    const program = path.resolve('dist/vtrenderproc.js');
+    const RENDER_PROC_NAME = "VTRenderProc";
+
+    const numRenderProcs = VTScene.calcNumRenderProcs();
+    for (let i = 0; i < numRenderProcs; i++) {
+      // Each render proc is a worker thread so that it can share the render buffer with us
+      const renderProc = new Worker(program);
+      this.renderProcs.push(renderProc);
+      this._renderProcIdxs.set(renderProc, i);
+
+      renderProc.on('error', err => console.log(`${RENDER_PROC_NAME} error: ${err}`));
+      renderProc.on('exit', code => {
+        console.log(`${RENDER_PROC_NAME} has exited with code ${code}.`);
+        // Remove the render proc from the renderer
+        this.renderProcs = this.renderProcs.filter(r => r !== renderProc);
+        this._renderProcIdxs.delete(renderProc);
+      });
     }
 
-    return chunkedRenderData;
+    this._initRenderProcs();
   }
 
-  _initChildProcesses() {
-    const numVoxels = this.voxelModel.numVoxels();
-    const numVoxelsPerProc = Math.ceil(numVoxels / this.childProcesses.length);
-
-    // Tell each of the child processes which voxel indices they're responsible for
-    for (let i = 0; i < this.childProcesses.length; i++) {
-      const currChildProc = this.childProcesses[i];
-      currChildProc.send({type: VTRenderProc.TO_PROC_INIT, data: {voxelIndexRange: [i*numVoxelsPerProc, i*numVoxelsPerProc + numVoxelsPerProc - 1], gridSize: this.voxelModel.gridSize}});
+  _initRenderProcs() {
+    // Share the work queue and render buffer with each of the render procs
+    for (let i = 0; i < this.renderProcs.length; i++) {
+      const currChildProc = this.renderProcs[i];
+      currChildProc.postMessage({type: VTRenderProc.TO_PROC_INIT, data: {
+        gridSize: [this.voxelModel.xSize(), this.voxelModel.ySize(), this.voxelModel.zSize()],
+        workerIdx: i,
+        numWorkers: this._workQueue.numWorkers,
+        workQueueBuffers: this._workQueue.getBuffers(),
+        renderBuffer: this._renderBuffer,
+        renderSync: this._renderSync,
+        lightingCacheValid: this._lightingCache.valid,
+      }});
     }
 
     this._updateChildRenderProcsFromScene(true);
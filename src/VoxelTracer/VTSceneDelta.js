@@ -0,0 +1,214 @@
+import * as THREE from 'three';
+
+import VTObject from './VTObject';
+
+const INITIAL_BUFFER_SIZE = 16*1024;
+
+/**
+ * Scene updates for the render procs are sent as a compact binary stream of records, written into a SharedArrayBuffer
+ * that all of the render procs read from (so nothing gets copied on its way to them). Each record is the object's
+ * type (see VTObject, as a char code) and ID followed by whatever parameters that type of object has (see the
+ * serialize/deserialize methods of the scene objects, lights and materials). Removed objects get a REMOVE_TYPE record.
+ *
+ * Big, rarely changing data (mesh geometry and texture images) isn't part of the stream: each one is uploaded to the
+ * render procs once, as a resource in shared memory, and records refer to it by its resource ID.
+ */
+export class VTSceneDeltaWriter {
+  static get REMOVE_TYPE() { return 'x'; }
+  static get TEXTURE_TYPE() { return 't'; } // Resource type of texture images, geometry uses VTObject.MESH_TYPE
+  static get NO_RESOURCE_ID() { return -1; }
+
+  constructor() {
+    this._setBuffer(new SharedArrayBuffer(INITIAL_BUFFER_SIZE));
+    this.offset = 0;
+    this._updateStart = 0;
+    this.resetResources();
+  }
+
+  // Where the writer is up to, see release
+  mark() {
+    return {buffer: this._buffer, offset: this.offset};
+  }
+
+  /**
+   * Let the buffer be reused once the render procs have read everything written before the given mark (e.g., once
+   * they've all finished rendering a frame). Anything written after it may still be unread and is kept where it is,
+   * so the buffer is only rewound when nothing has been written since.
+   */
+  release(mark) {
+    if (this._buffer === mark.buffer && this.offset === mark.offset) {
+      this.offset = 0;
+      this._updateStart = 0;
+    }
+  }
+
+  // Forget about all the uploaded resources, for when the render procs clear their scenes
+  resetResources() {
+    this._resourceIds = new WeakMap();
+    this._nextResourceId = 0;
+    this._resourceUploads = [];
+  }
+
+  /**
+   * Take everything written since the last update as an update for the render procs (see VTRPScene.applyUpdate).
+   */
+  takeUpdate(reinit) {
+    const update = {
+      reinit: reinit,
+      resources: this._resourceUploads,
+      buffer: this._buffer,
+      start: this._updateStart,
+      end: this.offset,
+    };
+    this._resourceUploads = [];
+    this._updateStart = this.offset;
+    return update;
+  }
+
+  /**
+   * Write the given scene object's record.
+   * @returns {Boolean} false if some of the object's resources aren't ready yet (e.g., its texture is still loading)
+   * and it will need to be written again later.
+   */
+  writeObject(obj) {
+    this._isComplete = true;
+    this.writeType(obj.type);
+    this.writeInt32(obj.id);
+    obj.serialize(this);
+    return this._isComplete;
+  }
+  writeRemove(id) {
+    this.writeType(VTSceneDeltaWriter.REMOVE_TYPE);
+    this.writeInt32(id);
+  }
+
+  writeType(type) { this.writeUint8(type.charCodeAt(0)); }
+  writeUint8(value) {
+    this._reserve(1);
+    this._view.setUint8(this.offset, value);
+    this.offset += 1;
+  }
+  writeInt32(value) {
+    this._reserve(4);
+    this._view.setInt32(this.offset, value, true);
+    this.offset += 4;
+  }
+  writeFloat64(value) {
+    this._reserve(8);
+    this._view.setFloat64(this.offset, value, true);
+    this.offset += 8;
+  }
+  writeBool(value) { this.writeUint8(value ? 1 : 0); }
+  writeVec3(v) { this.writeFloat64(v.x); this.writeFloat64(v.y); this.writeFloat64(v.z); }
+  writeColour(c) { this.writeFloat64(c.r); this.writeFloat64(c.g); this.writeFloat64(c.b); }
+  writeMatrix4(m) {
+    for (let i = 0; i < 16; i++) { this.writeFloat64(m.elements[i]); }
+  }
+
+  // Write the resource ID of the geometry, uploading it if this is the first time we've seen it
+  writeGeometry(geometry) {
+    let resourceId = this._resourceIds.get(geometry);
+    if (resourceId === undefined) {
+      const attributes = {};
+      Object.entries(geometry.attributes).forEach(entry => {
+        const [name, attribute] = entry;
+        attributes[name] = {array: VTSceneDeltaWriter._sharedCopy(attribute.array), itemSize: attribute.itemSize, normalized: attribute.normalized};
+      });
+      // N.B., The index isn't shared: each render proc builds a BVH for the geometry, which reorders the index
+      const index = geometry.index ? geometry.index.array.slice() : null;
+
+      resourceId = this._addResource(geometry, {type: VTObject.MESH_TYPE, attributes, index});
+    }
+    this.writeInt32(resourceId);
+  }
+
+  // Write the resource ID of the texture (if there is one), uploading it if this is the first time we've seen it
+  writeTexture(texture) {
+    let resourceId = VTSceneDeltaWriter.NO_RESOURCE_ID;
+    if (texture) {
+      if (texture.isLoaded()) {
+        resourceId = this._resourceIds.get(texture);
+        if (resourceId === undefined) {
+          const {data, shape, stride, offset} = texture.imgData;
+          resourceId = this._addResource(texture, {type: VTSceneDeltaWriter.TEXTURE_TYPE, data: VTSceneDeltaWriter._sharedCopy(data), shape, stride, offset});
+        }
+      }
+      else {
+        this._isComplete = false;
+      }
+    }
+    this.writeInt32(resourceId);
+  }
+
+  _addResource(obj, upload) {
+    const resourceId = this._nextResourceId++;
+    this._resourceIds.set(obj, resourceId);
+    this._resourceUploads.push({id: resourceId, ...upload});
+    return resourceId;
+  }
+
+  _setBuffer(buffer) {
+    this._buffer = buffer;
+    this._view = new DataView(buffer);
+  }
+
+  _reserve(numBytes) {
+    if (this.offset + numBytes <= this._buffer.byteLength) {
+      return;
+    }
+    // Anything not yet read by the render procs is still in the old buffer, the updates that refer to it keep it alive
+    const newBuffer = new SharedArrayBuffer(Math.max(2*this._buffer.byteLength, this.offset + numBytes));
+    const unsentBytes = new Uint8Array(this._buffer, this._updateStart, this.offset - this._updateStart);
+    new Uint8Array(newBuffer).set(unsentBytes);
+    this._setBuffer(newBuffer);
+    this.offset -= this._updateStart;
+    this._updateStart = 0;
+  }
+
+  static _sharedCopy(typedArray) {
+    const result = new typedArray.constructor(new SharedArrayBuffer(typedArray.byteLength));
+    result.set(typedArray);
+    return result;
+  }
+}
+
+export class VTSceneDeltaReader {
+  constructor(update) {
+    const {buffer, start, end} = update;
+    this._view = new DataView(buffer);
+    this.offset = start;
+    this._end = end;
+  }
+
+  hasMore() { return this.offset < this._end; }
+
+  readType() { return String.fromCharCode(this.readUint8()); }
+  readUint8() {
+    const value = this._view.getUint8(this.offset);
+    this.offset += 1;
+    return value;
+  }
+  readInt32() {
+    const value = this._view.getInt32(this.offset, true);
+    this.offset += 4;
+    return value;
+  }
+  readFloat64() {
+    const value = this._view.getFloat64(this.offset, true);
+    this.offset += 8;
+    return value;
+  }
+  readBool() { return this.readUint8() !== 0; }
+  readVec3() { return new THREE.Vector3(this.readFloat64(), this.readFloat64(), this.readFloat64()); }
+  readColour() { return new THREE.Color(this.readFloat64(), this.readFloat64(), this.readFloat64()); }
+  // The resource (uploaded to the render proc, see VTRPScene.addResources) with the ID that's next in the stream
+  readResource(resources) {
+    const resourceId = this.readInt32();
+    return (resourceId === VTSceneDeltaWriter.NO_RESOURCE_ID) ? null : resources[resourceId];
+  }
+  readMatrix4() {
+    const result = new THREE.Matrix4();
+    for (let i = 0; i < 16; i++) { result.elements[i] = this.readFloat64(); }
+    return result;
+  }
+}
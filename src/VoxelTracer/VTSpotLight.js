@@ -23,19 +23,23 @@ class VTSpotLight extends VTObject {
     this._isDirty = true;
   }
 
-  static build(jsonData) {
-    const {id, _position, _direction, _colour, _innerAngle, _outerAngle, _rangeAtten} = jsonData;
-    const result = new VTSpotLight(
-      new THREE.Vector3(_position.x, _position.y, _position.z),
-      new THREE.Vector3(_direction.x, _direction.y, _direction.z),
-      (new THREE.Color()).setHex(_colour), _innerAngle, _outerAngle, _rangeAtten
-    );
-    result.id = id;
-    return result;
+  static deserialize(reader) {
+    const position = reader.readVec3();
+    const direction = reader.readVec3();
+    const colour = reader.readColour();
+    const innerAngle = reader.readFloat64();
+    const outerAngle = reader.readFloat64();
+    const rangeAtten = {quadratic: reader.readFloat64(), linear: reader.readFloat64()};
+    return new VTSpotLight(position, direction, colour, innerAngle, outerAngle, rangeAtten);
   }
-  toJSON() {
-    const {id, type, _position, _direction, _colour, _innerAngle, _outerAngle, _rangeAtten} = this;
-    return {id, type,_position, _direction, _colour, _innerAngle, _outerAngle, _rangeAtten};
+  serialize(writer) {
+    writer.writeVec3(this._position);
+    writer.writeVec3(this._direction);
+    writer.writeColour(this._colour);
+    writer.writeFloat64(this._innerAngle);
+    writer.writeFloat64(this._outerAngle);
+    writer.writeFloat64(this._rangeAtten.quadratic);
+    writer.writeFloat64(this._rangeAtten.linear);
   }
 
   setPosition(p) { this._position = p; this.makeDirty(); }
@@ -51,19 +51,14 @@ class VTTexture {
     }
   }
 
-  static build(jsonData) {
-    if (!jsonData) { return null; }
-    const {imgData} = jsonData;
+  // Build the texture from its resource upload (see VTSceneDeltaWriter.writeTexture), the image data stays shared
+  static fromResource(resource) {
+    const {data, shape, stride, offset} = resource;
     const result = new VTTexture(null);
-    result.imgData = imgData;
+    result.imgData = ndarray(data, shape, stride, offset);
     return result;
   }
 
-  toJSON() {
-    const {imgData} = this;
-    return {imgData};
-  }
-
   isLoaded() {
     return this.imgData !== null;
   }
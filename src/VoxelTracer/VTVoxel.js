@@ -16,8 +16,9 @@ export class VTVoxelAbstract extends VTObject {
     this._matrixWorld = (options.matrixWorld !== undefined) ? options.matrixWorld : new THREE.Matrix4();
     this._receivesShadow = (options.receivesShadow !== undefined) ? options.receivesShadow : true;
 
-    // Temp variable for calculations
+    // Temp variables for calculations
     this._tempVec3 = new THREE.Vector3();
+    this._tempIntersectPt = new THREE.Vector3();
 
     this.computeBoundingBox();
   }
@@ -39,8 +40,22 @@ export class VTVoxelAbstract extends VTObject {
     this._boundingBox = VoxelGeometryUtils.singleVoxelBoundingBox(VoxelGeometryUtils.closestVoxelIdxPt(this._tempVec3));
   }
 
+  getWorldBoundingBox(target) {
+    return target.copy(this._boundingBox);
+  }
+
   intersectsRay(raycaster) {
-    return raycaster.ray.intersectsBox(this._boundingBox, this._tempVec3) !== null;
+    const {ray, near, far} = raycaster;
+    // A voxel doesn't block rays that start inside of it (e.g., the shadow rays of its own lighting)
+    if (this._boundingBox.containsPoint(ray.origin)) {
+      return false;
+    }
+    const hitPt = ray.intersectBox(this._boundingBox, this._tempIntersectPt);
+    if (hitPt === null) {
+      return false;
+    }
+    const distance = hitPt.distanceTo(ray.origin);
+    return distance >= near && distance <= far;
   }
 
   getCollidingVoxels(voxelBoundingBox=null) {
@@ -70,10 +85,11 @@ class VTVoxel extends VTVoxelAbstract  {
     return false;
   }
 
-  toJSON() {
-    const {id, type, _voxelIdxPt, _material, _matrixWorld, _receivesShadow} = this;
-    const matrixArray = _matrixWorld.toArray();
-    return {id, type, _voxelIdxPt, _material, matrixArray, _receivesShadow};
+  serialize(writer) {
+    writer.writeVec3(this._voxelIdxPt);
+    writer.writeMatrix4(this._matrixWorld);
+    writer.writeBool(this._receivesShadow);
+    this._material.serialize(writer);
   }
 
   intersectsBox(box) {
@@ -16,9 +16,10 @@ import SceneAnimCP from './SceneAnimCP';
 
 
 class MasterCP {
-  constructor(gridSize, controllerClient, soundManager) {
+  constructor(gridSizes, controllerClient, soundManager) {
 
-    this.gridSize = gridSize;
+    this.gridSizes = gridSizes; // [x,y,z] size of the grid, for controls of positions and sizes within it
+    this.gridSize = Math.max(...gridSizes); // Size of the cube that contains the whole grid, for everything else
     this.controllerClient = controllerClient;
     this.soundManager = soundManager;
 
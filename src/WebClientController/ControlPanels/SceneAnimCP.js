@@ -55,7 +55,7 @@ class SceneAnimCP extends AnimCP {
     const sceneTypeSubfolders = SCENE_TYPES.map(sceneType => {
       const subfolder = folder.addFolder({title: sceneType + " Settings"});
       const sceneSettings = self.settings[sceneType];
-      self._addSceneControls(subfolder, sceneSettings, sceneDefaultOptionsMap[sceneType].constraints);
+      self._addSceneControls(subfolder, sceneSettings, sceneDefaultOptionsMap[sceneType].constraints(self.masterCP.gridSizes));
       subfolder.hidden = true;
       folder.remove(subfolder);
       return subfolder;
@@ -6,7 +6,7 @@ import VoxelConstants from '../../VoxelConstants';
 
 class StarShowerAnimCP extends AnimCP {
   constructor(masterCP) {
-    super(masterCP, {...starShowerDefaultConfig});
+    super(masterCP, starShowerDefaultConfig(masterCP.gridSizes));
   }
 
   animatorType() { return VoxelAnimator.VOXEL_ANIM_TYPE_STAR_SHOWER; }
@@ -8,6 +8,7 @@ class ControllerClient {
     this.soundManager = soundManager;
     this.controlPanel = null;
     this.commEnabled = false;
+    this.serverAudio = false; // Whether the server has its own audio input, in which case ours isn't sent
   }
 
   start() {
@@ -48,15 +49,17 @@ class ControllerClient {
       case VoxelProtocol.SERVER_TO_CLIENT_WELCOME_HEADER:
         const welcomeDataObj = VoxelProtocol.getDataObjFromWelcomePacketStr(messageData);
         if (welcomeDataObj) {
-          const {gridSize, currentAnimatorType, currentAnimatorConfig, globalBrightness} = welcomeDataObj;
+          const {currentAnimatorType, currentAnimatorConfig, globalBrightness} = welcomeDataObj;
+          this.serverAudio = !!welcomeDataObj.serverAudio;
+          const gridSizes = welcomeDataObj.gridSize; // [x,y,z]
 
-          if (gridSize !== undefined && (!this.controlPanel || this.controlPanel.gridSize !== gridSize)) {
+          if (gridSizes !== undefined && (!this.controlPanel || this.controlPanel.gridSizes.join() !== gridSizes.join())) {
             console.log("Initializing Controls.");
             // Disable communication with the server while we (re)initialize the interface
             // otherwise we get a bunch of garbage requests going out from the controller while it initializes
             this.commEnabled  = false;
             if (this.controlPanel) { this.controlPanel.dispose(); }
-            this.controlPanel = new MasterCP(gridSize, this, this.soundManager);
+            this.controlPanel = new MasterCP(gridSizes, this, this.soundManager);
             this.commEnabled  = true;
           }
 
@@ -113,7 +116,7 @@ class ControllerClient {
     }
   }
   sendAudioInfo(audioInfo) {
-    if (this.socket.bufferedAmount === 0 && this.socket.readyState === WebSocket.OPEN) {
+    if (!this.serverAudio && this.socket.bufferedAmount === 0 && this.socket.readyState === WebSocket.OPEN) {
       this.socket.send(VoxelProtocol.buildClientPacketStrAudio(audioInfo));
     }
   }
@@ -1,14 +1,17 @@
 import VoxelProtocol from "../VoxelProtocol";
 
 const FRAMES_OUT_OF_SEQUENCE_BEFORE_RESET = 30;
+const FRAME_HISTORY = 16; // Frames kept for the server's deltas to be applied to, must match VIEWER_FRAME_HISTORY on the server
 
 class DisplayClient {
   constructor(voxelDisplay) {
     this.voxelDisplay = voxelDisplay;
     this.socket = new WebSocket('ws://' + VoxelProtocol.WEBSOCKET_HOST + ':' + VoxelProtocol.WEBSOCKET_PORT, VoxelProtocol.WEBSOCKET_PROTOCOL_VIEWER);
+    this.socket.binaryType = 'arraybuffer'; // Frames are read in the order they arrive, deltas depend on it
     this.lastFrameId = 0;
     this.consecutiveFramesOutofSequence = 0;
-    this.lastFrameHashCode = -1;
+    this.frameHistory = new Map(); // Frame ID -> bytes of the last FRAME_HISTORY frames, oldest first
+    this.keyframeRequested = false;
   }
 
   start() {
@@ -29,13 +32,7 @@ class DisplayClient {
         this.readPacket(event.data);
       }
       else {
-        const reader = new FileReader();
-        reader.addEventListener('loadend', () => {
-          const messageData = new Uint8Array(reader.result);
-          this.readPacket(messageData);
-        });
-
-        reader.readAsArrayBuffer(event.data);
+        this.readPacket(new Uint8Array(event.data));
       }
 
     }).bind(this));
@@ -49,11 +46,14 @@ class DisplayClient {
         const welcomeDataObj = VoxelProtocol.getDataObjFromWelcomePacketStr(messageData);
         if (welcomeDataObj) {
           const {gridSize} = welcomeDataObj;
-          if (gridSize !== undefined && gridSize !== this.voxelDisplay.gridSize) {
+          if (gridSize !== undefined && (gridSize[0] !== this.voxelDisplay.xSize() ||
+              gridSize[1] !== this.voxelDisplay.ySize() || gridSize[2] !== this.voxelDisplay.zSize())) {
             console.log("Resizing the voxel grid.");
-            this.voxelDisplay.rebuild(parseInt(gridSize));
+            this.voxelDisplay.rebuild(gridSize[0], gridSize[1], gridSize[2]);
           }
           this.lastFrameId = 0; // Reset the frame Id
+          this.frameHistory.clear();
+          this.keyframeRequested = false;
         }
         break;
         
@@ -72,13 +72,33 @@ class DisplayClient {
 
         switch (voxelDataType) {
           
-          case VoxelProtocol.VOXEL_DATA_ALL_TYPE:
+          case VoxelProtocol.VOXEL_DATA_ALL_TYPE: {
             //console.log("Recieved frame");
-            this.lastFrameHashCode = VoxelProtocol.readAndPaintVoxelDataAll(messageData, this.voxelDisplay, this.lastFrameHashCode);
-            if (this.lastFrameHashCode === -1) {
+            const frameLength = 3*this.voxelDisplay.xSize()*this.voxelDisplay.ySize()*this.voxelDisplay.zSize();
+            const frameBytes = VoxelProtocol.readViewerKeyframe(messageData, frameLength);
+            if (!frameBytes) {
               console.log("Invalid voxel (all) data.");
+              break;
+            }
+            this.keyframeRequested = false;
+            this.showFrame(packetFrameId, frameBytes);
+            break;
+          }
+
+          case VoxelProtocol.VOXEL_DATA_DELTA_TYPE: {
+            const baseFrameBytes = this.frameHistory.get(VoxelProtocol.readBaseFrameId(messageData));
+            const frameBytes = baseFrameBytes ? VoxelProtocol.readViewerDelta(messageData, baseFrameBytes) : null;
+            if (!frameBytes) {
+              // We can't rebuild this frame (or any after it that are based on it) until we get a keyframe
+              if (!this.keyframeRequested) {
+                console.log("Invalid voxel (delta) data, requesting a keyframe.");
+                this.sendKeyframeRequest();
+              }
+              break;
             }
+            this.showFrame(packetFrameId, frameBytes);
             break;
+          }
           
           default:
             console.log("Unimplemented protocol voxel data type: " + voxelDataType);
@@ -94,6 +114,29 @@ class DisplayClient {
     }
   }
 
+  /**
+   * Show a frame and keep it in the history for the deltas that follow, the server is told that we have it so it can
+   * base its deltas on it.
+   */
+  showFrame(frameId, frameBytes) {
+    this.frameHistory.delete(frameId);
+    this.frameHistory.set(frameId, frameBytes);
+    if (this.frameHistory.size > FRAME_HISTORY) {
+      this.frameHistory.delete(this.frameHistory.keys().next().value);
+    }
+    this.voxelDisplay.setVoxelBytes(frameBytes);
+    if (this.socket.readyState === WebSocket.OPEN) {
+      this.socket.send(VoxelProtocol.buildViewerFrameAckPacketStr(frameId));
+    }
+  }
+
+  sendKeyframeRequest() {
+    if (this.socket.readyState === WebSocket.OPEN) {
+      this.socket.send(VoxelProtocol.buildViewerKeyframeRequestPacketStr());
+      this.keyframeRequested = true;
+    }
+  }
+
   sendRequestFullStateUpdate() {
     if (this.socket.readyState === WebSocket.OPEN) {
       //this.socket.send(VoxelProtocol.buildClientPacketStr(VoxelProtocol.FULL_STATE_UPDATE_HEADER, null, null));
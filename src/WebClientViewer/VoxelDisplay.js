@@ -1,6 +1,7 @@
 import * as THREE from 'three';
 
 import VoxelConstants from '../VoxelConstants';
+import VoxelProtocol from '../VoxelProtocol';
 
 const DEFAULT_LED_POINT_SIZE = VoxelConstants.VOXEL_UNIT_SIZE * 1.33;
 
@@ -54,25 +55,24 @@ class VoxelDisplay {
     this.voxels = [];
   }
 
-  rebuild(gridSize) {
+  rebuild(xSize, ySize=xSize, zSize=xSize) {
 
     // Clean up any previous voxel grid
     this.removeVoxels();
 
-    const halfTranslationUnits = (gridSize*VoxelConstants.VOXEL_UNIT_SIZE)/2.0;
-    const worldTranslation = new THREE.Vector3(-halfTranslationUnits, -halfTranslationUnits, -halfTranslationUnits);
+    const halfTranslation = new THREE.Vector3(xSize, ySize, zSize).multiplyScalar(VoxelConstants.VOXEL_UNIT_SIZE/2.0);
+    const worldTranslation = halfTranslation.clone().negate();
 
-    this.gridSize = gridSize;
-    const numLEDs = this.gridSize*this.gridSize*this.gridSize;
+    const numLEDs = xSize*ySize*zSize;
 
     let ledPositions = new Float32Array(numLEDs*3);
     let ledColours   = new Float32Array(numLEDs*3).fill(1);
     let ledSizes     = new Float32Array(numLEDs).fill(DEFAULT_LED_POINT_SIZE * 0.5);
 
     let positionIdx = 0;
-    for (let x = 0; x < gridSize; x++) {
-      for (let y = 0; y < gridSize; y++) {
-        for (let z = 0; z < gridSize; z++) {
+    for (let x = 0; x < xSize; x++) {
+      for (let y = 0; y < ySize; y++) {
+        for (let z = 0; z < zSize; z++) {
 
           const currTranslation = new THREE.Vector3(
             x*VoxelConstants.VOXEL_UNIT_SIZE + VoxelConstants.VOXEL_UNIT_SIZE,
@@ -91,6 +91,7 @@ class VoxelDisplay {
     }
 
     this.colourBuffer = new THREE.BufferAttribute(ledColours, 3);
+    this.colourBuffer.setUsage(THREE.DynamicDrawUsage);
 
     // Add the LEDs to the scene
     let geometry = new THREE.BufferGeometry();
@@ -115,23 +116,23 @@ class VoxelDisplay {
     this._scene.add(this.leds);
 
     // Add wireframe outlines for all the cube boundaries of each LED within the array
-    let wfVertices = new Float32Array(Math.pow((this.gridSize + 1),3)*3*3*2);
-    let lineTranslation = halfTranslationUnits;
+    let wfVertices = new Float32Array((xSize + 1)*(ySize + 1)*(zSize + 1)*3*3*2);
+    const {x: lineTranslationX, y: lineTranslationY, z: lineTranslationZ} = halfTranslation;
     let idx = 0;
     const voxelUnitSize = VoxelConstants.VOXEL_UNIT_SIZE;
-    for (let x = 0; x <= this.gridSize; x++) {
-      for (let y = 0; y <= this.gridSize; y++) {
-        for (let z = 0; z <= this.gridSize; z++) {
+    for (let x = 0; x <= xSize; x++) {
+      for (let y = 0; y <= ySize; y++) {
+        for (let z = 0; z <= zSize; z++) {
           // Draw a line along the...
           // x-axis
-          wfVertices[idx++] = -lineTranslation; wfVertices[idx++] = -lineTranslation + y*voxelUnitSize; wfVertices[idx++] = -lineTranslation + z*voxelUnitSize;
-          wfVertices[idx++] = lineTranslation; wfVertices[idx++] = -lineTranslation + y*voxelUnitSize; wfVertices[idx++] = -lineTranslation + z*voxelUnitSize;
+          wfVertices[idx++] = -lineTranslationX; wfVertices[idx++] = -lineTranslationY + y*voxelUnitSize; wfVertices[idx++] = -lineTranslationZ + z*voxelUnitSize;
+          wfVertices[idx++] = lineTranslationX; wfVertices[idx++] = -lineTranslationY + y*voxelUnitSize; wfVertices[idx++] = -lineTranslationZ + z*voxelUnitSize;
           // y-axis
-          wfVertices[idx++] = -lineTranslation + x*voxelUnitSize; wfVertices[idx++] = -lineTranslation; wfVertices[idx++] = -lineTranslation + z*voxelUnitSize;
-          wfVertices[idx++] = -lineTranslation + x*voxelUnitSize; wfVertices[idx++] = lineTranslation; wfVertices[idx++] = -lineTranslation + z*voxelUnitSize;
+          wfVertices[idx++] = -lineTranslationX + x*voxelUnitSize; wfVertices[idx++] = -lineTranslationY; wfVertices[idx++] = -lineTranslationZ + z*voxelUnitSize;
+          wfVertices[idx++] = -lineTranslationX + x*voxelUnitSize; wfVertices[idx++] = lineTranslationY; wfVertices[idx++] = -lineTranslationZ + z*voxelUnitSize;
           // z-axis
-          wfVertices[idx++] = -lineTranslation + x*voxelUnitSize; wfVertices[idx++] = -lineTranslation + y*voxelUnitSize; wfVertices[idx++] = -lineTranslation;
-          wfVertices[idx++] = -lineTranslation + x*voxelUnitSize; wfVertices[idx++] = -lineTranslation + y*voxelUnitSize; wfVertices[idx++] = lineTranslation;
+          wfVertices[idx++] = -lineTranslationX + x*voxelUnitSize; wfVertices[idx++] = -lineTranslationY + y*voxelUnitSize; wfVertices[idx++] = -lineTranslationZ;
+          wfVertices[idx++] = -lineTranslationX + x*voxelUnitSize; wfVertices[idx++] = -lineTranslationY + y*voxelUnitSize; wfVertices[idx++] = lineTranslationZ;
         }
       }
     }
@@ -148,17 +149,17 @@ class VoxelDisplay {
     this.setOutlinesEnabled(this.outlinesEnabled);
     this.setOrbitModeEnabled(this.orbitModeEnabled);
 
-    for (let x = 0; x < this.gridSize; x++) {
+    for (let x = 0; x < xSize; x++) {
       let currXArr = [];
       this.voxels.push(currXArr);
-      for (let y = 0; y < this.gridSize; y++) {
+      for (let y = 0; y < ySize; y++) {
         let currYArr = [];
         currXArr.push(currYArr);
-        for (let z = 0; z < this.gridSize; z++) {
+        for (let z = 0; z < zSize; z++) {
 
           const currVoxelObj = {
             getColourIndex: function() {
-              return (x*self.gridSize*self.gridSize + y*self.gridSize + z)*3;
+              return ((x*ySize + y)*zSize + z)*3;
             },
             getColour: function() {
               const startIdx = this.getColourIndex();
@@ -168,12 +169,12 @@ class VoxelDisplay {
             setColourRGB: function(r, g, b) {
               const startIdx = this.getColourIndex();
               self.colourBuffer.set([r, g, b], startIdx);
-              self.colourBuffer.needsUpdate = true;
+              self._updateColours(startIdx, startIdx+3);
             },
             setColour: function(colour) { 
               const startIdx = this.getColourIndex();
               self.colourBuffer.set([colour.r, colour.g, colour.b], startIdx);
-              self.colourBuffer.needsUpdate = true;
+              self._updateColours(startIdx, startIdx+3);
             },
           };
 
@@ -233,6 +234,45 @@ class VoxelDisplay {
     } 
   }
 
+  /**
+   * Set the colours of all the voxels from a frame's bytes (see VoxelProtocol.buildViewerFrameBytes), only the voxels
+   * whose colours changed are written and only the span of the buffer between the first and last of them is uploaded.
+   */
+  setVoxelBytes(frameBytes) {
+    const colours = this.colourBuffer.array;
+    const length = Math.min(colours.length, frameBytes.length);
+    const byteToColour = VoxelProtocol.VIEWER_BYTE_TO_COLOUR;
+    let start = -1;
+    let end = -1;
+    for (let i = 0; i < length; i++) {
+      const colour = byteToColour[frameBytes[i]];
+      if (colours[i] !== colour) {
+        colours[i] = colour;
+        if (start === -1) { start = i; }
+        end = i;
+      }
+    }
+    if (start !== -1) {
+      this._updateColours(start, end+1);
+    }
+  }
+
+  // Flag a range of the colour buffer for upload, only the part of the buffer that changed since the last render is uploaded
+  _updateColours(start, end) {
+    const {updateRange} = this.colourBuffer;
+    if (updateRange.count === -1) {
+      // Nothing is waiting to be uploaded (three resets the range once it has been)
+      updateRange.offset = start;
+      updateRange.count = end - start;
+    }
+    else {
+      const rangeEnd = Math.max(updateRange.offset + updateRange.count, end);
+      updateRange.offset = Math.min(updateRange.offset, start);
+      updateRange.count = rangeEnd - updateRange.offset;
+    }
+    this.colourBuffer.needsUpdate = true;
+  }
+
   clearRGB(r=0, g=0, b=0) {
     for (let x = 0; x < this.voxels.length; x++) {
       for (let y = 0; y < this.voxels[x].length; y++) {
@@ -0,0 +1,74 @@
+#include "Arduino.h"
+#include "OctoWS2811.h"
+
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial(true);
+HardwareSerial Serial1;
+
+bool OctoWS2811::emulateTransferTime = true;
+uint32_t OctoWS2811::showCount = 0;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+uint32_t micros() {
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-startTime).count());
+}
+uint32_t millis() {
+  return micros() / 1000;
+}
+void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+  // Busy wait like the Teensy core does, sleeping would take far longer than a few microseconds
+  auto endTime = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+  while (std::chrono::steady_clock::now() < endTime) {}
+}
+
+#define NUM_PINS 64
+static uint8_t pinValues[NUM_PINS];
+static void (*pinInterrupts[NUM_PINS])(void);
+static int pinInterruptModes[NUM_PINS];
+static uint32_t pinFallingEdgeCounts[NUM_PINS];
+
+static void setPinValue(uint8_t pin, uint8_t value) {
+  if (pin >= NUM_PINS) { return; }
+  uint8_t prevValue = pinValues[pin];
+  pinValues[pin] = value;
+  if (value == prevValue) { return; }
+
+  bool falling = value == LOW;
+  if (falling) { pinFallingEdgeCounts[pin]++; }
+  int mode = pinInterruptModes[pin];
+  if (pinInterrupts[pin] && (mode == CHANGE || (mode == FALLING && falling) || (mode == RISING && !falling))) {
+    pinInterrupts[pin]();
+  }
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  // Like the Teensy 3.x core, which rewrites the pin's whole PORT_PCR register, this turns off any interrupt
+  // attached to the pin (it has to be attached again)
+  if (pin < NUM_PINS) { pinInterrupts[pin] = nullptr; }
+  // An input is read as high when pulled up and otherwise left as it was
+  if (mode == INPUT_PULLUP) { setPinValue(pin, HIGH); }
+}
+int digitalRead(uint8_t pin) {
+  return pin < NUM_PINS ? pinValues[pin] : LOW;
+}
+void digitalWrite(uint8_t pin, uint8_t value) {
+  setPinValue(pin, value);
+}
+
+void attachInterrupt(uint8_t pin, void (*function)(void), int mode) {
+  if (pin < NUM_PINS) { pinInterrupts[pin] = function; pinInterruptModes[pin] = mode; }
+}
+void detachInterrupt(uint8_t pin) {
+  if (pin < NUM_PINS) { pinInterrupts[pin] = nullptr; }
+}
+
+uint32_t hostFallingEdgeCount(uint8_t pin) {
+  return pin < NUM_PINS ? pinFallingEdgeCounts[pin] : 0;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+// Host (Linux) stand-in for the parts of the Teensy Arduino core that the slave firmware uses. This is only
+// ever compiled by host/Makefile, the Teensy build uses the real core through platformio.ini.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#define DMAMEM
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LOW 0
+#define HIGH 1
+#define CHANGE 2
+#define FALLING 3
+#define RISING 4
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+// Interrupt handlers are called right away (on the same thread) when a pin's level changes through
+// pinMode() or digitalWrite(), like a GPIO interrupt on a single core. pinMode() detaches the pin's handler,
+// as it does on the Teensy 3.x
+void attachInterrupt(uint8_t pin, void (*function)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+// Host-only: the number of falling edges seen on a pin so far
+uint32_t hostFallingEdgeCount(uint8_t pin);
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) { n += write(*buffer++); }
+    return n;
+  }
+
+  size_t print(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+  size_t print(int value) { return printf("%i", value); }
+  size_t println() { return print("\n"); }
+  size_t println(const char* str) { return print(str) + println(); }
+  size_t println(int value) { return print(value) + println(); }
+
+  size_t printf(const char* format, ...) __attribute__ ((format (printf, 2, 3))) {
+    char tempBuffer[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(tempBuffer, sizeof(tempBuffer), format, args);
+    va_end(args);
+    if (len <= 0) { return 0; }
+    return write((const uint8_t*)tempBuffer, static_cast<size_t>(len) < sizeof(tempBuffer) ? len : sizeof(tempBuffer)-1);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  virtual size_t readBytes(uint8_t* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && available() > 0) {
+      buffer[count++] = static_cast<uint8_t>(read());
+    }
+    return count;
+  }
+};
+
+/**
+ * Mock hardware serial port. Bytes pushed with feed() become readable in chunks of at most rxBufferSize
+ * bytes between calls to refill(), which is how the benchmark emulates the UART filling the RX FIFO/buffer
+ * between calls to loop(). Everything the firmware writes is kept in txBytes (or echoed to stdout).
+ */
+class HardwareSerial : public Stream {
+public:
+  HardwareSerial(bool echoToStdout = false) : rxBufferSize(64), echo(echoToStdout), quiet(false) {}
+
+  void begin(uint32_t baud) { (void)baud; }
+  void attachCts(uint8_t pin) { (void)pin; }
+  void attachRts(uint8_t pin) { (void)pin; }
+
+  int available() override { return static_cast<int>(rxReady.size()); }
+  int read() override {
+    if (rxReady.empty()) { return -1; }
+    uint8_t b = rxReady.front();
+    rxReady.pop_front();
+    return b;
+  }
+  int peek() override { return rxReady.empty() ? -1 : rxReady.front(); }
+
+  size_t write(uint8_t b) override {
+    if (echo) {
+      if (!quiet) { fputc(b, stdout); }
+    }
+    else {
+      txBytes.push_back(b);
+    }
+    return 1;
+  }
+  using Print::write;
+
+  // Host-only helpers for driving the mock
+  void feed(const uint8_t* buffer, size_t size) { rxPending.insert(rxPending.end(), buffer, buffer+size); }
+  size_t refill(size_t maxCount = static_cast<size_t>(-1)) {
+    size_t count = 0;
+    while (count < maxCount && rxReady.size() < rxBufferSize && !rxPending.empty()) {
+      rxReady.push_back(rxPending.front());
+      rxPending.pop_front();
+      count++;
+    }
+    return count;
+  }
+  size_t pending() const { return rxPending.size() + rxReady.size(); }
+
+  size_t rxBufferSize;
+  bool echo;
+  bool quiet;
+  std::vector<uint8_t> txBytes;
+
+private:
+  std::deque<uint8_t> rxPending;
+  std::deque<uint8_t> rxReady;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
@@ -0,0 +1,49 @@
+#pragma once
+
+// Host (Linux) stand-in for the OctoWS2811 library. show() copies the drawing memory into the display memory
+// just like the real library and, when emulateTransferTime is set, keeps busy() true for as long as the DMA
+// transfer of one frame to the WS2811 strips would take on the hardware (and blocks in show() while it's busy).
+
+#include "Arduino.h"
+
+#define WS2811_RGB 0
+#define WS2811_RBG 1
+#define WS2811_GRB 2
+#define WS2811_GBR 3
+#define WS2811_800kHz 0x00
+#define WS2811_400kHz 0x10
+
+class OctoWS2811 {
+public:
+  OctoWS2811(uint32_t numPerStrip, void* frameBuf, void* drawBuf, uint8_t config = WS2811_GRB) :
+    numPerStrip(numPerStrip), frameBuffer(frameBuf), drawBuffer(drawBuf), config(config), transferEndMicros(0) {}
+
+  void begin() { memset(frameBuffer, 0, numPerStrip*24); }
+
+  void show() {
+    while (busy()) {}
+    if (drawBuffer != frameBuffer) {
+      memcpy(frameBuffer, drawBuffer, numPerStrip*24);
+    }
+    if (emulateTransferTime) {
+      // 24 bits per LED at 800kHz is 30us, plus the 300us latch/reset time
+      transferEndMicros = micros() + numPerStrip*((config & WS2811_400kHz) ? 60 : 30) + 300;
+    }
+    showCount++;
+  }
+
+  int busy() { return emulateTransferTime && static_cast<int32_t>(transferEndMicros - micros()) > 0; }
+
+  void setPixel(uint32_t num, int color) { (void)num; (void)color; }
+  int numPixels() { return numPerStrip*8; }
+
+  static bool emulateTransferTime;
+  static uint32_t showCount;
+
+private:
+  uint32_t numPerStrip;
+  void* frameBuffer;
+  void* drawBuffer;
+  uint8_t config;
+  uint32_t transferEndMicros;
+};
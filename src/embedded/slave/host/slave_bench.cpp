@@ -0,0 +1,272 @@
+// Host benchmark for the slave firmware's receive path. The firmware is compiled as-is (against the stand-ins
+// in shim/) and fed a COBS encoded frame stream through the mock data serial port, either a raw capture of
+// what the server wrote to a slave's port or a synthetic stream of full and dirty row frames.
+//
+// Usage: slave_bench [options] [capture.bin]
+//   --frames N       Number of synthetic frames when no capture is given (default 2000)
+//   --dirty-rows N   Rows changed in each synthetic dirty frame, -1 for full frames only (default -1)
+//   --keyframe N     Synthetic full frame interval when sending dirty frames (default 60)
+//   --rx-chunk N     Size of the UART's RX buffer, the most bytes available to the firmware per loop() (default 64)
+//   --baud N         Emulate the UART receiving at N baud with flow control, 0 for as fast as possible (default 0)
+//   --sync           Enable frame sync mode, each synthetic frame is followed by a frame sync packet once the
+//                    firmware has acknowledged it and the next frame is only sent once the pulse is reported,
+//                    the same as the server does
+//   --raw            Send synthetic frames as raw colours, preceded by a gamma colour LUT with temporal dithering
+//   --no-dither      Turn off the temporal dithering for --raw
+//   --no-dma-wait    Don't emulate the time the LED DMA transfer takes in leds.show()
+//   --verbose        Echo the firmware's debug serial output
+
+#include "../src/main.cpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+#include <random>
+#include <string>
+
+static uint32_t decodedPacketCount = 0;
+
+static void benchPacketHandler(const void* sender, const uint8_t* buffer, size_t size) {
+  decodedPacketCount++;
+  onSerialPacketReceived(sender, buffer, size);
+}
+
+static void appendEncodedPacket(std::vector<uint8_t>& stream, const std::vector<uint8_t>& packet) {
+  std::vector<uint8_t> encoded(COBS::getEncodedBufferSize(packet.size()));
+  size_t numEncoded = COBS::encode(packet.data(), packet.size(), encoded.data());
+  stream.insert(stream.end(), encoded.begin(), encoded.begin()+numEncoded);
+  stream.push_back(0);
+}
+
+// In frame sync mode the frame sync packets aren't part of the stream, they're returned in syncPackets (one per
+// frame) to be fed as the firmware acknowledges each frame, which ends in the stream at frameEnds
+static size_t buildSyntheticStream(std::vector<uint8_t>& stream, int numFrames, int dirtyRows, int keyframeInterval, bool frameSync,
+                                   bool raw, bool dither, std::vector<size_t>& frameEnds,
+                                   std::vector<std::vector<uint8_t>>& syncPackets) {
+  std::mt19937 rng(1234);
+  std::vector<uint8_t> frame(OCTO_ROW_SIZE*ledsPerStrip);
+  std::vector<uint8_t> packet;
+
+  appendEncodedPacket(stream, {MY_SLAVE_ID, WELCOME_HEADER,
+    static_cast<uint8_t>(moduleYSize >> 8), static_cast<uint8_t>(moduleYSize & 0xFF),
+    static_cast<uint8_t>(moduleZSize >> 8), static_cast<uint8_t>(moduleZSize & 0xFF),
+    static_cast<uint8_t>(frameSync ? WELCOME_FLAG_FRAME_SYNC : 0)});
+  size_t numPackets = 1;
+
+  if (raw) {
+    packet.assign({MY_SLAVE_ID, COLOUR_LUT_TYPE, static_cast<uint8_t>(dither ? COLOUR_LUT_FLAG_DITHERING : 0)});
+    for (int c = 0; c < 3; c++) {
+      for (int i = 0; i < 256; i++) {
+        uint16_t value = static_cast<uint16_t>(255.0*256.0*pow(i/255.0, 2.24) + 0.5);
+        packet.push_back(static_cast<uint8_t>(value >> 8));
+        packet.push_back(static_cast<uint8_t>(value & 0xFF));
+      }
+    }
+    appendEncodedPacket(stream, packet);
+    appendEncodedPacket(stream, {MY_SLAVE_ID, BRIGHTNESS_TYPE, 0xC0, 0x00});
+    numPackets += 2;
+  }
+
+  for (int frameId = 0; frameId < numFrames; frameId++) {
+    bool isKeyframe = dirtyRows < 0 || (frameId % keyframeInterval) == 0;
+    packet.assign({MY_SLAVE_ID, 0, static_cast<uint8_t>((frameId >> 8) & 0xFF), static_cast<uint8_t>(frameId & 0xFF)});
+
+    if (isKeyframe) {
+      for (auto& b : frame) { b = static_cast<uint8_t>(rng()); }
+      packet[1] = raw ? VOXEL_DATA_RAW_TYPE : VOXEL_DATA_ALL_TYPE;
+      packet.insert(packet.end(), frame.begin(), frame.end());
+    }
+    else {
+      int baseFrameId = frameId-1;
+      packet[1] = VOXEL_DATA_DIRTY_TYPE;
+      packet.insert(packet.end(), {
+        static_cast<uint8_t>((baseFrameId >> 8) & 0xFF), static_cast<uint8_t>(baseFrameId & 0xFF),
+        static_cast<uint8_t>((dirtyRows >> 8) & 0xFF), static_cast<uint8_t>(dirtyRows & 0xFF)
+      });
+      for (int i = 0; i < dirtyRows; i++) {
+        int rowIdx = rng() % ledsPerStrip;
+        uint8_t* row = &frame[rowIdx*OCTO_ROW_SIZE];
+        for (int j = 0; j < OCTO_ROW_SIZE; j++) { row[j] = static_cast<uint8_t>(rng()); }
+        packet.push_back(static_cast<uint8_t>((rowIdx >> 8) & 0xFF));
+        packet.push_back(static_cast<uint8_t>(rowIdx & 0xFF));
+        packet.insert(packet.end(), row, row+OCTO_ROW_SIZE);
+      }
+    }
+    appendEncodedPacket(stream, packet);
+
+    if (frameSync) {
+      frameEnds.push_back(stream.size());
+      syncPackets.emplace_back();
+      appendEncodedPacket(syncPackets.back(), {FRAME_SYNC_MASTER_ID, FRAME_SYNC_TYPE, packet[2], packet[3]});
+    }
+  }
+
+  return numPackets + (frameSync ? 2*numFrames : numFrames);
+}
+
+// Count the messages starting with prefix that the firmware has written since the last call
+static size_t countNewTxMessages(const char* prefix, size_t& scanIdx) {
+  const std::vector<uint8_t>& tx = Serial1.txBytes;
+  size_t prefixLength = strlen(prefix);
+  size_t count = 0;
+  for (; scanIdx+prefixLength <= tx.size(); scanIdx++) {
+    if (memcmp(&tx[scanIdx], prefix, prefixLength) == 0) { count++; }
+  }
+  return count;
+}
+
+static size_t loadCapture(std::vector<uint8_t>& stream, const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "Failed to open capture file '%s'\n", path);
+    exit(1);
+  }
+  uint8_t chunk[4096];
+  size_t numRead = 0;
+  while ((numRead = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    stream.insert(stream.end(), chunk, chunk+numRead);
+  }
+  fclose(file);
+
+  size_t numPackets = 0;
+  for (auto b : stream) { if (b == 0) { numPackets++; } }
+  return numPackets;
+}
+
+int main(int argc, char** argv) {
+  int numFrames = 2000;
+  int dirtyRows = -1;
+  int keyframeInterval = 60;
+  int baud = 0;
+  bool frameSync = false;
+  bool raw = false;
+  bool dither = true;
+  const char* capturePath = nullptr;
+  Serial.quiet = true;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--frames" && i+1 < argc) { numFrames = atoi(argv[++i]); }
+    else if (arg == "--dirty-rows" && i+1 < argc) { dirtyRows = atoi(argv[++i]); }
+    else if (arg == "--keyframe" && i+1 < argc) { keyframeInterval = atoi(argv[++i]); }
+    else if (arg == "--rx-chunk" && i+1 < argc) { Serial1.rxBufferSize = atoi(argv[++i]); }
+    else if (arg == "--baud" && i+1 < argc) { baud = atoi(argv[++i]); }
+    else if (arg == "--sync") { frameSync = true; }
+    else if (arg == "--raw") { raw = true; }
+    else if (arg == "--no-dither") { dither = false; }
+    else if (arg == "--no-dma-wait") { OctoWS2811::emulateTransferTime = false; }
+    else if (arg == "--verbose") { Serial.quiet = false; }
+    else if (arg[0] != '-') { capturePath = argv[i]; }
+    else {
+      fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+      return 1;
+    }
+  }
+
+  std::vector<uint8_t> stream;
+  std::vector<size_t> frameEnds;
+  std::vector<std::vector<uint8_t>> syncPackets;
+  size_t numPackets = capturePath ? loadCapture(stream, capturePath) :
+    buildSyntheticStream(stream, numFrames, dirtyRows, keyframeInterval, frameSync, raw, dither, frameEnds, syncPackets);
+
+  setup();
+  myPacketSerial.setPacketHandler(&benchPacketHandler);
+  Serial1.feed(stream.data(), frameEnds.empty() ? stream.size() : frameEnds[0]);
+
+  // Frame sync handshake: the frame being synced, whether its sync packet was fed, and what the firmware reported
+  size_t syncFrameIdx = 0;
+  bool syncPacketFed = false;
+  size_t numAcksSeen = 0, numPulsesSeen = 0;
+  size_t ackScanIdx = 0, pulseScanIdx = 0;
+  uint32_t numIdleLoops = 0;
+  bool syncStalled = false;
+
+  // The latch latency is how long the loop() that received the last bytes of a frame took to show it
+  double totalLatchSecs = 0.0;
+  double maxLatchSecs = 0.0;
+  uint32_t numLatches = 0;
+  // In frame sync mode a frame should be shown in the loop() that saw the frame sync edge, unless the LEDs
+  // were still busy with the previous frame
+  uint32_t numDelayedLatches = 0;
+
+  // When emulating the baud rate the sender can't get ahead while the RX buffer is full (CTS/RTS flow control)
+  double bytesAllowance = 0.0;
+
+  auto startTime = std::chrono::steady_clock::now();
+  auto lastRefillTime = startTime;
+  while (Serial1.pending() > 0 || syncFrameIdx < frameEnds.size()) {
+    if (baud > 0) {
+      auto refillTime = std::chrono::steady_clock::now();
+      bytesAllowance += std::chrono::duration<double>(refillTime-lastRefillTime).count() * baud / 10.0;
+      lastRefillTime = refillTime;
+      bytesAllowance -= Serial1.refill(static_cast<size_t>(bytesAllowance));
+      if (bytesAllowance > Serial1.rxBufferSize) { bytesAllowance = Serial1.rxBufferSize; }
+    }
+    else {
+      Serial1.refill();
+    }
+
+    uint32_t prevShowCount = OctoWS2811::showCount;
+    uint32_t prevSyncCount = hostFallingEdgeCount(FRAME_SYNC_PIN);
+    auto loopStartTime = std::chrono::steady_clock::now();
+    loop();
+    if (OctoWS2811::showCount != prevShowCount) {
+      double latchSecs = std::chrono::duration<double>(std::chrono::steady_clock::now()-loopStartTime).count();
+      totalLatchSecs += latchSecs;
+      maxLatchSecs = latchSecs > maxLatchSecs ? latchSecs : maxLatchSecs;
+      numLatches++;
+      if (frameSyncEnabled && hostFallingEdgeCount(FRAME_SYNC_PIN) == prevSyncCount) {
+        numDelayedLatches++;
+      }
+    }
+
+    if (syncFrameIdx < frameEnds.size()) {
+      numAcksSeen += countNewTxMessages("FRAME_ACK ", ackScanIdx);
+      numPulsesSeen += countNewTxMessages("FRAME_SYNC ", pulseScanIdx);
+      if (!syncPacketFed && numAcksSeen > syncFrameIdx) {
+        Serial1.feed(syncPackets[syncFrameIdx].data(), syncPackets[syncFrameIdx].size());
+        syncPacketFed = true;
+        numIdleLoops = 0;
+      }
+      else if (syncPacketFed && numPulsesSeen > syncFrameIdx) {
+        syncFrameIdx++;
+        syncPacketFed = false;
+        numIdleLoops = 0;
+        if (syncFrameIdx < frameEnds.size()) {
+          Serial1.feed(&stream[frameEnds[syncFrameIdx-1]], frameEnds[syncFrameIdx] - frameEnds[syncFrameIdx-1]);
+        }
+      }
+      else if (Serial1.pending() == 0 && !leds.busy() && ++numIdleLoops > 100000) {
+        // The firmware is idle without having acknowledged the frame or reported the pulse
+        syncStalled = true;
+        break;
+      }
+    }
+  }
+  double totalSecs = std::chrono::duration<double>(std::chrono::steady_clock::now()-startTime).count();
+
+  printf("Module: %dx%d (%d LEDs per strip)\n", moduleYSize, moduleZSize, ledsPerStrip);
+  printf("Stream: %zu bytes, %zu packets%s\n", stream.size(), numPackets, capturePath ? " (capture)" : " (synthetic)");
+  printf("Elapsed: %.3f s\n", totalSecs);
+  printf("Decoded frames/sec: %.1f\n", decodedPacketCount / totalSecs);
+  printf("Bytes/sec: %.0f\n", stream.size() / totalSecs);
+  printf("Decoded packets: %u, LED shows: %u\n", decodedPacketCount, OctoWS2811::showCount);
+  printf("Dropped frames: %u (rejected by firmware), %u (superseded before being shown), %zu (lost before decode)\n",
+    droppedFrameCount, supersededFrameCount, numPackets > decodedPacketCount ? numPackets-decodedPacketCount : 0);
+  if (frameSyncEnabled) {
+    size_t numAcks = 0;
+    const char ackStr[] = "FRAME_ACK ";
+    for (size_t i = 0; i+sizeof(ackStr)-1 <= Serial1.txBytes.size(); i++) {
+      if (memcmp(&Serial1.txBytes[i], ackStr, sizeof(ackStr)-1) == 0) { numAcks++; }
+    }
+    printf("Frame sync: %zu frames acknowledged, %u sync pulses, %u shows delayed past their sync pulse%s\n",
+      numAcks, hostFallingEdgeCount(FRAME_SYNC_PIN), numDelayedLatches, syncStalled ? " (STALLED)" : "");
+  }
+  printf("Latch latency: %.2f us avg, %.2f us max\n", numLatches > 0 ? 1.0e6*totalLatchSecs/numLatches : 0.0, 1.0e6*maxLatchSecs);
+  for (led3d::ProfileCounter* counter = led3d::ProfileCounter::first(); counter != nullptr; counter = counter->next) {
+    printf("%s: %u calls, %.3f ms total, %.2f us/call\n", counter->name, counter->calls, counter->totalNanoSecs/1.0e6,
+      counter->calls > 0 ? counter->totalNanoSecs/(1.0e3*counter->calls) : 0.0);
+  }
+
+  return 0;
+}
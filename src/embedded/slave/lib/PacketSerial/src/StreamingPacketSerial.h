@@ -0,0 +1,313 @@
+//
+// Copyright (c) 2013 Christopher Baker <https://christopherbaker.net>
+//
+// SPDX-License-Identifier: MIT
+//
+
+
+#pragma once
+
+
+#include <Arduino.h>
+#include "Encoding/COBS.h"
+
+
+/// \brief A COBS packet serial class that decodes incoming bytes as they are read.
+///
+/// PacketSerial_ buffers each encoded packet and decodes it all at once when
+/// the packet marker arrives. This variant runs the COBS decoder on every
+/// chunk of bytes it reads instead, so the decode work is spread across the
+/// time it takes to receive the packet and only the last chunk is left to do
+/// once the packet marker arrives. Only the decoded bytes are ever stored.
+///
+/// The interface is the same as PacketSerial_, with the addition that the
+/// decode target handler is given the packet header as soon as it has been
+/// decoded and the rest of the packet is decoded straight into the buffer it
+/// returns.
+///
+/// \tparam PacketMarker The byte value used to mark the packet boundary.
+/// \tparam ReceiveBufferSize The number of bytes allocated for the decoded packet.
+template<uint8_t PacketMarker = 0, size_t ReceiveBufferSize = 256>
+class StreamingPacketSerial_
+{
+public:
+    /// \brief A typedef describing the packet handler method.
+    /// \sa PacketSerial_::PacketHandlerFunction
+    typedef void (*PacketHandlerFunction)(const uint8_t* buffer, size_t size);
+
+    /// \brief A typedef describing the packet handler method.
+    /// \sa PacketSerial_::PacketHandlerFunctionWithSender
+    typedef void (*PacketHandlerFunctionWithSender)(const void* sender, const uint8_t* buffer, size_t size);
+
+    /// \brief A typedef describing the decode target method.
+    ///
+    /// The decode target method has the form:
+    ///
+    ///     uint8_t* getDecodeTarget(const void* sender, const uint8_t* header, size_t headerSize, size_t* targetSize);
+    ///
+    /// where header is a pointer to the first headerSize decoded bytes of the
+    /// incoming packet. It returns the buffer that the whole packet (including
+    /// the header) will be decoded into and sets targetSize to its capacity,
+    /// or returns nullptr to keep decoding into the receive buffer.
+    typedef uint8_t* (*DecodeTargetFunction)(const void* sender, const uint8_t* header, size_t headerSize, size_t* targetSize);
+
+    /// \brief The maximum number of bytes read from the stream at once.
+    enum { ReadChunkSize = 64 };
+
+    /// \brief Construct a default StreamingPacketSerial_ device.
+    StreamingPacketSerial_()
+    {
+        resetPacket();
+    }
+
+    /// \brief Attach to an existing Arduino `Stream`.
+    /// \param stream A pointer to an Arduino `Stream`.
+    /// \sa PacketSerial_::setStream()
+    void setStream(Stream* stream)
+    {
+        _stream = stream;
+    }
+
+    /// \brief Get a pointer to the current stream.
+    /// \returns a non-const pointer to the stream, or nullptr if unset.
+    Stream* getStream()
+    {
+        return _stream;
+    }
+
+    /// \brief The update function services the serial connection.
+    ///
+    /// This must be called often, ideally once per `loop()`. All of the bytes
+    /// available on the stream are read in chunks of up to ReadChunkSize with
+    /// `readBytes()` and decoded right away.
+    void update()
+    {
+        if (_stream == nullptr) return;
+
+        uint8_t chunk[ReadChunkSize];
+        int numAvailable = 0;
+
+        while ((numAvailable = _stream->available()) > 0)
+        {
+            size_t numRead = _stream->readBytes(chunk, numAvailable < ReadChunkSize ? numAvailable : ReadChunkSize);
+            if (numRead == 0) break;
+
+            decodeChunk(chunk, numRead);
+        }
+    }
+
+    /// \brief Encode and send a packet of data.
+    /// \param buffer A pointer to a data buffer.
+    /// \param size The number of bytes in the data buffer.
+    /// \sa PacketSerial_::send()
+    void send(const uint8_t* buffer, size_t size) const
+    {
+        if(_stream == nullptr || buffer == nullptr || size == 0) return;
+
+        uint8_t _encodeBuffer[COBS::getEncodedBufferSize(size)];
+
+        size_t numEncoded = COBS::encode(buffer,
+                                         size,
+                                         _encodeBuffer);
+
+        _stream->write(_encodeBuffer, numEncoded);
+        _stream->write(PacketMarker);
+    }
+
+    /// \brief Set the function that will receive decoded packets.
+    /// \param onPacketFunction A pointer to the packet handler function.
+    /// \sa PacketSerial_::setPacketHandler()
+    void setPacketHandler(PacketHandlerFunction onPacketFunction)
+    {
+        _onPacketFunction = onPacketFunction;
+        _onPacketFunctionWithSender = nullptr;
+    }
+
+    /// \brief Set the function that will receive decoded packets.
+    /// \param onPacketFunctionWithSender A pointer to the packet handler function.
+    /// \sa PacketSerial_::setPacketHandler()
+    void setPacketHandler(PacketHandlerFunctionWithSender onPacketFunctionWithSender)
+    {
+        _onPacketFunction = nullptr;
+        _onPacketFunctionWithSender = onPacketFunctionWithSender;
+    }
+
+    /// \brief Set the function that chooses where packets are decoded to.
+    ///
+    /// The function is called once the first headerSize bytes of a packet
+    /// have been decoded. If it returns a buffer, those bytes are copied to it
+    /// and the rest of the packet is decoded straight into it as it arrives.
+    /// A packet that doesn't fit is truncated and flagged with overflow(). The
+    /// packet handler is still called with the decoded packet at the end.
+    ///
+    /// \param decodeTargetFunction A pointer to the decode target function.
+    /// \param headerSize The number of decoded bytes to give to the decode
+    ///        target function, at most ReceiveBufferSize.
+    void setDecodeTargetHandler(DecodeTargetFunction decodeTargetFunction, size_t headerSize)
+    {
+        _decodeTargetFunction = decodeTargetFunction;
+        _decodeTargetHeaderSize = headerSize < ReceiveBufferSize ? headerSize : ReceiveBufferSize;
+    }
+
+    /// \brief Check to see if the decoded packet overflowed its buffer.
+    ///
+    /// The state is reset every time a new packet marker is received NOT when
+    /// overflow() method is called.
+    ///
+    /// \returns true if the receive buffer (or decode target) overflowed.
+    bool overflow() const
+    {
+        return _recieveBufferOverflow;
+    }
+
+private:
+    StreamingPacketSerial_(const StreamingPacketSerial_&);
+    StreamingPacketSerial_& operator = (const StreamingPacketSerial_&);
+
+    void resetPacket()
+    {
+        _decodeBuffer = _receiveBuffer;
+        _decodeBufferSize = ReceiveBufferSize;
+        _decodeIndex = 0;
+        _blockRemaining = 0;
+        _blockCode = 0xFF;
+        _packetStarted = false;
+    }
+
+    void decodeChunk(const uint8_t* chunk, size_t size)
+    {
+        size_t i = 0;
+        while (i < size)
+        {
+            uint8_t data = chunk[i];
+
+            if (data == PacketMarker)
+            {
+                finishPacket();
+                i++;
+            }
+            else if (_blockRemaining == 0)
+            {
+                // This is a code byte: the previous block ended with a zero
+                // unless it was a full (0xFF) block.
+                if (_packetStarted && _blockCode != 0xFF)
+                {
+                    write(0);
+                }
+                _blockCode = data;
+                _blockRemaining = data > 0 ? data - 1 : 0;
+                _packetStarted = true;
+                i++;
+            }
+            else if (_decodeIndex < _decodeTargetHeaderSize)
+            {
+                // Still decoding the header, one byte at a time so the decode
+                // target can be chosen as soon as it's complete.
+                write(data);
+                _blockRemaining--;
+                i++;
+            }
+            else
+            {
+                // Copy as much of the current block as we have in one go,
+                // stopping early at any packet marker.
+                size_t count = size - i;
+                if (count > _blockRemaining) count = _blockRemaining;
+                const uint8_t* marker = static_cast<const uint8_t*>(memchr(&chunk[i], PacketMarker, count));
+                if (marker != nullptr) count = marker - &chunk[i];
+
+                write(&chunk[i], count);
+                _blockRemaining -= count;
+                i += count;
+            }
+        }
+    }
+
+    void write(uint8_t data)
+    {
+        if (_decodeIndex < _decodeBufferSize)
+        {
+            _decodeBuffer[_decodeIndex++] = data;
+            if (_decodeIndex == _decodeTargetHeaderSize)
+            {
+                chooseDecodeTarget();
+            }
+        }
+        else
+        {
+            _recieveBufferOverflow = true;
+        }
+    }
+
+    void write(const uint8_t* data, size_t count)
+    {
+        if (_decodeIndex + count > _decodeBufferSize)
+        {
+            count = _decodeBufferSize - _decodeIndex;
+            _recieveBufferOverflow = true;
+        }
+        memcpy(&_decodeBuffer[_decodeIndex], data, count);
+        _decodeIndex += count;
+    }
+
+    void chooseDecodeTarget()
+    {
+        if (_decodeTargetFunction == nullptr) return;
+
+        size_t targetSize = 0;
+        uint8_t* target = _decodeTargetFunction(this, _receiveBuffer, _decodeIndex, &targetSize);
+        if (target != nullptr && targetSize >= _decodeIndex)
+        {
+            memcpy(target, _receiveBuffer, _decodeIndex);
+            _decodeBuffer = target;
+            _decodeBufferSize = targetSize;
+        }
+    }
+
+    void finishPacket()
+    {
+        if (_packetStarted && (_onPacketFunction || _onPacketFunctionWithSender))
+        {
+            // A packet that ends in the middle of a block isn't valid COBS
+            size_t numDecoded = _blockRemaining == 0 ? _decodeIndex : 0;
+
+            if (_onPacketFunction)
+            {
+                _onPacketFunction(_decodeBuffer, numDecoded);
+            }
+            else if (_onPacketFunctionWithSender)
+            {
+                _onPacketFunctionWithSender(this, _decodeBuffer, numDecoded);
+            }
+        }
+
+        resetPacket();
+        _recieveBufferOverflow = false;
+    }
+
+    bool _recieveBufferOverflow = false;
+
+    uint8_t _receiveBuffer[ReceiveBufferSize];
+
+    // Where the current packet is being decoded to, either the receive buffer or a decode target
+    uint8_t* _decodeBuffer = nullptr;
+    size_t _decodeBufferSize = 0;
+    size_t _decodeIndex = 0;
+
+    // COBS decoder state: the current block's code and how many of its bytes are still to come
+    uint8_t _blockCode = 0xFF;
+    size_t _blockRemaining = 0;
+    bool _packetStarted = false;
+
+    Stream* _stream = nullptr;
+
+    PacketHandlerFunction _onPacketFunction = nullptr;
+    PacketHandlerFunctionWithSender _onPacketFunctionWithSender = nullptr;
+
+    DecodeTargetFunction _decodeTargetFunction = nullptr;
+    size_t _decodeTargetHeaderSize = 0;
+};
+
+
+/// \brief A typedef for a streaming PacketSerial type with COBS encoding.
+typedef StreamingPacketSerial_<> StreamingCOBSPacketSerial;
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "comm.h"
+
+namespace led3d {
+
+  /**
+   * Per channel lookup table from the raw (linear) colours that the server sends to the LED output colours.
+   * The server uploads a 256 entry curve for each channel (gamma and colour correction) and a global brightness,
+   * which scales the linear input before it goes through the curve. The looked up values are 8.8 fixed point so
+   * that temporal dithering can recover the fraction that's lost when the output is cut down to 8 bits.
+   */
+  class ColourLUT {
+  public:
+    static const int NUM_CHANNELS = 3;
+    static const int NUM_ENTRIES  = 256;
+
+    ColourLUT() : brightnessScale(0x10000), dithering(false) {
+      for (int c = 0; c < NUM_CHANNELS; c++) {
+        for (int i = 0; i < NUM_ENTRIES; i++) { curves[c][i] = static_cast<uint16_t>(i << 8); }
+      }
+      rebuild();
+    }
+
+    // Set every channel's curve from NUM_CHANNELS*NUM_ENTRIES big endian 8.8 fixed point values
+    void setCurves(const uint8_t* values) {
+      for (int c = 0; c < NUM_CHANNELS; c++) {
+        for (int i = 0; i < NUM_ENTRIES; i++, values += 2) {
+          curves[c][i] = static_cast<uint16_t>((values[0] << 8) | values[1]);
+        }
+      }
+      rebuild();
+    }
+
+    // Brightness in [0,1] as [0,0xFFFF]
+    void setBrightness(uint16_t brightness) {
+      brightnessScale = brightness + (brightness >> 15);
+      rebuild();
+    }
+
+    void setDithering(bool enabled) { dithering = enabled; }
+    bool isDithering() const { return dithering; }
+
+    uint16_t lookup(int channel, uint8_t value) const { return table[channel][value]; }
+
+  private:
+    void rebuild() {
+      // Interpolate each curve at value*brightness
+      for (int c = 0; c < NUM_CHANNELS; c++) {
+        for (int i = 0; i < NUM_ENTRIES; i++) {
+          uint32_t pos = static_cast<uint32_t>(i) * brightnessScale;
+          uint32_t idx = pos >> 16;
+          int32_t frac = static_cast<int32_t>(pos & 0xFFFF);
+          int32_t a = curves[c][idx];
+          int32_t b = idx+1 < NUM_ENTRIES ? curves[c][idx+1] : a;
+          table[c][i] = static_cast<uint16_t>(a + (((b - a) * frac) >> 16));
+        }
+      }
+    }
+
+    uint16_t curves[NUM_CHANNELS][NUM_ENTRIES];
+    uint16_t table[NUM_CHANNELS][NUM_ENTRIES];
+    uint32_t brightnessScale; // 16.16 fixed point
+    bool dithering;
+  };
+
+  /**
+   * Turn a row of raw colours (r,g,b for each of the NUM_OCTO_PINS pins) into a row of OCTO_ROW_SIZE bytes in the
+   * bit-transposed OctoWS2811 layout: byte k of each channel has bit (7-k) of that channel for every pin (pin i in bit i).
+   * When residuals is given (OCTO_ROW_SIZE bytes kept between frames) the fraction that each output value loses is
+   * carried over to the next time the row is rendered, so that over a few frames the LEDs average out to the exact value.
+   */
+  inline void renderOctoRow(const ColourLUT& lut, const uint8_t* rawRow, uint8_t* residuals, uint8_t* octoRow) {
+    uint8_t channels[ColourLUT::NUM_CHANNELS][NUM_OCTO_PINS];
+    for (int i = 0; i < NUM_OCTO_PINS; i++) {
+      for (int c = 0; c < ColourLUT::NUM_CHANNELS; c++) {
+        uint32_t value = lut.lookup(c, rawRow[i*3 + c]);
+        if (residuals) {
+          value += residuals[i*3 + c];
+          residuals[i*3 + c] = static_cast<uint8_t>(value);
+        }
+        else {
+          value += 0x80;
+        }
+        value >>= 8;
+        channels[c][i] = static_cast<uint8_t>(value > 255 ? 255 : value);
+      }
+    }
+
+    // 8x8 bit transpose of each channel (see Hacker's Delight), the pins go in backwards so that pin i ends up in bit i
+    for (int c = 0; c < ColourLUT::NUM_CHANNELS; c++) {
+      const uint8_t* a = channels[c];
+      uint32_t x = (a[7] << 24) | (a[6] << 16) | (a[5] << 8) | a[4];
+      uint32_t y = (a[3] << 24) | (a[2] << 16) | (a[1] << 8) | a[0];
+      uint32_t t;
+      t = (x ^ (x >> 7)) & 0x00AA00AA;  x = x ^ t ^ (t << 7);
+      t = (y ^ (y >> 7)) & 0x00AA00AA;  y = y ^ t ^ (t << 7);
+      t = (x ^ (x >> 14)) & 0x0000CCCC; x = x ^ t ^ (t << 14);
+      t = (y ^ (y >> 14)) & 0x0000CCCC; y = y ^ t ^ (t << 14);
+      t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+      y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+      x = t;
+
+      uint8_t* out = &octoRow[c*NUM_OCTO_PINS];
+      out[0] = x >> 24; out[1] = x >> 16; out[2] = x >> 8; out[3] = x;
+      out[4] = y >> 24; out[5] = y >> 16; out[6] = y >> 8; out[7] = y;
+    }
+  }
+
+};
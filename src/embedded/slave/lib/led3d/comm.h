@@ -5,22 +5,61 @@
 #include "voxel.h"
 
 #include <vector>
-#include <PacketSerial.h>
+#include <StreamingPacketSerial.h>
 
 // Serial Protocol Constants and Variables ***********************************************
 #define MAX_BUFFER_LOOKAHEAD 32
 #define NUM_OCTO_PINS 8
-// The serial buffer will need to be large in order to hold a full COBs encoded frame plus lookahead
-#define PACKET_BUFFER_MAX_SIZE (NUM_OCTO_PINS * MAX_VOXEL_CUBE_SIZE * MAX_VOXEL_CUBE_SIZE * 3 + 4 + MAX_BUFFER_LOOKAHEAD)
+#define OCTO_ROW_SIZE (NUM_OCTO_PINS * 3) // Bytes for a single bit-transposed LED index across all of the octo pins
 #define USB_SERIAL_BAUD 9600
 #define HW_SERIAL_BAUD 3000000
 
 // Packet Header/Identifier Constants
 #define WELCOME_HEADER 'W'
 #define VOXEL_DATA_ALL_TYPE 'A'
+#define VOXEL_DATA_DIRTY_TYPE 'P'
+#define FRAME_SYNC_TYPE 'S'
+#define VOXEL_DATA_RAW_TYPE 'R'
+#define COLOUR_LUT_TYPE 'G'
+#define BRIGHTNESS_TYPE 'B'
+
+// The welcome header has the module's big endian y and z sizes, followed by an (optional) byte of flags
+#define WELCOME_SIZES_SIZE 4
+#define WELCOME_FLAG_FRAME_SYNC 0x01
+
+// In frame sync mode the slaves only show a frame once the sync master pulls the shared frame sync line low,
+// the server tells it to do so with a FRAME_SYNC_TYPE packet once every slave has acknowledged the frame
+#define FRAME_SYNC_MASTER_ID 0
+#define FRAME_SYNC_PULSE_MICROSECS 5
+
+// Full voxel data packets start with the slave ID, type and frame ID
+#define VOXEL_DATA_ALL_HEADER_SIZE 4
+
+// Dirty (changed rows only) voxel data packets have a base frame ID and a row count after the frame ID,
+// followed by each row's index and its OCTO_ROW_SIZE bytes of data
+#define VOXEL_DATA_DIRTY_HEADER_SIZE 4
+#define VOXEL_DATA_DIRTY_ROW_SIZE (2 + OCTO_ROW_SIZE)
+
+// Raw voxel data packets have the same header and size as full voxel data packets, but each row holds the linear
+// r,g,b of each octo pin in turn, the slave applies its colour LUT (see colour.h) and does the bit-transposing.
+// Dirty voxel data packets patch whichever kind of frame they're based on.
+
+// Colour LUT packets have a flags byte followed by a 256 entry curve of big endian 8.8 fixed point values for
+// each of r, g and b. Brightness packets have a big endian brightness in [0,0xFFFF].
+#define COLOUR_LUT_FLAG_DITHERING 0x01
+#define COLOUR_LUT_SIZE (1 + 3*256*2)
+#define BRIGHTNESS_SIZE 2
 
 #define EMPTY_SLAVE_ID 255
 
 namespace led3d {
-  typedef PacketSerial_<COBS, 0, PACKET_BUFFER_MAX_SIZE> LED3DPacketSerial;
+  // The serial buffer will need to be large in order to hold a full decoded frame plus lookahead
+  constexpr size_t packetBufferSize(size_t ledsPerStrip) {
+    return NUM_OCTO_PINS*ledsPerStrip*3 + VOXEL_DATA_ALL_HEADER_SIZE + MAX_BUFFER_LOOKAHEAD;
+  }
+
+  template<size_t ledsPerStrip>
+  using LED3DPacketSerial_ = StreamingPacketSerial_<0, packetBufferSize(ledsPerStrip)>;
+
+  typedef LED3DPacketSerial_<VOXEL_MODULE_Y_SIZE*VOXEL_MODULE_Z_SIZE> LED3DPacketSerial;
 };
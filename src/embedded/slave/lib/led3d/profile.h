@@ -0,0 +1,46 @@
+#pragma once
+
+// Scoped timing hooks for the slave's receive path. These compile away to nothing on the Teensy, the host
+// build (see host/Makefile) defines LED3D_PROFILE so that the benchmark can report where the time is spent.
+#ifdef LED3D_PROFILE
+
+#include <stdint.h>
+#include <chrono>
+
+namespace led3d {
+
+  struct ProfileCounter {
+    ProfileCounter(const char* name) : name(name), totalNanoSecs(0), calls(0), next(first()) { first() = this; }
+
+    // All counters that have been hit at least once, as a linked list
+    static ProfileCounter*& first() { static ProfileCounter* firstCounter = nullptr; return firstCounter; }
+
+    const char* name;
+    uint64_t totalNanoSecs;
+    uint32_t calls;
+    ProfileCounter* next;
+  };
+
+  class ProfileScope {
+  public:
+    ProfileScope(ProfileCounter& counter) : counter(counter), start(std::chrono::steady_clock::now()) {}
+    ~ProfileScope() {
+      counter.totalNanoSecs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count();
+      counter.calls++;
+    }
+  private:
+    ProfileCounter& counter;
+    std::chrono::steady_clock::time_point start;
+  };
+
+};
+
+#define LED3D_PROFILE_SCOPE(name) \
+  static led3d::ProfileCounter name##ProfileCounter(#name); \
+  led3d::ProfileScope name##ProfileScope(name##ProfileCounter)
+
+#else
+
+#define LED3D_PROFILE_SCOPE(name)
+
+#endif
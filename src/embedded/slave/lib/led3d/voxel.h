@@ -21,7 +21,7 @@
  * SLAVE_IDX = (x / NUM_OCTO_PINS)
  * 
  * LED index (from the cube's x,y,z coordinates):
- * LED_IDX = SLAVE_STRIP_IDX*voxelCubeSize*voxelCubeSize + z*voxelCubeSize + y
+ * LED_IDX = SLAVE_STRIP_IDX*VOXEL_MODULE_Y_SIZE*VOXEL_MODULE_Z_SIZE + z*VOXEL_MODULE_Y_SIZE + y
  * 
  * If you were to then draw the vertical axis it would be the y-axis coming off the ground towards the sky,
  * these represent the vertical columns.
@@ -31,5 +31,13 @@
  * 
  */
 
-#define DEFAULT_VOXEL_CUBE_SIZE 16
-#define MAX_VOXEL_CUBE_SIZE 16
+// The y and z sizes of the module driven by each slave (the whole grid's y and z sizes, the x size is tiled across
+// slaves), set them for a different grid with build flags, e.g., -DVOXEL_MODULE_Y_SIZE=16 -DVOXEL_MODULE_Z_SIZE=32.
+// Every buffer is sized by the strip length (y*z LEDs) at compile time, which costs about 120 bytes of RAM per LED
+// in a strip: a Teensy 3.6 fits modules of up to 32x32.
+#ifndef VOXEL_MODULE_Y_SIZE
+#define VOXEL_MODULE_Y_SIZE 16
+#endif
+#ifndef VOXEL_MODULE_Z_SIZE
+#define VOXEL_MODULE_Z_SIZE 16
+#endif
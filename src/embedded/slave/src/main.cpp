@@ -2,6 +2,8 @@
 
 #include "../lib/led3d/voxel.h"
 #include "../lib/led3d/comm.h"
+#include "../lib/led3d/colour.h"
+#include "../lib/led3d/profile.h"
 
 #define BOOL_TO_STRING(b) (b ? "true" : "false")
 
@@ -18,47 +20,96 @@ led3d::LED3DPacketSerial myPacketSerial;
 #define STATUS_UPDATE_FRAMES 400
 
 static int lastKnownFrameId = -1;
+static int lastAppliedFrameId = -1;
+static bool keyframeRequested = false;
 static uint32_t lastFrameTimeMicroSecs = 0;
 static uint32_t frameDiffMicroSecs = 0;
 static int statusUpdateFrameCounter = 0;
+static uint32_t droppedFrameCount = 0;
+static uint32_t supersededFrameCount = 0;
+
+// In frame sync mode (set by the server in the welcome header) frames are staged until the frame sync line
+// is pulled low, so that every slave shows its part of the same frame at the same time
+static bool frameSyncEnabled = false;
+static volatile bool frameSyncPending = false;
+// The staged frame is only acknowledged once the LEDs are done showing the previous one, so that every slave can
+// latch it the moment the line is pulsed
+static int pendingAckFrameId = -1;
 
 
 // OCTOWS2811 Constants/Variables *******************************************************
 const int octoConfig = WS2811_800kHz; // All other settings are done on the server/computer that feeds the data
 
-const int voxelCubeSize = DEFAULT_VOXEL_CUBE_SIZE;
-const int ledsPerModule = NUM_OCTO_PINS * voxelCubeSize * voxelCubeSize;
-const int ledsPerStrip  = voxelCubeSize * voxelCubeSize;
+const int moduleYSize   = VOXEL_MODULE_Y_SIZE;
+const int moduleZSize   = VOXEL_MODULE_Z_SIZE;
+const int ledsPerModule = NUM_OCTO_PINS * moduleYSize * moduleZSize;
+const int ledsPerStrip  = moduleYSize * moduleZSize;
+static_assert(ledsPerStrip <= 0xFFFF, "Dirty voxel data packets address rows with 16 bit indices.");
 
 DMAMEM int displayMemory[ledsPerStrip*6];
-int drawingMemory[ledsPerStrip*6];
 
-OctoWS2811 leds(ledsPerStrip, displayMemory, drawingMemory, octoConfig);
+// Frames are received into one of two frame buffers while the newest complete frame sits in the other one,
+// waiting for the LEDs to finish showing the previous frame (see showLatestFrame). Full voxel data packets are
+// decoded straight into the receiving frame buffer (see getDecodeTarget), with the packet header landing in
+// the bytes right in front of its LED data.
+struct FrameBuffer {
+  uint8_t packetHeader[VOXEL_DATA_ALL_HEADER_SIZE];
+  int memory[ledsPerStrip*6];
+  bool raw; // Whether the memory holds raw colours (see VOXEL_DATA_RAW_TYPE) rather than the OctoWS2811 layout
+};
+static_assert(offsetof(FrameBuffer, memory) == VOXEL_DATA_ALL_HEADER_SIZE, "Frame memory must directly follow the packet header.");
+
+#define NUM_FRAME_BUFFERS 2
+static FrameBuffer frameBuffers[NUM_FRAME_BUFFERS];
+static int latestFrameBufferIdx = -1;
+static bool latestFrameShown = true;
+
+// Raw frames go through the colour LUT on their way to the display memory, with the dithering residuals of each
+// LED colour channel carried from one refresh to the next
+static led3d::ColourLUT colourLUT;
+static uint8_t ditherResiduals[ledsPerStrip*OCTO_ROW_SIZE];
+static bool colourLUTChanged = false;
+
+// The display memory is also used as the drawing memory: frames are copied into it from the frame buffers
+// only while the DMA is idle, which saves show() from copying them a second time
+OctoWS2811 leds(ledsPerStrip, displayMemory, displayMemory, octoConfig);
 // **************************************************************************************
 
-void reinit(uint8_t cubeSize, bool force=false) {
+void reinit(uint16_t ySize, uint16_t zSize) {
   lastKnownFrameId = -1;
+  lastAppliedFrameId = -1;
+  keyframeRequested = false;
   statusUpdateFrameCounter = 0;
   lastFrameTimeMicroSecs = 0;
+  frameSyncPending = false;
+  pendingAckFrameId = -1;
 
-  if (cubeSize != voxelCubeSize) {
-    DEBUG_SERIAL.print("Invalid cube size, this board was designed to drive a cube size of "); Serial.println(voxelCubeSize);
+  if (ySize != moduleYSize || zSize != moduleZSize) {
+    DEBUG_SERIAL.printf("[Slave %i] Invalid module size %ix%i, this board was built to drive a module size of %ix%i (see voxel.h)",
+      MY_SLAVE_ID, ySize, zSize, moduleYSize, moduleZSize);
+    DEBUG_SERIAL.println();
     return;
   }
 }
 
 void readWelcomeHeader(const uint8_t* buffer, size_t size, size_t startIdx) {
   DEBUG_SERIAL.printf("[Slave %i] Welcome Header / Init data recieved on slave.", MY_SLAVE_ID); DEBUG_SERIAL.println();
-  if (size >= 1) {
-    // There's only one byte and it defines the y module size
-    uint8_t newCubeSize = buffer[startIdx];
-    if (newCubeSize > 0) {
-      reinit(newCubeSize);
+  if (size >= WELCOME_SIZES_SIZE) {
+    // The y and z module sizes, optionally followed by a byte of flags
+    uint16_t newYSize = static_cast<uint16_t>((buffer[startIdx] << 8) + buffer[startIdx+1]);
+    uint16_t newZSize = static_cast<uint16_t>((buffer[startIdx+2] << 8) + buffer[startIdx+3]);
+    frameSyncEnabled = size > WELCOME_SIZES_SIZE && (buffer[startIdx+WELCOME_SIZES_SIZE] & WELCOME_FLAG_FRAME_SYNC) != 0;
+    DEBUG_SERIAL.printf("[Slave %i] Frame sync: %s", MY_SLAVE_ID, BOOL_TO_STRING(frameSyncEnabled)); DEBUG_SERIAL.println();
+    if (newYSize > 0 && newZSize > 0) {
+      reinit(newYSize, newZSize);
     }
     else {
-      DEBUG_SERIAL.printf("[Slave %i] ERROR: Received module cube side that was zero, ignoring.", MY_SLAVE_ID); DEBUG_SERIAL.println();
+      DEBUG_SERIAL.printf("[Slave %i] ERROR: Received a module size of zero, ignoring.", MY_SLAVE_ID); DEBUG_SERIAL.println();
     }
   }
+  else {
+    DEBUG_SERIAL.printf("[Slave %i] ERROR: Welcome header is too short, ignoring.", MY_SLAVE_ID); DEBUG_SERIAL.println();
+  }
   lastKnownFrameId = -1;
 }
 
@@ -66,49 +117,253 @@ int getFrameId(const uint8_t* buffer, size_t size) {
   return size > 3 ? static_cast<uint16_t>((buffer[2] << 8) + buffer[3]) : 0;
 }
 
-void readFullVoxelData(const uint8_t* buffer, size_t size, size_t startIdx, int frameId) {
+bool isValidFrameOrdering(int frameId) {
+  return frameId > lastKnownFrameId || (frameId >= 0 && lastKnownFrameId >= 0xFFF0);
+}
+
+void updateFrameTiming() {
+  uint32_t currMicroSecs = micros();
+  if (lastFrameTimeMicroSecs != 0) {
+    if (currMicroSecs > lastFrameTimeMicroSecs) {
+      frameDiffMicroSecs = currMicroSecs-lastFrameTimeMicroSecs;
+    }
+  } 
+  lastFrameTimeMicroSecs = currMicroSecs;
+}
+
+void updateStatus() {
+  // Debug/Info status update
+  statusUpdateFrameCounter++;
+  if (statusUpdateFrameCounter % STATUS_UPDATE_FRAMES == 0) {
+     DEBUG_SERIAL.printf("[Slave %i] LED Refresh FPS: %.2f, Frame#: %i, Dropped Frames: %u, Superseded Frames: %u", 
+       MY_SLAVE_ID, (1000000.0f/((float)frameDiffMicroSecs)), lastKnownFrameId, droppedFrameCount, supersededFrameCount); 
+     DEBUG_SERIAL.println();
+     statusUpdateFrameCounter = 0;
+  }
+}
+
+void requestKeyframe() {
+  // Let the server know that the next frame needs to be a full one, only do this once until we get it
+  if (!keyframeRequested) {
+    const char keyframeReqStr[] = "KEYFRAME\n";
+    myPacketSerial.send((const uint8_t*)keyframeReqStr, sizeof(keyframeReqStr));
+    keyframeRequested = true;
+  }
+}
+
+void acknowledgeFrame(int frameId) {
+  // The server waits for every slave to acknowledge a frame before it has the frame sync line pulsed, the
+  // acknowledgement is sent from loop() once the LEDs are free (see sendPendingFrameAck)
+  if (frameSyncEnabled) {
+    pendingAckFrameId = frameId;
+  }
+}
+
+void sendPendingFrameAck() {
+  if (pendingAckFrameId < 0 || leds.busy()) {
+    return;
+  }
+  char tempBuffer[20];
+  int len = snprintf(tempBuffer, sizeof(tempBuffer), "FRAME_ACK %d\n", pendingAckFrameId);
+  myPacketSerial.send((const uint8_t*)tempBuffer, static_cast<size_t>(len));
+  pendingAckFrameId = -1;
+}
+
+void onFrameSync() {
+  // Interrupt handler for the falling edge of the frame sync line, the staged frame is shown from loop()
+  frameSyncPending = true;
+}
+
+void pulseFrameSync(int frameId) {
+  // Only the sync master drives the (pulled up) frame sync line, every other slave latches on the falling edge.
+  // pinMode() rewrites the pin's whole control register, which also turns off its interrupt, so the master
+  // latches its own frame directly and attaches the interrupt again for when it isn't the one pulsing.
+  pinMode(FRAME_SYNC_PIN, OUTPUT);
+  digitalWrite(FRAME_SYNC_PIN, LOW);
+  frameSyncPending = true;
+  delayMicroseconds(FRAME_SYNC_PULSE_MICROSECS);
+  pinMode(FRAME_SYNC_PIN, INPUT_PULLUP);
+  attachInterrupt(FRAME_SYNC_PIN, onFrameSync, FALLING);
+
+  // Let the server know that it can start sending the next frame
+  char tempBuffer[20];
+  int len = snprintf(tempBuffer, sizeof(tempBuffer), "FRAME_SYNC %d\n", frameId);
+  myPacketSerial.send((const uint8_t*)tempBuffer, static_cast<size_t>(len));
+}
+
+FrameBuffer& getReceivingFrameBuffer() {
+  return frameBuffers[latestFrameBufferIdx == 0 ? 1 : 0];
+}
+
+void setLatestFrame(int frameBufferIdx, int frameId) {
+  if (!latestFrameShown) {
+    // The LEDs were still busy with the frame before it, it will never be shown
+    supersededFrameCount++;
+  }
+  latestFrameBufferIdx = frameBufferIdx;
+  latestFrameShown = false;
+  lastAppliedFrameId = frameId;
+}
+
+void renderFrame(const FrameBuffer& frameBuffer) {
+  if (!frameBuffer.raw) {
+    memcpy(displayMemory, frameBuffer.memory, sizeof(displayMemory));
+    return;
+  }
+
+  LED3D_PROFILE_SCOPE(renderRawFrame);
+  const uint8_t* rawBytes = (const uint8_t*)frameBuffer.memory;
+  uint8_t* displayBytes = (uint8_t*)displayMemory;
+  uint8_t* residuals = colourLUT.isDithering() ? ditherResiduals : nullptr;
+  for (int rowIdx = 0; rowIdx < ledsPerStrip; rowIdx++) {
+    led3d::renderOctoRow(colourLUT, &rawBytes[rowIdx*OCTO_ROW_SIZE], residuals ? &residuals[rowIdx*OCTO_ROW_SIZE] : nullptr,
+      &displayBytes[rowIdx*OCTO_ROW_SIZE]);
+  }
+}
+
+void showLatestFrame() {
+  // Hand the newest complete frame to the LEDs as soon as they're done showing the previous one
+  if (latestFrameBufferIdx < 0 || leds.busy()) {
+    return;
+  }
+  const FrameBuffer& frameBuffer = frameBuffers[latestFrameBufferIdx];
+  if (latestFrameShown) {
+    // Show it again when the colour LUT changes, dithered frames also keep getting refreshed in the meantime so
+    // that they average out to the exact colours
+    if (frameBuffer.raw && (colourLUTChanged || colourLUT.isDithering())) {
+      renderFrame(frameBuffer);
+      leds.show();
+      colourLUTChanged = false;
+    }
+    return;
+  }
+  renderFrame(frameBuffer);
+  colourLUTChanged = false;
+  leds.show();
+  updateFrameTiming();
+  latestFrameShown = true;
+}
+
+void readFullVoxelData(const uint8_t* buffer, size_t size, size_t startIdx, int frameId, bool raw) {
+  LED3D_PROFILE_SCOPE(readFullVoxelData);
   bool validSize = static_cast<int>(size) >= 3*ledsPerModule;
-  bool validFrameOrdering = frameId > lastKnownFrameId || (frameId >= 0 && lastKnownFrameId >= 0xFFF0);
+  bool validFrameOrdering = isValidFrameOrdering(frameId);
   if (validSize && validFrameOrdering) {
 
-    // Copy directly into drawing memory.
-    memcpy((uint8_t*)drawingMemory, &buffer[startIdx], sizeof(drawingMemory));
+    // Copy into the receiving frame buffer, unless the packet was already decoded there
+    FrameBuffer& frameBuffer = getReceivingFrameBuffer();
+    if (&buffer[startIdx] != (const uint8_t*)frameBuffer.memory) {
+      memcpy((uint8_t*)frameBuffer.memory, &buffer[startIdx], sizeof(frameBuffer.memory));
+    }
+    frameBuffer.raw = raw;
 
     //DEBUG_SERIAL.printf("Buffer: %i %i %i", buffer[startIdx], buffer[startIdx+1], buffer[startIdx+2]); DEBUG_SERIAL.println();
     // Sanity Testing
     //int color = ((buffer[startIdx] & 0x0000FF) << 16)  + ((buffer[startIdx+1] & 0x0000FF) << 8) + (buffer[startIdx+2] & 0x0000FF);
     //leds.setPixel(0, color);
 
-    leds.show();
-
-    uint32_t currMicroSecs = micros();
-    if (lastFrameTimeMicroSecs != 0) {
-      if (currMicroSecs > lastFrameTimeMicroSecs) {
-        frameDiffMicroSecs = currMicroSecs-lastFrameTimeMicroSecs;
-      }
-    } 
-    lastFrameTimeMicroSecs = currMicroSecs;
+    setLatestFrame(&frameBuffer - frameBuffers, frameId);
+    keyframeRequested = false;
+    acknowledgeFrame(frameId);
   }
   else {
+    droppedFrameCount++;
     DEBUG_SERIAL.printf("[Slave %i] Throwing out frame %i [valid size: %s, valid frame ordering: %s]", MY_SLAVE_ID, frameId, BOOL_TO_STRING(validSize), BOOL_TO_STRING(validFrameOrdering));
     DEBUG_SERIAL.println();
     if (!validSize) {
-      DEBUG_SERIAL.printf("[Slave %i] Frame size was %i, expected %i", MY_SLAVE_ID, size, 3*ledsPerModule); DEBUG_SERIAL.println();
+      DEBUG_SERIAL.printf("[Slave %i] Frame size was %i, expected %i", MY_SLAVE_ID, static_cast<int>(size), 3*ledsPerModule); DEBUG_SERIAL.println();
     }
     if (!validFrameOrdering) {
       DEBUG_SERIAL.printf("[Slave %i] Previous Tracked Frame ID: %i, Current Frame ID: %i", MY_SLAVE_ID, lastKnownFrameId, frameId); DEBUG_SERIAL.println();
     }
   }
   lastKnownFrameId = frameId;
+  updateStatus();
+}
 
-  // Debug/Info status update
-  statusUpdateFrameCounter++;
-  if (statusUpdateFrameCounter % STATUS_UPDATE_FRAMES == 0) {
-     DEBUG_SERIAL.printf("[Slave %i] LED Refresh FPS: %.2f, Frame#: %i", MY_SLAVE_ID, (1000000.0f/((float)frameDiffMicroSecs)), lastKnownFrameId); 
-     DEBUG_SERIAL.println();
-     statusUpdateFrameCounter = 0;
+void readDirtyVoxelData(const uint8_t* buffer, size_t size, size_t startIdx, int frameId) {
+  LED3D_PROFILE_SCOPE(readDirtyVoxelData);
+  if (size < VOXEL_DATA_DIRTY_HEADER_SIZE) {
+    DEBUG_SERIAL.printf("[Slave %i] Throwing out dirty frame %i, missing header", MY_SLAVE_ID, frameId); DEBUG_SERIAL.println();
+    droppedFrameCount++;
+    return;
+  }
+
+  // The dirty rows only make sense on top of the frame that the server last sent to us
+  int baseFrameId = static_cast<uint16_t>((buffer[startIdx] << 8) + buffer[startIdx+1]);
+  size_t numRows  = static_cast<uint16_t>((buffer[startIdx+2] << 8) + buffer[startIdx+3]);
+  startIdx += VOXEL_DATA_DIRTY_HEADER_SIZE;
+  size -= VOXEL_DATA_DIRTY_HEADER_SIZE;
+
+  bool validSize = size >= numRows*VOXEL_DATA_DIRTY_ROW_SIZE;
+  bool validFrameOrdering = isValidFrameOrdering(frameId);
+  bool validBaseFrame = baseFrameId == lastAppliedFrameId;
+  if (validSize && validFrameOrdering && validBaseFrame) {
+
+    // Patch each of the changed rows directly into the latest frame, it's only ever read while being copied
+    // to the LEDs in showLatestFrame so this is safe even when it has already been shown
+    uint8_t* drawingBytes = (uint8_t*)frameBuffers[latestFrameBufferIdx].memory;
+    for (size_t i = 0; i < numRows; i++, startIdx += VOXEL_DATA_DIRTY_ROW_SIZE) {
+      size_t rowIdx = static_cast<uint16_t>((buffer[startIdx] << 8) + buffer[startIdx+1]);
+      if (rowIdx < static_cast<size_t>(ledsPerStrip)) {
+        memcpy(&drawingBytes[rowIdx*OCTO_ROW_SIZE], &buffer[startIdx+2], OCTO_ROW_SIZE);
+      }
+    }
+
+    if (numRows > 0) {
+      setLatestFrame(latestFrameBufferIdx, frameId);
+    }
+    else {
+      lastAppliedFrameId = frameId;
+    }
+    acknowledgeFrame(frameId);
   }
+  else {
+    droppedFrameCount++;
+    DEBUG_SERIAL.printf("[Slave %i] Throwing out dirty frame %i [valid size: %s, valid frame ordering: %s, valid base frame: %s]", 
+      MY_SLAVE_ID, frameId, BOOL_TO_STRING(validSize), BOOL_TO_STRING(validFrameOrdering), BOOL_TO_STRING(validBaseFrame));
+    DEBUG_SERIAL.println();
+    if (!validBaseFrame) {
+      DEBUG_SERIAL.printf("[Slave %i] Last Applied Frame ID: %i, Base Frame ID: %i", MY_SLAVE_ID, lastAppliedFrameId, baseFrameId); DEBUG_SERIAL.println();
+      requestKeyframe();
+    }
+  }
+  lastKnownFrameId = frameId;
+  updateStatus();
+}
 
+void readColourLUT(const uint8_t* buffer, size_t size, size_t startIdx) {
+  if (size < COLOUR_LUT_SIZE) {
+    DEBUG_SERIAL.printf("[Slave %i] Throwing out colour LUT, size was %i, expected %i", MY_SLAVE_ID, static_cast<int>(size), COLOUR_LUT_SIZE);
+    DEBUG_SERIAL.println();
+    return;
+  }
+  colourLUT.setDithering((buffer[startIdx] & COLOUR_LUT_FLAG_DITHERING) != 0);
+  colourLUT.setCurves(&buffer[startIdx+1]);
+  // Show the current frame again with the new colours
+  colourLUTChanged = true;
+}
+
+void readBrightness(const uint8_t* buffer, size_t size, size_t startIdx) {
+  if (size < BRIGHTNESS_SIZE) {
+    return;
+  }
+  colourLUT.setBrightness(static_cast<uint16_t>((buffer[startIdx] << 8) + buffer[startIdx+1]));
+  colourLUTChanged = true;
+}
+
+uint8_t* getDecodeTarget(const void* sender, const uint8_t* header, size_t headerSize, size_t* targetSize) {
+  // Full frames that will be shown get decoded right into the receiving frame buffer as they arrive, everything
+  // else is decoded into the packet serial's receive buffer
+  if (sender == &myPacketSerial && headerSize == VOXEL_DATA_ALL_HEADER_SIZE &&
+      header[0] == MY_SLAVE_ID &&
+      (static_cast<char>(header[1]) == VOXEL_DATA_ALL_TYPE || static_cast<char>(header[1]) == VOXEL_DATA_RAW_TYPE) &&
+      isValidFrameOrdering(getFrameId(header, headerSize))) {
+    FrameBuffer& frameBuffer = getReceivingFrameBuffer();
+    *targetSize = sizeof(FrameBuffer);
+    return frameBuffer.packetHeader;
+  }
+  return nullptr;
 }
 
 void onSerialPacketReceived(const void* sender, const uint8_t* buffer, size_t size) {
@@ -139,7 +394,32 @@ void onSerialPacketReceived(const void* sender, const uint8_t* buffer, size_t si
 
       case VOXEL_DATA_ALL_TYPE:
         bufferIdx += 2; // Frame ID
-        readFullVoxelData(buffer, static_cast<size_t>(size-bufferIdx), bufferIdx, getFrameId(buffer, size));
+        readFullVoxelData(buffer, static_cast<size_t>(size-bufferIdx), bufferIdx, getFrameId(buffer, size), false);
+        break;
+
+      case VOXEL_DATA_RAW_TYPE:
+        bufferIdx += 2; // Frame ID
+        readFullVoxelData(buffer, static_cast<size_t>(size-bufferIdx), bufferIdx, getFrameId(buffer, size), true);
+        break;
+
+      case VOXEL_DATA_DIRTY_TYPE:
+        bufferIdx += 2; // Frame ID
+        readDirtyVoxelData(buffer, static_cast<size_t>(size-bufferIdx), bufferIdx, getFrameId(buffer, size));
+        break;
+
+      case COLOUR_LUT_TYPE:
+        readColourLUT(buffer, static_cast<size_t>(size-bufferIdx), bufferIdx);
+        break;
+
+      case BRIGHTNESS_TYPE:
+        readBrightness(buffer, static_cast<size_t>(size-bufferIdx), bufferIdx);
+        break;
+
+      case FRAME_SYNC_TYPE:
+        // Every slave has acknowledged the staged frame, if we're the sync master then latch it everywhere
+        if (frameSyncEnabled && MY_SLAVE_ID == FRAME_SYNC_MASTER_ID) {
+          pulseFrameSync(getFrameId(buffer, size));
+        }
         break;
 
       default:
@@ -163,7 +443,9 @@ void loop() {
 */
 
 void setup() {
-  //TODO: pinMode(FRAME_SYNC_PIN, INPUT_PULLUP); // Frame Sync
+  // Frame Sync, the line is shared by all of the slaves and only ever pulled low by the sync master
+  pinMode(FRAME_SYNC_PIN, INPUT_PULLUP);
+  attachInterrupt(FRAME_SYNC_PIN, onFrameSync, FALLING);
 
   // Serial for receiving render data
   DEBUG_SERIAL.begin(USB_SERIAL_BAUD);
@@ -174,6 +456,7 @@ void setup() {
 
   myPacketSerial.setStream(&DATA_SERIAL);
   myPacketSerial.setPacketHandler(&onSerialPacketReceived);
+  myPacketSerial.setDecodeTargetHandler(&getDecodeTarget, VOXEL_DATA_ALL_HEADER_SIZE);
 
   lastKnownFrameId = 0;
   leds.begin();
@@ -186,4 +469,20 @@ void loop() {
   if (myPacketSerial.overflow()) {
     DEBUG_SERIAL.println("Serial buffer overflow.");
   }
+
+  if (frameSyncEnabled) {
+    // Show the staged frame once the frame sync line has been pulsed, at worst one serial update() after
+    // the edge. The server doesn't send the next frame until the sync master reports the pulse, so the staged
+    // frame can't be replaced before then, and it was only acknowledged once the LEDs were free so they're
+    // never still busy with the frame before.
+    sendPendingFrameAck();
+    if (frameSyncPending) {
+      frameSyncPending = false;
+      showLatestFrame();
+    }
+  }
+  else {
+    // Receiving the next frame and showing the last one overlap, the LEDs get a new frame whenever they're free
+    showLatestFrame();
+  }
 }
@@ -0,0 +1,135 @@
+#include "audiofft.h"
+
+#include <math.h>
+
+// SSE2 is part of x86-64 so it doesn't need a runtime check, everything else gets the scalar loops (which the
+// compiler is free to vectorize for its own target)
+#if defined(__x86_64__) || defined(_M_X64)
+#define AUDIOFFT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace audiofft {
+
+  namespace {
+    const double PI = 3.14159265358979323846;
+
+    int log2Of(int value) {
+      int bits = 0;
+      while ((1 << bits) < value) { bits++; }
+      return bits;
+    }
+  };
+
+  bool isValidSize(int size) {
+    return size >= MIN_FFT_SIZE && size <= MAX_FFT_SIZE && (size & (size - 1)) == 0;
+  }
+
+  Plan::Plan(int size) :
+    size_(size), halfSize_(size/2), window_(size), bitReversed_(size/2), twiddleRe_(size/2), twiddleIm_(size/2),
+    splitRe_(size/2), splitIm_(size/2), re_(size/2), im_(size/2) {
+
+    for (int n = 0; n < size_; n++) {
+      window_[n] = static_cast<float>(0.5 - 0.5*cos(2.0*PI*n/(size_ - 1)));
+    }
+
+    const int bits = log2Of(halfSize_);
+    for (int n = 0; n < halfSize_; n++) {
+      int reversed = 0;
+      for (int b = 0; b < bits; b++) {
+        reversed |= ((n >> b) & 1) << (bits - 1 - b);
+      }
+      bitReversed_[n] = reversed;
+    }
+
+    // The stage that combines blocks of len values uses e^(-2*pi*i*j/len) for j < len/2, stored from len/2-1
+    for (int half = 1; half < halfSize_; half *= 2) {
+      for (int j = 0; j < half; j++) {
+        const double angle = -PI*j/half;
+        twiddleRe_[half - 1 + j] = static_cast<float>(cos(angle));
+        twiddleIm_[half - 1 + j] = static_cast<float>(sin(angle));
+      }
+    }
+    for (int k = 0; k < halfSize_; k++) {
+      const double angle = -2.0*PI*k/size_;
+      splitRe_[k] = static_cast<float>(cos(angle));
+      splitIm_[k] = static_cast<float>(sin(angle));
+    }
+  }
+
+  void Plan::amplitudeSpectrum(const float* samples, float* spectrum) {
+    // Pack the windowed even samples into the real parts and the odd ones into the imaginary parts, in bit reversed
+    // order for the in-place FFT
+    for (int n = 0; n < halfSize_; n++) {
+      const int idx = bitReversed_[n];
+      re_[idx] = samples[2*n]*window_[2*n];
+      im_[idx] = samples[2*n + 1]*window_[2*n + 1];
+    }
+
+    complexFFT();
+
+    // Z[k] = E[k] + i*O[k] where E and O are the spectra of the even and odd samples, which are recovered through
+    // their symmetry, then X[k] = E[k] + e^(-2*pi*i*k/size)*O[k]
+    for (int k = 0; k < halfSize_; k++) {
+      const int m = (halfSize_ - k) & (halfSize_ - 1);
+      const float evenRe = 0.5f*(re_[k] + re_[m]);
+      const float evenIm = 0.5f*(im_[k] - im_[m]);
+      const float oddRe  = 0.5f*(im_[k] + im_[m]);
+      const float oddIm  = -0.5f*(re_[k] - re_[m]);
+      const float xRe = evenRe + splitRe_[k]*oddRe - splitIm_[k]*oddIm;
+      const float xIm = evenIm + splitRe_[k]*oddIm + splitIm_[k]*oddRe;
+      spectrum[k] = sqrtf(xRe*xRe + xIm*xIm);
+    }
+  }
+
+  void Plan::complexFFT() {
+    float* re = re_.data();
+    float* im = im_.data();
+    for (int half = 1; half < halfSize_; half *= 2) {
+      const float* wRe = &twiddleRe_[half - 1];
+      const float* wIm = &twiddleIm_[half - 1];
+      for (int start = 0; start < halfSize_; start += 2*half) {
+        float* aRe = re + start;
+        float* aIm = im + start;
+        float* bRe = aRe + half;
+        float* bIm = aIm + half;
+        int j = 0;
+#ifdef AUDIOFFT_SSE2
+        for (; j + 4 <= half; j += 4) {
+          const __m128 br = _mm_loadu_ps(bRe + j);
+          const __m128 bi = _mm_loadu_ps(bIm + j);
+          const __m128 wr = _mm_loadu_ps(wRe + j);
+          const __m128 wi = _mm_loadu_ps(wIm + j);
+          const __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+          const __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+          const __m128 ar = _mm_loadu_ps(aRe + j);
+          const __m128 ai = _mm_loadu_ps(aIm + j);
+          _mm_storeu_ps(bRe + j, _mm_sub_ps(ar, tr));
+          _mm_storeu_ps(bIm + j, _mm_sub_ps(ai, ti));
+          _mm_storeu_ps(aRe + j, _mm_add_ps(ar, tr));
+          _mm_storeu_ps(aIm + j, _mm_add_ps(ai, ti));
+        }
+#endif
+        for (; j < half; j++) {
+          const float tr = bRe[j]*wRe[j] - bIm[j]*wIm[j];
+          const float ti = bRe[j]*wIm[j] + bIm[j]*wRe[j];
+          bRe[j] = aRe[j] - tr;
+          bIm[j] = aIm[j] - ti;
+          aRe[j] += tr;
+          aIm[j] += ti;
+        }
+      }
+    }
+  }
+
+  void bandLevels(const float* spectrum, const int* bandStarts, int numBands, float* levels) {
+    for (int i = 0; i < numBands; i++) {
+      float level = 0.0f;
+      for (int k = bandStarts[i]; k < bandStarts[i + 1]; k++) {
+        level = spectrum[k] > level ? spectrum[k] : level;
+      }
+      levels[i] = level;
+    }
+  }
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Audio analysis kernels for the server's audio input (see src/Server/Audio/AudioFFT.js).
+//
+// The spectrum of N samples is a real FFT computed as an N/2 point complex FFT of the even and odd samples packed into
+// the real and imaginary parts, followed by a pass that splits the result back into the spectrum of the real signal.
+// The complex FFT is an iterative radix-2 one with the real and imaginary parts in separate arrays, so that the
+// butterflies of each stage run four at a time on SSE2.
+
+#include <stddef.h>
+#include <vector>
+
+namespace audiofft {
+
+  // Smallest and largest supported FFT sizes, every size must be a power of two
+  const int MIN_FFT_SIZE = 16;
+  const int MAX_FFT_SIZE = 1 << 16;
+
+  bool isValidSize(int size);
+
+  // The window, twiddle factors and bit reversal for one FFT size, made once and reused for every analysis
+  class Plan {
+  public:
+    explicit Plan(int size);
+
+    int size() const { return size_; }
+
+    // Amplitude spectrum (the magnitudes of the first size/2 frequency bins, bin k is k*sampleRate/size Hz) of size
+    // samples after a Hann window, the same as Meyda's amplitudeSpectrum
+    void amplitudeSpectrum(const float* samples, float* spectrum);
+
+  private:
+    void complexFFT();
+
+    int size_;
+    int halfSize_;
+    std::vector<float> window_;
+    std::vector<int> bitReversed_;
+    std::vector<float> twiddleRe_, twiddleIm_; // Each stage's twiddles one after the other, 1+2+4+...+halfSize/2
+    std::vector<float> splitRe_, splitIm_;     // e^(-2*pi*i*k/size) for splitting the real spectrum
+    std::vector<float> re_, im_;
+  };
+
+  // Level of each of numBands bands of the spectrum, the largest magnitude of bins [bandStarts[i], bandStarts[i+1])
+  void bandLevels(const float* spectrum, const int* bandStarts, int numBands, float* levels);
+
+}
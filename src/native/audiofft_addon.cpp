@@ -0,0 +1,125 @@
+// Node addon exposing the audio analysis kernels (see audiofft.h) to the server, loaded through
+// src/Server/Audio/AudioFFT.js.
+
+#include <node_api.h>
+
+#include <stdio.h>
+
+#include <map>
+#include <memory>
+
+#include "audiofft.h"
+
+#define NAPI_CALL(env, call) \
+  do { if ((call) != napi_ok) { napi_throw_error((env), nullptr, "N-API call failed: " #call); return nullptr; } } while (0)
+
+static const size_t MAX_ARGS = 4;
+
+// Plans are made the first time each FFT size is used and kept for the life of the process, there's usually just one
+static std::map<int, std::unique_ptr<audiofft::Plan>> plans;
+
+// Reads the arguments of a kernel, throwing a JS error and returning false when there are too few of them
+static bool getArgs(napi_env env, napi_callback_info info, size_t numArgs, const char* funcName, napi_value* args) {
+  size_t argc = MAX_ARGS;
+  if (napi_get_cb_info(env, info, &argc, args, nullptr, nullptr) != napi_ok) {
+    napi_throw_error(env, nullptr, "Failed to get the arguments.");
+    return false;
+  }
+  if (argc < numArgs) {
+    char message[64];
+    snprintf(message, sizeof(message), "%s expects %d arguments.", funcName, static_cast<int>(numArgs));
+    napi_throw_type_error(env, nullptr, message);
+    return false;
+  }
+  return true;
+}
+
+static bool getTypedArrayArg(napi_env env, napi_value value, napi_typedarray_type expectedType, const char* message,
+                             void** data, size_t* length) {
+  bool isTypedArray = false;
+  napi_typedarray_type type;
+  if (napi_is_typedarray(env, value, &isTypedArray) != napi_ok || !isTypedArray ||
+      napi_get_typedarray_info(env, value, &type, length, data, nullptr, nullptr) != napi_ok || type != expectedType) {
+    napi_throw_type_error(env, nullptr, message);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * amplitudeSpectrum(samples, spectrum)
+ * samples is a Float32Array whose length is the FFT size (a power of two), spectrum a Float32Array of at least half
+ * that length.
+ */
+static napi_value AmplitudeSpectrum(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  void* samples = nullptr;
+  void* spectrum = nullptr;
+  size_t numSamples = 0, spectrumLength = 0;
+  if (!getArgs(env, info, 2, "amplitudeSpectrum", args) ||
+      !getTypedArrayArg(env, args[0], napi_float32_array, "The samples must be a Float32Array.", &samples, &numSamples) ||
+      !getTypedArrayArg(env, args[1], napi_float32_array, "The spectrum must be a Float32Array.", &spectrum, &spectrumLength)) {
+    return nullptr;
+  }
+  const int size = static_cast<int>(numSamples);
+  if (numSamples > static_cast<size_t>(audiofft::MAX_FFT_SIZE) || !audiofft::isValidSize(size)) {
+    napi_throw_range_error(env, nullptr, "The number of samples must be a power of two from 16 to 65536.");
+    return nullptr;
+  }
+  if (spectrumLength < numSamples/2) {
+    napi_throw_range_error(env, nullptr, "The spectrum is smaller than half the number of samples.");
+    return nullptr;
+  }
+
+  std::unique_ptr<audiofft::Plan>& plan = plans[size];
+  if (!plan) {
+    plan.reset(new audiofft::Plan(size));
+  }
+  plan->amplitudeSpectrum(static_cast<const float*>(samples), static_cast<float*>(spectrum));
+  return nullptr;
+}
+
+/**
+ * bandLevels(spectrum, bandStarts, levels)
+ * bandStarts is an Int32Array of the first bin of each band followed by the end of the last band, levels a
+ * Float32Array with room for every band.
+ */
+static napi_value BandLevels(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  void* spectrum = nullptr;
+  void* bandStarts = nullptr;
+  void* levels = nullptr;
+  size_t spectrumLength = 0, numBandStarts = 0, levelsLength = 0;
+  if (!getArgs(env, info, 3, "bandLevels", args) ||
+      !getTypedArrayArg(env, args[0], napi_float32_array, "The spectrum must be a Float32Array.", &spectrum, &spectrumLength) ||
+      !getTypedArrayArg(env, args[1], napi_int32_array, "The band starts must be an Int32Array.", &bandStarts, &numBandStarts) ||
+      !getTypedArrayArg(env, args[2], napi_float32_array, "The levels must be a Float32Array.", &levels, &levelsLength)) {
+    return nullptr;
+  }
+  if (numBandStarts < 1 || levelsLength < numBandStarts - 1) {
+    napi_throw_range_error(env, nullptr, "There must be a level for every band.");
+    return nullptr;
+  }
+  const int* starts = static_cast<const int*>(bandStarts);
+  for (size_t i = 0; i < numBandStarts; i++) {
+    if (starts[i] < 0 || static_cast<size_t>(starts[i]) > spectrumLength || (i > 0 && starts[i] < starts[i - 1])) {
+      napi_throw_range_error(env, nullptr, "The band starts must be increasing bins of the spectrum.");
+      return nullptr;
+    }
+  }
+
+  audiofft::bandLevels(static_cast<const float*>(spectrum), starts, static_cast<int>(numBandStarts) - 1,
+                       static_cast<float*>(levels));
+  return nullptr;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+  napi_property_descriptor properties[] = {
+    { "amplitudeSpectrum", nullptr, AmplitudeSpectrum, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "bandLevels", nullptr, BandLevels, nullptr, nullptr, nullptr, napi_default, nullptr },
+  };
+  NAPI_CALL(env, napi_define_properties(env, exports, sizeof(properties)/sizeof(properties[0]), properties));
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
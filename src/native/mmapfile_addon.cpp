@@ -0,0 +1,101 @@
+// Node addon for memory mapping files read-only, used by the animation cache (see src/Server/AnimationCache.js) so
+// that cached frames are paged in from disk as they're played rather than read into the heap, loaded through
+// src/NativeAddons.js.
+
+#include <node_api.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define NAPI_CALL(env, call) \
+  do { if ((call) != napi_ok) { napi_throw_error((env), nullptr, "N-API call failed: " #call); return nullptr; } } while (0)
+
+static const size_t MAX_PATH_LENGTH = 4096;
+
+#ifndef _WIN32
+static void unmapFile(napi_env, void* data, void* hint) {
+  munmap(data, reinterpret_cast<size_t>(hint));
+}
+#endif
+
+/**
+ * map(path) -> Buffer of the whole file, mapped read-only. The mapping is released when the Buffer is garbage
+ * collected, writing to the Buffer crashes the process.
+ */
+static napi_value Map(napi_env env, napi_callback_info info) {
+  size_t argc = 1;
+  napi_value args[1];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, nullptr, nullptr));
+  if (argc < 1) {
+    napi_throw_type_error(env, nullptr, "map expects 1 argument.");
+    return nullptr;
+  }
+
+  char path[MAX_PATH_LENGTH];
+  size_t pathLength = 0;
+  if (napi_get_value_string_utf8(env, args[0], path, sizeof(path), &pathLength) != napi_ok) {
+    napi_throw_type_error(env, nullptr, "The path must be a string.");
+    return nullptr;
+  }
+  if (pathLength >= sizeof(path) - 1) {
+    napi_throw_range_error(env, nullptr, "The path is too long.");
+    return nullptr;
+  }
+
+#ifdef _WIN32
+  napi_throw_error(env, nullptr, "Memory mapping isn't supported on this platform.");
+  return nullptr;
+#else
+  char message[MAX_PATH_LENGTH + 64];
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    snprintf(message, sizeof(message), "Failed to open %s: %s", path, strerror(errno));
+    napi_throw_error(env, nullptr, message);
+    return nullptr;
+  }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+    close(fd);
+    snprintf(message, sizeof(message), "Can't map %s, it's empty or can't be read.", path);
+    napi_throw_error(env, nullptr, message);
+    return nullptr;
+  }
+
+  const size_t length = static_cast<size_t>(fileStat.st_size);
+  void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // The mapping keeps the file open
+  if (data == MAP_FAILED) {
+    snprintf(message, sizeof(message), "Failed to map %s: %s", path, strerror(errno));
+    napi_throw_error(env, nullptr, message);
+    return nullptr;
+  }
+  // Frames are played from start to end
+  madvise(data, length, MADV_SEQUENTIAL);
+
+  napi_value buffer;
+  if (napi_create_external_buffer(env, length, data, unmapFile, reinterpret_cast<void*>(length), &buffer) != napi_ok) {
+    munmap(data, length);
+    napi_throw_error(env, nullptr, "Failed to wrap the mapping in a Buffer.");
+    return nullptr;
+  }
+  return buffer;
+#endif
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+  napi_property_descriptor properties[] = {
+    { "map", nullptr, Map, nullptr, nullptr, nullptr, napi_default, nullptr },
+  };
+  NAPI_CALL(env, napi_define_properties(env, exports, sizeof(properties)/sizeof(properties[0]), properties));
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
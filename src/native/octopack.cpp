@@ -0,0 +1,247 @@
+#include "octopack.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define OCTOPACK_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// The AVX2 path is compiled for AVX2 on its own so that the rest of the addon still runs on any x86-64 CPU
+#if defined(__GNUC__) || defined(__clang__)
+#define OCTOPACK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define OCTOPACK_TARGET_AVX2
+#endif
+
+namespace octopack {
+
+  namespace {
+
+    // Rows are packed 4 at a time. The gamma corrected channel bytes of a group of rows are gathered into planes,
+    // [channel][row][pin], so that each of the transpose paths can load 8, 16 or 32 contiguous bytes at once.
+    const int ROWS_PER_GROUP = 4;
+    struct RowGroup {
+      alignas(32) uint8_t planes[3][ROWS_PER_GROUP][NUM_OCTO_PINS];
+    };
+
+    // Transposes a whole group into ROWS_PER_GROUP consecutive rows of OCTO_ROW_SIZE bytes
+    typedef void (*TransposeFunc)(const RowGroup& group, uint8_t* out);
+
+    // Transpose an 8x8 bit matrix where byte i of x is row i and bit j of a byte is column j (see Hacker's Delight)
+    inline uint64_t transpose8x8(uint64_t x) {
+      uint64_t t;
+      t = (x ^ (x >> 7))  & 0x00AA00AA00AA00AAULL; x = x ^ t ^ (t << 7);
+      t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL; x = x ^ t ^ (t << 14);
+      t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL; x = x ^ t ^ (t << 28);
+      return x;
+    }
+
+    void transposeScalar(const RowGroup& group, uint8_t* out) {
+      for (int row = 0; row < ROWS_PER_GROUP; row++) {
+        for (int c = 0; c < 3; c++) {
+          // Byte j of the transposed matrix has bit j of each pin, the octo row wants the most significant bit first
+          uint64_t x = 0;
+          for (int i = 0; i < NUM_OCTO_PINS; i++) { x |= static_cast<uint64_t>(group.planes[c][row][i]) << (8*i); }
+          x = transpose8x8(x);
+          uint8_t* channelOut = &out[row*OCTO_ROW_SIZE + c*NUM_OCTO_PINS];
+          for (int k = 0; k < NUM_OCTO_PINS; k++) { channelOut[k] = static_cast<uint8_t>(x >> (8*(7-k))); }
+        }
+      }
+    }
+
+#ifdef OCTOPACK_X86
+    // movemask gathers the top bit of every byte, i.e., bit 7 of each pin for all the rows in the register at once,
+    // adding the register to itself then shifts the next bit up into place
+    void transposeSSE2(const RowGroup& group, uint8_t* out) {
+      for (int c = 0; c < 3; c++) {
+        for (int row = 0; row < ROWS_PER_GROUP; row += 2) {
+          __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(group.planes[c][row]));
+          uint8_t* channelOut = &out[row*OCTO_ROW_SIZE + c*NUM_OCTO_PINS];
+          for (int k = 0; k < NUM_OCTO_PINS; k++) {
+            int mask = _mm_movemask_epi8(v);
+            channelOut[k] = static_cast<uint8_t>(mask);
+            channelOut[OCTO_ROW_SIZE+k] = static_cast<uint8_t>(mask >> 8);
+            v = _mm_add_epi8(v, v);
+          }
+        }
+      }
+    }
+
+    OCTOPACK_TARGET_AVX2 void transposeAVX2(const RowGroup& group, uint8_t* out) {
+      for (int c = 0; c < 3; c++) {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(group.planes[c][0]));
+        uint8_t* channelOut = &out[c*NUM_OCTO_PINS];
+        for (int k = 0; k < NUM_OCTO_PINS; k++) {
+          uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(v));
+          channelOut[k] = static_cast<uint8_t>(mask);
+          channelOut[OCTO_ROW_SIZE+k] = static_cast<uint8_t>(mask >> 8);
+          channelOut[2*OCTO_ROW_SIZE+k] = static_cast<uint8_t>(mask >> 16);
+          channelOut[3*OCTO_ROW_SIZE+k] = static_cast<uint8_t>(mask >> 24);
+          v = _mm256_add_epi8(v, v);
+        }
+      }
+    }
+#endif
+
+    TransposeFunc getTransposeFunc(Path path) {
+#ifdef OCTOPACK_X86
+      switch (path) {
+        case Path::AVX2: return transposeAVX2;
+        case Path::SSE2: return transposeSSE2;
+        default: break;
+      }
+#else
+      (void)path;
+#endif
+      return transposeScalar;
+    }
+
+    inline uint8_t gammaAt(const uint8_t gamma[256], double value) {
+      // Clamp without branches (these are unpredictable for real frames), written so that NaN ends up as 0
+      value = value > 0.0 ? value : 0.0;
+      value = value < 255.0 ? value : 255.0;
+      return gamma[static_cast<int>(value)];
+    }
+
+    struct FloatConverter {
+      FloatConverter(double brightness, const uint8_t gamma[256]) : scale(255.0*brightness), gamma(gamma) {}
+      uint8_t operator()(float c) const { return gammaAt(gamma, c*scale); }
+      double scale;
+      const uint8_t* gamma;
+    };
+
+    struct Uint8Converter {
+      Uint8Converter(double brightness, const uint8_t gamma[256]) {
+        for (int u = 0; u < 256; u++) { lut[u] = gammaAt(gamma, static_cast<double>(u)*brightness); }
+      }
+      uint8_t operator()(uint8_t u) const { return lut[u]; }
+      uint8_t lut[256];
+    };
+
+    template<typename T, typename Converter>
+    void packAll(const T* framebuffer, int xSize, int ySize, int zSize, const Converter& convert,
+                 uint8_t* out, size_t outStride, TransposeFunc transpose) {
+
+      const int numRows = ySize*zSize;
+      const size_t xSliceSize = static_cast<size_t>(ySize)*zSize*3;
+
+      RowGroup group;
+      alignas(32) uint8_t partialRows[ROWS_PER_GROUP*OCTO_ROW_SIZE];
+
+      for (int s = 0; s < numSlaves(xSize); s++) {
+        const T* slaveFramebuffer = framebuffer + static_cast<size_t>(s)*NUM_OCTO_PINS*xSliceSize;
+        uint8_t* slaveOut = out + s*outStride;
+
+        int y = 0, z = 0;
+        for (int rowIdx = 0; rowIdx < numRows; rowIdx += ROWS_PER_GROUP) {
+          const int numGroupRows = numRows-rowIdx < ROWS_PER_GROUP ? numRows-rowIdx : ROWS_PER_GROUP;
+          if (numGroupRows < ROWS_PER_GROUP) {
+            memset(&group, 0, sizeof(group));
+          }
+
+          for (int row = 0; row < numGroupRows; row++) {
+            const T* voxel = slaveFramebuffer + (static_cast<size_t>(y)*zSize + z)*3;
+            for (int i = 0; i < NUM_OCTO_PINS; i++, voxel += xSliceSize) {
+              group.planes[0][row][i] = convert(voxel[0]);
+              group.planes[1][row][i] = convert(voxel[1]);
+              group.planes[2][row][i] = convert(voxel[2]);
+            }
+            if (++y == ySize) { y = 0; z++; }
+          }
+
+          uint8_t* rowsOut = &slaveOut[static_cast<size_t>(rowIdx)*OCTO_ROW_SIZE];
+          if (numGroupRows == ROWS_PER_GROUP) {
+            transpose(group, rowsOut);
+          }
+          else {
+            transpose(group, partialRows);
+            memcpy(rowsOut, partialRows, numGroupRows*OCTO_ROW_SIZE);
+          }
+        }
+      }
+    }
+
+    struct RawFloatConverter {
+      uint8_t operator()(float c) const {
+        double value = c*255.0;
+        value = value > 0.0 ? value : 0.0;
+        value = value < 255.0 ? value : 255.0;
+        return static_cast<uint8_t>(value);
+      }
+    };
+
+    struct RawUint8Converter {
+      uint8_t operator()(uint8_t u) const { return u; }
+    };
+
+    template<typename T, typename Converter>
+    void packRawAll(const T* framebuffer, int xSize, int ySize, int zSize, const Converter& convert, uint8_t* out, size_t outStride) {
+      const size_t xSliceSize = static_cast<size_t>(ySize)*zSize*3;
+
+      for (int s = 0; s < numSlaves(xSize); s++) {
+        const T* slaveFramebuffer = framebuffer + static_cast<size_t>(s)*NUM_OCTO_PINS*xSliceSize;
+        uint8_t* rowOut = out + s*outStride;
+        for (int z = 0; z < zSize; z++) {
+          for (int y = 0; y < ySize; y++) {
+            const T* voxel = slaveFramebuffer + (static_cast<size_t>(y)*zSize + z)*3;
+            for (int i = 0; i < NUM_OCTO_PINS; i++, voxel += xSliceSize) {
+              *rowOut++ = convert(voxel[0]);
+              *rowOut++ = convert(voxel[1]);
+              *rowOut++ = convert(voxel[2]);
+            }
+          }
+        }
+      }
+    }
+
+  };
+
+  Path bestPath() {
+#ifdef OCTOPACK_X86
+#if defined(__GNUC__) || defined(__clang__)
+    if (__builtin_cpu_supports("avx2")) { return Path::AVX2; }
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, 7, 0);
+    bool cpuHasAVX2 = (info[1] & (1 << 5)) != 0;
+    __cpuid(info, 1);
+    bool osSavesYMM = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    if (cpuHasAVX2 && osSavesYMM) { return Path::AVX2; }
+#endif
+    return Path::SSE2;
+#else
+    return Path::Scalar;
+#endif
+  }
+
+  const char* pathName(Path path) {
+    switch (path) {
+      case Path::AVX2: return "avx2";
+      case Path::SSE2: return "sse2";
+      default: return "scalar";
+    }
+  }
+
+  void pack(const float* framebuffer, int xSize, int ySize, int zSize, double brightness, const uint8_t gamma[256],
+            uint8_t* out, size_t outStride, Path path) {
+    packAll(framebuffer, xSize, ySize, zSize, FloatConverter(brightness, gamma), out, outStride, getTransposeFunc(path));
+  }
+
+  void pack(const uint8_t* framebuffer, int xSize, int ySize, int zSize, double brightness, const uint8_t gamma[256],
+            uint8_t* out, size_t outStride, Path path) {
+    packAll(framebuffer, xSize, ySize, zSize, Uint8Converter(brightness, gamma), out, outStride, getTransposeFunc(path));
+  }
+
+  void packRaw(const float* framebuffer, int xSize, int ySize, int zSize, uint8_t* out, size_t outStride) {
+    packRawAll(framebuffer, xSize, ySize, zSize, RawFloatConverter(), out, outStride);
+  }
+
+  void packRaw(const uint8_t* framebuffer, int xSize, int ySize, int zSize, uint8_t* out, size_t outStride) {
+    packRawAll(framebuffer, xSize, ySize, zSize, RawUint8Converter(), out, outStride);
+  }
+
+}
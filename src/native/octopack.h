@@ -0,0 +1,40 @@
+#pragma once
+
+// Packs a voxel framebuffer into the OctoWS2811 bit-transposed frame that each slave Teensy shows as-is.
+//
+// The framebuffer is flat and laid out like the server's nested voxel data, i.e., the RGB colour of voxel (x,y,z)
+// starts at ((x*ySize + y)*zSize + z)*3. Slave s drives the x-slices [s*8, s*8+8), one per octo pin, and its frame
+// has a row of OCTO_ROW_SIZE bytes for each (z,y) (row index z*ySize + y): byte k of a row's colour channel holds
+// bit (7-k) of that channel for each of the 8 pins, with pin i in bit i.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace octopack {
+
+  static const int NUM_OCTO_PINS = 8;
+  static const int OCTO_ROW_SIZE = NUM_OCTO_PINS*3;
+
+  // Implementations of the 8x8 bit transpose, the fastest one that the CPU supports is used by default
+  enum class Path { Scalar, SSE2, AVX2 };
+
+  Path bestPath();
+  const char* pathName(Path path);
+
+  inline int numSlaves(int xSize) { return xSize / NUM_OCTO_PINS; }
+  inline size_t slaveFrameSize(int ySize, int zSize) { return static_cast<size_t>(ySize)*zSize*OCTO_ROW_SIZE; }
+
+  // Pack the frames of all numSlaves(xSize) slaves: slave s's frame is written to out + s*outStride.
+  // Brightness and gamma are folded together: a (float) colour channel c in [0,1] becomes gamma[c*brightness*255],
+  // and a (uint8) colour channel u in [0,255] becomes gamma[u*brightness], clamped to the table.
+  void pack(const float* framebuffer, int xSize, int ySize, int zSize, double brightness, const uint8_t gamma[256],
+            uint8_t* out, size_t outStride, Path path = bestPath());
+  void pack(const uint8_t* framebuffer, int xSize, int ySize, int zSize, double brightness, const uint8_t gamma[256],
+            uint8_t* out, size_t outStride, Path path = bestPath());
+
+  // Pack the frames of all numSlaves(xSize) slaves as raw colours, the slaves apply their own colour LUT and do the
+  // bit-transposing: each row has the r,g,b of every pin in turn. Float colours in [0,1] become bytes in [0,255].
+  void packRaw(const float* framebuffer, int xSize, int ySize, int zSize, uint8_t* out, size_t outStride);
+  void packRaw(const uint8_t* framebuffer, int xSize, int ySize, int zSize, uint8_t* out, size_t outStride);
+
+}
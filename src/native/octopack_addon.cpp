@@ -0,0 +1,162 @@
+// Node addon exposing the octo packer (see octopack.h) to the server, loaded through src/OctoPacker.js.
+
+#include <node_api.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "octopack.h"
+
+#define NAPI_CALL(env, call) \
+  do { if ((call) != napi_ok) { napi_throw_error((env), nullptr, "N-API call failed: " #call); return nullptr; } } while (0)
+
+static bool getTypedArrayArg(napi_env env, napi_value value, napi_typedarray_type* type, void** data, size_t* length) {
+  bool isTypedArray = false;
+  if (napi_is_typedarray(env, value, &isTypedArray) != napi_ok || !isTypedArray) {
+    return false;
+  }
+  return napi_get_typedarray_info(env, value, type, length, data, nullptr, nullptr) == napi_ok;
+}
+
+static bool isByteArrayType(napi_typedarray_type type) {
+  return type == napi_uint8_array || type == napi_uint8_clamped_array;
+}
+
+struct PackArgs {
+  napi_typedarray_type framebufferType;
+  void* framebuffer;
+  int32_t xSize, ySize, zSize;
+  double brightness;
+  const uint8_t* gamma;
+  uint8_t* out;
+  size_t outStride;
+};
+
+// Reads (framebuffer, xSize, ySize, zSize, [brightness, gammaTable,] out, headerSize), throwing a JS error and
+// returning false when any of them are invalid
+static bool getPackArgs(napi_env env, napi_callback_info info, bool withColour, const char* funcName, PackArgs* packArgs) {
+  const size_t numArgs = withColour ? 8 : 6;
+  size_t argc = 8;
+  napi_value args[8];
+  if (napi_get_cb_info(env, info, &argc, args, nullptr, nullptr) != napi_ok) {
+    napi_throw_error(env, nullptr, "Failed to get the arguments.");
+    return false;
+  }
+  if (argc < numArgs) {
+    char message[64];
+    snprintf(message, sizeof(message), "%s expects %d arguments.", funcName, static_cast<int>(numArgs));
+    napi_throw_type_error(env, nullptr, message);
+    return false;
+  }
+  napi_value outArg = args[numArgs-2];
+  napi_value headerSizeArg = args[numArgs-1];
+
+  napi_typedarray_type gammaType, outType;
+  void* gammaData = nullptr;
+  void* outData = nullptr;
+  size_t framebufferLength = 0, gammaLength = 0, outLength = 0;
+  if (!getTypedArrayArg(env, args[0], &packArgs->framebufferType, &packArgs->framebuffer, &framebufferLength) ||
+      (packArgs->framebufferType != napi_float32_array && !isByteArrayType(packArgs->framebufferType))) {
+    napi_throw_type_error(env, nullptr, "The framebuffer must be a Float32Array or a Uint8Array.");
+    return false;
+  }
+  if (withColour && (!getTypedArrayArg(env, args[5], &gammaType, &gammaData, &gammaLength) || !isByteArrayType(gammaType) || gammaLength < 256)) {
+    napi_throw_type_error(env, nullptr, "The gamma table must be a Uint8Array with 256 entries.");
+    return false;
+  }
+  if (!getTypedArrayArg(env, outArg, &outType, &outData, &outLength) || !isByteArrayType(outType)) {
+    napi_throw_type_error(env, nullptr, "The output must be a Buffer or a Uint8Array.");
+    return false;
+  }
+
+  int32_t headerSize = 0;
+  packArgs->brightness = 1.0;
+  if (napi_get_value_int32(env, args[1], &packArgs->xSize) != napi_ok ||
+      napi_get_value_int32(env, args[2], &packArgs->ySize) != napi_ok ||
+      napi_get_value_int32(env, args[3], &packArgs->zSize) != napi_ok ||
+      (withColour && napi_get_value_double(env, args[4], &packArgs->brightness) != napi_ok) ||
+      napi_get_value_int32(env, headerSizeArg, &headerSize) != napi_ok) {
+    napi_throw_type_error(env, nullptr, "The grid sizes, brightness and header size must be numbers.");
+    return false;
+  }
+  if (packArgs->xSize < 0 || packArgs->ySize < 0 || packArgs->zSize < 0 || headerSize < 0) {
+    napi_throw_range_error(env, nullptr, "The grid sizes and header size can't be negative.");
+    return false;
+  }
+
+  const size_t numValues = static_cast<size_t>(packArgs->xSize)*packArgs->ySize*packArgs->zSize*3;
+  packArgs->outStride = headerSize + octopack::slaveFrameSize(packArgs->ySize, packArgs->zSize);
+  if (framebufferLength < numValues) {
+    napi_throw_range_error(env, nullptr, "The framebuffer is smaller than the grid.");
+    return false;
+  }
+  if (outLength < octopack::numSlaves(packArgs->xSize)*packArgs->outStride) {
+    napi_throw_range_error(env, nullptr, "The output is too small for every slave's packet.");
+    return false;
+  }
+
+  packArgs->gamma = static_cast<const uint8_t*>(gammaData);
+  packArgs->out = static_cast<uint8_t*>(outData) + headerSize;
+  return true;
+}
+
+/**
+ * packSlaveFrames(framebuffer, xSize, ySize, zSize, brightness, gammaTable, out, headerSize)
+ * Packs the frame of every slave into out (a Buffer/Uint8Array), slave s's frame starts at
+ * s*(headerSize + ySize*zSize*24) + headerSize, leaving room in front of each frame for its packet header.
+ * The framebuffer is a flat Float32Array (colours in [0,1]) or Uint8Array (colours in [0,255]).
+ */
+static napi_value PackSlaveFrames(napi_env env, napi_callback_info info) {
+  PackArgs a;
+  if (!getPackArgs(env, info, true, "packSlaveFrames", &a)) {
+    return nullptr;
+  }
+  if (a.framebufferType == napi_float32_array) {
+    octopack::pack(static_cast<const float*>(a.framebuffer), a.xSize, a.ySize, a.zSize, a.brightness, a.gamma, a.out, a.outStride);
+  }
+  else {
+    octopack::pack(static_cast<const uint8_t*>(a.framebuffer), a.xSize, a.ySize, a.zSize, a.brightness, a.gamma, a.out, a.outStride);
+  }
+  return nullptr;
+}
+
+/**
+ * packSlaveRawFrames(framebuffer, xSize, ySize, zSize, out, headerSize)
+ * The same as packSlaveFrames, but the frames hold raw colours for slaves that apply their own colour LUT.
+ */
+static napi_value PackSlaveRawFrames(napi_env env, napi_callback_info info) {
+  PackArgs a;
+  if (!getPackArgs(env, info, false, "packSlaveRawFrames", &a)) {
+    return nullptr;
+  }
+  if (a.framebufferType == napi_float32_array) {
+    octopack::packRaw(static_cast<const float*>(a.framebuffer), a.xSize, a.ySize, a.zSize, a.out, a.outStride);
+  }
+  else {
+    octopack::packRaw(static_cast<const uint8_t*>(a.framebuffer), a.xSize, a.ySize, a.zSize, a.out, a.outStride);
+  }
+  return nullptr;
+}
+
+/**
+ * simdPath()
+ * The name of the transpose path being used ("avx2", "sse2" or "scalar").
+ */
+static napi_value SimdPath(napi_env env, napi_callback_info) {
+  napi_value result;
+  const char* name = octopack::pathName(octopack::bestPath());
+  NAPI_CALL(env, napi_create_string_utf8(env, name, strlen(name), &result));
+  return result;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+  napi_property_descriptor properties[] = {
+    { "packSlaveFrames", nullptr, PackSlaveFrames, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "packSlaveRawFrames", nullptr, PackSlaveRawFrames, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "simdPath", nullptr, SimdPath, nullptr, nullptr, nullptr, napi_default, nullptr },
+  };
+  NAPI_CALL(env, napi_define_properties(env, exports, sizeof(properties)/sizeof(properties[0]), properties));
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,191 @@
+// Benchmark for the octo packer: packs random frames with every transpose path the CPU supports, checks them against
+// a straightforward per-voxel reference (the same algorithm the server used to run in JS) and reports the time per frame.
+//
+// Usage: octopack_bench [options]
+//   --slaves N   Number of slaves, i.e., the x size is 8*N (default 2)
+//   --size N     The y and z size of the grid (default 16)
+//   --y N        The y size of the grid (default --size)
+//   --z N        The z size of the grid (default --size)
+//   --frames N   Number of frames packed by each path (default 2000)
+//   --scaling    Pack frames for a range of grid sizes with the best path and report the time per frame and per voxel
+
+#include "octopack.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+static void packReference(const float* framebuffer, int xSize, int ySize, int zSize, float brightness,
+                          const uint8_t gamma[256], uint8_t* out, size_t outStride) {
+  for (int s = 0; s < octopack::numSlaves(xSize); s++) {
+    uint8_t* slaveOut = out + s*outStride;
+    for (int z = 0; z < zSize; z++) {
+      for (int y = 0; y < ySize; y++) {
+        uint32_t octoVoxels[octopack::NUM_OCTO_PINS];
+        for (int i = 0; i < octopack::NUM_OCTO_PINS; i++) {
+          const float* voxel = &framebuffer[((static_cast<size_t>(s*octopack::NUM_OCTO_PINS + i)*ySize + y)*zSize + z)*3];
+          uint32_t colour = 0;
+          for (int c = 0; c < 3; c++) {
+            double value = voxel[c]*(255.0*brightness);
+            colour = (colour << 8) | gamma[value >= 255.0 ? 255 : (value > 0.0 ? static_cast<int>(value) : 0)];
+          }
+          octoVoxels[i] = colour;
+        }
+        for (uint32_t mask = 0x800000; mask != 0; mask >>= 1) {
+          uint8_t b = 0;
+          for (int i = 0; i < octopack::NUM_OCTO_PINS; i++) {
+            if ((octoVoxels[i] & mask) != 0) { b |= (1 << i); }
+          }
+          *slaveOut++ = b;
+        }
+      }
+    }
+  }
+}
+
+struct BenchGrid {
+  BenchGrid(int xSize, int ySize, int zSize) : xSize(xSize), ySize(ySize), zSize(zSize),
+    numSlaves(octopack::numSlaves(xSize)), frameSize(octopack::slaveFrameSize(ySize, zSize)),
+    floatFramebuffer(static_cast<size_t>(xSize)*ySize*zSize*3), uint8Framebuffer(floatFramebuffer.size()),
+    out(numSlaves*frameSize) {
+
+    // A few colour channels go over 1 to make sure that they're clamped
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> colourDist(0.0f, 1.1f);
+    for (size_t i = 0; i < floatFramebuffer.size(); i++) {
+      floatFramebuffer[i] = colourDist(rng);
+      uint8Framebuffer[i] = static_cast<uint8_t>(rng());
+    }
+  }
+
+  size_t numVoxels() const { return static_cast<size_t>(xSize)*ySize*zSize; }
+
+  int xSize, ySize, zSize;
+  int numSlaves;
+  size_t frameSize;
+  std::vector<float> floatFramebuffer;
+  std::vector<uint8_t> uint8Framebuffer;
+  std::vector<uint8_t> out;
+};
+
+static double secsPerFrame(int numFrames, const std::function<void()>& packFrame) {
+  auto startTime = std::chrono::steady_clock::now();
+  for (int i = 0; i < numFrames; i++) { packFrame(); }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()-startTime).count() / numFrames;
+}
+
+// Frame build time for grids from the original 16^3 up to 64^3, including the non-cubic shapes of real installations
+static void benchScaling(int numFrames, float brightness, const uint8_t gamma[256]) {
+  const int gridSizes[][3] = { {16,16,16}, {24,16,32}, {32,32,32}, {48,32,48}, {48,48,48}, {64,64,64} };
+  const octopack::Path path = octopack::bestPath();
+
+  printf("Frame build time versus voxel count (%s path)\n", octopack::pathName(path));
+  printf("%-10s %8s %7s %12s %12s %12s\n", "grid", "voxels", "slaves", "us/frame", "ns/voxel", "raw us/frame");
+  for (const auto& size : gridSizes) {
+    BenchGrid grid(size[0], size[1], size[2]);
+    // Keep the total work about the same for every grid size
+    const int gridFrames = std::max(10, static_cast<int>(numFrames*4096/grid.numVoxels()));
+
+    double packSecs = secsPerFrame(gridFrames, [&]() {
+      octopack::pack(grid.floatFramebuffer.data(), grid.xSize, grid.ySize, grid.zSize, brightness, gamma,
+        grid.out.data(), grid.frameSize, path);
+    });
+    double packRawSecs = secsPerFrame(gridFrames, [&]() {
+      octopack::packRaw(grid.floatFramebuffer.data(), grid.xSize, grid.ySize, grid.zSize, grid.out.data(), grid.frameSize);
+    });
+
+    char gridName[32];
+    snprintf(gridName, sizeof(gridName), "%dx%dx%d", grid.xSize, grid.ySize, grid.zSize);
+    printf("%-10s %8zu %7d %12.2f %12.2f %12.2f\n", gridName, grid.numVoxels(), grid.numSlaves,
+      1.0e6*packSecs, 1.0e9*packSecs/grid.numVoxels(), 1.0e6*packRawSecs);
+  }
+}
+
+int main(int argc, char** argv) {
+  int numSlaves = 2;
+  int ySize = 16, zSize = 16;
+  int numFrames = 2000;
+  bool scaling = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg == "--slaves" && i+1 < argc) { numSlaves = atoi(argv[++i]); }
+    else if (arg == "--size" && i+1 < argc) { ySize = zSize = atoi(argv[++i]); }
+    else if (arg == "--y" && i+1 < argc) { ySize = atoi(argv[++i]); }
+    else if (arg == "--z" && i+1 < argc) { zSize = atoi(argv[++i]); }
+    else if (arg == "--frames" && i+1 < argc) { numFrames = atoi(argv[++i]); }
+    else if (arg == "--scaling") { scaling = true; }
+    else {
+      fprintf(stderr, "Unknown option '%s'\n", argv[i]);
+      return 1;
+    }
+  }
+
+  const float brightness = 0.8f;
+
+  uint8_t gamma[256];
+  for (int i = 0; i < 256; i++) { gamma[i] = static_cast<uint8_t>(255.0*pow(i/255.0, 2.2) + 0.5); }
+
+  if (scaling) {
+    benchScaling(numFrames, brightness, gamma);
+    return 0;
+  }
+
+  BenchGrid grid(numSlaves*octopack::NUM_OCTO_PINS, ySize, zSize);
+  const int xSize = grid.xSize;
+  const size_t frameSize = grid.frameSize;
+  std::vector<float>& floatFramebuffer = grid.floatFramebuffer;
+  std::vector<uint8_t>& uint8Framebuffer = grid.uint8Framebuffer;
+  std::vector<uint8_t>& out = grid.out;
+
+  std::vector<uint8_t> expected(numSlaves*frameSize);
+  packReference(floatFramebuffer.data(), xSize, ySize, zSize, brightness, gamma, expected.data(), frameSize);
+
+  printf("Grid: %dx%dx%d (%d slaves), %zu bytes per slave frame, best path: %s\n",
+    xSize, ySize, zSize, numSlaves, frameSize, octopack::pathName(octopack::bestPath()));
+
+  auto timeFrames = [&](const char* name, const std::function<void()>& packFrame) {
+    printf("%-16s %8.2f us/frame\n", name, 1.0e6*secsPerFrame(numFrames, packFrame));
+  };
+
+  timeFrames("reference", [&]() {
+    packReference(floatFramebuffer.data(), xSize, ySize, zSize, brightness, gamma, out.data(), frameSize);
+  });
+
+  bool allMatch = true;
+  const octopack::Path paths[] = { octopack::Path::Scalar, octopack::Path::SSE2, octopack::Path::AVX2 };
+  for (octopack::Path path : paths) {
+    if (path > octopack::bestPath()) { continue; }
+
+    std::vector<uint8_t> uint8Expected(numSlaves*frameSize);
+    octopack::pack(uint8Framebuffer.data(), xSize, ySize, zSize, brightness, gamma, uint8Expected.data(), frameSize, octopack::Path::Scalar);
+
+    std::string floatName = std::string(octopack::pathName(path)) + " (float)";
+    timeFrames(floatName.c_str(), [&]() {
+      octopack::pack(floatFramebuffer.data(), xSize, ySize, zSize, brightness, gamma, out.data(), frameSize, path);
+    });
+    bool floatMatch = out == expected;
+
+    std::string uint8Name = std::string(octopack::pathName(path)) + " (uint8)";
+    timeFrames(uint8Name.c_str(), [&]() {
+      octopack::pack(uint8Framebuffer.data(), xSize, ySize, zSize, brightness, gamma, out.data(), frameSize, path);
+    });
+    bool uint8Match = out == uint8Expected;
+
+    if (!floatMatch || !uint8Match) {
+      printf("ERROR: %s output doesn't match the reference (float: %s, uint8: %s)\n",
+        octopack::pathName(path), floatMatch ? "ok" : "mismatch", uint8Match ? "ok" : "mismatch");
+      allMatch = false;
+    }
+  }
+
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+#include "voxelkernels.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+// SSE2 is part of x86-64 so it doesn't need a runtime check, everything else gets the scalar loops (which the
+// compiler is free to vectorize for its own target)
+#if defined(__x86_64__) || defined(_M_X64)
+#define VOXELKERNELS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace voxelkernels {
+
+  namespace {
+
+    // Four voxels' worth of a colour, i.e., 12 channel values that line up with three 4-wide vectors
+    const int PATTERN_VOXELS = 4;
+    struct ColourPattern {
+      alignas(16) float values[PATTERN_VOXELS*3];
+      explicit ColourPattern(const float colour[3]) {
+        for (int i = 0; i < PATTERN_VOXELS*3; i++) { values[i] = colour[i % 3]; }
+      }
+    };
+
+    inline float clamp01(float value) { return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value); }
+
+    // Write or add the colour to numVoxels consecutive voxels
+    void drawSpan(float* out, int numVoxels, const ColourPattern& pattern, BlendMode mode) {
+      int i = 0;
+#ifdef VOXELKERNELS_SSE2
+      const __m128 p0 = _mm_load_ps(&pattern.values[0]);
+      const __m128 p1 = _mm_load_ps(&pattern.values[4]);
+      const __m128 p2 = _mm_load_ps(&pattern.values[8]);
+      if (mode == BLEND_ADDITIVE) {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (; i + PATTERN_VOXELS <= numVoxels; i += PATTERN_VOXELS, out += PATTERN_VOXELS*3) {
+          _mm_storeu_ps(out,   _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_loadu_ps(out),   p0), zero), one));
+          _mm_storeu_ps(out+4, _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_loadu_ps(out+4), p1), zero), one));
+          _mm_storeu_ps(out+8, _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_loadu_ps(out+8), p2), zero), one));
+        }
+      }
+      else {
+        for (; i + PATTERN_VOXELS <= numVoxels; i += PATTERN_VOXELS, out += PATTERN_VOXELS*3) {
+          _mm_storeu_ps(out,   p0);
+          _mm_storeu_ps(out+4, p1);
+          _mm_storeu_ps(out+8, p2);
+        }
+      }
+#endif
+      for (; i < numVoxels; i++, out += 3) {
+        for (int c = 0; c < 3; c++) {
+          out[c] = (mode == BLEND_ADDITIVE) ? clamp01(out[c] + pattern.values[c]) : pattern.values[c];
+        }
+      }
+    }
+
+    inline float* voxelAt(const Grid& grid, int x, int y, int z) {
+      return &grid.buffer[((static_cast<size_t>(x)*grid.ySize + y)*grid.zSize + z)*3];
+    }
+
+  }
+
+  void clear(const Grid& grid, const float colour[3]) {
+    // The z-columns are back to back, so the whole buffer is cleared as one span per x-slice
+    const ColourPattern pattern(colour);
+    const int sliceVoxels = grid.ySize*grid.zSize;
+    for (int x = 0; x < grid.xSize; x++) {
+      drawSpan(voxelAt(grid, x, 0, 0), sliceVoxels, pattern, BLEND_OVERWRITE);
+    }
+  }
+
+  void blend(float* dst, const float* src, size_t numValues, BlendMode mode) {
+    if (mode != BLEND_ADDITIVE) {
+      if (dst != src) { memmove(dst, src, numValues*sizeof(float)); }
+      return;
+    }
+
+    size_t i = 0;
+#ifdef VOXELKERNELS_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= numValues; i += 4) {
+      const __m128 sum = _mm_add_ps(_mm_loadu_ps(&dst[i]), _mm_loadu_ps(&src[i]));
+      _mm_storeu_ps(&dst[i], _mm_min_ps(_mm_max_ps(sum, zero), one));
+    }
+#endif
+    for (; i < numValues; i++) { dst[i] = clamp01(dst[i] + src[i]); }
+  }
+
+  void combineAlpha(float* dst, const float* fb1, const float* fb2, size_t numValues, float alpha) {
+    const float oneMinusAlpha = 1.0f - alpha;
+    size_t i = 0;
+#ifdef VOXELKERNELS_SSE2
+    const __m128 a = _mm_set1_ps(alpha);
+    const __m128 b = _mm_set1_ps(oneMinusAlpha);
+    for (; i + 4 <= numValues; i += 4) {
+      const __m128 value = _mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(&fb1[i])), _mm_mul_ps(b, _mm_loadu_ps(&fb2[i])));
+      _mm_storeu_ps(&dst[i], value);
+    }
+#endif
+    for (; i < numValues; i++) { dst[i] = alpha*fb1[i] + oneMinusAlpha*fb2[i]; }
+  }
+
+  void drawAABB(const Grid& grid, const double minPt[3], const double maxPt[3], const float colour[3], bool fill, BlendMode mode) {
+    const int sizes[3] = { grid.xSize, grid.ySize, grid.zSize };
+    int lo[3], hi[3];
+    for (int i = 0; i < 3; i++) {
+      lo[i] = static_cast<int>(std::max(floor(minPt[i]), 0.0));
+      hi[i] = static_cast<int>(std::min(ceil(maxPt[i]), static_cast<double>(sizes[i]-1)));
+      if (lo[i] > hi[i]) { return; }
+    }
+
+    const ColourPattern pattern(colour);
+    const int spanLength = hi[2] - lo[2] + 1;
+    for (int x = lo[0]; x <= hi[0]; x++) {
+      for (int y = lo[1]; y <= hi[1]; y++) {
+        float* span = voxelAt(grid, x, y, lo[2]);
+        if (fill || x == lo[0] || x == hi[0] || y == lo[1] || y == hi[1]) {
+          drawSpan(span, spanLength, pattern, mode);
+        }
+        else {
+          // Inside the box's outer x and y layers only the two z faces are drawn
+          drawSpan(span, 1, pattern, mode);
+          if (spanLength > 1) {
+            drawSpan(span + (spanLength-1)*3, 1, pattern, mode);
+          }
+        }
+      }
+    }
+  }
+
+  void drawSphere(const Grid& grid, const double center[3], double radius, double errUnits, const float colour[3],
+                  bool fill, BlendMode mode) {
+    const int sizes[3] = { grid.xSize, grid.ySize, grid.zSize };
+    int lo[3], hi[3];
+    for (int i = 0; i < 3; i++) {
+      lo[i] = static_cast<int>(std::max(floor(center[i] - radius), 0.0));
+      hi[i] = static_cast<int>(std::min(ceil(center[i] + radius), static_cast<double>(sizes[i]-1)));
+      if (lo[i] > hi[i]) { return; }
+    }
+
+    // Each voxel gets the same test as VoxelGeometryUtils.voxelSphereList, the voxels that pass are drawn in runs along z
+    const ColourPattern pattern(colour);
+    for (int x = lo[0]; x <= hi[0]; x++) {
+      const double dx = x - center[0];
+      for (int y = lo[1]; y <= hi[1]; y++) {
+        const double dy = y - center[1];
+        const double dxySqr = dx*dx + dy*dy;
+        float* column = voxelAt(grid, x, y, 0);
+        int runStart = -1;
+        for (int z = lo[2]; z <= hi[2] + 1; z++) {
+          bool inside = false;
+          if (z <= hi[2]) {
+            const double dz = z - center[2];
+            const double dist = sqrt(dxySqr + dz*dz) - radius;
+            inside = fill ? (dist < errUnits) : (fabs(dist) < errUnits);
+          }
+          if (inside && runStart < 0) {
+            runStart = z;
+          }
+          else if (!inside && runStart >= 0) {
+            drawSpan(&column[runStart*3], z - runStart, pattern, mode);
+            runStart = -1;
+          }
+        }
+      }
+    }
+  }
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Kernels for the CPU voxel framebuffer (see src/Server/VoxelFramebufferCPU.js).
+//
+// The framebuffer is one contiguous array of floats laid out like the server's nested voxel data, i.e., the RGB colour
+// of voxel (x,y,z) starts at ((x*ySize + y)*zSize + z)*3, with every colour channel in [0,1]. Each z-column of voxels is
+// contiguous, so the primitives are rasterized as spans along z and the whole-buffer kernels run over the flat array.
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace voxelkernels {
+
+  // Matches BLEND_MODE_OVERWRITE and BLEND_MODE_ADDITIVE in VoxelModel.js
+  enum BlendMode { BLEND_OVERWRITE = 0, BLEND_ADDITIVE = 1 };
+
+  struct Grid {
+    float* buffer;
+    int xSize, ySize, zSize;
+    size_t numValues() const { return static_cast<size_t>(xSize)*ySize*zSize*3; }
+  };
+
+  // Set every voxel to the given colour
+  void clear(const Grid& grid, const float colour[3]);
+
+  // Blend numValues channel values of src into dst, additive blending clamps the results to [0,1]
+  void blend(float* dst, const float* src, size_t numValues, BlendMode mode);
+
+  // dst = alpha*fb1 + (1-alpha)*fb2, dst may be one of fb1 or fb2
+  void combineAlpha(float* dst, const float* fb1, const float* fb2, size_t numValues, float alpha);
+
+  // Draw the voxels of the box [floor(minPt), ceil(maxPt)] (clipped to the grid), only its outer layer of voxels
+  // when it isn't filled
+  void drawAABB(const Grid& grid, const double minPt[3], const double maxPt[3], const float colour[3], bool fill, BlendMode mode);
+
+  // Draw the voxels whose centers are within errUnits of the sphere (or inside it when it's filled)
+  void drawSphere(const Grid& grid, const double center[3], double radius, double errUnits, const float colour[3],
+                  bool fill, BlendMode mode);
+
+}
@@ -0,0 +1,192 @@
+// Node addon exposing the CPU voxel framebuffer kernels (see voxelkernels.h) to the server, loaded through
+// src/Server/VoxelKernels.js.
+
+#include <node_api.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "voxelkernels.h"
+
+#define NAPI_CALL(env, call) \
+  do { if ((call) != napi_ok) { napi_throw_error((env), nullptr, "N-API call failed: " #call); return nullptr; } } while (0)
+
+static const size_t MAX_ARGS = 16;
+
+// Reads the arguments of a kernel, throwing a JS error and returning false when there are too few of them
+static bool getArgs(napi_env env, napi_callback_info info, size_t numArgs, const char* funcName, napi_value* args) {
+  size_t argc = MAX_ARGS;
+  if (napi_get_cb_info(env, info, &argc, args, nullptr, nullptr) != napi_ok) {
+    napi_throw_error(env, nullptr, "Failed to get the arguments.");
+    return false;
+  }
+  if (argc < numArgs) {
+    char message[64];
+    snprintf(message, sizeof(message), "%s expects %d arguments.", funcName, static_cast<int>(numArgs));
+    napi_throw_type_error(env, nullptr, message);
+    return false;
+  }
+  return true;
+}
+
+static bool getFloatArrayArg(napi_env env, napi_value value, float** data, size_t* length) {
+  bool isTypedArray = false;
+  napi_typedarray_type type;
+  void* arrayData = nullptr;
+  if (napi_is_typedarray(env, value, &isTypedArray) != napi_ok || !isTypedArray ||
+      napi_get_typedarray_info(env, value, &type, length, &arrayData, nullptr, nullptr) != napi_ok ||
+      type != napi_float32_array) {
+    napi_throw_type_error(env, nullptr, "Framebuffers must be Float32Arrays.");
+    return false;
+  }
+  *data = static_cast<float*>(arrayData);
+  return true;
+}
+
+static bool getDoubleArgs(napi_env env, const napi_value* args, size_t numArgs, double* values) {
+  for (size_t i = 0; i < numArgs; i++) {
+    if (napi_get_value_double(env, args[i], &values[i]) != napi_ok) {
+      napi_throw_type_error(env, nullptr, "Expected a number.");
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads (framebuffer, xSize, ySize, zSize) into a grid
+static bool getGridArgs(napi_env env, const napi_value* args, voxelkernels::Grid* grid) {
+  size_t length = 0;
+  if (!getFloatArrayArg(env, args[0], &grid->buffer, &length)) {
+    return false;
+  }
+  if (napi_get_value_int32(env, args[1], &grid->xSize) != napi_ok ||
+      napi_get_value_int32(env, args[2], &grid->ySize) != napi_ok ||
+      napi_get_value_int32(env, args[3], &grid->zSize) != napi_ok) {
+    napi_throw_type_error(env, nullptr, "The grid sizes must be numbers.");
+    return false;
+  }
+  if (grid->xSize < 0 || grid->ySize < 0 || grid->zSize < 0 || length < grid->numValues()) {
+    napi_throw_range_error(env, nullptr, "The framebuffer is smaller than the grid.");
+    return false;
+  }
+  return true;
+}
+
+static voxelkernels::BlendMode toBlendMode(double value) {
+  return static_cast<int>(value) == voxelkernels::BLEND_ADDITIVE ? voxelkernels::BLEND_ADDITIVE : voxelkernels::BLEND_OVERWRITE;
+}
+
+/**
+ * clear(framebuffer, xSize, ySize, zSize, r, g, b)
+ */
+static napi_value Clear(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  voxelkernels::Grid grid;
+  double colour[3];
+  if (!getArgs(env, info, 7, "clear", args) || !getGridArgs(env, args, &grid) || !getDoubleArgs(env, &args[4], 3, colour)) {
+    return nullptr;
+  }
+  const float colourF[3] = { static_cast<float>(colour[0]), static_cast<float>(colour[1]), static_cast<float>(colour[2]) };
+  voxelkernels::clear(grid, colourF);
+  return nullptr;
+}
+
+/**
+ * blend(dstFramebuffer, srcFramebuffer, blendMode)
+ * Both framebuffers must be the same size.
+ */
+static napi_value Blend(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  float* dst = nullptr;
+  float* src = nullptr;
+  size_t dstLength = 0, srcLength = 0;
+  double blendMode = 0;
+  if (!getArgs(env, info, 3, "blend", args) || !getFloatArrayArg(env, args[0], &dst, &dstLength) ||
+      !getFloatArrayArg(env, args[1], &src, &srcLength) || !getDoubleArgs(env, &args[2], 1, &blendMode)) {
+    return nullptr;
+  }
+  if (dstLength != srcLength) {
+    napi_throw_range_error(env, nullptr, "The framebuffers must be the same size.");
+    return nullptr;
+  }
+  voxelkernels::blend(dst, src, dstLength, toBlendMode(blendMode));
+  return nullptr;
+}
+
+/**
+ * combineAlpha(dstFramebuffer, framebuffer1, framebuffer2, alpha)
+ * dst = alpha*framebuffer1 + (1-alpha)*framebuffer2, all of the framebuffers must be the same size.
+ */
+static napi_value CombineAlpha(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  float* dst = nullptr;
+  float* fb1 = nullptr;
+  float* fb2 = nullptr;
+  size_t dstLength = 0, fb1Length = 0, fb2Length = 0;
+  double alpha = 0;
+  if (!getArgs(env, info, 4, "combineAlpha", args) || !getFloatArrayArg(env, args[0], &dst, &dstLength) ||
+      !getFloatArrayArg(env, args[1], &fb1, &fb1Length) || !getFloatArrayArg(env, args[2], &fb2, &fb2Length) ||
+      !getDoubleArgs(env, &args[3], 1, &alpha)) {
+    return nullptr;
+  }
+  if (dstLength != fb1Length || dstLength != fb2Length) {
+    napi_throw_range_error(env, nullptr, "The framebuffers must be the same size.");
+    return nullptr;
+  }
+  voxelkernels::combineAlpha(dst, fb1, fb2, dstLength, static_cast<float>(alpha));
+  return nullptr;
+}
+
+/**
+ * drawAABB(framebuffer, xSize, ySize, zSize, minX, minY, minZ, maxX, maxY, maxZ, r, g, b, fill, blendMode)
+ */
+static napi_value DrawAABB(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  voxelkernels::Grid grid;
+  double values[11];
+  bool fill = false;
+  if (!getArgs(env, info, 15, "drawAABB", args) || !getGridArgs(env, args, &grid) ||
+      !getDoubleArgs(env, &args[4], 9, values) || !getDoubleArgs(env, &args[14], 1, &values[10])) {
+    return nullptr;
+  }
+  NAPI_CALL(env, napi_coerce_to_bool(env, args[13], &args[13]));
+  NAPI_CALL(env, napi_get_value_bool(env, args[13], &fill));
+
+  const float colour[3] = { static_cast<float>(values[6]), static_cast<float>(values[7]), static_cast<float>(values[8]) };
+  voxelkernels::drawAABB(grid, &values[0], &values[3], colour, fill, toBlendMode(values[10]));
+  return nullptr;
+}
+
+/**
+ * drawSphere(framebuffer, xSize, ySize, zSize, centerX, centerY, centerZ, radius, errUnits, r, g, b, fill, blendMode)
+ */
+static napi_value DrawSphere(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  voxelkernels::Grid grid;
+  double values[10];
+  bool fill = false;
+  if (!getArgs(env, info, 14, "drawSphere", args) || !getGridArgs(env, args, &grid) ||
+      !getDoubleArgs(env, &args[4], 8, values) || !getDoubleArgs(env, &args[13], 1, &values[9])) {
+    return nullptr;
+  }
+  NAPI_CALL(env, napi_coerce_to_bool(env, args[12], &args[12]));
+  NAPI_CALL(env, napi_get_value_bool(env, args[12], &fill));
+
+  const float colour[3] = { static_cast<float>(values[5]), static_cast<float>(values[6]), static_cast<float>(values[7]) };
+  voxelkernels::drawSphere(grid, &values[0], values[3], values[4], colour, fill, toBlendMode(values[9]));
+  return nullptr;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+  napi_property_descriptor properties[] = {
+    { "clear", nullptr, Clear, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "blend", nullptr, Blend, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "combineAlpha", nullptr, CombineAlpha, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "drawAABB", nullptr, DrawAABB, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "drawSphere", nullptr, DrawSphere, nullptr, nullptr, nullptr, napi_default, nullptr },
+  };
+  NAPI_CALL(env, napi_define_properties(env, exports, sizeof(properties)/sizeof(properties[0]), properties));
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,899 @@
+#include "vtcore.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+// SSE2 is part of x86-64 so it doesn't need a runtime check, everything else gets the scalar loops (which the
+// compiler is free to vectorize for its own target)
+#if defined(__x86_64__) || defined(_M_X64)
+#define VTCORE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace vtcore {
+
+  namespace {
+
+    // Matches VoxelConstants.VOXEL_EPSILON and the constants of MathUtils.js
+    const double VOXEL_EPSILON = 0.00001;
+    const double SQRT3 = 1.73205080757;
+    const double SQRT2PI = 4.44288293816;
+    const double SQRT1_2 = 0.7071067811865476;
+
+    const int LEAF_TRIANGLES = 4; // Triangles per BVH leaf, i.e., one packet
+    const double NO_INV_DIRECTION = 1e30; // Stands in for 1/0 in the slab tests so that they never produce NaNs
+    // The slab tests that cull shadow casters and BVH nodes are padded by this much along the ray, so that rounding
+    // never culls anything that the exact tests would count as a hit (e.g., rays that end on the corner of a voxel)
+    const double CULL_MARGIN = VOXEL_EPSILON;
+
+    // Like MathUtils.clamp, NaNs stay NaNs
+    inline double clamp(double value, double min, double max) {
+      return (value != value) ? value : (value < min ? min : (value > max ? max : value));
+    }
+
+    // THREE.Vector3.applyMatrix4 (column-major, with the perspective divide)
+    inline Vec3 applyMatrix4(const Vec3& v, const double* e) {
+      const double w = 1 / (e[3]*v.x + e[7]*v.y + e[11]*v.z + e[15]);
+      return Vec3((e[0]*v.x + e[4]*v.y + e[8]*v.z + e[12])*w,
+                  (e[1]*v.x + e[5]*v.y + e[9]*v.z + e[13])*w,
+                  (e[2]*v.x + e[6]*v.y + e[10]*v.z + e[14])*w);
+    }
+    // THREE.Vector3.transformDirection
+    inline Vec3 transformDirection(const Vec3& v, const double* e) {
+      return Vec3(e[0]*v.x + e[4]*v.y + e[8]*v.z,
+                  e[1]*v.x + e[5]*v.y + e[9]*v.z,
+                  e[2]*v.x + e[6]*v.y + e[10]*v.z).normalized();
+    }
+
+    // THREE.Matrix4.invert, a singular matrix becomes all zeros
+    void invertMatrix4(const double* m, double* result) {
+      const double n11 = m[0], n21 = m[1], n31 = m[2], n41 = m[3];
+      const double n12 = m[4], n22 = m[5], n32 = m[6], n42 = m[7];
+      const double n13 = m[8], n23 = m[9], n33 = m[10], n43 = m[11];
+      const double n14 = m[12], n24 = m[13], n34 = m[14], n44 = m[15];
+
+      const double t11 = n23*n34*n42 - n24*n33*n42 + n24*n32*n43 - n22*n34*n43 - n23*n32*n44 + n22*n33*n44;
+      const double t12 = n14*n33*n42 - n13*n34*n42 - n14*n32*n43 + n12*n34*n43 + n13*n32*n44 - n12*n33*n44;
+      const double t13 = n13*n24*n42 - n14*n23*n42 + n14*n22*n43 - n12*n24*n43 - n13*n22*n44 + n12*n23*n44;
+      const double t14 = n14*n23*n32 - n13*n24*n32 - n14*n22*n33 + n12*n24*n33 + n13*n22*n34 - n12*n23*n34;
+
+      const double det = n11*t11 + n21*t12 + n31*t13 + n41*t14;
+      if (det == 0) {
+        for (int i = 0; i < 16; i++) { result[i] = 0; }
+        return;
+      }
+      const double detInv = 1 / det;
+
+      result[0] = t11*detInv;
+      result[1] = (n24*n33*n41 - n23*n34*n41 - n24*n31*n43 + n21*n34*n43 + n23*n31*n44 - n21*n33*n44)*detInv;
+      result[2] = (n22*n34*n41 - n24*n32*n41 + n24*n31*n42 - n21*n34*n42 - n22*n31*n44 + n21*n32*n44)*detInv;
+      result[3] = (n23*n32*n41 - n22*n33*n41 - n23*n31*n42 + n21*n33*n42 + n22*n31*n43 - n21*n32*n43)*detInv;
+
+      result[4] = t12*detInv;
+      result[5] = (n13*n34*n41 - n14*n33*n41 + n14*n31*n43 - n11*n34*n43 - n13*n31*n44 + n11*n33*n44)*detInv;
+      result[6] = (n14*n32*n41 - n12*n34*n41 - n14*n31*n42 + n11*n34*n42 + n12*n31*n44 - n11*n32*n44)*detInv;
+      result[7] = (n12*n33*n41 - n13*n32*n41 + n13*n31*n42 - n11*n33*n42 - n12*n31*n43 + n11*n32*n43)*detInv;
+
+      result[8] = t13*detInv;
+      result[9] = (n14*n23*n41 - n13*n24*n41 - n14*n21*n43 + n11*n24*n43 + n13*n21*n44 - n11*n23*n44)*detInv;
+      result[10] = (n12*n24*n41 - n14*n22*n41 + n14*n21*n42 - n11*n24*n42 - n12*n21*n44 + n11*n22*n44)*detInv;
+      result[11] = (n13*n22*n41 - n12*n23*n41 - n13*n21*n42 + n11*n23*n42 + n12*n21*n43 - n11*n22*n43)*detInv;
+
+      result[12] = t14*detInv;
+      result[13] = (n13*n24*n31 - n14*n23*n31 + n14*n21*n33 - n11*n24*n33 - n13*n21*n34 + n11*n23*n34)*detInv;
+      result[14] = (n14*n22*n31 - n12*n24*n31 - n14*n21*n32 + n11*n24*n32 + n12*n21*n34 - n11*n22*n34)*detInv;
+      result[15] = (n12*n23*n31 - n13*n22*n31 + n13*n21*n32 - n11*n23*n32 - n12*n21*n33 + n11*n22*n33)*detInv;
+    }
+
+    // THREE.Triangle.closestPointToPoint
+    Vec3 closestPointOnTriangle(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c) {
+      const Vec3 ab = b - a, ac = c - a, ap = p - a;
+      const double d1 = ab.dot(ap), d2 = ac.dot(ap);
+      if (d1 <= 0 && d2 <= 0) { return a; }
+
+      const Vec3 bp = p - b;
+      const double d3 = ab.dot(bp), d4 = ac.dot(bp);
+      if (d3 >= 0 && d4 <= d3) { return b; }
+
+      const double vc = d1*d4 - d3*d2;
+      if (vc <= 0 && d1 >= 0 && d3 <= 0) { return a + ab*(d1 / (d1 - d3)); }
+
+      const Vec3 cp = p - c;
+      const double d5 = ab.dot(cp), d6 = ac.dot(cp);
+      if (d6 >= 0 && d5 <= d6) { return c; }
+
+      const double vb = d5*d2 - d1*d6;
+      if (vb <= 0 && d2 >= 0 && d6 <= 0) { return a + ac*(d2 / (d2 - d6)); }
+
+      const double va = d3*d6 - d5*d4;
+      if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        return b + (c - b)*((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+      }
+
+      const double denom = 1 / (va + vb + vc);
+      return a + ab*(vb*denom) + ac*(vc*denom);
+    }
+
+    // THREE.Triangle.getBarycoord
+    Vec3 barycoord(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c) {
+      const Vec3 v0 = c - a, v1 = b - a, v2 = p - a;
+      const double dot00 = v0.dot(v0), dot01 = v0.dot(v1), dot02 = v0.dot(v2), dot11 = v1.dot(v1), dot12 = v1.dot(v2);
+      const double denom = dot00*dot11 - dot01*dot01;
+      if (denom == 0) { return Vec3(-2, -1, -1); }
+      const double invDenom = 1 / denom;
+      const double u = (dot11*dot02 - dot01*dot12)*invDenom;
+      const double v = (dot00*dot12 - dot01*dot02)*invDenom;
+      return Vec3(1 - u - v, v, u);
+    }
+
+    // THREE.Ray.intersectBox, the distance from the ray's origin to where it enters the box (or leaves it, when the
+    // ray starts inside of it). The distance is measured between the points, the same way as VTVoxelAbstract.intersectsRay.
+    bool rayIntersectsBox(const Ray& ray, const Box& box, double* distance) {
+      const Vec3& o = ray.origin;
+      const double invX = 1 / ray.direction.x, invY = 1 / ray.direction.y, invZ = 1 / ray.direction.z;
+      double tmin, tmax, tymin, tymax, tzmin, tzmax;
+      if (invX >= 0) { tmin = (box.min.x - o.x)*invX; tmax = (box.max.x - o.x)*invX; }
+      else { tmin = (box.max.x - o.x)*invX; tmax = (box.min.x - o.x)*invX; }
+      if (invY >= 0) { tymin = (box.min.y - o.y)*invY; tymax = (box.max.y - o.y)*invY; }
+      else { tymin = (box.max.y - o.y)*invY; tymax = (box.min.y - o.y)*invY; }
+      if (tmin > tymax || tymin > tmax) { return false; }
+      if (tymin > tmin || tmin != tmin) { tmin = tymin; }
+      if (tymax < tmax || tmax != tmax) { tmax = tymax; }
+      if (invZ >= 0) { tzmin = (box.min.z - o.z)*invZ; tzmax = (box.max.z - o.z)*invZ; }
+      else { tzmin = (box.max.z - o.z)*invZ; tzmax = (box.min.z - o.z)*invZ; }
+      if (tmin > tzmax || tzmin > tmax) { return false; }
+      if (tzmin > tmin || tmin != tmin) { tmin = tzmin; }
+      if (tzmax < tmax || tmax != tmax) { tmax = tzmax; }
+      if (tmax < 0) { return false; }
+      const Vec3 hitPt = ray.direction*(tmin >= 0 ? tmin : tmax) + o;
+      *distance = (hitPt - o).length();
+      return true;
+    }
+
+    // Slab test of the ray segment against a box, conservative (touching counts as a hit)
+    inline bool raySegmentHitsBox(const Ray& ray, const Box& box) {
+      const Vec3& o = ray.origin;
+      const Vec3& inv = ray.invDirection;
+      double tMin = ray.near - CULL_MARGIN, tMax = ray.far + CULL_MARGIN;
+      double t0 = (box.min.x - o.x)*inv.x, t1 = (box.max.x - o.x)*inv.x;
+      tMin = std::max(tMin, std::min(t0, t1)); tMax = std::min(tMax, std::max(t0, t1));
+      t0 = (box.min.y - o.y)*inv.y; t1 = (box.max.y - o.y)*inv.y;
+      tMin = std::max(tMin, std::min(t0, t1)); tMax = std::min(tMax, std::max(t0, t1));
+      t0 = (box.min.z - o.z)*inv.z; t1 = (box.max.z - o.z)*inv.z;
+      tMin = std::max(tMin, std::min(t0, t1)); tMax = std::min(tMax, std::max(t0, t1));
+      return tMin <= tMax;
+    }
+
+    // Ray against the front faces of a packet of triangles (THREE.Ray.intersectTriangle with backface culling), the
+    // hit has to be within [near, far] along the ray. Returns a bit mask of the lanes that are hit.
+    int rayHitsTrianglePacket(const Ray& ray, const TrianglePacket& p) {
+      int hits = 0;
+#ifdef VTCORE_SSE2
+      const __m128d zero = _mm_setzero_pd();
+      const __m128d ox = _mm_set1_pd(ray.origin.x), oy = _mm_set1_pd(ray.origin.y), oz = _mm_set1_pd(ray.origin.z);
+      const __m128d dx = _mm_set1_pd(ray.direction.x), dy = _mm_set1_pd(ray.direction.y), dz = _mm_set1_pd(ray.direction.z);
+      const __m128d near = _mm_set1_pd(ray.near), far = _mm_set1_pd(ray.far);
+      for (int lane = 0; lane < LEAF_TRIANGLES; lane += 2) {
+        const __m128d nx = _mm_loadu_pd(&p.nx[lane]), ny = _mm_loadu_pd(&p.ny[lane]), nz = _mm_loadu_pd(&p.nz[lane]);
+        // Only front faces (facing against the ray) can be hit, which flips the signs of the tests below
+        const __m128d DdN = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, nx), _mm_mul_pd(dy, ny)), _mm_mul_pd(dz, nz));
+        __m128d valid = _mm_cmplt_pd(DdN, zero);
+        const __m128d absDdN = _mm_sub_pd(zero, DdN);
+
+        const __m128d qx = _mm_sub_pd(ox, _mm_loadu_pd(&p.ax[lane]));
+        const __m128d qy = _mm_sub_pd(oy, _mm_loadu_pd(&p.ay[lane]));
+        const __m128d qz = _mm_sub_pd(oz, _mm_loadu_pd(&p.az[lane]));
+        const __m128d e1x = _mm_loadu_pd(&p.e1x[lane]), e1y = _mm_loadu_pd(&p.e1y[lane]), e1z = _mm_loadu_pd(&p.e1z[lane]);
+        const __m128d e2x = _mm_loadu_pd(&p.e2x[lane]), e2y = _mm_loadu_pd(&p.e2y[lane]), e2z = _mm_loadu_pd(&p.e2z[lane]);
+
+        // -d.(q x e2)
+        const __m128d qe2x = _mm_sub_pd(_mm_mul_pd(qy, e2z), _mm_mul_pd(qz, e2y));
+        const __m128d qe2y = _mm_sub_pd(_mm_mul_pd(qz, e2x), _mm_mul_pd(qx, e2z));
+        const __m128d qe2z = _mm_sub_pd(_mm_mul_pd(qx, e2y), _mm_mul_pd(qy, e2x));
+        const __m128d DdQxE2 = _mm_sub_pd(zero, _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, qe2x), _mm_mul_pd(dy, qe2y)), _mm_mul_pd(dz, qe2z)));
+        valid = _mm_and_pd(valid, _mm_cmpge_pd(DdQxE2, zero));
+
+        // -d.(e1 x q)
+        const __m128d e1qx = _mm_sub_pd(_mm_mul_pd(e1y, qz), _mm_mul_pd(e1z, qy));
+        const __m128d e1qy = _mm_sub_pd(_mm_mul_pd(e1z, qx), _mm_mul_pd(e1x, qz));
+        const __m128d e1qz = _mm_sub_pd(_mm_mul_pd(e1x, qy), _mm_mul_pd(e1y, qx));
+        const __m128d DdE1xQ = _mm_sub_pd(zero, _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, e1qx), _mm_mul_pd(dy, e1qy)), _mm_mul_pd(dz, e1qz)));
+        valid = _mm_and_pd(valid, _mm_cmpge_pd(DdE1xQ, zero));
+        valid = _mm_and_pd(valid, _mm_cmple_pd(_mm_add_pd(DdQxE2, DdE1xQ), absDdN));
+
+        // q.n, the distance along the ray is q.n/|d.n|
+        const __m128d QdN = _mm_add_pd(_mm_add_pd(_mm_mul_pd(qx, nx), _mm_mul_pd(qy, ny)), _mm_mul_pd(qz, nz));
+        valid = _mm_and_pd(valid, _mm_cmpge_pd(QdN, zero));
+        const __m128d t = _mm_div_pd(QdN, _mm_or_pd(_mm_and_pd(valid, absDdN), _mm_andnot_pd(valid, _mm_set1_pd(1))));
+        valid = _mm_and_pd(valid, _mm_and_pd(_mm_cmpge_pd(t, near), _mm_cmple_pd(t, far)));
+
+        hits |= _mm_movemask_pd(valid) << lane;
+      }
+      hits &= (1 << p.count) - 1;
+#else
+      const Vec3& o = ray.origin;
+      const Vec3& d = ray.direction;
+      for (int lane = 0; lane < p.count; lane++) {
+        const Vec3 n(p.nx[lane], p.ny[lane], p.nz[lane]);
+        const double DdN = d.dot(n);
+        if (!(DdN < 0)) { continue; }
+        const double absDdN = -DdN;
+        const Vec3 q = o - Vec3(p.ax[lane], p.ay[lane], p.az[lane]);
+        const Vec3 e1(p.e1x[lane], p.e1y[lane], p.e1z[lane]);
+        const Vec3 e2(p.e2x[lane], p.e2y[lane], p.e2z[lane]);
+        const double DdQxE2 = -d.dot(q.cross(e2));
+        if (DdQxE2 < 0) { continue; }
+        const double DdE1xQ = -d.dot(e1.cross(q));
+        if (DdE1xQ < 0 || DdQxE2 + DdE1xQ > absDdN) { continue; }
+        const double QdN = q.dot(n);
+        if (QdN < 0) { continue; }
+        const double t = QdN / absDdN;
+        if (t >= ray.near && t <= ray.far) { hits |= 1 << lane; }
+      }
+#endif
+      return hits;
+    }
+
+  }
+
+  // Divisions are multiplications by the reciprocal, like THREE.Vector3.divideScalar, so that shadow rays that graze
+  // the edges of shadow casters hit (or miss) them exactly like they do in JS
+  double Vec3::length() const { return sqrt(x*x + y*y + z*z); }
+  Vec3 Vec3::normalized() const {
+    double len = length();
+    if (len == 0) { len = 1; }
+    return *this*(1 / len);
+  }
+
+  Colour Colour::clamped() const { return Colour(clamp(r, 0, 1), clamp(g, 0, 1), clamp(b, 0, 1)); }
+
+  bool Box::containsPoint(const Vec3& p) const {
+    return !(p.x < min.x || p.x > max.x || p.y < min.y || p.y > max.y || p.z < min.z || p.z > max.z);
+  }
+  bool Box::intersectsBox(const Box& b) const {
+    return !(b.max.x < min.x || b.min.x > max.x || b.max.y < min.y || b.min.y > max.y || b.max.z < min.z || b.min.z > max.z);
+  }
+  Box Box::transformed(const double m[16]) const {
+    Box result;
+    result.min = Vec3(INFINITY, INFINITY, INFINITY);
+    result.max = Vec3(-INFINITY, -INFINITY, -INFINITY);
+    for (int c = 0; c < 8; c++) {
+      const Vec3 corner = applyMatrix4(Vec3((c & 1) ? max.x : min.x, (c & 2) ? max.y : min.y, (c & 4) ? max.z : min.z), m);
+      result.min = Vec3(std::min(result.min.x, corner.x), std::min(result.min.y, corner.y), std::min(result.min.z, corner.z));
+      result.max = Vec3(std::max(result.max.x, corner.x), std::max(result.max.y, corner.y), std::max(result.max.z, corner.z));
+    }
+    return result;
+  }
+
+  Colour Texture::sample(double u, double v) const {
+    // NOTE: Assumes uv coordinates are in [0,1], anything else is clamped to the edge of the image
+    const int uIdx = std::max(0, std::min(shape[0]-1, static_cast<int>(floor(u*(shape[0]-1)))));
+    const int vIdx = std::max(0, std::min(shape[1]-1, static_cast<int>(floor(v*(shape[1]-1)))));
+    const float* texel = &data[offset + uIdx*stride[0] + vIdx*stride[1]];
+    return Colour(texel[0], texel[stride[2]], texel[2*stride[2]]);
+  }
+
+  bool Material::isVisible() const { return floor(alpha*255 + 0.5) >= 1; }
+
+  Colour Material::emission(const double* uv) const {
+    return (type == MATERIAL_EMISSION) ? albedo(uv) : emissive;
+  }
+
+  Colour Material::albedo(const double* uv) const {
+    return (uv && texture) ? colour*texture->sample(uv[0], uv[1]) : colour;
+  }
+
+  Colour Material::brdf(const Vec3& nObjToLightVec, const Vec3& normal, const double* uv, const Colour& lightColour) const {
+    const double dot = clamp(nObjToLightVec.dot(normal), 0, 1);
+    return brdfAmbient(uv, lightColour)*dot;
+  }
+
+  Colour Material::brdfAmbient(const double* uv, const Colour& lightColour) const {
+    if (type == MATERIAL_EMISSION) {
+      return (albedo(uv) + lightColour)*alpha;
+    }
+    return reflect ? ((albedo(uv) + lightColour)*lightColour)*alpha : basicBrdfAmbient(uv, lightColour);
+  }
+
+  Colour Material::basicBrdfAmbient(const double* uv, const Colour& lightColour) const {
+    if (type == MATERIAL_EMISSION) {
+      return brdfAmbient(uv, lightColour);
+    }
+    return (albedo(uv)*lightColour)*alpha;
+  }
+
+  Ray::Ray(const Vec3& origin, const Vec3& direction, double near, double far) :
+    origin(origin), direction(direction), near(near), far(far) {
+    invDirection = Vec3(
+      (direction.x != 0) ? 1 / direction.x : NO_INV_DIRECTION,
+      (direction.y != 0) ? 1 / direction.y : NO_INV_DIRECTION,
+      (direction.z != 0) ? 1 / direction.z : NO_INV_DIRECTION
+    );
+  }
+
+  Geometry::Geometry(const float* positions, size_t numVertices, const float* normals, const float* uvs,
+                     const uint32_t* index, size_t indexLength) :
+    positions_(positions, positions + 3*numVertices) {
+    if (normals) { normals_.assign(normals, normals + 3*numVertices); }
+    if (uvs) { uvs_.assign(uvs, uvs + 2*numVertices); }
+    if (index) {
+      index_.assign(index, index + indexLength - (indexLength % 3));
+    }
+    else {
+      index_.resize(numVertices - (numVertices % 3));
+      for (size_t i = 0; i < index_.size(); i++) { index_[i] = static_cast<uint32_t>(i); }
+    }
+
+    const size_t numTris = numTriangles();
+    std::vector<uint32_t> triangles(numTris);
+    std::vector<Vec3> centroids(numTris);
+    for (size_t i = 0; i < numTris; i++) {
+      triangles[i] = static_cast<uint32_t>(i);
+      centroids[i] = (position(index_[3*i]) + position(index_[3*i+1]) + position(index_[3*i+2]))*(1.0/3.0);
+    }
+    nodes_.reserve(numTris > 0 ? 2*numTris / LEAF_TRIANGLES + 1 : 1);
+    buildNode(triangles, 0, numTris, centroids);
+  }
+
+  // Median split along the longest axis of the triangle centroids, leaves are single packets of triangles
+  uint32_t Geometry::buildNode(std::vector<uint32_t>& triangles, size_t start, size_t end, const std::vector<Vec3>& centroids) {
+    const uint32_t nodeIdx = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(BVHNode());
+
+    Box box;
+    box.min = Vec3(INFINITY, INFINITY, INFINITY);
+    box.max = Vec3(-INFINITY, -INFINITY, -INFINITY);
+    Box centroidBox = box;
+    for (size_t i = start; i < end; i++) {
+      for (int corner = 0; corner < 3; corner++) {
+        const Vec3 p = position(index_[3*triangles[i] + corner]);
+        box.min = Vec3(std::min(box.min.x, p.x), std::min(box.min.y, p.y), std::min(box.min.z, p.z));
+        box.max = Vec3(std::max(box.max.x, p.x), std::max(box.max.y, p.y), std::max(box.max.z, p.z));
+      }
+      const Vec3& c = centroids[triangles[i]];
+      centroidBox.min = Vec3(std::min(centroidBox.min.x, c.x), std::min(centroidBox.min.y, c.y), std::min(centroidBox.min.z, c.z));
+      centroidBox.max = Vec3(std::max(centroidBox.max.x, c.x), std::max(centroidBox.max.y, c.y), std::max(centroidBox.max.z, c.z));
+    }
+
+    if (end - start <= static_cast<size_t>(LEAF_TRIANGLES)) {
+      TrianglePacket packet;
+      memset(&packet, 0, sizeof(packet));
+      packet.count = static_cast<int>(end - start);
+      for (int lane = 0; lane < packet.count; lane++) {
+        const uint32_t tri = triangles[start + lane];
+        const Vec3 a = position(index_[3*tri]), b = position(index_[3*tri+1]), c = position(index_[3*tri+2]);
+        const Vec3 e1 = b - a, e2 = c - a, n = e1.cross(e2);
+        packet.ax[lane] = a.x; packet.ay[lane] = a.y; packet.az[lane] = a.z;
+        packet.e1x[lane] = e1.x; packet.e1y[lane] = e1.y; packet.e1z[lane] = e1.z;
+        packet.e2x[lane] = e2.x; packet.e2y[lane] = e2.y; packet.e2z[lane] = e2.z;
+        packet.nx[lane] = n.x; packet.ny[lane] = n.y; packet.nz[lane] = n.z;
+        packet.triangles[lane] = tri;
+      }
+      BVHNode& node = nodes_[nodeIdx];
+      node.box = box;
+      node.isLeaf = true;
+      node.packet = static_cast<uint32_t>(packets_.size());
+      packets_.push_back(packet);
+      return nodeIdx;
+    }
+
+    const Vec3 extent = centroidBox.max - centroidBox.min;
+    const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    const size_t mid = start + (end - start)/2;
+    std::nth_element(triangles.begin() + start, triangles.begin() + mid, triangles.begin() + end,
+      [&centroids, axis](uint32_t t0, uint32_t t1) {
+        const Vec3& c0 = centroids[t0];
+        const Vec3& c1 = centroids[t1];
+        return axis == 0 ? c0.x < c1.x : (axis == 1 ? c0.y < c1.y : c0.z < c1.z);
+      });
+
+    const uint32_t left = buildNode(triangles, start, mid, centroids);
+    const uint32_t right = buildNode(triangles, mid, end, centroids);
+    BVHNode& node = nodes_[nodeIdx];
+    node.box = box;
+    node.isLeaf = false;
+    node.left = left;
+    node.right = right;
+    return nodeIdx;
+  }
+
+  Vec3 Geometry::position(uint32_t vertex) const {
+    return Vec3(positions_[3*vertex], positions_[3*vertex+1], positions_[3*vertex+2]);
+  }
+  Vec3 Geometry::normal(uint32_t vertex) const {
+    return Vec3(normals_[3*vertex], normals_[3*vertex+1], normals_[3*vertex+2]);
+  }
+  void Geometry::uv(uint32_t vertex, double result[2]) const {
+    if (uvs_.empty()) {
+      result[0] = result[1] = 0;
+      return;
+    }
+    result[0] = uvs_[2*vertex];
+    result[1] = uvs_[2*vertex+1];
+  }
+
+  bool Geometry::intersectsRay(const Ray& ray) const {
+    if (packets_.empty()) { return false; }
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+      const BVHNode& node = nodes_[stack[--stackSize]];
+      if (!raySegmentHitsBox(ray, node.box)) { continue; }
+      if (node.isLeaf) {
+        if (rayHitsTrianglePacket(ray, packets_[node.packet])) { return true; }
+      }
+      else {
+        stack[stackSize++] = node.left;
+        stack[stackSize++] = node.right;
+      }
+    }
+    return false;
+  }
+
+  template <typename Visitor>
+  void Geometry::shapecast(const Box& box, const double matrixWorld[16], Visitor visit) const {
+    if (packets_.empty()) { return; }
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+      const BVHNode& node = nodes_[stack[--stackSize]];
+      if (!box.intersectsBox(node.box.transformed(matrixWorld))) { continue; }
+      if (node.isLeaf) {
+        const TrianglePacket& packet = packets_[node.packet];
+        for (int lane = 0; lane < packet.count; lane++) { visit(packet.triangles[lane]); }
+      }
+      else {
+        stack[stackSize++] = node.left;
+        stack[stackSize++] = node.right;
+      }
+    }
+  }
+
+  Colour Lights::emission(size_t i, const Vec3& pos, double distance) const {
+    double attenuation = clamp(1.0 / (1.0 + quadratic[i]*distance*distance + linear[i]*distance), 0, 1);
+    if (isSpot[i]) {
+      const Vec3 nLightToVoxel = (pos - position(i))*(1 / distance);
+      const double dot = nLightToVoxel.x*dirX[i] + nLightToVoxel.y*dirY[i] + nLightToVoxel.z*dirZ[i];
+      const double spotAttenuation = pow(clamp((dot - cosOuter[i])*angleRangeInv[i], 0, 1), 2);
+      attenuation = attenuation*spotAttenuation;
+    }
+    return Colour(r[i], g[i], b[i])*attenuation;
+  }
+
+  size_t Lights::add(int32_t id) {
+    ids.push_back(id);
+    for (auto* values : { &posX, &posY, &posZ, &r, &g, &b, &quadratic, &linear, &dirX, &dirY, &dirZ, &cosOuter, &angleRangeInv }) {
+      values->push_back(0);
+    }
+    isSpot.push_back(0);
+    return ids.size() - 1;
+  }
+
+  void Lights::removeAt(size_t i) {
+    const size_t last = ids.size() - 1;
+    ids[i] = ids[last]; ids.pop_back();
+    isSpot[i] = isSpot[last]; isSpot.pop_back();
+    for (auto* values : { &posX, &posY, &posZ, &r, &g, &b, &quadratic, &linear, &dirX, &dirY, &dirZ, &cosOuter, &angleRangeInv }) {
+      (*values)[i] = (*values)[last];
+      values->pop_back();
+    }
+  }
+
+  size_t ShadowCasters::add(int32_t id) {
+    ids.push_back(id);
+    types.push_back(CASTER_VOXEL);
+    for (auto* values : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) { values->push_back(0); }
+    return ids.size() - 1;
+  }
+
+  void ShadowCasters::removeAt(size_t i) {
+    const size_t last = ids.size() - 1;
+    ids[i] = ids[last]; ids.pop_back();
+    types[i] = types[last]; types.pop_back();
+    for (auto* values : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) {
+      (*values)[i] = (*values)[last];
+      values->pop_back();
+    }
+  }
+
+  void ShadowCasters::setBox(size_t i, const Box& box) {
+    minX[i] = box.min.x; minY[i] = box.min.y; minZ[i] = box.min.z;
+    maxX[i] = box.max.x; maxY[i] = box.max.y; maxZ[i] = box.max.z;
+  }
+
+  Scene::Scene(int xSize, int ySize, int zSize) : xSize_(xSize), ySize_(ySize), zSize_(zSize) {}
+
+  void Scene::clear() {
+    renderables_.clear();
+    lights_ = Lights();
+    shadowCasters_ = ShadowCasters();
+    shadowCasterIdxs_.clear();
+    hasAmbientLight_ = false;
+  }
+
+  void Scene::clearResources() {
+    geometries_.clear();
+    textures_.clear();
+  }
+
+  void Scene::addGeometry(int32_t resourceId, std::shared_ptr<const Geometry> geometry) { geometries_[resourceId] = geometry; }
+  void Scene::addTexture(int32_t resourceId, std::shared_ptr<const Texture> texture) { textures_[resourceId] = texture; }
+
+  std::shared_ptr<const Geometry> Scene::geometry(int32_t resourceId) const {
+    auto it = geometries_.find(resourceId);
+    return (it != geometries_.end()) ? it->second : nullptr;
+  }
+  std::shared_ptr<const Texture> Scene::texture(int32_t resourceId) const {
+    auto it = textures_.find(resourceId);
+    return (it != textures_.end()) ? it->second : nullptr;
+  }
+
+  void Scene::setAmbientLight(const Colour& colour) {
+    hasAmbientLight_ = true;
+    ambientLight_ = colour;
+  }
+  void Scene::removeAmbientLight() { hasAmbientLight_ = false; }
+
+  Renderable* Scene::renderable(int32_t id) {
+    return (id >= 0 && static_cast<size_t>(id) < renderables_.size()) ? renderables_[id].get() : nullptr;
+  }
+
+  // Replace whatever had the ID with a new renderable of the given type
+  Renderable& Scene::setRenderable(int32_t id, RenderableType type) {
+    remove(id);
+    if (static_cast<size_t>(id) >= renderables_.size()) {
+      renderables_.resize(id + 1);
+    }
+    renderables_[id].reset(new Renderable());
+    renderables_[id]->type = type;
+    return *renderables_[id];
+  }
+
+  void Scene::setPointLight(int32_t id, const Vec3& position, const Colour& colour, double quadratic, double linear) {
+    Renderable& light = setRenderable(id, RENDERABLE_LIGHT);
+    const size_t i = lights_.add(id);
+    light.lightIdx = i;
+    lights_.posX[i] = position.x; lights_.posY[i] = position.y; lights_.posZ[i] = position.z;
+    lights_.r[i] = colour.r; lights_.g[i] = colour.g; lights_.b[i] = colour.b;
+    lights_.quadratic[i] = quadratic;
+    lights_.linear[i] = linear;
+  }
+
+  void Scene::setSpotLight(int32_t id, const Vec3& position, const Vec3& direction, const Colour& colour,
+                           double innerAngle, double outerAngle, double quadratic, double linear) {
+    setPointLight(id, position, colour, quadratic, linear);
+    const size_t i = renderables_[id]->lightIdx;
+    const Vec3 nDirection = direction.normalized();
+    const double cosOuter = cos(0.5*std::max(innerAngle, outerAngle));
+    const double cosInner = cos(0.5*innerAngle);
+    lights_.isSpot[i] = 1;
+    lights_.dirX[i] = nDirection.x; lights_.dirY[i] = nDirection.y; lights_.dirZ[i] = nDirection.z;
+    lights_.cosOuter[i] = cosOuter;
+    lights_.angleRangeInv[i] = 1.0 / std::max(cosInner - cosOuter, VOXEL_EPSILON);
+  }
+
+  void Scene::setVoxel(int32_t id, const Vec3& position, bool receivesShadow, const Material& material) {
+    Renderable& voxel = setRenderable(id, RENDERABLE_VOXEL);
+    voxel.position = position;
+    voxel.receivesShadow = receivesShadow;
+    voxel.material = material;
+
+    // See VTVoxelAbstract.computeBoundingBox
+    Box box;
+    box.min = Vec3(floor(position.x), floor(position.y), floor(position.z));
+    box.max = box.min + Vec3(1, 1, 1);
+    setShadowCaster(id, CASTER_VOXEL, box);
+  }
+
+  void Scene::setFog(int32_t id, const Box& box, const Colour& colour, double scattering) {
+    Renderable& fog = setRenderable(id, RENDERABLE_FOG);
+    fog.fogBox = box;
+    fog.fogColour = colour;
+    fog.scattering = scattering;
+  }
+
+  void Scene::setMesh(int32_t id, std::shared_ptr<const Geometry> geometry, const double matrixWorld[16], const Material& material) {
+    Renderable& mesh = setRenderable(id, RENDERABLE_MESH);
+    mesh.geometry = geometry;
+    mesh.material = material;
+    memcpy(mesh.matrixWorld, matrixWorld, sizeof(mesh.matrixWorld));
+    invertMatrix4(mesh.matrixWorld, mesh.inverseMatrixWorld);
+    if (geometry && geometry->numTriangles() > 0) {
+      setShadowCaster(id, CASTER_MESH, geometry->boundingBox().transformed(mesh.matrixWorld));
+    }
+  }
+
+  void Scene::remove(int32_t id) {
+    Renderable* existing = renderable(id);
+    if (!existing) { return; }
+    if (existing->type == RENDERABLE_LIGHT) {
+      const size_t i = existing->lightIdx;
+      lights_.removeAt(i);
+      if (i < lights_.size()) {
+        renderables_[lights_.ids[i]]->lightIdx = i;
+      }
+    }
+    removeShadowCaster(id);
+    renderables_[id].reset();
+  }
+
+  void Scene::setShadowCaster(int32_t id, ShadowCasterType type, const Box& box) {
+    auto it = shadowCasterIdxs_.find(id);
+    const size_t i = (it != shadowCasterIdxs_.end()) ? it->second : shadowCasters_.add(id);
+    shadowCasterIdxs_[id] = i;
+    shadowCasters_.types[i] = type;
+    shadowCasters_.setBox(i, box);
+  }
+
+  void Scene::removeShadowCaster(int32_t id) {
+    auto it = shadowCasterIdxs_.find(id);
+    if (it == shadowCasterIdxs_.end()) { return; }
+    const size_t i = it->second;
+    shadowCasterIdxs_.erase(it);
+    shadowCasters_.removeAt(i);
+    if (i < shadowCasters_.size()) {
+      shadowCasterIdxs_[shadowCasters_.ids[i]] = i;
+    }
+  }
+
+  // Like VTRPScene._calculateShadowCasterLightMultiplier: 1 when nothing blocks the segment to the light, otherwise 0
+  // (every shadow caster blocks all of the light). The caster bounds are culled two at a time, the survivors get the
+  // exact test.
+  double Scene::shadowLightMultiplier(const Vec3& point, const Vec3& nToLightVec, double distanceToLight) const {
+    const size_t numCasters = shadowCasters_.size();
+    if (numCasters == 0) { return 1; }
+    const Ray ray(point, nToLightVec, VOXEL_EPSILON, distanceToLight);
+    const ShadowCasters& c = shadowCasters_;
+
+    auto blocks = [this, &ray, &c](size_t i) {
+      if (c.types[i] == CASTER_VOXEL) {
+        // A voxel doesn't shadow anything from inside of itself (e.g., its own lighting), see VTVoxelAbstract.intersectsRay
+        Box box;
+        box.min = Vec3(c.minX[i], c.minY[i], c.minZ[i]);
+        box.max = Vec3(c.maxX[i], c.maxY[i], c.maxZ[i]);
+        if (box.containsPoint(ray.origin)) { return false; }
+        double distance = 0;
+        return rayIntersectsBox(ray, box, &distance) && distance >= ray.near && distance <= ray.far;
+      }
+      // Meshes are hit tested in their own space, the ray's direction isn't normalized there so distances stay the same
+      const Renderable& mesh = *renderables_[c.ids[i]];
+      const Vec3 localOrigin = applyMatrix4(ray.origin, mesh.inverseMatrixWorld);
+      const Vec3 localDirection = applyMatrix4(ray.origin + ray.direction, mesh.inverseMatrixWorld) - localOrigin;
+      return mesh.geometry->intersectsRay(Ray(localOrigin, localDirection, ray.near, ray.far));
+    };
+
+    size_t i = 0;
+#ifdef VTCORE_SSE2
+    const __m128d ox = _mm_set1_pd(ray.origin.x), oy = _mm_set1_pd(ray.origin.y), oz = _mm_set1_pd(ray.origin.z);
+    const __m128d ix = _mm_set1_pd(ray.invDirection.x), iy = _mm_set1_pd(ray.invDirection.y), iz = _mm_set1_pd(ray.invDirection.z);
+    const __m128d near = _mm_set1_pd(ray.near - CULL_MARGIN), far = _mm_set1_pd(ray.far + CULL_MARGIN);
+    for (; i + 2 <= numCasters; i += 2) {
+      __m128d t0 = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(&c.minX[i]), ox), ix);
+      __m128d t1 = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(&c.maxX[i]), ox), ix);
+      __m128d tMin = _mm_max_pd(near, _mm_min_pd(t0, t1));
+      __m128d tMax = _mm_min_pd(far, _mm_max_pd(t0, t1));
+      t0 = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(&c.minY[i]), oy), iy);
+      t1 = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(&c.maxY[i]), oy), iy);
+      tMin = _mm_max_pd(tMin, _mm_min_pd(t0, t1));
+      tMax = _mm_min_pd(tMax, _mm_max_pd(t0, t1));
+      t0 = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(&c.minZ[i]), oz), iz);
+      t1 = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(&c.maxZ[i]), oz), iz);
+      tMin = _mm_max_pd(tMin, _mm_min_pd(t0, t1));
+      tMax = _mm_min_pd(tMax, _mm_max_pd(t0, t1));
+
+      const int hits = _mm_movemask_pd(_mm_cmple_pd(tMin, tMax));
+      if (((hits & 1) && blocks(i)) || ((hits & 2) && blocks(i+1))) { return 0; }
+    }
+#endif
+    for (; i < numCasters; i++) {
+      Box box;
+      box.min = Vec3(c.minX[i], c.minY[i], c.minZ[i]);
+      box.max = Vec3(c.maxX[i], c.maxY[i], c.maxZ[i]);
+      if (raySegmentHitsBox(ray, box) && blocks(i)) { return 0; }
+    }
+    return 1;
+  }
+
+  // See VTRPScene.calculateVoxelLighting
+  Colour Scene::calculateVoxelLighting(const Vec3& point, const Material& material, bool receivesShadow) const {
+    Colour finalColour = material.emission(nullptr);
+
+    for (size_t j = 0; j < lights_.size(); j++) {
+      const Vec3 toLight = lights_.position(j) - point;
+      const double distanceToLight = std::max(VOXEL_EPSILON, toLight.length());
+      const Vec3 nVoxelToLightVec = toLight*(1 / distanceToLight);
+
+      const double lightMultiplier = receivesShadow ? shadowLightMultiplier(point, nVoxelToLightVec, distanceToLight) : 1.0;
+      if (lightMultiplier > 0) {
+        const Colour lightEmission = lights_.emission(j, point, distanceToLight)*lightMultiplier;
+        finalColour += material.brdfAmbient(nullptr, lightEmission);
+      }
+    }
+
+    if (hasAmbientLight_) {
+      finalColour += material.basicBrdfAmbient(nullptr, ambientLight_);
+    }
+    return finalColour.clamped();
+  }
+
+  // See VTRPScene.calculateFogLighting
+  Colour Scene::calculateFogLighting(const Vec3& point) const {
+    Colour finalColour;
+    if (lights_.size() == 0) { return finalColour; }
+
+    for (size_t j = 0; j < lights_.size(); j++) {
+      const Vec3 lightPos = lights_.position(j);
+      const Vec3 fromLight = point - lightPos;
+      const double distanceFromLight = std::max(VOXEL_EPSILON, fromLight.length());
+      const Vec3 nLightToFogVec = fromLight*(1 / distanceFromLight);
+
+      const double lightMultiplier = shadowLightMultiplier(lightPos, nLightToFogVec, distanceFromLight);
+      if (lightMultiplier > 0) {
+        finalColour += lights_.emission(j, point, distanceFromLight)*lightMultiplier;
+      }
+    }
+    return finalColour.clamped();
+  }
+
+  // See VTRPScene.calculateLightingSamples
+  Colour Scene::calculateLightingSamples(const std::vector<TriSample>& samples, const Material& material) const {
+    Colour finalColour;
+    const double factorPerSample = 1.0 / samples.size();
+
+    for (const TriSample& sample : samples) {
+      const Vec3& point = sample.point;
+      Colour sampleLightContrib = material.emission(sample.uv)*sample.falloff;
+
+      for (size_t j = 0; j < lights_.size(); j++) {
+        const Vec3 toLight = lights_.position(j) - point;
+        const double distanceToLight = std::max(VOXEL_EPSILON, toLight.length());
+        const Vec3 nObjToLightVec = toLight*(1 / distanceToLight);
+        if (nObjToLightVec.dot(sample.normal) <= 0) {
+          continue;
+        }
+
+        const double lightMultiplier = shadowLightMultiplier(point, nObjToLightVec, distanceToLight);
+        if (lightMultiplier > 0) {
+          const Colour lightEmission = lights_.emission(j, point, distanceToLight)*(lightMultiplier*sample.falloff);
+          sampleLightContrib += material.brdf(nObjToLightVec, sample.normal, sample.uv, lightEmission)*sample.falloff;
+        }
+      }
+      finalColour += sampleLightContrib*factorPerSample;
+    }
+
+    if (hasAmbientLight_) {
+      Colour ambientContrib;
+      for (const TriSample& sample : samples) {
+        ambientContrib += material.basicBrdfAmbient(sample.uv, ambientLight_)*sample.falloff;
+      }
+      finalColour += ambientContrib*factorPerSample;
+    }
+    return finalColour.clamped();
+  }
+
+  // See VTRPMesh._preRender, samples of the mesh's triangles whose closest points to the voxel's center are in the voxel
+  const std::vector<TriSample>& Scene::triSamples(Renderable& mesh, int32_t voxelIdx, const Vec3& voxelPt) {
+    auto it = mesh.triSamplesByVoxel.find(voxelIdx);
+    if (it != mesh.triSamplesByVoxel.end()) {
+      return it->second;
+    }
+    std::vector<TriSample>& samples = mesh.triSamplesByVoxel[voxelIdx];
+    if (!mesh.geometry) { return samples; }
+
+    const Geometry& geometry = *mesh.geometry;
+    const double* matrixWorld = mesh.matrixWorld;
+    Box voxelBox;
+    voxelBox.min = Vec3(floor(voxelPt.x), floor(voxelPt.y), floor(voxelPt.z));
+    voxelBox.max = voxelBox.min + Vec3(1, 1, 1);
+    const Vec3 center = (voxelBox.min + voxelBox.max)*0.5;
+
+    const double furthestPossibleDistFromCenter = SQRT3*SQRT1_2;
+    const double sigma = furthestPossibleDistFromCenter / 10.0;
+    const double valueAtZero = (1.0 / SQRT2PI*sigma);
+
+    geometry.shapecast(voxelBox, matrixWorld, [&](uint32_t tri) {
+      const uint32_t i0 = geometry.vertexIndex(tri, 0), i1 = geometry.vertexIndex(tri, 1), i2 = geometry.vertexIndex(tri, 2);
+      const Vec3 a = applyMatrix4(geometry.position(i0), matrixWorld);
+      const Vec3 b = applyMatrix4(geometry.position(i1), matrixWorld);
+      const Vec3 c = applyMatrix4(geometry.position(i2), matrixWorld);
+
+      const Vec3 closestPt = closestPointOnTriangle(center, a, b, c);
+      if (!voxelBox.containsPoint(closestPt)) {
+        return;
+      }
+      const double sqrDist = (closestPt - center).lengthSq();
+
+      TriSample sample;
+      sample.point = closestPt;
+      const Vec3 bary = barycoord(closestPt, a, b, c);
+      if (geometry.hasNormals()) {
+        const Vec3 n = geometry.normal(i0)*bary.x + (geometry.normal(i1)*bary.y + geometry.normal(i2)*bary.z);
+        sample.normal = transformDirection(n.normalized(), matrixWorld);
+      }
+      else {
+        // No vertex normals, use the face normal
+        sample.normal = (b - a).cross(c - a).normalized();
+      }
+      double uv0[2], uv1[2], uv2[2];
+      geometry.uv(i0, uv0); geometry.uv(i1, uv1); geometry.uv(i2, uv2);
+      sample.uv[0] = uv0[0]*bary.x + (uv1[0]*bary.y + uv2[0]*bary.z);
+      sample.uv[1] = uv0[1]*bary.x + (uv1[1]*bary.y + uv2[1]*bary.z);
+
+      // Is the voxel sample point (i.e., the center) inside or outside the triangle? Outside gets a gaussian falloff.
+      const double toTriangleDotNorm = (sample.point - center).normalized().dot(sample.normal);
+      sample.falloff = (toTriangleDotNorm >= 0.0) ? 1.0 :
+        ((1.0 / SQRT2PI*sigma) * exp(-0.5 * (sqrDist / (2*sigma*sigma))) / valueAtZero);
+
+      samples.push_back(sample);
+    });
+
+    return samples;
+  }
+
+  Colour Scene::calculateVoxelColour(Renderable& renderable, int32_t voxelIdx, const Vec3& voxelPt) {
+    switch (renderable.type) {
+      case RENDERABLE_VOXEL:
+        // See VTRPVoxel.calculateVoxelColour
+        if (!renderable.material.isVisible()) { return Colour(); }
+        return calculateVoxelLighting(renderable.position, renderable.material, renderable.receivesShadow);
+
+      case RENDERABLE_FOG: {
+        // See VTRPFog.calculateVoxelColour
+        if (!renderable.fogBox.containsPoint(voxelPt)) { return Colour(); }
+        const Colour fogLighting = calculateFogLighting(voxelPt);
+        return Colour(clamp(renderable.scattering*(fogLighting.r*renderable.fogColour.r), 0, 1),
+                      clamp(renderable.scattering*(fogLighting.g*renderable.fogColour.g), 0, 1),
+                      clamp(renderable.scattering*(fogLighting.b*renderable.fogColour.b), 0, 1));
+      }
+
+      case RENDERABLE_MESH: {
+        // See VTRPMesh.calculateVoxelColour
+        if (!renderable.material.isVisible()) { return Colour(); }
+        const std::vector<TriSample>& samples = triSamples(renderable, voxelIdx, voxelPt);
+        return samples.empty() ? Colour() : calculateLightingSamples(samples, renderable.material);
+      }
+
+      case RENDERABLE_LIGHT: {
+        // See VTPointLight/VTSpotLight.calculateVoxelColour
+        const size_t i = renderable.lightIdx;
+        return lights_.emission(i, voxelPt, (lights_.position(i) - voxelPt).length());
+      }
+
+      default:
+        return Colour();
+    }
+  }
+
+  void Scene::renderWorkItems(const int32_t* workItems, size_t startItem, size_t endItem, float* renderBuffer, uint8_t* lightingCacheValid) {
+    const int32_t yzSize = ySize_*zSize_;
+    size_t i = startItem;
+    while (i < endItem) {
+      // Each voxel's work items are consecutive and it's either still lit from a previous frame or all of them get rendered
+      const int32_t voxelIdx = workItems[2*i];
+      size_t voxelEnd = i+1;
+      while (voxelEnd < endItem && workItems[2*voxelEnd] == voxelIdx) { voxelEnd++; }
+      if (lightingCacheValid[voxelIdx]) {
+        i = voxelEnd;
+        continue;
+      }
+
+      const Vec3 voxelPt(voxelIdx / yzSize, (voxelIdx / zSize_) % ySize_, voxelIdx % zSize_);
+      float* out = &renderBuffer[3*static_cast<size_t>(voxelIdx)];
+      for (; i < voxelEnd; i++) {
+        Renderable* r = renderable(workItems[2*i+1]);
+        if (!r || r->type == RENDERABLE_NONE) { continue; }
+
+        const Colour colour = calculateVoxelColour(*r, voxelIdx, voxelPt);
+        out[0] = static_cast<float>(out[0] + colour.r);
+        out[1] = static_cast<float>(out[1] + colour.g);
+        out[2] = static_cast<float>(out[2] + colour.b);
+      }
+      lightingCacheValid[voxelIdx] = 1;
+    }
+  }
+
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+// Native core of the voxel tracer's render procs (see src/VoxelTracer/RenderProc/VTRPScene.js and VTRPNativeScene.js).
+//
+// The render procs keep their scene objects in JS and mirror them into a vtcore::Scene, which then renders the work
+// items of the frame (see VTRPWorkQueue) into the shared render buffer. Everything here is a port of the JS lighting
+// (VTRPScene.calculateVoxelLighting/calculateFogLighting/calculateLightingSamples, the lights and materials) and has to
+// give the same results, it just does it without allocating anything per voxel:
+// - Lights and shadow casters are kept as structures of arrays so they can be looped over (and ray tested) in packets.
+// - Mesh geometry is kept in its local space with a BVH over its triangles, shadow rays are transformed into the space
+//   of each mesh they might hit, the same way three.js raycasts meshes.
+// - The triangle samples of each (mesh, voxel) are memoized like VTRPMesh does, until the mesh changes.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vtcore {
+
+  struct Vec3 {
+    double x, y, z;
+    Vec3() : x(0), y(0), z(0) {}
+    Vec3(double x, double y, double z) : x(x), y(y), z(z) {}
+    Vec3 operator+(const Vec3& v) const { return Vec3(x+v.x, y+v.y, z+v.z); }
+    Vec3 operator-(const Vec3& v) const { return Vec3(x-v.x, y-v.y, z-v.z); }
+    Vec3 operator*(double s) const { return Vec3(x*s, y*s, z*s); }
+    double dot(const Vec3& v) const { return x*v.x + y*v.y + z*v.z; }
+    Vec3 cross(const Vec3& v) const { return Vec3(y*v.z - z*v.y, z*v.x - x*v.z, x*v.y - y*v.x); }
+    double lengthSq() const { return dot(*this); }
+    double length() const;
+    Vec3 normalized() const; // Zero vectors stay zero, like THREE.Vector3.normalize
+  };
+
+  struct Colour {
+    double r, g, b;
+    Colour() : r(0), g(0), b(0) {}
+    Colour(double r, double g, double b) : r(r), g(g), b(b) {}
+    Colour operator+(const Colour& c) const { return Colour(r+c.r, g+c.g, b+c.b); }
+    Colour operator*(const Colour& c) const { return Colour(r*c.r, g*c.g, b*c.b); }
+    Colour operator*(double s) const { return Colour(r*s, g*s, b*s); }
+    Colour& operator+=(const Colour& c) { r += c.r; g += c.g; b += c.b; return *this; }
+    Colour clamped() const; // Each channel clamped to [0,1]
+  };
+
+  struct Box {
+    Vec3 min, max;
+    bool containsPoint(const Vec3& p) const;
+    bool intersectsBox(const Box& b) const;
+    Box transformed(const double m[16]) const; // Bounds of the box's 8 transformed corners, like THREE.Box3.applyMatrix4
+  };
+
+  // An RGB float image, indexed like the ndarray of VTTexture: data[offset + u*stride[0] + v*stride[1] + channel*stride[2]]
+  struct Texture {
+    std::vector<float> data;
+    int shape[3];
+    int stride[3];
+    int offset;
+    Colour sample(double u, double v) const;
+  };
+
+  // Matches VTMaterial.LAMBERT_TYPE and EMISSION_TYPE (see VTLambertMaterial and VTEmissionMaterial)
+  enum MaterialType { MATERIAL_LAMBERT = 0, MATERIAL_EMISSION = 1 };
+
+  struct Material {
+    MaterialType type = MATERIAL_LAMBERT;
+    Colour colour;
+    Colour emissive; // Lambert only
+    double alpha = 1;
+    bool reflect = false; // Lambert only
+    std::shared_ptr<const Texture> texture;
+
+    bool isVisible() const;
+    Colour emission(const double* uv) const;
+    Colour albedo(const double* uv) const;
+    Colour brdf(const Vec3& nObjToLightVec, const Vec3& normal, const double* uv, const Colour& lightColour) const;
+    Colour brdfAmbient(const double* uv, const Colour& lightColour) const;
+    Colour basicBrdfAmbient(const double* uv, const Colour& lightColour) const;
+  };
+
+  // Ray segment [near, far] along a normalized direction, with everything the packet tests need precomputed
+  struct Ray {
+    Vec3 origin, direction, invDirection;
+    double near, far;
+    Ray(const Vec3& origin, const Vec3& direction, double near, double far);
+  };
+
+  // Four triangles at a time for the packet ray tests, (edge1, edge2, normal) in the three.js winding. Unused lanes
+  // have a zero normal, which never hits.
+  struct TrianglePacket {
+    double ax[4], ay[4], az[4];
+    double e1x[4], e1y[4], e1z[4];
+    double e2x[4], e2y[4], e2z[4];
+    double nx[4], ny[4], nz[4];
+    uint32_t triangles[4];
+    int count;
+  };
+
+  struct BVHNode {
+    Box box;
+    uint32_t left, right; // Child nodes of inner nodes
+    uint32_t packet;      // Triangle packet of leaves
+    bool isLeaf;
+  };
+
+  // Mesh geometry (a resource, see VTSceneDelta) in its local space
+  class Geometry {
+  public:
+    // Positions (and normals) are xyz per vertex, uvs are uv per vertex, either may be null. The index is 3 vertex
+    // indices per triangle, a null index means every 3 vertices are a triangle.
+    Geometry(const float* positions, size_t numVertices, const float* normals, const float* uvs,
+             const uint32_t* index, size_t indexLength);
+
+    const Box& boundingBox() const { return nodes_[0].box; }
+    size_t numTriangles() const { return index_.size() / 3; }
+
+    // Whether the (local space) ray hits the front face of any triangle within [ray.near, ray.far]
+    bool intersectsRay(const Ray& ray) const;
+    // Visit every triangle in the leaves whose world space bounds (under matrixWorld) overlap the box
+    template <typename Visitor> void shapecast(const Box& box, const double matrixWorld[16], Visitor visit) const;
+
+    Vec3 position(uint32_t vertex) const;
+    Vec3 normal(uint32_t vertex) const;
+    void uv(uint32_t vertex, double result[2]) const;
+    uint32_t vertexIndex(size_t triangle, int corner) const { return index_[3*triangle + corner]; }
+    bool hasNormals() const { return !normals_.empty(); }
+
+  private:
+    uint32_t buildNode(std::vector<uint32_t>& triangles, size_t start, size_t end, const std::vector<Vec3>& centroids);
+
+    std::vector<float> positions_, normals_, uvs_;
+    std::vector<uint32_t> index_;
+    std::vector<BVHNode> nodes_;
+    std::vector<TrianglePacket> packets_;
+  };
+
+  // A sample of a mesh's surface within a voxel, see VTRPMesh._preRender
+  struct TriSample {
+    Vec3 point, normal;
+    double uv[2];
+    double falloff;
+  };
+
+  enum RenderableType { RENDERABLE_NONE = 0, RENDERABLE_VOXEL, RENDERABLE_FOG, RENDERABLE_MESH, RENDERABLE_LIGHT };
+
+  struct Renderable {
+    RenderableType type = RENDERABLE_NONE;
+    Material material;
+    // Voxels
+    Vec3 position;
+    bool receivesShadow = true;
+    // Fog
+    Box fogBox;
+    Colour fogColour;
+    double scattering = 0;
+    // Meshes
+    std::shared_ptr<const Geometry> geometry;
+    double matrixWorld[16];
+    double inverseMatrixWorld[16];
+    std::unordered_map<int32_t, std::vector<TriSample>> triSamplesByVoxel;
+    // Lights (their index in Lights)
+    size_t lightIdx = 0;
+  };
+
+  // Point and spot lights, struct of arrays
+  struct Lights {
+    std::vector<int32_t> ids;
+    std::vector<double> posX, posY, posZ;
+    std::vector<double> r, g, b;
+    std::vector<double> quadratic, linear;
+    std::vector<uint8_t> isSpot;
+    std::vector<double> dirX, dirY, dirZ, cosOuter, angleRangeInv; // Spot lights only
+
+    size_t size() const { return ids.size(); }
+    Vec3 position(size_t i) const { return Vec3(posX[i], posY[i], posZ[i]); }
+    // Like VTPointLight/VTSpotLight.emission
+    Colour emission(size_t i, const Vec3& pos, double distance) const;
+    size_t add(int32_t id);
+    void removeAt(size_t i); // Moves the last light into i
+  };
+
+  enum ShadowCasterType { CASTER_VOXEL = 0, CASTER_MESH = 1 };
+
+  // Bounds of the shadow casters (struct of arrays) for culling shadow rays a pair of casters at a time
+  struct ShadowCasters {
+    std::vector<int32_t> ids;
+    std::vector<uint8_t> types;
+    std::vector<double> minX, minY, minZ, maxX, maxY, maxZ;
+
+    size_t size() const { return ids.size(); }
+    size_t add(int32_t id);
+    void removeAt(size_t i);
+    void setBox(size_t i, const Box& box);
+  };
+
+  class Scene {
+  public:
+    Scene(int xSize, int ySize, int zSize);
+
+    void clear();
+    void clearResources();
+    void addGeometry(int32_t resourceId, std::shared_ptr<const Geometry> geometry);
+    void addTexture(int32_t resourceId, std::shared_ptr<const Texture> texture);
+    std::shared_ptr<const Geometry> geometry(int32_t resourceId) const;
+    std::shared_ptr<const Texture> texture(int32_t resourceId) const;
+
+    void setAmbientLight(const Colour& colour);
+    void removeAmbientLight();
+    void setPointLight(int32_t id, const Vec3& position, const Colour& colour, double quadratic, double linear);
+    void setSpotLight(int32_t id, const Vec3& position, const Vec3& direction, const Colour& colour,
+                      double innerAngle, double outerAngle, double quadratic, double linear);
+    void setVoxel(int32_t id, const Vec3& position, bool receivesShadow, const Material& material);
+    void setFog(int32_t id, const Box& box, const Colour& colour, double scattering);
+    void setMesh(int32_t id, std::shared_ptr<const Geometry> geometry, const double matrixWorld[16], const Material& material);
+    void remove(int32_t id);
+
+    // Render the (voxel index, renderable ID) work items [startItem, endItem) into the render buffer, skipping the
+    // voxels that are flagged as valid in the lighting cache and flagging the rest once they're done
+    void renderWorkItems(const int32_t* workItems, size_t startItem, size_t endItem, float* renderBuffer, uint8_t* lightingCacheValid);
+
+  private:
+    Renderable& setRenderable(int32_t id, RenderableType type);
+    Renderable* renderable(int32_t id);
+    void setShadowCaster(int32_t id, ShadowCasterType type, const Box& box);
+    void removeShadowCaster(int32_t id);
+
+    double shadowLightMultiplier(const Vec3& point, const Vec3& nToLightVec, double distanceToLight) const;
+    Colour calculateVoxelLighting(const Vec3& point, const Material& material, bool receivesShadow) const;
+    Colour calculateFogLighting(const Vec3& point) const;
+    Colour calculateLightingSamples(const std::vector<TriSample>& samples, const Material& material) const;
+    const std::vector<TriSample>& triSamples(Renderable& mesh, int32_t voxelIdx, const Vec3& voxelPt);
+    Colour calculateVoxelColour(Renderable& renderable, int32_t voxelIdx, const Vec3& voxelPt);
+
+    int xSize_, ySize_, zSize_;
+    std::vector<std::unique_ptr<Renderable>> renderables_; // By ID
+    Lights lights_;
+    ShadowCasters shadowCasters_;
+    std::unordered_map<int32_t, size_t> shadowCasterIdxs_; // Index in shadowCasters_ by ID
+    bool hasAmbientLight_ = false;
+    Colour ambientLight_;
+    std::unordered_map<int32_t, std::shared_ptr<const Geometry>> geometries_;
+    std::unordered_map<int32_t, std::shared_ptr<const Texture>> textures_;
+  };
+
+}
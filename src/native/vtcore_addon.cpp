@@ -0,0 +1,447 @@
+// Node addon exposing the native voxel tracer core (see vtcore.h) to the render procs, loaded through
+// src/VoxelTracer/RenderProc/VTRPNativeScene.js.
+
+#include <node_api.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include "vtcore.h"
+
+#define NAPI_CALL(env, call) \
+  do { if ((call) != napi_ok) { napi_throw_error((env), nullptr, "N-API call failed: " #call); return nullptr; } } while (0)
+
+static const size_t MAX_ARGS = 8;
+
+// Layout of the Float64Array that materials are passed in (see VTRPNativeScene._materialParams)
+enum MaterialParam {
+  MATERIAL_PARAM_TYPE = 0, MATERIAL_PARAM_COLOUR = 1, MATERIAL_PARAM_EMISSIVE = 4, MATERIAL_PARAM_ALPHA = 7,
+  MATERIAL_PARAM_REFLECT = 8, MATERIAL_PARAM_TEXTURE_ID = 9, NUM_MATERIAL_PARAMS = 10
+};
+
+// Reads the arguments of a method and the scene that it was called on, throwing a JS error and returning false when
+// there are too few of them
+static bool getArgs(napi_env env, napi_callback_info info, size_t numArgs, const char* funcName, napi_value* args,
+                    vtcore::Scene** scene) {
+  size_t argc = MAX_ARGS;
+  napi_value thisArg;
+  if (napi_get_cb_info(env, info, &argc, args, &thisArg, nullptr) != napi_ok) {
+    napi_throw_error(env, nullptr, "Failed to get the arguments.");
+    return false;
+  }
+  if (argc < numArgs) {
+    char message[64];
+    snprintf(message, sizeof(message), "%s expects %d arguments.", funcName, static_cast<int>(numArgs));
+    napi_throw_type_error(env, nullptr, message);
+    return false;
+  }
+  if (napi_unwrap(env, thisArg, reinterpret_cast<void**>(scene)) != napi_ok) {
+    napi_throw_type_error(env, nullptr, "Expected to be called on a Scene.");
+    return false;
+  }
+  return true;
+}
+
+static bool isNullArg(napi_env env, napi_value value) {
+  napi_valuetype type;
+  return napi_typeof(env, value, &type) == napi_ok && (type == napi_null || type == napi_undefined);
+}
+
+// Reads a typed array of one of the given types (the type it turned out to be goes in type)
+static bool getTypedArrayArg(napi_env env, napi_value value, std::initializer_list<napi_typedarray_type> types,
+                             const char* message, void** data, size_t* length, napi_typedarray_type* type) {
+  bool isTypedArray = false;
+  if (napi_is_typedarray(env, value, &isTypedArray) != napi_ok || !isTypedArray ||
+      napi_get_typedarray_info(env, value, type, length, data, nullptr, nullptr) != napi_ok ||
+      std::find(types.begin(), types.end(), *type) == types.end()) {
+    napi_throw_type_error(env, nullptr, message);
+    return false;
+  }
+  return true;
+}
+
+// Reads a Float64Array of parameters, it has to hold at least numParams of them
+static bool getParamsArg(napi_env env, napi_value value, size_t numParams, double** params) {
+  size_t length = 0;
+  napi_typedarray_type type;
+  if (!getTypedArrayArg(env, value, { napi_float64_array }, "Parameters must be a Float64Array.",
+                        reinterpret_cast<void**>(params), &length, &type)) {
+    return false;
+  }
+  if (length < numParams) {
+    napi_throw_range_error(env, nullptr, "Too few parameters.");
+    return false;
+  }
+  return true;
+}
+
+static bool getInt32Arg(napi_env env, napi_value value, int32_t* result) {
+  if (napi_get_value_int32(env, value, result) != napi_ok) {
+    napi_throw_type_error(env, nullptr, "Expected a number.");
+    return false;
+  }
+  return true;
+}
+
+static bool getMaterialArg(napi_env env, napi_value value, const vtcore::Scene& scene, vtcore::Material* material) {
+  double* params = nullptr;
+  if (!getParamsArg(env, value, NUM_MATERIAL_PARAMS, &params)) {
+    return false;
+  }
+  material->type = static_cast<int>(params[MATERIAL_PARAM_TYPE]) == vtcore::MATERIAL_EMISSION ?
+    vtcore::MATERIAL_EMISSION : vtcore::MATERIAL_LAMBERT;
+  material->colour = vtcore::Colour(params[MATERIAL_PARAM_COLOUR], params[MATERIAL_PARAM_COLOUR+1], params[MATERIAL_PARAM_COLOUR+2]);
+  material->emissive = vtcore::Colour(params[MATERIAL_PARAM_EMISSIVE], params[MATERIAL_PARAM_EMISSIVE+1], params[MATERIAL_PARAM_EMISSIVE+2]);
+  material->alpha = params[MATERIAL_PARAM_ALPHA];
+  material->reflect = params[MATERIAL_PARAM_REFLECT] != 0;
+  const int32_t textureId = static_cast<int32_t>(params[MATERIAL_PARAM_TEXTURE_ID]);
+  material->texture = (textureId >= 0) ? scene.texture(textureId) : nullptr;
+  return true;
+}
+
+static void FinalizeScene(napi_env, void* data, void*) {
+  delete static_cast<vtcore::Scene*>(data);
+}
+
+/**
+ * new Scene(xSize, ySize, zSize)
+ */
+static napi_value NewScene(napi_env env, napi_callback_info info) {
+  size_t argc = 3;
+  napi_value args[3];
+  napi_value thisArg;
+  int32_t sizes[3];
+  NAPI_CALL(env, napi_get_cb_info(env, info, &argc, args, &thisArg, nullptr));
+  if (argc < 3) {
+    napi_throw_type_error(env, nullptr, "Scene expects 3 arguments.");
+    return nullptr;
+  }
+  for (int i = 0; i < 3; i++) {
+    if (!getInt32Arg(env, args[i], &sizes[i])) { return nullptr; }
+  }
+  vtcore::Scene* scene = new vtcore::Scene(sizes[0], sizes[1], sizes[2]);
+  if (napi_wrap(env, thisArg, scene, FinalizeScene, nullptr, nullptr) != napi_ok) {
+    delete scene;
+    napi_throw_error(env, nullptr, "Failed to create the Scene.");
+    return nullptr;
+  }
+  return thisArg;
+}
+
+/**
+ * clear()
+ */
+static napi_value Clear(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  if (!getArgs(env, info, 0, "clear", args, &scene)) {
+    return nullptr;
+  }
+  scene->clear();
+  return nullptr;
+}
+
+/**
+ * clearResources()
+ */
+static napi_value ClearResources(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  if (!getArgs(env, info, 0, "clearResources", args, &scene)) {
+    return nullptr;
+  }
+  scene->clearResources();
+  return nullptr;
+}
+
+/**
+ * addGeometry(resourceId, positions, normals, uvs, index)
+ * positions/normals/uvs are Float32Arrays, normals/uvs/index may be null, the index is a Uint16Array or Uint32Array.
+ */
+static napi_value AddGeometry(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  int32_t resourceId = 0;
+  if (!getArgs(env, info, 5, "addGeometry", args, &scene) || !getInt32Arg(env, args[0], &resourceId)) {
+    return nullptr;
+  }
+
+  void* attributes[3] = { nullptr, nullptr, nullptr };
+  size_t lengths[3] = { 0, 0, 0 };
+  napi_typedarray_type type;
+  for (int i = 0; i < 3; i++) {
+    if (i > 0 && isNullArg(env, args[1+i])) { continue; }
+    if (!getTypedArrayArg(env, args[1+i], { napi_float32_array }, "Geometry attributes must be Float32Arrays.",
+                          &attributes[i], &lengths[i], &type)) {
+      return nullptr;
+    }
+  }
+  const size_t numVertices = lengths[0] / 3;
+  if ((attributes[1] && lengths[1] < 3*numVertices) || (attributes[2] && lengths[2] < 2*numVertices)) {
+    napi_throw_range_error(env, nullptr, "Every vertex needs a normal and a uv.");
+    return nullptr;
+  }
+
+  std::vector<uint32_t> index;
+  bool hasIndex = !isNullArg(env, args[4]);
+  if (hasIndex) {
+    void* indexData = nullptr;
+    size_t indexLength = 0;
+    if (!getTypedArrayArg(env, args[4], { napi_uint16_array, napi_uint32_array }, "The index must be a Uint16Array or Uint32Array.",
+                          &indexData, &indexLength, &type)) {
+      return nullptr;
+    }
+    index.resize(indexLength);
+    for (size_t i = 0; i < indexLength; i++) {
+      index[i] = (type == napi_uint16_array) ? static_cast<const uint16_t*>(indexData)[i] : static_cast<const uint32_t*>(indexData)[i];
+      if (index[i] >= numVertices) {
+        napi_throw_range_error(env, nullptr, "The index refers to a vertex that doesn't exist.");
+        return nullptr;
+      }
+    }
+  }
+
+  scene->addGeometry(resourceId, std::make_shared<vtcore::Geometry>(
+    static_cast<const float*>(attributes[0]), numVertices, static_cast<const float*>(attributes[1]),
+    static_cast<const float*>(attributes[2]), hasIndex ? index.data() : nullptr, index.size()));
+  return nullptr;
+}
+
+/**
+ * addTexture(resourceId, data, [shape0, shape1, shape2, stride0, stride1, stride2, offset])
+ * data is the texture's Float32Array, indexed like an ndarray with the given shape, strides and offset.
+ */
+static napi_value AddTexture(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  int32_t resourceId = 0;
+  void* data = nullptr;
+  size_t length = 0;
+  napi_typedarray_type type;
+  double* params = nullptr;
+  if (!getArgs(env, info, 3, "addTexture", args, &scene) || !getInt32Arg(env, args[0], &resourceId) ||
+      !getTypedArrayArg(env, args[1], { napi_float32_array }, "Texture data must be a Float32Array.", &data, &length, &type) ||
+      !getParamsArg(env, args[2], 7, &params)) {
+    return nullptr;
+  }
+
+  std::shared_ptr<vtcore::Texture> texture = std::make_shared<vtcore::Texture>();
+  for (int i = 0; i < 3; i++) {
+    texture->shape[i] = static_cast<int>(params[i]);
+    texture->stride[i] = static_cast<int>(params[3+i]);
+  }
+  texture->offset = static_cast<int>(params[6]);
+
+  // Every texel that can be sampled has to be in the data
+  const long long lastIdx = texture->offset + static_cast<long long>(texture->shape[0]-1)*texture->stride[0] +
+    static_cast<long long>(texture->shape[1]-1)*texture->stride[1] + 2LL*texture->stride[2];
+  if (texture->shape[0] < 1 || texture->shape[1] < 1 || texture->shape[2] < 3 || texture->offset < 0 ||
+      texture->stride[0] < 0 || texture->stride[1] < 0 || texture->stride[2] < 0 || lastIdx >= static_cast<long long>(length)) {
+    napi_throw_range_error(env, nullptr, "The texture's shape doesn't fit its data.");
+    return nullptr;
+  }
+  texture->data.assign(static_cast<const float*>(data), static_cast<const float*>(data) + length);
+  scene->addTexture(resourceId, texture);
+  return nullptr;
+}
+
+/**
+ * setAmbientLight(r, g, b)
+ */
+static napi_value SetAmbientLight(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  double rgb[3];
+  if (!getArgs(env, info, 3, "setAmbientLight", args, &scene)) {
+    return nullptr;
+  }
+  for (int i = 0; i < 3; i++) {
+    if (napi_get_value_double(env, args[i], &rgb[i]) != napi_ok) {
+      napi_throw_type_error(env, nullptr, "Expected a number.");
+      return nullptr;
+    }
+  }
+  scene->setAmbientLight(vtcore::Colour(rgb[0], rgb[1], rgb[2]));
+  return nullptr;
+}
+
+/**
+ * removeAmbientLight()
+ */
+static napi_value RemoveAmbientLight(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  if (!getArgs(env, info, 0, "removeAmbientLight", args, &scene)) {
+    return nullptr;
+  }
+  scene->removeAmbientLight();
+  return nullptr;
+}
+
+/**
+ * setPointLight(id, [x, y, z, r, g, b, quadratic, linear])
+ */
+static napi_value SetPointLight(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  int32_t id = 0;
+  double* p = nullptr;
+  if (!getArgs(env, info, 2, "setPointLight", args, &scene) || !getInt32Arg(env, args[0], &id) ||
+      !getParamsArg(env, args[1], 8, &p)) {
+    return nullptr;
+  }
+  scene->setPointLight(id, vtcore::Vec3(p[0], p[1], p[2]), vtcore::Colour(p[3], p[4], p[5]), p[6], p[7]);
+  return nullptr;
+}
+
+/**
+ * setSpotLight(id, [x, y, z, dirX, dirY, dirZ, r, g, b, innerAngle, outerAngle, quadratic, linear])
+ */
+static napi_value SetSpotLight(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  int32_t id = 0;
+  double* p = nullptr;
+  if (!getArgs(env, info, 2, "setSpotLight", args, &scene) || !getInt32Arg(env, args[0], &id) ||
+      !getParamsArg(env, args[1], 13, &p)) {
+    return nullptr;
+  }
+  scene->setSpotLight(id, vtcore::Vec3(p[0], p[1], p[2]), vtcore::Vec3(p[3], p[4], p[5]), vtcore::Colour(p[6], p[7], p[8]),
+                      p[9], p[10], p[11], p[12]);
+  return nullptr;
+}
+
+/**
+ * setVoxel(id, [x, y, z, receivesShadow], material)
+ * The position is the voxel's world space position.
+ */
+static napi_value SetVoxel(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  int32_t id = 0;
+  double* p = nullptr;
+  vtcore::Material material;
+  if (!getArgs(env, info, 3, "setVoxel", args, &scene) || !getInt32Arg(env, args[0], &id) ||
+      !getParamsArg(env, args[1], 4, &p) || !getMaterialArg(env, args[2], *scene, &material)) {
+    return nullptr;
+  }
+  scene->setVoxel(id, vtcore::Vec3(p[0], p[1], p[2]), p[3] != 0, material);
+  return nullptr;
+}
+
+/**
+ * setFog(id, [minX, minY, minZ, maxX, maxY, maxZ, r, g, b, scattering])
+ */
+static napi_value SetFog(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  int32_t id = 0;
+  double* p = nullptr;
+  if (!getArgs(env, info, 2, "setFog", args, &scene) || !getInt32Arg(env, args[0], &id) ||
+      !getParamsArg(env, args[1], 10, &p)) {
+    return nullptr;
+  }
+  vtcore::Box box;
+  box.min = vtcore::Vec3(p[0], p[1], p[2]);
+  box.max = vtcore::Vec3(p[3], p[4], p[5]);
+  scene->setFog(id, box, vtcore::Colour(p[6], p[7], p[8]), p[9]);
+  return nullptr;
+}
+
+/**
+ * setMesh(id, geometryResourceId, matrixWorld, material)
+ * matrixWorld is a Float64Array of the 16 (column-major) elements of the mesh's world matrix.
+ */
+static napi_value SetMesh(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  int32_t id = 0, geometryId = 0;
+  double* matrixWorld = nullptr;
+  vtcore::Material material;
+  if (!getArgs(env, info, 4, "setMesh", args, &scene) || !getInt32Arg(env, args[0], &id) ||
+      !getInt32Arg(env, args[1], &geometryId) || !getParamsArg(env, args[2], 16, &matrixWorld) ||
+      !getMaterialArg(env, args[3], *scene, &material)) {
+    return nullptr;
+  }
+  scene->setMesh(id, scene->geometry(geometryId), matrixWorld, material);
+  return nullptr;
+}
+
+/**
+ * remove(id)
+ */
+static napi_value Remove(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  int32_t id = 0;
+  if (!getArgs(env, info, 1, "remove", args, &scene) || !getInt32Arg(env, args[0], &id)) {
+    return nullptr;
+  }
+  scene->remove(id);
+  return nullptr;
+}
+
+/**
+ * renderWorkItems(workItems, startItem, endItem, renderBuffer, lightingCacheValid)
+ * workItems is an Int32Array of (voxel index, renderable ID) pairs, see VTRPScene.renderWorkItems.
+ */
+static napi_value RenderWorkItems(napi_env env, napi_callback_info info) {
+  napi_value args[MAX_ARGS];
+  vtcore::Scene* scene = nullptr;
+  void* workItems = nullptr;
+  void* renderBuffer = nullptr;
+  void* valid = nullptr;
+  size_t workItemsLength = 0, renderBufferLength = 0, validLength = 0;
+  napi_typedarray_type type;
+  int32_t startItem = 0, endItem = 0;
+  if (!getArgs(env, info, 5, "renderWorkItems", args, &scene) ||
+      !getTypedArrayArg(env, args[0], { napi_int32_array }, "Work items must be an Int32Array.", &workItems, &workItemsLength, &type) ||
+      !getInt32Arg(env, args[1], &startItem) || !getInt32Arg(env, args[2], &endItem) ||
+      !getTypedArrayArg(env, args[3], { napi_float32_array }, "The render buffer must be a Float32Array.", &renderBuffer, &renderBufferLength, &type) ||
+      !getTypedArrayArg(env, args[4], { napi_uint8_array }, "The lighting cache must be a Uint8Array.", &valid, &validLength, &type)) {
+    return nullptr;
+  }
+  if (startItem < 0 || endItem < startItem || static_cast<size_t>(endItem)*2 > workItemsLength) {
+    napi_throw_range_error(env, nullptr, "The work items are out of range.");
+    return nullptr;
+  }
+  const int32_t* items = static_cast<const int32_t*>(workItems);
+  for (int32_t i = startItem; i < endItem; i++) {
+    if (items[2*i] < 0 || static_cast<size_t>(items[2*i]) >= validLength || static_cast<size_t>(items[2*i])*3 + 3 > renderBufferLength) {
+      napi_throw_range_error(env, nullptr, "A work item's voxel is outside of the render buffer.");
+      return nullptr;
+    }
+  }
+
+  scene->renderWorkItems(items, startItem, endItem, static_cast<float*>(renderBuffer), static_cast<uint8_t*>(valid));
+  return nullptr;
+}
+
+static napi_value Init(napi_env env, napi_value exports) {
+  napi_property_descriptor methods[] = {
+    { "clear", nullptr, Clear, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "clearResources", nullptr, ClearResources, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "addGeometry", nullptr, AddGeometry, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "addTexture", nullptr, AddTexture, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "setAmbientLight", nullptr, SetAmbientLight, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "removeAmbientLight", nullptr, RemoveAmbientLight, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "setPointLight", nullptr, SetPointLight, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "setSpotLight", nullptr, SetSpotLight, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "setVoxel", nullptr, SetVoxel, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "setFog", nullptr, SetFog, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "setMesh", nullptr, SetMesh, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "remove", nullptr, Remove, nullptr, nullptr, nullptr, napi_default, nullptr },
+    { "renderWorkItems", nullptr, RenderWorkItems, nullptr, nullptr, nullptr, napi_default, nullptr },
+  };
+  napi_value sceneClass;
+  NAPI_CALL(env, napi_define_class(env, "Scene", NAPI_AUTO_LENGTH, NewScene, nullptr,
+                                   sizeof(methods)/sizeof(methods[0]), methods, &sceneClass));
+  NAPI_CALL(env, napi_set_named_property(env, exports, "Scene", sceneClass));
+  return exports;
+}
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, Init)
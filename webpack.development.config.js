@@ -82,4 +82,16 @@ const renderChildConfig = {...commonConfig,
   },
 };
 
-module.exports = [webClientViewerConfig, webClientControllerConfig, serverConfig, renderChildConfig];
\ No newline at end of file
+const slaveWriterConfig = {...commonConfig,
+  target: 'node',
+  externals: [nodeExternals()],
+  entry: {
+    slavewriterproc: './src/Server/SlaveWriter/slavewriterprocess.js',
+  },
+  output: {
+    filename: 'slavewriterproc.js',
+    path: distPath,
+  },
+};
+
+module.exports = [webClientViewerConfig, webClientControllerConfig, serverConfig, renderChildConfig, slaveWriterConfig];
\ No newline at end of file
@@ -76,4 +76,16 @@ const renderChildConfig = {...commonConfig,
   },
 };
 
-module.exports = [webClientViewerConfig, webClientControllerConfig, serverConfig, renderChildConfig];
+const slaveWriterConfig = {...commonConfig,
+  target: 'node',
+  externals: [nodeExternals()],
+  entry: {
+    slavewriterproc: './src/Server/SlaveWriter/slavewriterprocess.js',
+  },
+  output: {
+    filename: 'slavewriterproc.js',
+    path: distPath,
+  },
+};
+
+module.exports = [webClientViewerConfig, webClientControllerConfig, serverConfig, renderChildConfig, slaveWriterConfig];